@@ -0,0 +1,99 @@
+#pragma once
+
+#include "ImageAsset.h"
+#include "MeshAsset.h"
+#include "TextureAsset.h"
+
+#include <Core/BoundedQueue.h>
+#include <Core/JobSystem.h>
+
+#include <glm/glm.hpp>
+
+#include <atomic>
+#include <filesystem>
+#include <mutex>
+#include <optional>
+#include <vector>
+
+namespace VKRE {
+
+    using AssetID = uint64_t;
+
+    enum class AssetType {
+        MESH, TEXTURE
+    };
+
+    struct AssetRequest {
+        std::filesystem::path path;
+        AssetType type = AssetType::TEXTURE;
+
+        // Where the asset is needed in the world, used to load whatever the camera is about to see first
+        glm::vec3 position{ 0.0f };
+        float radius = 1.0f;
+        float bias = 0.0f; // Added to the computed priority, e.g. to force UI textures ahead of everything
+    };
+
+    struct DecodedAsset {
+        AssetID id = 0;
+        AssetType type = AssetType::TEXTURE;
+        std::filesystem::path path;
+
+        std::optional<MeshAsset> mesh;
+        std::optional<DecodedImage> image;
+        std::optional<TextureAsset> texture; // Cooked (.vktex) textures skip decoding entirely
+
+        bool IsValid() const { return mesh.has_value() || image.has_value() || texture.has_value(); }
+    };
+
+    // Loads and decodes assets on the job system workers and hands the results to the uploader through a bounded queue.
+    // Requests are not ordered when they are made, each worker picks the most important pending request when it starts,
+    // so moving the camera reorders everything that hasn't started decoding yet.
+    // Only as many decodes are submitted as the queue has room left for, the rest wait here until the uploader pops. Workers are
+    // shared with the frame's jobs, none of them is ever left waiting on the uploader.
+    class AssetPipeline {
+    public:
+        AssetPipeline(JobSystem& jobSystem, size_t uploadQueueCapacity = 16);
+        ~AssetPipeline();
+
+        AssetID Request(AssetRequest&& request);
+        void SetCamera(const glm::vec3& position, const glm::vec3& forward);
+
+        // Called from the thread that owns the GPU upload, never blocks
+        std::optional<DecodedAsset> PopDecoded();
+
+        uint32_t GetPendingCount() const { return mPendingCount.load(std::memory_order_relaxed); }
+        bool IsIdle() const { return GetPendingCount() == 0 && mDecodedQueue.GetSize() == 0; }
+
+    private:
+        struct PendingRequest {
+            AssetID id;
+            AssetRequest request;
+            float priority;
+
+            bool operator<(const PendingRequest& other) const { return priority < other.priority; }
+        };
+
+        float ComputePriority(const AssetRequest& request) const;
+        std::optional<PendingRequest> PopMostImportant();
+        void ProcessNext();
+        // Submits a job for every pending request that has a place in the decoded queue and no job yet
+        void SubmitJobs();
+
+    private:
+        JobSystem& mJobSystem;
+        BoundedQueue<DecodedAsset> mDecodedQueue;
+
+        std::mutex mPendingMutex;
+        std::vector<PendingRequest> mPending; // Max-heap on priority
+        bool mPrioritiesDirty = false;
+        size_t mScheduledJobs = 0; // Submitted, but haven't picked their request yet
+        size_t mInFlight = 0;      // Jobs submitted or running plus decoded assets not popped yet, never more than the queue's capacity
+        glm::vec3 mCameraPosition{ 0.0f };
+        glm::vec3 mCameraForward{ 0.0f, 0.0f, -1.0f };
+
+        AssetID mNextID = 1;
+        std::atomic<uint32_t> mPendingCount{ 0 };
+        std::atomic<uint32_t> mOutstandingJobs{ 0 };
+    };
+
+}
@@ -0,0 +1,21 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <optional>
+
+namespace VKRE {
+
+    // A source image (png, jpg, tga, ...) decoded to tightly packed RGBA8
+    struct DecodedImage {
+        uint32_t width = 0;
+        uint32_t height = 0;
+        std::unique_ptr<uint8_t, void(*)(void*)> pixels{ nullptr, nullptr };
+
+        size_t GetSize() const { return static_cast<size_t>(width) * height * 4; }
+    };
+
+    std::optional<DecodedImage> DecodeImage(const std::filesystem::path& path);
+
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#include "MeshFormat.h"
+
+#include <Core/MappedFile.h>
+
+#include <filesystem>
+#include <optional>
+#include <span>
+
+namespace VKRE {
+
+    // A cooked mesh mapped into memory. Nothing is parsed or converted; the accessors are views into the mapping.
+    class MeshAsset {
+    public:
+        static std::optional<MeshAsset> Load(const std::filesystem::path& path);
+
+        const MeshFormat::FileHeader& GetHeader() const { return *mHeader; }
+        const MeshFormat::Bounds& GetBounds() const { return mHeader->bounds; }
+
+        std::span<const MeshFormat::Submesh> GetSubmeshes() const;
+        std::span<const MeshFormat::Vertex> GetVertices() const;
+        std::span<const uint32_t> GetIndices() const;
+        std::span<const MeshFormat::Meshlet> GetMeshlets() const;
+        std::span<const uint32_t> GetMeshletVertices() const;
+        std::span<const uint32_t> GetMeshletTriangles() const;
+        std::span<const MeshFormat::Lod> GetLods() const;
+        std::span<const MeshFormat::LodRange> GetLodRanges() const;
+
+        std::span<const std::byte> GetSectionData(MeshFormat::SectionType type) const;
+        const MeshFormat::Section* FindSection(MeshFormat::SectionType type) const;
+
+        void Prefetch() const { mFile.Prefetch(); }
+
+    private:
+        MeshAsset() = default;
+
+        // A section cooked with another layout of T reads as missing rather than as garbage. The mapping is page aligned, so the offset
+        // is all that decides the alignment.
+        template <typename T> std::span<const T> GetSectionAs(MeshFormat::SectionType type) const {
+            const MeshFormat::Section* section = FindSection(type);
+            if (!section || section->elementSize != sizeof(T) || section->offset % alignof(T) != 0)
+                return {};
+            std::span<const std::byte> data = mFile.GetRange(section->offset, section->size);
+            return std::span<const T>(reinterpret_cast<const T*>(data.data()), section->elementCount);
+        }
+
+    private:
+        MappedFile mFile;
+        const MeshFormat::FileHeader* mHeader = nullptr;
+        std::span<const MeshFormat::Section> mSections;
+    };
+
+}
@@ -0,0 +1,115 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+
+// Binary layout of cooked meshes (.vkmesh). Shared between the offline cooker and the runtime loader, so it must not depend on Vulkan.
+// A file is a FileHeader followed by a table of sections. Every section is aligned to MESH_SECTION_ALIGNMENT and its bytes are already in the
+// layout the GPU consumes, so loading a section is a single memcpy from the mapped file into staging memory.
+namespace VKRE::MeshFormat {
+
+    inline constexpr uint32_t MESH_FILE_MAGIC = 0x48534D56; // "VMSH"
+    inline constexpr uint32_t MESH_FILE_VERSION = 3;
+    inline constexpr uint32_t MESH_SECTION_ALIGNMENT = 16;
+
+    // Small enough that one 64 wide culling workgroup writes a whole meshlet, at most two triangles per invocation
+    inline constexpr uint32_t MAX_MESHLET_VERTICES = 64;
+    inline constexpr uint32_t MAX_MESHLET_TRIANGLES = 124;
+
+    inline constexpr uint32_t MAX_MESH_LODS = 8;
+
+    // Interleaved so that it can be read as a std430 array through a buffer device address
+    struct Vertex {
+        glm::vec3 position;
+        float uvX;
+        glm::vec3 normal;
+        float uvY;
+        glm::vec4 color;
+    };
+    static_assert(sizeof(Vertex) == 48, "Vertex must match the std430 layout used by the shaders");
+
+    struct Bounds {
+        glm::vec3 center;
+        float radius;
+        glm::vec3 extents;
+        float padding;
+    };
+    static_assert(sizeof(Bounds) == 32);
+
+    struct Submesh {
+        uint32_t firstIndex;
+        uint32_t indexCount;
+        int32_t vertexOffset;
+        uint32_t materialIndex;
+        uint32_t firstMeshlet;
+        uint32_t meshletCount;
+        uint32_t padding[2];
+        Bounds bounds;
+    };
+    static_assert(sizeof(Submesh) == 64);
+
+    // A cluster of at most MAX_MESHLET_TRIANGLES triangles over at most MAX_MESHLET_VERTICES vertices, laid out for std430.
+    // The cone is the spread of the triangle normals: the whole meshlet faces away from the camera when
+    // dot(center - camera, coneAxis) >= coneCutoff * length(center - camera) + radius. A cutoff of 1 means it can never be cone culled.
+    struct Meshlet {
+        glm::vec3 center;
+        float radius;
+        glm::vec3 coneAxis;
+        float coneCutoff;
+        uint32_t vertexOffset;   // Into the MESHLET_VERTICES section, which holds indices into the vertex buffer
+        uint32_t triangleOffset; // Into the MESHLET_TRIANGLES section, one uint32_t per triangle with three 8-bit meshlet local vertex indices
+        uint32_t vertexCount;
+        uint32_t triangleCount;
+    };
+    static_assert(sizeof(Meshlet) == 48, "Meshlet must match the std430 layout used by the shaders");
+
+    // One level of detail of the whole mesh, level 0 being the original triangles. Every submesh has an index range per level, the one
+    // of submesh i at level l is LOD_RANGES[l * submeshCount + i]. Simplified levels reuse the submesh's vertices and only add indices.
+    struct Lod {
+        float error;            // How far the level's surface may stray from the original, in object space units
+        uint32_t triangleCount; // Over all submeshes
+    };
+    static_assert(sizeof(Lod) == 8);
+
+    struct LodRange {
+        uint32_t firstIndex;    // Relative like Submesh::firstIndex, vertices are still offset by the submesh's vertexOffset
+        uint32_t indexCount;
+    };
+    static_assert(sizeof(LodRange) == 8);
+
+    enum class SectionType : uint32_t {
+        SUBMESHES = 0,
+        VERTICES = 1,
+        INDICES = 2,
+        MESHLETS = 3,
+        MESHLET_VERTICES = 4,
+        MESHLET_TRIANGLES = 5,
+        LODS = 6,
+        LOD_RANGES = 7,
+    };
+
+    struct Section {
+        SectionType type;
+        uint32_t elementSize;
+        uint64_t elementCount;
+        uint64_t offset; // From the start of the file
+        uint64_t size;   // In bytes
+    };
+    static_assert(sizeof(Section) == 32);
+
+    struct FileHeader {
+        uint32_t magic;
+        uint32_t version;
+        uint32_t sectionCount;
+        uint32_t flags;
+        Bounds bounds;
+        // Followed by sectionCount Section entries
+    };
+    static_assert(sizeof(FileHeader) == 48);
+
+    constexpr uint64_t AlignSectionOffset(uint64_t offset) {
+        return (offset + MESH_SECTION_ALIGNMENT - 1) & ~static_cast<uint64_t>(MESH_SECTION_ALIGNMENT - 1);
+    }
+
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+#include "TextureFormat.h"
+
+#include <Core/MappedFile.h>
+
+#include <filesystem>
+#include <optional>
+#include <span>
+
+namespace VKRE {
+
+    // A cooked texture mapped into memory. Nothing is decoded, the mip accessors are views into the mapping.
+    class TextureAsset {
+    public:
+        static std::optional<TextureAsset> Load(const std::filesystem::path& path);
+
+        const TextureFormat::FileHeader& GetHeader() const { return *mHeader; }
+        TextureFormat::PixelFormat GetFormat() const { return mHeader->format; }
+        bool IsSRGB() const { return mHeader->flags & TextureFormat::TEXTURE_FLAG_SRGB; }
+        uint32_t GetWidth() const { return mHeader->width; }
+        uint32_t GetHeight() const { return mHeader->height; }
+        uint32_t GetMipCount() const { return mHeader->mipCount; }
+
+        std::span<const TextureFormat::MipLevel> GetMipLevels() const { return mMipLevels; }
+        std::span<const std::byte> GetMipData(uint32_t mip) const;
+
+        // Mips are stored back to back, so any run of them is a single contiguous range of the file
+        std::span<const std::byte> GetMipRangeData(uint32_t firstMip, uint32_t mipCount) const;
+
+        void Prefetch() const { mFile.Prefetch(); }
+        void PrefetchMips(uint32_t firstMip, uint32_t mipCount) const;
+
+    private:
+        TextureAsset() = default;
+
+    private:
+        MappedFile mFile;
+        const TextureFormat::FileHeader* mHeader = nullptr;
+        std::span<const TextureFormat::MipLevel> mMipLevels;
+    };
+
+}
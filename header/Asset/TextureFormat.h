@@ -0,0 +1,92 @@
+#pragma once
+
+#include <cstdint>
+
+// Binary layout of cooked textures (.vktex). Shared between the offline cooker and the runtime loader, so it must not depend on Vulkan.
+// A file is a FileHeader followed by mipCount MipLevel entries and the mip data, largest mip first. Every mip is stored exactly as
+// vkCmdCopyBufferToImage expects it (tightly packed rows of 4x4 blocks for the block-compressed formats) at an aligned offset,
+// so uploading is a memcpy of the mapped file into staging memory followed by one copy region per mip.
+namespace VKRE::TextureFormat {
+
+    inline constexpr uint32_t TEXTURE_FILE_MAGIC = 0x58455456; // "VTEX"
+    inline constexpr uint32_t TEXTURE_FILE_VERSION = 1;
+    inline constexpr uint32_t TEXTURE_DATA_ALIGNMENT = 16; // Multiple of every block size, as required for buffer to image copies
+
+    enum class PixelFormat : uint32_t {
+        RGBA8 = 0,
+        BC1 = 1, // RGB, 4 bpp
+        BC3 = 2, // RGBA, 8 bpp
+        BC4 = 3, // R, 4 bpp
+        BC5 = 4, // RG, 8 bpp, used for tangent space normal maps
+        BC7 = 5, // RGBA, 8 bpp
+    };
+
+    enum FileFlags : uint32_t {
+        TEXTURE_FLAG_SRGB = 1 << 0,
+    };
+
+    struct MipLevel {
+        uint32_t width;
+        uint32_t height;
+        uint64_t offset; // From the start of the file
+        uint64_t size;   // In bytes
+    };
+    static_assert(sizeof(MipLevel) == 24);
+
+    struct FileHeader {
+        uint32_t magic;
+        uint32_t version;
+        PixelFormat format;
+        uint32_t flags;
+        uint32_t width;
+        uint32_t height;
+        uint32_t mipCount;
+        uint32_t padding;
+        // Followed by mipCount MipLevel entries
+    };
+    static_assert(sizeof(FileHeader) == 32);
+
+    constexpr bool IsBlockCompressed(PixelFormat format) {
+        return format != PixelFormat::RGBA8;
+    }
+
+    // Bytes per 4x4 block for the compressed formats, bytes per pixel otherwise
+    constexpr uint32_t GetBlockSize(PixelFormat format) {
+        switch (format) {
+            case PixelFormat::BC1:
+            case PixelFormat::BC4:
+                return 8;
+            case PixelFormat::BC3:
+            case PixelFormat::BC5:
+            case PixelFormat::BC7:
+                return 16;
+            case PixelFormat::RGBA8:
+                return 4;
+        }
+        return 0;
+    }
+
+    constexpr uint64_t GetMipSize(PixelFormat format, uint32_t width, uint32_t height) {
+        if (!IsBlockCompressed(format))
+            return static_cast<uint64_t>(width) * height * GetBlockSize(format);
+
+        uint64_t blocksX = (width + 3) / 4;
+        uint64_t blocksY = (height + 3) / 4;
+        return blocksX * blocksY * GetBlockSize(format);
+    }
+
+    constexpr uint32_t GetMaxMipCount(uint32_t width, uint32_t height) {
+        uint32_t count = 1;
+        while (width > 1 || height > 1) {
+            width = width > 1 ? width / 2 : 1;
+            height = height > 1 ? height / 2 : 1;
+            count++;
+        }
+        return count;
+    }
+
+    constexpr uint64_t AlignDataOffset(uint64_t offset) {
+        return (offset + TEXTURE_DATA_ALIGNMENT - 1) & ~static_cast<uint64_t>(TEXTURE_DATA_ALIGNMENT - 1);
+    }
+
+}
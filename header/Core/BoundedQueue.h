@@ -0,0 +1,82 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <mutex>
+#include <optional>
+
+namespace VKRE {
+
+    // Multi-producer, multi-consumer FIFO with a fixed capacity. Producers block in Push() while it is full, which is what keeps
+    // the amount of decoded-but-not-yet-consumed data bounded.
+    template <typename T> class BoundedQueue {
+    public:
+        explicit BoundedQueue(size_t capacity)
+            :mCapacity(capacity > 0 ? capacity : 1) {}
+
+        // Returns false without pushing if the queue was closed while waiting
+        bool Push(T&& value) {
+            std::unique_lock lock(mMutex);
+            mNotFull.wait(lock, [this]() { return mClosed || mItems.size() < mCapacity; });
+            if (mClosed)
+                return false;
+
+            mItems.push_back(std::move(value));
+            lock.unlock();
+            mNotEmpty.notify_one();
+            return true;
+        }
+
+        std::optional<T> TryPop() {
+            std::unique_lock lock(mMutex);
+            if (mItems.empty())
+                return std::nullopt;
+
+            T value = std::move(mItems.front());
+            mItems.pop_front();
+            lock.unlock();
+            mNotFull.notify_one();
+            return value;
+        }
+
+        std::optional<T> Pop() {
+            std::unique_lock lock(mMutex);
+            mNotEmpty.wait(lock, [this]() { return mClosed || !mItems.empty(); });
+            if (mItems.empty())
+                return std::nullopt;
+
+            T value = std::move(mItems.front());
+            mItems.pop_front();
+            lock.unlock();
+            mNotFull.notify_one();
+            return value;
+        }
+
+        // Wakes up every blocked producer and consumer, items already queued can still be popped
+        void Close() {
+            {
+                std::lock_guard lock(mMutex);
+                mClosed = true;
+            }
+            mNotFull.notify_all();
+            mNotEmpty.notify_all();
+        }
+
+        size_t GetSize() const {
+            std::lock_guard lock(mMutex);
+            return mItems.size();
+        }
+
+        size_t GetCapacity() const { return mCapacity; }
+
+    private:
+        const size_t mCapacity;
+        std::deque<T> mItems;
+        mutable std::mutex mMutex;
+        std::condition_variable mNotFull;
+        std::condition_variable mNotEmpty;
+        bool mClosed = false;
+    };
+
+}
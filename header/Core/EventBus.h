@@ -0,0 +1,106 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <type_traits>
+#include <vector>
+
+namespace VKRE {
+
+    struct EventBusSpecs {
+        size_t arenaSize = 64 * 1024; // Bytes of events a frame can hold, events posted past that are dropped
+    };
+
+    // Typed events posted from any thread and delivered on the thread that calls Dispatch, once per frame.
+    //
+    // Events are copied into one of two arenas, a reservation is a single fetch_add on an atomic that packs the arena index with the
+    // write offset, so posting never locks or allocates. Dispatch swaps the arenas with one exchange on the same atomic and delivers
+    // the old one in posting order, waiting on each event's ready flag for producers that are still copying. Events must be trivially
+    // copyable, and since they live in the arena they can't own anything.
+    //
+    // Handlers are plain function pointers with a user pointer, kept per event type and registered up front, usually by a subsystem's
+    // constructor. Subscribe and Unsubscribe must not be called while Dispatch runs.
+    class EventBus {
+    public:
+        explicit EventBus(const EventBusSpecs& specs = {});
+        ~EventBus() = default;
+
+        EventBus(const EventBus&) = delete;
+        EventBus& operator=(const EventBus&) = delete;
+
+        template <typename Event> void Subscribe(void (*handler)(const Event&, void*), void* userData = nullptr) {
+            AddHandler(GetEventTypeID<Event>(), [](const void* event, void (*function)(), void* userData) {
+                reinterpret_cast<void (*)(const Event&, void*)>(function)(*static_cast<const Event*>(event), userData);
+            }, reinterpret_cast<void (*)()>(handler), userData);
+        }
+
+        // Subscribes a member function, e.g. Subscribe<WindowFocusEvent, &Window::OnFocus>(this)
+        template <typename Event, auto Method, typename Object> void Subscribe(Object* object) {
+            AddHandler(GetEventTypeID<Event>(), [](const void* event, void (*)(), void* userData) {
+                (static_cast<Object*>(userData)->*Method)(*static_cast<const Event*>(event));
+            }, nullptr, object);
+        }
+
+        // Removes every handler of the event type registered with userData
+        template <typename Event> void Unsubscribe(void* userData) { RemoveHandlers(GetEventTypeID<Event>(), userData); }
+
+        // Thread safe and lock free. Returns false when this frame's arena is full and the event was dropped.
+        template <typename Event> bool Post(const Event& event) {
+            static_assert(std::is_trivially_copyable_v<Event>, "Events are copied into the arena byte for byte");
+            static_assert(alignof(Event) <= RECORD_ALIGNMENT);
+            return Post(GetEventTypeID<Event>(), &event, sizeof(Event));
+        }
+
+        // Delivers everything posted before the call, in posting order. Events posted by the handlers go out next Dispatch.
+        void Dispatch();
+
+        uint64_t GetDroppedCount() const { return mDroppedCount.load(std::memory_order_relaxed); }
+
+    private:
+        static constexpr size_t RECORD_ALIGNMENT = 16;
+
+        struct alignas(RECORD_ALIGNMENT) RecordHeader {
+            std::atomic<uint32_t> ready; // Set last, with release, by the producer
+            uint32_t type;
+            uint32_t size;               // Payload bytes, the record takes the header plus the payload rounded up
+            uint32_t padding;
+        };
+        static_assert(sizeof(RecordHeader) == RECORD_ALIGNMENT);
+
+        // Type IDs are handed out on first use, they index mHandlers
+        static inline std::atomic<uint32_t> sNextEventTypeID{ 0 };
+        template <typename Event> static uint32_t GetEventTypeID() {
+            static const uint32_t id = sNextEventTypeID.fetch_add(1, std::memory_order_relaxed);
+            return id;
+        }
+
+        // Written into a record that ran past the end of the arena, nothing after it was written either
+        static constexpr uint32_t END_OF_ARENA = ~0u;
+
+        // Calls function, the subscribed handler with its type erased, or the member function baked into the invoker
+        using Invoker = void (*)(const void* event, void (*function)(), void* userData);
+
+        bool Post(uint32_t type, const void* event, uint32_t size);
+        void AddHandler(uint32_t type, Invoker invoker, void (*function)(), void* userData);
+        void RemoveHandlers(uint32_t type, void* userData);
+
+    private:
+        struct Subscription {
+            Invoker invoker;
+            void (*function)();
+            void* userData;
+        };
+
+        size_t mArenaSize;
+        std::unique_ptr<std::byte[]> mArenas[2];
+        // Arena index in the high 32 bits, write offset in the low ones
+        std::atomic<uint64_t> mWriteState{ 0 };
+        std::atomic<uint64_t> mDroppedCount{ 0 };
+
+        std::vector<std::vector<Subscription>> mHandlers; // By event type ID
+    };
+
+}
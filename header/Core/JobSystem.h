@@ -0,0 +1,61 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+
+namespace VKRE {
+
+    // Fixed pool of worker threads pulling from a single priority queue. Jobs with a higher priority run first, equal priorities run in submission order.
+    class JobSystem {
+    public:
+        using Job = std::function<void()>;
+
+        explicit JobSystem(uint32_t workerCount = 0); // 0 uses one worker per hardware thread, minus the calling thread
+        ~JobSystem();
+
+        JobSystem(const JobSystem&) = delete;
+        JobSystem& operator=(const JobSystem&) = delete;
+
+        void Submit(Job&& job, float priority = 0.0f);
+
+        // Splits [0, count) into batches, runs them on the workers and the calling thread and returns once all of them are done
+        void ParallelFor(uint32_t count, uint32_t batchSize, const std::function<void(uint32_t begin, uint32_t end)>& function);
+
+        void WaitIdle();
+        uint32_t GetWorkerCount() const { return static_cast<uint32_t>(mWorkers.size()); }
+
+    private:
+        struct QueuedJob {
+            float priority;
+            uint64_t sequence;
+            Job job;
+
+            bool operator<(const QueuedJob& other) const {
+                if (priority != other.priority)
+                    return priority < other.priority;
+                return sequence > other.sequence;
+            }
+        };
+
+        void WorkerLoop();
+        bool TryRunOne();
+
+    private:
+        std::vector<std::thread> mWorkers;
+        std::priority_queue<QueuedJob> mJobs;
+        std::mutex mMutex;
+        std::condition_variable mJobAvailable;
+        std::condition_variable mIdle;
+
+        uint64_t mNextSequence = 0;
+        uint32_t mActiveJobs = 0;
+        bool mShuttingDown = false;
+    };
+
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <span>
+
+namespace VKRE {
+
+    // Read-only memory mapping of a whole file. Cooked assets are laid out so that their streams can be copied straight out of this mapping.
+    class MappedFile {
+    public:
+        MappedFile() = default;
+        ~MappedFile();
+
+        MappedFile(const MappedFile&) = delete;
+        MappedFile& operator=(const MappedFile&) = delete;
+        MappedFile(MappedFile&& other) noexcept;
+        MappedFile& operator=(MappedFile&& other) noexcept;
+
+        bool Open(const std::filesystem::path& path);
+        void Close();
+
+        // Asks the OS to read the whole mapping in ahead of time, so that the copy out of it doesn't stall on page faults
+        void Prefetch() const;
+        void Prefetch(uint64_t offset, uint64_t size) const;
+
+        bool IsOpen() const { return mData != nullptr; }
+        const std::byte* GetData() const { return mData; }
+        size_t GetSize() const { return mSize; }
+
+        std::span<const std::byte> GetRange(uint64_t offset, uint64_t size) const {
+            if (offset > mSize || size > mSize - offset)
+                return {};
+            return std::span<const std::byte>(mData + offset, size);
+        }
+
+    private:
+        const std::byte* mData = nullptr;
+        size_t mSize = 0;
+
+        #ifdef _WIN32
+        void* mFileHandle = nullptr;
+        void* mMappingHandle = nullptr;
+        #else
+        int mFileDescriptor = -1;
+        #endif
+    };
+
+}
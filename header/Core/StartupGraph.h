@@ -0,0 +1,79 @@
+#pragma once
+
+#include "JobSystem.h"
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <initializer_list>
+#include <mutex>
+#include <queue>
+#include <string>
+#include <vector>
+
+namespace VKRE {
+
+    using StartupStageID = uint32_t;
+
+    enum class StartupThread {
+        ANY,  // Runs on a job system worker
+        MAIN  // Runs on the thread that called Run, for APIs such as GLFW's window functions that must stay there
+    };
+
+    struct StartupStageTiming {
+        std::string name;
+        std::chrono::duration<double, std::milli> start;    // Since Run was called
+        std::chrono::duration<double, std::milli> duration;
+        StartupThread thread;
+    };
+
+    // Startup work split into stages that run as soon as the stages they depend on are done, so independent ones overlap. Stages can
+    // only depend on stages added before them, which keeps the graph acyclic. Every stage is timed, see GetTimings and PrintReport.
+    class StartupGraph {
+    public:
+        explicit StartupGraph(JobSystem& jobSystem) :mJobSystem(jobSystem) {}
+
+        StartupGraph(const StartupGraph&) = delete;
+        StartupGraph& operator=(const StartupGraph&) = delete;
+
+        StartupStageID AddStage(std::string name, std::initializer_list<StartupStageID> dependencies, std::function<void()>&& function, StartupThread thread = StartupThread::ANY);
+
+        // Runs every stage once and returns when all of them are done. Main thread stages are run here while waiting.
+        void Run();
+
+        std::vector<StartupStageTiming> GetTimings() const;
+        std::chrono::duration<double, std::milli> GetTotalTime() const { return mTotalTime; }
+        void PrintReport() const;
+
+    private:
+        struct Stage {
+            std::string name;
+            std::function<void()> function;
+            StartupThread thread;
+            std::vector<StartupStageID> dependents;
+            uint32_t remainingDependencies = 0;
+
+            std::chrono::steady_clock::time_point start;
+            std::chrono::steady_clock::time_point end;
+        };
+
+        // Called with mMutex held, queues a stage whose dependencies are all done
+        void Schedule(StartupStageID stage);
+        // Runs the stage, then schedules whichever of its dependents it was the last dependency of
+        void RunStage(StartupStageID stage);
+
+    private:
+        JobSystem& mJobSystem;
+        std::vector<Stage> mStages;
+
+        std::mutex mMutex;
+        std::condition_variable mProgress;
+        std::queue<StartupStageID> mMainThreadReady;
+        uint32_t mFinishedCount = 0;
+
+        std::chrono::steady_clock::time_point mStartTime;
+        std::chrono::duration<double, std::milli> mTotalTime{ 0.0 };
+    };
+
+}
@@ -4,27 +4,98 @@
 
 #include <Vulkan/VulkanContext.h>
 #include <Vulkan/VulkanRenderer.h>
+#include <Vulkan/VulkanRenderThread.h>
 
+#include <Asset/AssetPipeline.h>
+#include <Core/EventBus.h>
+#include <Core/JobSystem.h>
+#include <Core/StartupGraph.h>
+#include <Scene/Camera.h>
+#include <Scene/RenderQueue.h>
+#include <Scene/Scene.h>
+
+#include <chrono>
 #include <memory>
+#include <span>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+struct EngineSpecs {
+    VKRE::WindowSpecs window{ .resizable = true };
+    VKRE::VulkanRendererSpecs renderer;
+    // Requested while the device is still being created, so their reads and decodes overlap the rest of startup
+    std::vector<VKRE::AssetRequest> startupAssets;
+    bool printStartupReport = true;
+};
 
 class Engine {
 public:
-    Engine();
+    Engine(const EngineSpecs& specs = {});
     ~Engine();
 
     void Run();
 
     static Engine& GetInstance() { return *mInstance; }
 
-public:
-    // TODO: Make this an event system... For now just a way to know if we're resizing the window is fine
-    bool hasResized = false;
+    VKRE::JobSystem& GetJobSystem() { return *mJobSystem; }
+    // Dispatched once a frame on the main thread, right after the window polls its events
+    VKRE::EventBus& GetEventBus() { return mEventBus; }
+    VKRE::AssetPipeline& GetAssetPipeline() { return *mAssetPipeline; }
+    VKRE::Scene& GetScene() { return mScene; }
+    // Screenshots and capture sessions, requested here and written by the job system a few frames later
+    VKRE::VulkanFrameCapture& GetFrameCapture() { return mVulkanRenderer->GetFrameCapture(); }
+    // Filled during the frame (see VulkanGPUScene::QueueInstance), sorted and handed to the render thread by Run, then cleared for the
+    // next frame
+    VKRE::RenderQueue& GetRenderQueue() { return mSnapshot.queue; }
+    // IDs of EngineSpecs::startupAssets, in the order they were given
+    std::span<const VKRE::AssetID> GetStartupAssets() const { return mStartupAssets; }
+    std::span<const VKRE::StartupStageTiming> GetStartupTimings() const { return mStartupTimings; }
+
+    // Gives the entity its own instance of the mesh in the GPU scene, which then follows the entity's world transform. Dynamic
+    // meshes are expected to move and are redrawn into the shadow cascades every frame, moving a static one invalidates their cache.
+    void AttachMesh(VKRE::Entity entity, VKRE::GPUMeshID mesh, bool dynamic = false);
+    // Submeshes with the material sample the cooked texture for their albedo. Textures still being decoded are bound once they're
+    // uploaded, the material stays untextured until then.
+    void BindMaterialTexture(uint32_t materialIndex, VKRE::AssetID texture);
+
+    // Opens another window on the same device, it shows the same frame as the main one and is presented together with it. Windows
+    // the user closes are closed by Run, the engine stops when the main window closes.
+    std::shared_ptr<VKRE::Window> OpenWindow(const VKRE::WindowSpecs& specs);
+    void CloseWindow(const std::shared_ptr<VKRE::Window>& window);
+
+private:
+    void UploadDecodedAssets();
+    void SyncScene();
+    void GatherLights();
 
 private:
     static inline Engine* mInstance = nullptr;
+    // Caps the per-frame hitch of GPU uploads, everything else waits in the pipeline's bounded queue
+    static const uint32_t MAX_UPLOADS_PER_FRAME = 4;
+    // Of the asset pipeline's decoded queue, grown to fit every startup asset when there are more
+    static const size_t DECODED_QUEUE_CAPACITY = 16;
 
-    // TODO: Make multiple windows possible (through an array with window ids? but then we need to make sure that each context is tied to the correct id? idk... For now this is fine especially when we add ImGui's multiviewport)
-    std::shared_ptr<VKRE::Window> mWindow;
+    std::shared_ptr<VKRE::Window> mWindow; // The main window, the device was created for its surface
+    std::vector<std::shared_ptr<VKRE::Window>> mWindows;        // Opened with OpenWindow
+    std::vector<std::shared_ptr<VKRE::Window>> mClosingWindows;          // Kept alive until the renderer has released their surfaces
+    std::vector<std::shared_ptr<VKRE::Window>> mSubmittedClosingWindows; // Closed before the frame that is still being recorded
     std::shared_ptr<VKRE::VulkanContext> mVulkanContext;
     std::shared_ptr<VKRE::VulkanRenderer> mVulkanRenderer;
+    std::unique_ptr<VKRE::VulkanRenderThread> mRenderThread;
+
+    VKRE::EventBus mEventBus; // The destructor releases the window and renderer, which subscribe to it, explicitly
+    std::unique_ptr<VKRE::JobSystem> mJobSystem;
+    std::unique_ptr<VKRE::AssetPipeline> mAssetPipeline;
+    std::vector<VKRE::AssetID> mStartupAssets;
+    std::vector<VKRE::StartupStageTiming> mStartupTimings;
+    std::chrono::steady_clock::time_point mStartTime;
+    bool mPrintStartupReport = true;
+    VKRE::Camera mCamera;
+    VKRE::Scene mScene;
+    VKRE::RenderSnapshot mSnapshot; // The frame being simulated, swapped with the render thread's on submit
+    std::unordered_map<VKRE::AssetID, VKRE::GPUMeshID> mMeshes; // Meshes live in the renderer's GPU scene, instances reference them by ID
+    std::unordered_map<VKRE::AssetID, std::shared_ptr<VKRE::VulkanImage2D>> mTextures;
+    std::unordered_map<VKRE::AssetID, VKRE::StreamedTextureID> mStreamedTextures; // Cooked textures, their images change as mips stream in and out
+    std::vector<std::pair<uint32_t, VKRE::AssetID>> mPendingMaterialTextures;   // Materials bound to textures that aren't streamed yet
 };
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+namespace VKRE {
+
+    // A fly camera: WASD to move, Q/E down and up, hold the right mouse button to look around.
+    // Projections follow Vulkan conventions, depth in [0, 1] and y pointing down in clip space. Depth is reversed, 1 at the near plane
+    // and 0 at the far plane, which spreads float precision evenly over distance.
+    class Camera {
+    public:
+        void Update(float deltaTime);
+
+        void SetPosition(const glm::vec3& position) { mPosition = position; }
+        void SetRotation(float yaw, float pitch) { mYaw = yaw; mPitch = pitch; }
+        void SetPerspective(float verticalFov, float nearPlane, float farPlane) { mVerticalFov = verticalFov; mNearPlane = nearPlane; mFarPlane = farPlane; }
+        void SetMoveSpeed(float speed) { mMoveSpeed = speed; }
+
+        const glm::vec3& GetPosition() const { return mPosition; }
+        glm::vec3 GetForward() const;
+        float GetNearPlane() const { return mNearPlane; }
+        float GetFarPlane() const { return mFarPlane; }
+        float GetVerticalFov() const { return mVerticalFov; }
+
+        glm::mat4 GetView() const;
+        glm::mat4 GetProjection(float aspectRatio) const;
+
+    private:
+        glm::vec3 mPosition{ 0.0f, 0.0f, 3.0f };
+        float mYaw = 0.0f;   // Radians, 0 looks down -Z
+        float mPitch = 0.0f; // Radians
+
+        float mVerticalFov = glm::radians(70.0f);
+        float mNearPlane = 0.1f;
+        float mFarPlane = 1000.0f;
+
+        float mMoveSpeed = 5.0f;
+        float mLookSpeed = 0.0025f;
+        glm::vec2 mLastMousePosition{ 0.0f };
+        bool mLooking = false;
+    };
+
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+#include "Registry.h"
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+#include <cstdint>
+
+namespace VKRE {
+
+    // Relative to the parent, or to the world for roots. Set it through Scene::SetLocalTransform so the change gets propagated.
+    struct LocalTransform {
+        glm::vec3 position{ 0.0f };
+        glm::quat rotation{ 1.0f, 0.0f, 0.0f, 0.0f };
+        glm::vec3 scale{ 1.0f };
+
+        glm::mat4 ToMatrix() const { return glm::scale(glm::translate(glm::mat4(1.0f), position) * glm::mat4_cast(rotation), scale); }
+    };
+
+    // Written by Scene::UpdateTransforms only
+    struct WorldTransform {
+        glm::mat4 matrix{ 1.0f };
+    };
+
+    // Children form an intrusive linked list, so walking a subtree needs no allocation per node
+    struct Hierarchy {
+        Entity parent = NULL_ENTITY;
+        Entity firstChild = NULL_ENTITY;
+        Entity nextSibling = NULL_ENTITY;
+        Entity previousSibling = NULL_ENTITY;
+        uint32_t depth = 0;
+    };
+
+    // An instance of a mesh in the renderer's GPU scene, its transform follows the entity's WorldTransform
+    struct MeshRenderer {
+        uint32_t mesh = UINT32_MAX;     // GPUMeshID
+        uint32_t instance = UINT32_MAX; // GPUInstanceID
+    };
+
+    enum class LightType : uint32_t {
+        Point = 0,
+        Spot = 1
+    };
+
+    // Placed at the entity's world position, spot lights shine down the entity's -Z axis. Gathered for the renderer every frame.
+    struct Light {
+        LightType type = LightType::Point;
+        glm::vec3 color{ 1.0f };
+        float intensity = 1.0f;
+        float range = 10.0f;        // The light fades out to nothing at this distance
+        float innerConeAngle = 0.3f; // Radians from the axis, spot lights are at full intensity inside it
+        float outerConeAngle = 0.5f; // Radians from the axis, and fade out to zero between the two
+    };
+
+    // Local space box the entity occupies in the scene's spatial index, set it through Scene::SetBounds
+    struct SpatialBounds {
+        glm::vec3 center{ 0.0f };
+        glm::vec3 extents{ 0.0f };
+        uint32_t proxy = UINT32_MAX; // DynamicBVH proxy
+    };
+
+}
@@ -0,0 +1,294 @@
+#pragma once
+
+#include <Core/JobSystem.h>
+#include <Scene/Frustum.h>
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <cfloat>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#if defined(__x86_64__) || defined(_M_X64)
+    #define VKRE_BVH_SSE
+    #include <immintrin.h>
+#endif
+
+namespace VKRE {
+
+    struct AABB {
+        glm::vec3 min{ 0.0f };
+        glm::vec3 max{ 0.0f };
+
+        static AABB FromCenterExtents(const glm::vec3& center, const glm::vec3& extents) { return { center - extents, center + extents }; }
+        // Bounds of a local space box after the transform, without going through its eight corners
+        static AABB Transform(const glm::mat4& transform, const glm::vec3& center, const glm::vec3& extents);
+
+        glm::vec3 GetCenter() const { return (min + max) * 0.5f; }
+        glm::vec3 GetExtents() const { return (max - min) * 0.5f; }
+        // Half of the surface area, only ever compared against other areas
+        float GetArea() const { const glm::vec3 size = max - min; return size.x * size.y + size.y * size.z + size.z * size.x; }
+
+        bool Contains(const AABB& other) const { return glm::all(glm::lessThanEqual(min, other.min)) && glm::all(glm::greaterThanEqual(max, other.max)); }
+        bool Overlaps(const AABB& other) const { return glm::all(glm::lessThanEqual(min, other.max)) && glm::all(glm::greaterThanEqual(max, other.min)); }
+        static AABB Union(const AABB& a, const AABB& b) { return { glm::min(a.min, b.min), glm::max(a.max, b.max) }; }
+    };
+
+    struct Ray {
+        glm::vec3 origin{ 0.0f };
+        glm::vec3 direction{ 0.0f, 0.0f, -1.0f }; // Distances are in multiples of its length
+        float maxDistance = FLT_MAX;
+    };
+
+    struct RayHit {
+        uint32_t userData = UINT32_MAX;
+        float distance = FLT_MAX;
+
+        bool IsHit() const { return userData != UINT32_MAX; }
+    };
+
+    // Bounding volume hierarchy over moving objects, in the style of Box2D's dynamic tree. Leaves hold a box fattened by a margin, so
+    // small moves don't touch the tree at all. Larger ones refit the leaf in place and walk up to the root, rotating nodes wherever
+    // swapping a child with its aunt shrinks the tree's surface area, which keeps it balanced without rebuilding. Insertion picks the
+    // sibling with the lowest surface area cost, and a proxy that moved clear of its old fat box is simply inserted again.
+    //
+    // Queries only read the tree, any number of them may run in parallel as long as nothing modifies it meanwhile.
+    class DynamicBVH {
+    public:
+        static constexpr uint32_t NULL_NODE = UINT32_MAX;
+        static constexpr uint32_t TRAVERSAL_STACK_SIZE = 1024;
+
+        explicit DynamicBVH(float margin = 0.1f);
+
+        uint32_t CreateProxy(const AABB& bounds, uint32_t userData);
+        void DestroyProxy(uint32_t proxy);
+        // Returns false if the bounds still fit inside the proxy's fat box and the tree was left alone
+        bool MoveProxy(uint32_t proxy, const AABB& bounds);
+
+        uint32_t GetUserData(uint32_t proxy) const { return mNodes[proxy].userData; }
+        AABB GetFatBounds(uint32_t proxy) const { return mNodes[proxy].GetBounds(); }
+        uint32_t GetProxyCount() const { return mProxyCount; }
+        uint32_t GetHeight() const { return mRoot == NULL_NODE ? 0 : mNodes[mRoot].height; }
+
+        // callback(userData) for every proxy whose fat box overlaps the bounds, return false from it to stop early
+        template <typename Callback> void QueryAABB(const AABB& bounds, Callback&& callback) const;
+        // callback(userData) for every proxy whose fat box touches the frustum. Subtrees fully inside are reported without further tests.
+        template <typename Callback> void QueryFrustum(const Frustum& frustum, Callback&& callback) const;
+        // Closest proxy along the ray. callback(userData, boxDistance) refines the hit against the real shape and returns its distance,
+        // or a negative value for a miss. Nodes are visited near to far and skipped once they start past the closest hit so far.
+        template <typename Callback> RayHit RayCast(const Ray& ray, Callback&& callback) const;
+        // Hits against the fat boxes themselves
+        RayHit RayCast(const Ray& ray) const { return RayCast(ray, [](uint32_t, float boxDistance) { return boxDistance; }); }
+
+        // Runs one ray cast per ray across the job system's workers and the calling thread
+        template <typename Callback> void RayCastBatch(JobSystem& jobSystem, std::span<const Ray> rays, std::span<RayHit> hits, Callback&& callback) const;
+        void RayCastBatch(JobSystem& jobSystem, std::span<const Ray> rays, std::span<RayHit> hits) const {
+            RayCastBatch(jobSystem, rays, hits, [](uint32_t, float boxDistance) { return boxDistance; });
+        }
+        // callback(queryIndex, userData) for every overlap of every box, called concurrently from the workers
+        template <typename Callback> void QueryAABBBatch(JobSystem& jobSystem, std::span<const AABB> boxes, Callback&& callback) const;
+
+    private:
+        // Bounds are padded to vec4 so the ray kernel can load them straight into SSE registers
+        struct Node {
+            glm::vec4 lower{ 0.0f };
+            glm::vec4 upper{ 0.0f };
+            uint32_t parent = NULL_NODE; // Doubles as the next free node while in the free list
+            uint32_t child1 = NULL_NODE;
+            uint32_t child2 = NULL_NODE;
+            uint32_t height = 0;         // 0 for leaves
+            uint32_t userData = UINT32_MAX;
+
+            bool IsLeaf() const { return child1 == NULL_NODE; }
+            AABB GetBounds() const { return { glm::vec3(lower), glm::vec3(upper) }; }
+            void SetBounds(const AABB& bounds) { lower = glm::vec4(bounds.min, 0.0f); upper = glm::vec4(bounds.max, 0.0f); }
+        };
+
+        struct RayData {
+            glm::vec4 origin;
+            glm::vec4 inverseDirection;
+        };
+
+        uint32_t AllocateNode();
+        void FreeNode(uint32_t node);
+        void InsertLeaf(uint32_t leaf);
+        void RemoveLeaf(uint32_t leaf);
+        void RefitAncestors(uint32_t node);
+        void RotateNodes(uint32_t node);
+
+        static RayData PrepareRay(const Ray& ray);
+        // Entry distance of the ray into the node's box, or FLT_MAX if it misses within [0, maxDistance]
+        static float IntersectRay(const Node& node, const RayData& ray, float maxDistance);
+
+    private:
+        std::vector<Node> mNodes;
+        uint32_t mRoot = NULL_NODE;
+        uint32_t mFreeList = NULL_NODE;
+        uint32_t mProxyCount = 0;
+        float mMargin = 0.1f;
+    };
+
+    inline float DynamicBVH::IntersectRay(const Node& node, const RayData& ray, float maxDistance) {
+#ifdef VKRE_BVH_SSE
+        const __m128 origin = _mm_loadu_ps(&ray.origin.x);
+        const __m128 inverseDirection = _mm_loadu_ps(&ray.inverseDirection.x);
+        const __m128 t0 = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(&node.lower.x), origin), inverseDirection);
+        const __m128 t1 = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(&node.upper.x), origin), inverseDirection);
+
+        // The unused fourth lane carries the ray's own [0, maxDistance] interval through the reductions
+        const __m128 xyzMask = _mm_castsi128_ps(_mm_set_epi32(0, -1, -1, -1));
+        __m128 tNear = _mm_or_ps(_mm_and_ps(xyzMask, _mm_min_ps(t0, t1)), _mm_andnot_ps(xyzMask, _mm_setzero_ps()));
+        __m128 tFar = _mm_or_ps(_mm_and_ps(xyzMask, _mm_max_ps(t0, t1)), _mm_andnot_ps(xyzMask, _mm_set1_ps(maxDistance)));
+
+        tNear = _mm_max_ps(tNear, _mm_shuffle_ps(tNear, tNear, _MM_SHUFFLE(1, 0, 3, 2)));
+        tNear = _mm_max_ps(tNear, _mm_shuffle_ps(tNear, tNear, _MM_SHUFFLE(2, 3, 0, 1)));
+        tFar = _mm_min_ps(tFar, _mm_shuffle_ps(tFar, tFar, _MM_SHUFFLE(1, 0, 3, 2)));
+        tFar = _mm_min_ps(tFar, _mm_shuffle_ps(tFar, tFar, _MM_SHUFFLE(2, 3, 0, 1)));
+
+        const float entry = _mm_cvtss_f32(tNear);
+        return entry <= _mm_cvtss_f32(tFar) ? entry : FLT_MAX;
+#else
+        const glm::vec3 t0 = (glm::vec3(node.lower) - glm::vec3(ray.origin)) * glm::vec3(ray.inverseDirection);
+        const glm::vec3 t1 = (glm::vec3(node.upper) - glm::vec3(ray.origin)) * glm::vec3(ray.inverseDirection);
+        const glm::vec3 tNear = glm::min(t0, t1);
+        const glm::vec3 tFar = glm::max(t0, t1);
+        const float entry = std::max({ tNear.x, tNear.y, tNear.z, 0.0f });
+        const float exit = std::min({ tFar.x, tFar.y, tFar.z, maxDistance });
+        return entry <= exit ? entry : FLT_MAX;
+#endif
+    }
+
+    template <typename Callback> void DynamicBVH::QueryAABB(const AABB& bounds, Callback&& callback) const {
+        if (mRoot == NULL_NODE)
+            return;
+
+        uint32_t stack[TRAVERSAL_STACK_SIZE];
+        uint32_t stackSize = 0;
+        stack[stackSize++] = mRoot;
+        while (stackSize > 0) {
+            const Node& node = mNodes[stack[--stackSize]];
+            if (!node.GetBounds().Overlaps(bounds))
+                continue;
+
+            if (node.IsLeaf()) {
+                if (!callback(node.userData))
+                    return;
+            } else {
+                stack[stackSize++] = node.child1;
+                stack[stackSize++] = node.child2;
+            }
+        }
+    }
+
+    template <typename Callback> void DynamicBVH::QueryFrustum(const Frustum& frustum, Callback&& callback) const {
+        if (mRoot == NULL_NODE)
+            return;
+
+        struct Entry {
+            uint32_t node;
+            bool inside; // Every plane already passed, no need to test descendants
+        };
+        Entry stack[TRAVERSAL_STACK_SIZE];
+        uint32_t stackSize = 0;
+        stack[stackSize++] = { mRoot, false };
+        while (stackSize > 0) {
+            const Entry entry = stack[--stackSize];
+            const Node& node = mNodes[entry.node];
+
+            bool inside = entry.inside;
+            if (!inside) {
+                const glm::vec3 center = (glm::vec3(node.lower) + glm::vec3(node.upper)) * 0.5f;
+                const glm::vec3 extents = (glm::vec3(node.upper) - glm::vec3(node.lower)) * 0.5f;
+                bool outside = false;
+                inside = true;
+                for (const glm::vec4& plane : frustum.planes) {
+                    const float distance = glm::dot(glm::vec3(plane), center) + plane.w;
+                    const float radius = glm::dot(glm::abs(glm::vec3(plane)), extents);
+                    if (distance < -radius) {
+                        outside = true;
+                        break;
+                    }
+                    inside &= distance >= radius;
+                }
+                if (outside)
+                    continue;
+            }
+
+            if (node.IsLeaf()) {
+                callback(node.userData);
+            } else {
+                stack[stackSize++] = { node.child1, inside };
+                stack[stackSize++] = { node.child2, inside };
+            }
+        }
+    }
+
+    template <typename Callback> RayHit DynamicBVH::RayCast(const Ray& ray, Callback&& callback) const {
+        RayHit hit;
+        hit.distance = ray.maxDistance;
+        if (mRoot == NULL_NODE)
+            return { UINT32_MAX, FLT_MAX };
+
+        const RayData rayData = PrepareRay(ray);
+        if (IntersectRay(mNodes[mRoot], rayData, hit.distance) == FLT_MAX)
+            return { UINT32_MAX, FLT_MAX };
+
+        struct Entry {
+            uint32_t node;
+            float distance;
+        };
+        Entry stack[TRAVERSAL_STACK_SIZE];
+        uint32_t stackSize = 0;
+        stack[stackSize++] = { mRoot, 0.0f };
+        while (stackSize > 0) {
+            const Entry entry = stack[--stackSize];
+            if (entry.distance > hit.distance)
+                continue;
+
+            const Node& node = mNodes[entry.node];
+            if (node.IsLeaf()) {
+                const float distance = callback(node.userData, entry.distance);
+                if (distance >= 0.0f && distance <= hit.distance) {
+                    hit.distance = distance;
+                    hit.userData = node.userData;
+                }
+                continue;
+            }
+
+            const float distance1 = IntersectRay(mNodes[node.child1], rayData, hit.distance);
+            const float distance2 = IntersectRay(mNodes[node.child2], rayData, hit.distance);
+            // Push the farther child first so the nearer one is visited next
+            if (distance1 <= distance2) {
+                if (distance2 != FLT_MAX)
+                    stack[stackSize++] = { node.child2, distance2 };
+                if (distance1 != FLT_MAX)
+                    stack[stackSize++] = { node.child1, distance1 };
+            } else {
+                if (distance1 != FLT_MAX)
+                    stack[stackSize++] = { node.child1, distance1 };
+                stack[stackSize++] = { node.child2, distance2 };
+            }
+        }
+
+        if (!hit.IsHit())
+            hit.distance = FLT_MAX;
+        return hit;
+    }
+
+    template <typename Callback> void DynamicBVH::RayCastBatch(JobSystem& jobSystem, std::span<const Ray> rays, std::span<RayHit> hits, Callback&& callback) const {
+        jobSystem.ParallelFor(static_cast<uint32_t>(rays.size()), 64, [&](uint32_t begin, uint32_t end) {
+            for (uint32_t i = begin; i < end; i++)
+                hits[i] = RayCast(rays[i], callback);
+        });
+    }
+
+    template <typename Callback> void DynamicBVH::QueryAABBBatch(JobSystem& jobSystem, std::span<const AABB> boxes, Callback&& callback) const {
+        jobSystem.ParallelFor(static_cast<uint32_t>(boxes.size()), 64, [&](uint32_t begin, uint32_t end) {
+            for (uint32_t i = begin; i < end; i++)
+                QueryAABB(boxes[i], [&](uint32_t userData) { callback(i, userData); return true; });
+        });
+    }
+
+}
@@ -0,0 +1,19 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+namespace VKRE {
+
+    // Planes are in the space the matrix transforms from (world space for a view projection matrix), normals point inside.
+    // Order is left, right, bottom, top, near, far, with near and far swapped for reverse-Z projections. The layout matches the frustum
+    // arrays the culling shaders read.
+    struct Frustum {
+        glm::vec4 planes[6];
+
+        // Expects Vulkan clip space, depth in [0, 1]. Planes without a normal, like the far plane of an infinite projection, never cull.
+        static Frustum FromMatrix(const glm::mat4& viewProjection);
+
+        bool IntersectsSphere(const glm::vec3& center, float radius) const;
+    };
+
+}
@@ -0,0 +1,88 @@
+#pragma once
+
+#include <Core/JobSystem.h>
+#include <Scene/Frustum.h>
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <span>
+#include <vector>
+
+namespace VKRE {
+
+    // Bounding volumes kept as one array per component, so the culling kernels load eight of them with a single instruction each.
+    // The arrays are padded to a multiple of FRUSTUM_CULLING_BATCH, which lets the kernels run without a scalar tail.
+    inline constexpr uint32_t FRUSTUM_CULLING_BATCH = 8;
+
+    class BoundingSphereSoA {
+    public:
+        uint32_t Add(const glm::vec3& center, float radius);
+        void Set(uint32_t index, const glm::vec3& center, float radius);
+        void Reserve(uint32_t count);
+        void Clear();
+
+        uint32_t GetCount() const { return mCount; }
+        const float* GetCenterX() const { return mCenterX.data(); }
+        const float* GetCenterY() const { return mCenterY.data(); }
+        const float* GetCenterZ() const { return mCenterZ.data(); }
+        const float* GetRadius() const { return mRadius.data(); }
+
+    private:
+        std::vector<float> mCenterX;
+        std::vector<float> mCenterY;
+        std::vector<float> mCenterZ;
+        std::vector<float> mRadius;
+        uint32_t mCount = 0;
+    };
+
+    // Axis aligned boxes as center and half extents
+    class BoundingBoxSoA {
+    public:
+        uint32_t Add(const glm::vec3& center, const glm::vec3& extents);
+        void Set(uint32_t index, const glm::vec3& center, const glm::vec3& extents);
+        void Reserve(uint32_t count);
+        void Clear();
+
+        uint32_t GetCount() const { return mCount; }
+        const float* GetCenterX() const { return mCenterX.data(); }
+        const float* GetCenterY() const { return mCenterY.data(); }
+        const float* GetCenterZ() const { return mCenterZ.data(); }
+        const float* GetExtentX() const { return mExtentX.data(); }
+        const float* GetExtentY() const { return mExtentY.data(); }
+        const float* GetExtentZ() const { return mExtentZ.data(); }
+
+    private:
+        std::vector<float> mCenterX;
+        std::vector<float> mCenterY;
+        std::vector<float> mCenterZ;
+        std::vector<float> mExtentX;
+        std::vector<float> mExtentY;
+        std::vector<float> mExtentZ;
+        uint32_t mCount = 0;
+    };
+
+    // Tests SoA bounding volumes against a frustum and writes one visibility bit per volume, bit i % 64 of word i / 64. The kernel is
+    // picked once at runtime: AVX2 with FMA tests eight volumes per iteration, SSE four, and the scalar one is left for non x86 builds.
+    namespace FrustumCulling {
+        enum class Kernel {
+            Scalar,
+            SSE,
+            AVX2
+        };
+
+        Kernel GetKernel();
+        const char* GetKernelName(Kernel kernel);
+
+        inline uint32_t GetVisibilityWordCount(uint32_t volumeCount) { return (volumeCount + 63) / 64; }
+
+        // Culls the volumes in [begin, end), begin must be a multiple of 64 so that no word is shared with another range
+        void CullSpheres(const Frustum& frustum, const BoundingSphereSoA& spheres, uint32_t begin, uint32_t end, std::span<uint64_t> visibility);
+        void CullBoxes(const Frustum& frustum, const BoundingBoxSoA& boxes, uint32_t begin, uint32_t end, std::span<uint64_t> visibility);
+
+        // Same as above over every volume, split into batches across the job system's workers and the calling thread
+        void CullSpheres(JobSystem& jobSystem, const Frustum& frustum, const BoundingSphereSoA& spheres, std::span<uint64_t> visibility);
+        void CullBoxes(JobSystem& jobSystem, const Frustum& frustum, const BoundingBoxSoA& boxes, std::span<uint64_t> visibility);
+    }
+
+}
@@ -0,0 +1,183 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <utility>
+#include <vector>
+
+namespace VKRE {
+
+    // Entities are just handles: the low 24 bits index into the sparse arrays, the high 8 bits are a generation that changes every time
+    // the index is reused, so a stale handle stops matching its old components.
+    using Entity = uint32_t;
+    inline constexpr Entity NULL_ENTITY = UINT32_MAX;
+    inline constexpr uint32_t ENTITY_INDEX_BITS = 24;
+    inline constexpr uint32_t ENTITY_INDEX_MASK = (1u << ENTITY_INDEX_BITS) - 1;
+
+    inline uint32_t GetEntityIndex(Entity entity) { return entity & ENTITY_INDEX_MASK; }
+    inline uint32_t GetEntityGeneration(Entity entity) { return entity >> ENTITY_INDEX_BITS; }
+    inline Entity MakeEntity(uint32_t index, uint32_t generation) { return (generation << ENTITY_INDEX_BITS) | (index & ENTITY_INDEX_MASK); }
+
+    class ComponentPoolBase {
+    public:
+        virtual ~ComponentPoolBase() = default;
+
+        virtual bool Has(Entity entity) const = 0;
+        virtual void Remove(Entity entity) = 0;
+    };
+
+    // Sparse set: components of one type packed densely in insertion order, with a sparse array from entity index to dense index.
+    // Removal swaps the last component into the hole, so dense indices of other components change whenever one is removed.
+    template <typename T> class ComponentPool final : public ComponentPoolBase {
+    public:
+        static constexpr uint32_t INVALID_INDEX = UINT32_MAX;
+
+        template <typename... Args> T& Emplace(Entity entity, Args&&... args) {
+            const uint32_t index = GetEntityIndex(entity);
+            if (index >= mSparse.size())
+                mSparse.resize(index + 1, INVALID_INDEX);
+
+            if (Has(entity))
+                return mComponents[mSparse[index]] = T{ std::forward<Args>(args)... };
+
+            mSparse[index] = static_cast<uint32_t>(mComponents.size());
+            mEntities.push_back(entity);
+            return mComponents.emplace_back(T{ std::forward<Args>(args)... });
+        }
+
+        void Remove(Entity entity) override {
+            if (!Has(entity))
+                return;
+
+            const uint32_t denseIndex = mSparse[GetEntityIndex(entity)];
+            const uint32_t lastIndex = static_cast<uint32_t>(mComponents.size() - 1);
+            if (denseIndex != lastIndex) {
+                mComponents[denseIndex] = std::move(mComponents[lastIndex]);
+                mEntities[denseIndex] = mEntities[lastIndex];
+                mSparse[GetEntityIndex(mEntities[denseIndex])] = denseIndex;
+            }
+
+            mComponents.pop_back();
+            mEntities.pop_back();
+            mSparse[GetEntityIndex(entity)] = INVALID_INDEX;
+        }
+
+        bool Has(Entity entity) const override {
+            const uint32_t index = GetEntityIndex(entity);
+            return index < mSparse.size() && mSparse[index] != INVALID_INDEX && mEntities[mSparse[index]] == entity;
+        }
+
+        T& Get(Entity entity) { return mComponents[mSparse[GetEntityIndex(entity)]]; }
+        const T& Get(Entity entity) const { return mComponents[mSparse[GetEntityIndex(entity)]]; }
+        T* TryGet(Entity entity) { return Has(entity) ? &Get(entity) : nullptr; }
+        const T* TryGet(Entity entity) const { return Has(entity) ? &Get(entity) : nullptr; }
+
+        uint32_t GetDenseIndex(Entity entity) const { return Has(entity) ? mSparse[GetEntityIndex(entity)] : INVALID_INDEX; }
+        uint32_t GetSize() const { return static_cast<uint32_t>(mComponents.size()); }
+
+        std::span<T> GetComponents() { return mComponents; }
+        std::span<const T> GetComponents() const { return mComponents; }
+        std::span<const Entity> GetEntities() const { return mEntities; }
+
+    private:
+        std::vector<uint32_t> mSparse;
+        std::vector<Entity> mEntities;
+        std::vector<T> mComponents;
+    };
+
+    // Owns the entities and one component pool per component type. Iteration walks the dense array of one pool, so systems touching a
+    // single component stream through contiguous memory.
+    class Registry {
+    public:
+        Entity Create() {
+            uint32_t index;
+            if (!mFreeIndices.empty()) {
+                index = mFreeIndices.back();
+                mFreeIndices.pop_back();
+            } else {
+                index = static_cast<uint32_t>(mGenerations.size());
+                mGenerations.push_back(0);
+            }
+
+            mAliveCount++;
+            return MakeEntity(index, mGenerations[index]);
+        }
+
+        void Destroy(Entity entity) {
+            if (!IsAlive(entity))
+                return;
+
+            for (const auto& pool : mPools) {
+                if (pool)
+                    pool->Remove(entity);
+            }
+
+            const uint32_t index = GetEntityIndex(entity);
+            mGenerations[index] = static_cast<uint8_t>(mGenerations[index] + 1);
+            mFreeIndices.push_back(index);
+            mAliveCount--;
+        }
+
+        bool IsAlive(Entity entity) const {
+            const uint32_t index = GetEntityIndex(entity);
+            return entity != NULL_ENTITY && index < mGenerations.size() && mGenerations[index] == GetEntityGeneration(entity);
+        }
+
+        uint32_t GetAliveCount() const { return mAliveCount; }
+        // One past the highest entity index ever handed out, the size for arrays indexed by GetEntityIndex
+        uint32_t GetEntityCapacity() const { return static_cast<uint32_t>(mGenerations.size()); }
+
+        template <typename T, typename... Args> T& Add(Entity entity, Args&&... args) { return GetPool<T>().Emplace(entity, std::forward<Args>(args)...); }
+        template <typename T> void Remove(Entity entity) { GetPool<T>().Remove(entity); }
+        template <typename T> bool Has(Entity entity) const { const ComponentPool<T>* pool = FindPool<T>(); return pool && pool->Has(entity); }
+        template <typename T> T& Get(Entity entity) { return GetPool<T>().Get(entity); }
+        template <typename T> const T& Get(Entity entity) const { return FindPool<T>()->Get(entity); }
+        template <typename T> T* TryGet(Entity entity) { return GetPool<T>().TryGet(entity); }
+
+        template <typename T> ComponentPool<T>& GetPool() {
+            const uint32_t typeID = GetComponentTypeID<T>();
+            if (typeID >= mPools.size())
+                mPools.resize(typeID + 1);
+            if (!mPools[typeID])
+                mPools[typeID] = std::make_unique<ComponentPool<T>>();
+            return static_cast<ComponentPool<T>&>(*mPools[typeID]);
+        }
+
+        // Calls function(entity, first, rest...) for every entity that has all the listed components. The first component's pool drives
+        // the iteration, so list the rarest one first. Components must not be added or removed from inside the function.
+        template <typename First, typename... Rest, typename Function> void Each(Function&& function) {
+            ComponentPool<First>& pool = GetPool<First>();
+            std::span<First> components = pool.GetComponents();
+            std::span<const Entity> entities = pool.GetEntities();
+            for (size_t i = 0; i < components.size(); i++) {
+                const Entity entity = entities[i];
+                if ((GetPool<Rest>().Has(entity) && ...))
+                    function(entity, components[i], GetPool<Rest>().Get(entity)...);
+            }
+        }
+
+    private:
+        template <typename T> const ComponentPool<T>* FindPool() const {
+            const uint32_t typeID = GetComponentTypeID<T>();
+            if (typeID >= mPools.size() || !mPools[typeID])
+                return nullptr;
+            return static_cast<const ComponentPool<T>*>(mPools[typeID].get());
+        }
+
+        template <typename T> static uint32_t GetComponentTypeID() {
+            static const uint32_t id = sNextComponentTypeID.fetch_add(1, std::memory_order_relaxed);
+            return id;
+        }
+
+    private:
+        static inline std::atomic<uint32_t> sNextComponentTypeID{ 0 };
+
+        std::vector<std::unique_ptr<ComponentPoolBase>> mPools;
+        std::vector<uint8_t> mGenerations;
+        std::vector<uint32_t> mFreeIndices;
+        uint32_t mAliveCount = 0;
+    };
+
+}
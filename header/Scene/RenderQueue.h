@@ -0,0 +1,121 @@
+#pragma once
+
+#include <Core/JobSystem.h>
+
+#include <cstdint>
+#include <span>
+#include <vector>
+
+namespace VKRE {
+
+    // Everything a draw needs to be ordered by, packed from most to least significant so that sorting the keys groups draws by pass,
+    // then pipeline, then material, then mesh, and orders each group by depth:
+    //
+    //   pass 4 | pipeline 8 | material 16 | mesh 20 | depth 16
+    //
+    // Fields are truncated to their widths. Mesh is whatever identifies the geometry of one draw, a GPU submesh index for the scene.
+    namespace DrawKey {
+        inline constexpr uint32_t PASS_BITS = 4;
+        inline constexpr uint32_t PIPELINE_BITS = 8;
+        inline constexpr uint32_t MATERIAL_BITS = 16;
+        inline constexpr uint32_t MESH_BITS = 20;
+        inline constexpr uint32_t DEPTH_BITS = 16;
+
+        inline constexpr uint32_t DEPTH_SHIFT = 0;
+        inline constexpr uint32_t MESH_SHIFT = DEPTH_SHIFT + DEPTH_BITS;
+        inline constexpr uint32_t MATERIAL_SHIFT = MESH_SHIFT + MESH_BITS;
+        inline constexpr uint32_t PIPELINE_SHIFT = MATERIAL_SHIFT + MATERIAL_BITS;
+        inline constexpr uint32_t PASS_SHIFT = PIPELINE_SHIFT + PIPELINE_BITS;
+        static_assert(PASS_SHIFT + PASS_BITS == 64);
+
+        inline constexpr uint64_t GetField(uint64_t key, uint32_t shift, uint32_t bits) { return (key >> shift) & ((uint64_t(1) << bits) - 1); }
+
+        inline constexpr uint64_t Make(uint32_t pass, uint32_t pipeline, uint32_t material, uint32_t mesh, uint32_t depth) {
+            return (uint64_t(pass) & ((1u << PASS_BITS) - 1)) << PASS_SHIFT
+                 | (uint64_t(pipeline) & ((1u << PIPELINE_BITS) - 1)) << PIPELINE_SHIFT
+                 | (uint64_t(material) & ((1u << MATERIAL_BITS) - 1)) << MATERIAL_SHIFT
+                 | (uint64_t(mesh) & ((1u << MESH_BITS) - 1)) << MESH_SHIFT
+                 | (uint64_t(depth) & ((1u << DEPTH_BITS) - 1)) << DEPTH_SHIFT;
+        }
+
+        inline constexpr uint32_t GetPass(uint64_t key) { return static_cast<uint32_t>(GetField(key, PASS_SHIFT, PASS_BITS)); }
+        inline constexpr uint32_t GetPipeline(uint64_t key) { return static_cast<uint32_t>(GetField(key, PIPELINE_SHIFT, PIPELINE_BITS)); }
+        inline constexpr uint32_t GetMaterial(uint64_t key) { return static_cast<uint32_t>(GetField(key, MATERIAL_SHIFT, MATERIAL_BITS)); }
+        inline constexpr uint32_t GetMesh(uint64_t key) { return static_cast<uint32_t>(GetField(key, MESH_SHIFT, MESH_BITS)); }
+        inline constexpr uint32_t GetDepth(uint64_t key) { return static_cast<uint32_t>(GetField(key, DEPTH_SHIFT, DEPTH_BITS)); }
+
+        // Maps a view depth in [0, maxDepth] to the depth field, near first. Back to front flips it for blended passes.
+        uint32_t QuantizeDepth(float depth, float maxDepth, bool backToFront = false);
+    }
+
+    // Bits of the two leading key fields that changed from the previous batch
+    enum RenderStateChange : uint32_t {
+        RENDER_STATE_PASS = 1 << 0,
+        RENDER_STATE_PIPELINE = 1 << 1,
+        RENDER_STATE_MATERIAL = 1 << 2
+    };
+
+    // Consecutive sorted items that share everything but depth, drawn as one instanced draw. Their payloads are
+    // GetPayloads()[firstItem, firstItem + itemCount).
+    struct DrawBatch {
+        uint64_t key;
+        uint32_t firstItem;
+        uint32_t itemCount;
+    };
+
+    // Draws are pushed in any order as a key and a 32-bit payload, usually an instance ID. Sort orders them with an LSD radix sort over
+    // 8-bit digits, whose histogram and scatter steps are split into chunks across the job system. Digits every key agrees on are
+    // skipped, so a frame with one pass and a handful of pipelines pays for far fewer than eight passes.
+    class RenderQueue {
+    public:
+        void Push(uint64_t key, uint32_t payload) { mKeys.push_back(key); mPayloads.push_back(payload); }
+        void Reserve(uint32_t count);
+        void Clear();
+
+        void Sort(JobSystem& jobSystem);
+
+        // onStateChange(key, RenderStateChange bits) runs before the first batch and whenever pass, pipeline or material change,
+        // onDraw(const DrawBatch&) once per batch. Only valid after Sort.
+        template <typename StateCallback, typename DrawCallback> void Walk(StateCallback&& onStateChange, DrawCallback&& onDraw) const;
+
+        uint32_t GetCount() const { return static_cast<uint32_t>(mKeys.size()); }
+        bool IsEmpty() const { return mKeys.empty(); }
+        std::span<const uint64_t> GetKeys() const { return mKeys; }
+        std::span<const uint32_t> GetPayloads() const { return mPayloads; }
+
+    private:
+        std::vector<uint64_t> mKeys;
+        std::vector<uint32_t> mPayloads;
+        std::vector<uint64_t> mScratchKeys;
+        std::vector<uint32_t> mScratchPayloads;
+        std::vector<uint32_t> mChunkHistograms; // 256 counters per chunk, reused across digits
+    };
+
+    template <typename StateCallback, typename DrawCallback> void RenderQueue::Walk(StateCallback&& onStateChange, DrawCallback&& onDraw) const {
+        constexpr uint32_t BATCH_SHIFT = DrawKey::MESH_SHIFT;
+
+        uint32_t itemIndex = 0;
+        uint64_t previousKey = 0;
+        while (itemIndex < mKeys.size()) {
+            const uint64_t key = mKeys[itemIndex];
+            uint32_t changes = 0;
+            if (itemIndex == 0 || DrawKey::GetPass(key) != DrawKey::GetPass(previousKey))
+                changes |= RENDER_STATE_PASS | RENDER_STATE_PIPELINE | RENDER_STATE_MATERIAL;
+            if (DrawKey::GetPipeline(key) != DrawKey::GetPipeline(previousKey))
+                changes |= RENDER_STATE_PIPELINE | RENDER_STATE_MATERIAL;
+            if (DrawKey::GetMaterial(key) != DrawKey::GetMaterial(previousKey))
+                changes |= RENDER_STATE_MATERIAL;
+            if (changes != 0)
+                onStateChange(key, changes);
+
+            uint32_t end = itemIndex + 1;
+            while (end < mKeys.size() && (mKeys[end] >> BATCH_SHIFT) == (key >> BATCH_SHIFT))
+                end++;
+
+            onDraw(DrawBatch{ key, itemIndex, end - itemIndex });
+            previousKey = key;
+            itemIndex = end;
+        }
+    }
+
+}
@@ -0,0 +1,86 @@
+#pragma once
+
+#include "Components.h"
+#include "DynamicBVH.h"
+#include "Registry.h"
+
+#include <Core/JobSystem.h>
+
+#include <span>
+#include <utility>
+#include <vector>
+
+namespace VKRE {
+
+    // Entities with a transform hierarchy on top of the registry. Every entity made here has a LocalTransform, a WorldTransform and a
+    // Hierarchy, other components can be added through GetRegistry().
+    //
+    // World transforms are updated one depth level at a time, each level split across the job system's workers since its entities only
+    // read the level above. Only entities whose local transform changed, and everything below them, are recomputed. The ones that
+    // changed are listed afterwards so only those get uploaded.
+    //
+    // Entities with SpatialBounds are also kept in a DynamicBVH, keyed by entity, which follows their world transforms.
+    class Scene {
+    public:
+        Entity CreateEntity(const LocalTransform& transform = {}, Entity parent = NULL_ENTITY);
+        // Destroys the entity and all of its descendants
+        void DestroyEntity(Entity entity);
+        bool IsAlive(Entity entity) const { return mRegistry.IsAlive(entity); }
+
+        // NULL_ENTITY makes the entity a root. Parenting an entity to one of its own descendants is refused.
+        bool SetParent(Entity entity, Entity parent);
+        Entity GetParent(Entity entity) const { return mRegistry.Get<Hierarchy>(entity).parent; }
+
+        void SetLocalTransform(Entity entity, const LocalTransform& transform);
+        // Forces the entity's world transform to be recomputed and reported as changed by the next UpdateTransforms
+        void MarkTransformDirty(Entity entity);
+        const LocalTransform& GetLocalTransform(Entity entity) const { return mRegistry.Get<LocalTransform>(entity); }
+        // As of the last UpdateTransforms
+        const glm::mat4& GetWorldTransform(Entity entity) const { return mRegistry.Get<WorldTransform>(entity).matrix; }
+
+        void UpdateTransforms(JobSystem& jobSystem);
+        // Entities whose world transform changed in the last UpdateTransforms, parents before children
+        std::span<const Entity> GetChangedEntities() const { return mChangedEntities; }
+
+        // Adds the entity to the spatial index, or replaces its box. The bounds are in the entity's local space.
+        void SetBounds(Entity entity, const glm::vec3& center, const glm::vec3& extents);
+        void RemoveBounds(Entity entity);
+        // Up to date as of the last UpdateTransforms, user data of every proxy is its entity
+        const DynamicBVH& GetSpatialIndex() const { return mSpatialIndex; }
+
+        // MeshRenderers of entities destroyed since the last call, their GPU instances still have to be removed
+        std::vector<MeshRenderer> TakeDestroyedMeshRenderers() { return std::exchange(mDestroyedMeshRenderers, {}); }
+
+        Registry& GetRegistry() { return mRegistry; }
+        const Registry& GetRegistry() const { return mRegistry; }
+
+    private:
+        // Dense indices are cached per level, they stay valid until an entity with a transform is created or destroyed
+        struct TransformNode {
+            Entity entity;
+            Entity parent;
+            uint32_t localIndex;
+            uint32_t worldIndex;
+            uint32_t parentWorldIndex;
+        };
+
+        void Unlink(Entity entity);
+        void UpdateDepths(Entity root);
+        void RebuildLevels();
+        void UpdateSpatialIndex();
+
+    private:
+        Registry mRegistry;
+
+        std::vector<std::vector<TransformNode>> mLevels;
+        bool mLevelsDirty = false;
+
+        std::vector<uint8_t> mDirty; // Per entity index, bytes so that workers can set their own flag without racing their neighbours
+        bool mAnyDirty = false;
+        std::vector<Entity> mChangedEntities;
+        std::vector<MeshRenderer> mDestroyedMeshRenderers;
+
+        DynamicBVH mSpatialIndex;
+    };
+
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+#include "VulkanUtils.h"
+#include "VulkanContext.h"
+
+#include <memory>
+
+namespace VKRE {
+
+    struct BufferInfo {
+        VkBuffer buffer = VK_NULL_HANDLE;
+        VmaAllocation allocation = VK_NULL_HANDLE;
+        VmaAllocationInfo allocationInfo{};
+        VkDeviceSize size = 0;
+        VkDeviceAddress deviceAddress = 0;
+    };
+
+    class VulkanBuffer {
+    public:
+        VulkanBuffer(std::shared_ptr<VulkanContext> context);
+        ~VulkanBuffer();
+
+        BufferInfo& GetBufferInfo() { return mBufferInfo; }
+
+        // Host visible buffers are created persistently mapped, GetMappedData() returns nullptr for device local ones
+        void CreateBuffer(VkDeviceSize size, VkBufferUsageFlags usageFlags, VmaMemoryUsage memoryUsage, VmaAllocationCreateFlags allocationFlags = 0);
+        void* GetMappedData() const { return mBufferInfo.allocationInfo.pMappedData; }
+        void Release();
+
+    private:
+        std::shared_ptr<VulkanContext> mContext;
+        BufferInfo mBufferInfo;
+    };
+
+    namespace BufferUtils {
+        // A VkMemoryBarrier2 covering every buffer, which is what all buffer hazards in the engine need so far
+        void GlobalBarrier(VkCommandBuffer cmd, VkPipelineStageFlags2 srcStage, VkAccessFlags2 srcAccess, VkPipelineStageFlags2 dstStage, VkAccessFlags2 dstAccess);
+    }
+
+}
@@ -0,0 +1,129 @@
+#pragma once
+
+#include "VulkanUtils.h"
+#include "VulkanContext.h"
+#include "VulkanBuffer.h"
+#include "VulkanPipeline.h"
+
+#include <Scene/Components.h>
+
+#include <glm/glm.hpp>
+
+#include <memory>
+#include <vector>
+
+namespace VKRE {
+
+    struct ClusteredLightingSpecs {
+        uint32_t maxLights = 16384;            // Per frame, anything past that is dropped
+        glm::uvec3 gridSize{ 16, 9, 24 };      // Clusters across the screen and depth slices
+        uint32_t maxLightsPerCluster = 256;
+    };
+
+    // The std430 structs below must match shaders/include/Lighting.glsl
+    struct GPULight {
+        glm::vec3 position;  // World space
+        float range;
+        glm::vec3 color;     // Premultiplied by the intensity
+        LightType type;
+        glm::vec3 direction; // World space, spot lights only
+        float innerConeCos;
+        float outerConeCos;
+        uint32_t padding[3];
+    };
+    static_assert(sizeof(GPULight) == 64);
+
+    // What the lights are binned for, the projection must be reverse-Z. shadowData points at the sun's ShadowData
+    // (see VulkanShadowCascades), which must exist even with shadows turned off.
+    struct LightingView {
+        glm::mat4 view;
+        glm::mat4 projection;
+        float nearPlane;
+        float farPlane;
+        glm::uvec2 screenSize;
+        VkDeviceAddress shadowData;
+    };
+
+    // The lights of one frame, copied on the main thread by VulkanClusteredLighting::Capture for the render thread to bin
+    struct LightingSnapshot {
+        std::vector<GPULight> lights;
+        glm::vec3 sunDirection{ 0.0f };
+        glm::vec3 sunColor{ 0.0f };
+        glm::vec3 ambientColor{ 0.0f };
+    };
+
+    // Clustered forward lighting. The view frustum is split into a grid of clusters, screen tiles along x and y and exponential slices
+    // along depth, so every cluster stays roughly cubic. Each frame a compute pass tests every light against every cluster's view space
+    // box and writes the indices of the ones that touch it. Fragments then only shade with the lights of the cluster they fall in,
+    // which keeps the cost per pixel bounded by local light density instead of the scene's light count.
+    class VulkanClusteredLighting {
+    public:
+        VulkanClusteredLighting(std::shared_ptr<VulkanContext> context, uint32_t framesInFlight, const ClusteredLightingSpecs& specs = {});
+        ~VulkanClusteredLighting();
+
+        // Lights are gathered again every frame, returns false once maxLights is reached
+        void ClearLights() { mLights.clear(); }
+        bool AddLight(const GPULight& light);
+        uint32_t GetLightCount() const { return static_cast<uint32_t>(mLights.size()); }
+
+        void SetSun(const glm::vec3& direction, const glm::vec3& color) { mSunDirection = glm::normalize(direction); mSunColor = color; }
+        void SetAmbient(const glm::vec3& color) { mAmbientColor = color; }
+        const glm::vec3& GetSunDirection() const { return mSunDirection; }
+
+        // Main thread, the lights and sun as they are now. The render thread only ever sees them through a snapshot.
+        void Capture(LightingSnapshot& snapshot) const;
+        // Uploads the snapshot's lights and bins them, the cluster lists are ready for the fragment shader once this returns
+        void Cull(VkCommandBuffer cmd, uint32_t frameIndex, const LightingView& view, const LightingSnapshot& lights);
+
+        // Address of the frame's LightingData, the shading pipeline reaches every other lighting buffer through it
+        VkDeviceAddress GetLightingDataAddress(uint32_t frameIndex) const { return mFrames[frameIndex].dataBuffer->GetBufferInfo().deviceAddress; }
+
+    private:
+        struct PushConstants {
+            VkDeviceAddress data;
+        };
+
+        // Must match LightingData in shaders/include/Lighting.glsl
+        struct LightingData {
+            glm::mat4 view;
+            glm::mat4 inverseProjection;
+            glm::vec4 sunDirection;
+            glm::vec4 sunColor;
+            glm::vec4 ambientColor;
+            glm::uvec4 gridSize;    // w is maxLightsPerCluster
+            glm::vec2 tileSize;
+            glm::vec2 screenSize;
+            float nearPlane;
+            float farPlane;
+            float sliceScale;
+            float sliceBias;
+            uint32_t lightCount;
+            uint32_t padding0[3];
+            VkDeviceAddress lights;
+            VkDeviceAddress clusterCounts;
+            VkDeviceAddress clusterLights;
+            VkDeviceAddress shadows;
+        };
+        static_assert(sizeof(LightingData) == 272);
+
+        struct LightingFrame {
+            std::unique_ptr<VulkanBuffer> dataBuffer;
+            std::unique_ptr<VulkanBuffer> lightBuffer;
+        };
+
+    private:
+        std::shared_ptr<VulkanContext> mContext;
+        ClusteredLightingSpecs mSpecs;
+        VulkanComputePipeline mCullPipeline;
+
+        std::unique_ptr<VulkanBuffer> mClusterCountBuffer;
+        std::unique_ptr<VulkanBuffer> mClusterLightBuffer;
+        std::vector<LightingFrame> mFrames;
+
+        std::vector<GPULight> mLights;
+        glm::vec3 mSunDirection = glm::normalize(glm::vec3(0.4f, 1.0f, 0.3f));
+        glm::vec3 mSunColor{ 0.85f };
+        glm::vec3 mAmbientColor{ 0.15f };
+    };
+
+}
@@ -4,21 +4,32 @@
 
 #include "VulkanPhysicalDevice.h"
 #include "VulkanLogicalDevice.h"
+#include "VulkanObjectCache.h"
 
 #include "Window/GlfwWindow.h"
 
-#include <vector>
+#include <cstddef>
+#include <filesystem>
 #include <memory>
+#include <mutex>
+#include <span>
+#include <vector>
 
 namespace VKRE {
 
     class VulkanContext {
     public:
+        // Creates the instance first if CreateInstance hasn't been called yet
         VulkanContext(std::shared_ptr<Window> window);
         ~VulkanContext();
 
+        // Doesn't need a window, only the extensions it will ask for, so startup can create the instance while the window is being created
+        static void CreateInstance(const std::vector<const char*>& windowExtensions);
         static const VkInstance GetInstance() { return sInstance; }
+        // The main window's surface, the device was picked to present to it
         VkSurfaceKHR GetSurface() const { return mSurface; }
+        // Surface for another window, the caller destroys it. Aborts if the graphics queue can't present to it.
+        VkSurfaceKHR CreateSurface(const Window& window) const;
 
         VmaAllocator GetAllocator() { return mAllocator; }
         std::shared_ptr<Window> GetWindowContext() { return mWindow; }
@@ -28,10 +39,21 @@ namespace VKRE {
         const QueueFamilyIndinces& GetQueueFamilies() const { return mPhysicalDevice.queueFamilyIndicies; }
         const VkQueue GetGraphicsQueue() const { return mLogicalDevice.graphicsQueue; }
         const VkQueue GetPresentQueue() const { return mLogicalDevice.presentQueue; }
-
-        bool IsValidationLayersEnabled() const { return mEnableValidationLayers; }
-        uint32_t GetValidationLayersCount() const { return static_cast<uint32_t>(mValidationLayers.size()); }
-        std::vector<const char*> GetValidationLayers() const { return mValidationLayers; }
+        // Queues must not be used from two threads at once, hold this around submits, presents and device waits
+        std::mutex& GetQueueMutex() { return mQueueMutex; }
+
+        bool IsValidationLayersEnabled() const { return sEnableValidationLayers; }
+        uint32_t GetValidationLayersCount() const { return static_cast<uint32_t>(sValidationLayers.size()); }
+        std::vector<const char*> GetValidationLayers() const { return sValidationLayers; }
+
+        // Every pipeline is created through this cache. Data saved by an earlier run lets the driver skip compiling the pipelines again,
+        // data from another driver or device is ignored. Until CreatePipelineCache is called it's VK_NULL_HANDLE, which Vulkan allows.
+        static std::vector<std::byte> ReadPipelineCacheFile(const std::filesystem::path& path);
+        void CreatePipelineCache(std::span<const std::byte> initialData);
+        void SavePipelineCache(const std::filesystem::path& path) const;
+        VkPipelineCache GetPipelineCache() const { return mPipelineCache; }
+        // Samplers, layouts and shader modules are shared through this, whoever asks for them doesn't destroy them
+        VulkanObjectCache& GetObjectCache() { return *mObjectCache; }
 
     private:
         static inline VkInstance sInstance = VK_NULL_HANDLE;
@@ -42,17 +64,20 @@ namespace VKRE {
         VulkanLogicalDevice mLogicalDevice{};
 
         VmaAllocator mAllocator;
+        VkPipelineCache mPipelineCache = VK_NULL_HANDLE;
+        std::unique_ptr<VulkanObjectCache> mObjectCache;
+        std::mutex mQueueMutex;
         VulkanUtils::DeletionQueue mDeletionQueue;
 
         // TODO: Make validation layers only available in debug mode
-        const std::vector<const char*> mValidationLayers = {
+        static inline const std::vector<const char*> sValidationLayers = {
             "VK_LAYER_KHRONOS_validation"
         };
 
         #ifdef NDEBUG // TODO: Add custom macro
-        const bool mEnableValidationLayers = false;
+        static constexpr bool sEnableValidationLayers = false;
         #else
-        const bool mEnableValidationLayers = true;
+        static constexpr bool sEnableValidationLayers = true;
         #endif
     };
 
@@ -0,0 +1,98 @@
+#pragma once
+
+#include "VulkanUtils.h"
+#include "VulkanContext.h"
+#include "VulkanImage.h"
+
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace VKRE {
+
+    struct DefragmenterSpecs {
+        VkDeviceSize maxBytesPerPass = 32ull * 1024 * 1024;
+        uint32_t maxAllocationsPerPass = 64;
+        uint32_t checkIntervalFrames = 300;             // How often the allocator's statistics are looked at while no defragmentation runs
+        float minFreeRatio = 0.25f;                     // Share of the allocated blocks that has to be free before a defragmentation starts
+        VkDeviceSize minFreeBytes = 64ull * 1024 * 1024; // And the least it's worth starting one for
+    };
+
+    // Compacts the memory of sampled textures in the background. Long sessions that stream textures in and out leave blocks with holes
+    // nothing fits into, a defragmentation moves allocations together so whole blocks can be given back.
+    //
+    // Textures that may move are allocated from a pool of their own, see GetAllocationCreateInfo, and only that pool is defragmented.
+    // Its memory type is the one picked for a plain color texture, textures whose format can't live in it go to the default pools and
+    // never move. Buffers, render targets and everything else stay in the default pools and are never proposed.
+    //
+    // A pass is started at the beginning of a frame, its copies are recorded into that frame's command buffer before anything samples
+    // the moved images, and it's ended once that frame slot's fence has been waited on, when the copies are done and the old memory can
+    // go. Only one pass is in flight at a time, each bounded by maxBytesPerPass and maxAllocationsPerPass.
+    //
+    // Every image allocated with GetAllocationCreateInfo has to be registered right after it's created, Register skips the ones outside the pool. Registered images must be sampled only, kept in SHADER_READ_ONLY_OPTIMAL outside of the frames that write them, and be created with TRANSFER_SRC usage.
+    // Their image and view handles change when they're moved, so they have to be read from the image each frame instead of kept, and
+    // descriptors that reference them rewritten, see VulkanTextureStreamer::UpdateDescriptorSet.
+    // The last reference to a registered image has to release it, never an explicit Release(), a pass may still be moving it.
+    class VulkanDefragmenter {
+    public:
+        VulkanDefragmenter(std::shared_ptr<VulkanContext> context, const DefragmenterSpecs& specs = {});
+        // Expects the device to be idle and every image allocated from the pool to be released
+        ~VulkanDefragmenter();
+
+        VulkanDefragmenter(const VulkanDefragmenter&) = delete;
+        VulkanDefragmenter& operator=(const VulkanDefragmenter&) = delete;
+
+        // For the images that will be registered, device local memory from the defragmented pool when images of the format and usage
+        // can live in its memory type, from the default pools otherwise
+        VmaAllocationCreateInfo GetAllocationCreateInfo(VkFormat format, VkImageUsageFlags usage) const;
+        // Thread safe
+        void Register(const std::shared_ptr<VulkanImage2D>& image);
+
+        // Must be called after the frame's fence has been waited on, before the frame records anything that samples registered images
+        void BeginFrame(VkCommandBuffer cmd, uint32_t frameIndex);
+
+        bool IsRunning() const { return mDefragmentation != VK_NULL_HANDLE; }
+        // Summed over every defragmentation that has finished
+        const VmaDefragmentationStats& GetStats() const { return mStats; }
+
+    private:
+        enum class PassResult {
+            MOVING,        // Copies were recorded, the pass ends once the frame is done
+            NOTHING_MOVED, // Every proposed move was ignored, the pass has ended already
+            FINISHED       // The defragmentation has nothing left to move
+        };
+
+        bool IsPoolCompatible(uint32_t memoryTypeBits) const { return memoryTypeBits & (1u << mMemoryTypeIndex); }
+        bool ShouldStart();
+        PassResult BeginPass(VkCommandBuffer cmd, uint32_t frameIndex);
+        // Returns true when the defragmentation has nothing left to move
+        bool EndPass();
+        void EndDefragmentation();
+
+    private:
+        struct Pass {
+            VmaDefragmentationPassMoveInfo moves{};
+            uint32_t frameIndex = 0;
+            bool inFlight = false;
+            std::vector<std::shared_ptr<VulkanImage2D>> movedImages; // Kept alive until the pass ends, VMA must not see them freed before
+            std::vector<std::pair<VkImage, VkImageView>> oldImages;   // Still bound to the memory the images moved out of
+        };
+
+        std::shared_ptr<VulkanContext> mContext;
+        DefragmenterSpecs mSpecs;
+        VmaPool mPool = VK_NULL_HANDLE;
+        uint32_t mMemoryTypeIndex = 0;
+
+        std::mutex mRegistryMutex;
+        std::unordered_map<VmaAllocation, std::weak_ptr<VulkanImage2D>> mRegistry;
+
+        VmaDefragmentationContext mDefragmentation = VK_NULL_HANDLE;
+        Pass mPass;
+        uint64_t mFrameNumber = 0;
+        uint64_t mLastCheckFrame = 0;
+        VmaDefragmentationStats mStats{};
+    };
+
+}
@@ -0,0 +1,70 @@
+#pragma once
+
+#include "VulkanUtils.h"
+#include "VulkanContext.h"
+#include "VulkanBuffer.h"
+#include "VulkanImage.h"
+#include "VulkanPipeline.h"
+
+#include <glm/glm.hpp>
+
+#include <memory>
+
+namespace VKRE {
+
+    inline constexpr uint32_t DEPTH_PYRAMID_MAX_LEVELS = 16;
+
+    // Must match DepthPyramidInfo in shaders/include/DepthPyramid.glsl
+    struct DepthPyramidInfo {
+        glm::uvec2 depthSize;
+        uint32_t levelCount;
+        uint32_t reverseZ;
+        glm::uvec4 levels[DEPTH_PYRAMID_MAX_LEVELS]; // Width, height and first texel of each level
+    };
+    static_assert(sizeof(DepthPyramidInfo) == 272, "DepthPyramidInfo must match the std430 layout used by the shaders");
+
+    // Min/max depth mip chain of a depth attachment for occlusion culling. The levels are stored as vec2 texels in one buffer, so the
+    // culling shaders reach them through a device address like the rest of the scene. Level 0 is half the depth resolution rounded up
+    // and each texel of level n covers exactly the 2^(n+1) pixel square of the depth buffer below it, edges included.
+    //
+    // The whole chain is built by a single dispatch: every workgroup reduces a 64x64 pixel tile down to one texel in shared memory, and
+    // the last workgroup to finish reduces the remaining levels from those.
+    class VulkanDepthPyramid {
+    public:
+        VulkanDepthPyramid(std::shared_ptr<VulkanContext> context, std::shared_ptr<VulkanImage2D> depthImage, bool reverseZ = false);
+        ~VulkanDepthPyramid();
+
+        // The depth image must be in VK_IMAGE_LAYOUT_DEPTH_READ_ONLY_OPTIMAL, the pyramid is ready for the compute stage once this returns
+        void Build(VkCommandBuffer cmd);
+
+        VkDeviceAddress GetInfoAddress() const { return mInfoBuffer->GetBufferInfo().deviceAddress; }
+        VkDeviceAddress GetPyramidAddress() const { return mPyramidBuffer->GetBufferInfo().deviceAddress; }
+        const DepthPyramidInfo& GetInfo() const { return mInfo; }
+
+    private:
+        struct PushConstants {
+            VkDeviceAddress info;
+            VkDeviceAddress pyramid;
+            VkDeviceAddress counter;
+            uint32_t groupCount;
+            uint32_t padding;
+        };
+
+    private:
+        std::shared_ptr<VulkanContext> mContext;
+        std::shared_ptr<VulkanImage2D> mDepthImage;
+        VulkanComputePipeline mPipeline;
+
+        VkSampler mSampler = VK_NULL_HANDLE;
+        VkDescriptorSetLayout mSetLayout = VK_NULL_HANDLE;
+        VkDescriptorPool mDescriptorPool = VK_NULL_HANDLE;
+        VkDescriptorSet mDescriptorSet = VK_NULL_HANDLE;
+
+        std::unique_ptr<VulkanBuffer> mInfoBuffer;
+        std::unique_ptr<VulkanBuffer> mPyramidBuffer;
+        std::unique_ptr<VulkanBuffer> mCounterBuffer;
+        DepthPyramidInfo mInfo{};
+        glm::uvec2 mGroupCount{ 1 };
+    };
+
+}
@@ -0,0 +1,76 @@
+#pragma once
+
+#include "VulkanUtils.h"
+#include "VulkanContext.h"
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace VKRE {
+
+    // How many descriptors of a type a pool holds per set it can allocate
+    struct DescriptorPoolRatio {
+        VkDescriptorType type;
+        float ratio;
+    };
+
+    struct DescriptorAllocatorSpecs {
+        uint32_t initialSetsPerPool = 64;
+        uint32_t maxSetsPerPool = 4096;
+        float growthFactor = 1.5f;    // Each new pool of a lane holds this many times the sets of the last one, up to maxSetsPerPool
+        uint32_t laneCount = 0;       // 0 uses one per hardware thread plus one, enough for the job system's workers, the main and the render thread
+        std::vector<DescriptorPoolRatio> ratios = {
+            { VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 4.0f },
+            { VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 2.0f },
+            { VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1.0f },
+            { VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1.0f }
+        };
+    };
+
+    // Descriptor sets that live for one frame. Sets are never freed one by one, every pool a frame used is reset with a single
+    // vkResetDescriptorPool once that frame slot's fence has been waited on.
+    //
+    // Each frame keeps its pools per lane, and every thread that allocates is given its own lane the first time it does, so recording
+    // threads don't share a pool and the per-lane mutex is never contended unless there are more threads than lanes. A lane allocates
+    // from its current pool until the driver reports it full, then moves on to a pool from its free list or creates a new one, each
+    // new pool larger than the last.
+    class VulkanDescriptorAllocator {
+    public:
+        VulkanDescriptorAllocator(std::shared_ptr<VulkanContext> context, uint32_t framesInFlight, const DescriptorAllocatorSpecs& specs = {});
+        ~VulkanDescriptorAllocator();
+
+        VulkanDescriptorAllocator(const VulkanDescriptorAllocator&) = delete;
+        VulkanDescriptorAllocator& operator=(const VulkanDescriptorAllocator&) = delete;
+
+        // Must be called after the frame's fence has been waited on, everything allocated for frameIndex before is reset
+        void BeginFrame(uint32_t frameIndex);
+        // Valid until the next BeginFrame for frameIndex. Thread safe.
+        VkDescriptorSet Allocate(uint32_t frameIndex, VkDescriptorSetLayout layout);
+
+    private:
+        struct Lane {
+            std::mutex mutex;
+            std::vector<VkDescriptorPool> freePools; // Empty, or reset since they were last allocated from
+            std::vector<VkDescriptorPool> usedPools; // Allocated from this frame, the current one last
+            uint32_t setsPerPool = 0;                // Of the next pool this lane creates
+        };
+
+        Lane& GetLane(uint32_t frameIndex);
+        // Makes a reset or new pool the lane's current one
+        VkDescriptorPool NextPool(Lane& lane);
+        VkDescriptorPool CreatePool(uint32_t setCount);
+
+    private:
+        std::shared_ptr<VulkanContext> mContext;
+        DescriptorAllocatorSpecs mSpecs;
+        uint32_t mLaneCount;
+        std::unique_ptr<Lane[]> mLanes; // mLaneCount per frame in flight, frame by frame
+        uint32_t mFramesInFlight;
+
+        // Lane indices are handed out to threads on their first allocation, from any allocator
+        static inline std::atomic<uint32_t> sNextThreadLane{ 0 };
+    };
+
+}
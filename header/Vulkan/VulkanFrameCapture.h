@@ -0,0 +1,114 @@
+#pragma once
+
+#include "VulkanUtils.h"
+#include "VulkanContext.h"
+#include "VulkanBuffer.h"
+#include "VulkanImage.h"
+
+#include <Core/JobSystem.h>
+
+#include <atomic>
+#include <filesystem>
+#include <memory>
+#include <optional>
+#include <vector>
+
+namespace VKRE {
+
+    enum class CaptureFormat {
+        PNG,
+        RAW // Tightly packed 8-bit sRGB RGBA rows, top row first, GetExtent() in size
+    };
+
+    struct FrameCaptureSpecs {
+        // A frame that finds every buffer still in flight or being encoded is dropped, capturing never waits for the GPU or the workers
+        uint32_t readbackBufferCount = 6;
+        float encodePriority = -1.0f; // Job priority of the encodes, below asset loading
+    };
+
+    // The captures the main thread asked for since the last VulkanFrameCapture::Capture, applied on the render thread
+    struct FrameCaptureSnapshot {
+        std::optional<std::filesystem::path> screenshot;
+        std::optional<std::filesystem::path> sessionDirectory; // Nothing while no session is running
+        CaptureFormat sessionFormat = CaptureFormat::PNG;
+        uint32_t sessionRevision = 0;                           // Bumped by every StartSession and StopSession
+    };
+
+    // Copies finished frames back to the CPU and writes them to disk without stalling the frame.
+    //
+    // Record blits the frame into an 8-bit sRGB image, the same conversion the present does, and copies that into one of a ring of
+    // host visible readback buffers, all in the frame's own command buffer. The buffer is only read once the frame slot comes around
+    // again, when its fence has been waited on already, and is then handed to a job that encodes it straight from the mapped memory.
+    // It goes back to the ring when the job is done.
+    //
+    // Screenshot and the session functions are called on the main thread and reach the render thread through Capture and Apply,
+    // BeginFrame and Record are called by the renderer while it records.
+    class VulkanFrameCapture {
+    public:
+        VulkanFrameCapture(std::shared_ptr<VulkanContext> context, JobSystem& jobSystem, VkExtent2D extent, uint32_t framesInFlight, const FrameCaptureSpecs& specs = {});
+        // Must be destroyed once the device is idle, frames that are still waiting to be read are encoded before it returns
+        ~VulkanFrameCapture();
+
+        // Writes the next recorded frame to path as a PNG
+        void Screenshot(const std::filesystem::path& path);
+        // Writes every recorded frame into directory, numbered from 0, until StopSession
+        void StartSession(const std::filesystem::path& directory, CaptureFormat format = CaptureFormat::PNG);
+        void StopSession();
+        bool IsSessionActive() const { return mRequestedSession.has_value(); }
+
+        // Main thread, moves the screenshot request into the snapshot
+        void Capture(FrameCaptureSnapshot& snapshot);
+        // Render thread, every captured snapshot in order, including the ones of frames that were never recorded
+        void Apply(const FrameCaptureSnapshot& snapshot);
+
+        // Must be called after the frame's fence has been waited on, hands the frames recorded in this slot to the workers
+        void BeginFrame(uint32_t frameIndex);
+        // Captures source if anything asked for this frame. source must be in TRANSFER_SRC_OPTIMAL and stays in it.
+        void Record(VkCommandBuffer cmd, uint32_t frameIndex, VulkanImage2D& source);
+
+        VkExtent2D GetExtent() const { return mExtent; }
+        uint64_t GetDroppedFrameCount() const { return mDroppedFrames.load(std::memory_order_relaxed); }
+
+    private:
+        struct CaptureSession {
+            std::filesystem::path directory;
+            CaptureFormat format;
+            uint32_t nextFrame = 0;
+        };
+
+        struct ReadbackSlot {
+            std::unique_ptr<VulkanBuffer> buffer;
+            std::filesystem::path path;
+            CaptureFormat format = CaptureFormat::PNG;
+            uint32_t frameIndex = 0;
+            bool inFlight = false;              // Recorded, its frame hasn't retired yet
+            std::atomic<bool> encoding{ false }; // Owned by an encode job until it clears this
+        };
+
+        ReadbackSlot* AcquireSlot();
+        void Encode(ReadbackSlot& slot);
+        void Retire(ReadbackSlot& slot);
+
+    private:
+        std::shared_ptr<VulkanContext> mContext;
+        JobSystem& mJobSystem;
+        FrameCaptureSpecs mSpecs;
+        VkExtent2D mExtent;
+
+        std::unique_ptr<VulkanImage2D> mConvertImage; // The blit's sRGB target, copied into the readback buffer
+        std::vector<ReadbackSlot> mSlots;
+
+        // Main thread
+        std::optional<std::filesystem::path> mRequestedScreenshot;
+        std::optional<CaptureSession> mRequestedSession;
+        uint32_t mSessionRevision = 0;
+
+        // Render thread
+        std::optional<std::filesystem::path> mScreenshotPath;
+        std::optional<CaptureSession> mSession;
+        uint32_t mAppliedSessionRevision = 0;
+        std::atomic<uint64_t> mDroppedFrames = 0;
+        std::atomic<uint32_t> mOutstandingEncodes{ 0 };
+    };
+
+}
@@ -10,7 +10,6 @@ namespace VKRE {
     struct VulkanFrameData {
         VkCommandPool commandPool;
         VkCommandBuffer commandBuffer;
-        VkSemaphore presentCompleteSemaphore;
         VkFence waitFence;
         VulkanUtils::DeletionQueue deletionQueue;
     };
@@ -20,7 +19,9 @@ namespace VKRE {
         VulkanFrameManager(std::shared_ptr<VulkanContext> context, uint32_t framesInFlight = 2);
         ~VulkanFrameManager();
 
-        VulkanFrameData& GetCurrentFrame() { return mFrames[mCurrentFrame % mFrames.size()]; }
+        VulkanFrameData& GetCurrentFrame() { return mFrames[GetCurrentFrameIndex()]; }
+        uint32_t GetCurrentFrameIndex() const { return static_cast<uint32_t>(mCurrentFrame % mFrames.size()); }
+        uint32_t GetFramesInFlight() const { return static_cast<uint32_t>(mFrames.size()); }
         uint64_t GetTotalFramesCount() const { return mCurrentFrame; }
         void AdvanceFrame() { mCurrentFrame++; }
 
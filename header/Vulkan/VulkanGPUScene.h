@@ -0,0 +1,330 @@
+#pragma once
+
+#include "VulkanUtils.h"
+#include "VulkanContext.h"
+#include "VulkanBuffer.h"
+#include "VulkanDepthPyramid.h"
+#include "VulkanImmediateSubmit.h"
+#include "VulkanPipeline.h"
+
+#include <Asset/MeshAsset.h>
+#include <Scene/Frustum.h>
+#include <Scene/FrustumCulling.h>
+#include <Scene/RenderQueue.h>
+
+#include <glm/glm.hpp>
+
+#include <functional>
+#include <memory>
+#include <optional>
+#include <vector>
+
+namespace VKRE {
+
+    using GPUMeshID = uint32_t;
+    using GPUInstanceID = uint32_t;
+
+    struct GPUSceneSpecs {
+        uint32_t maxVertices = 8 * 1024 * 1024;
+        uint32_t maxIndices = 32 * 1024 * 1024;
+        uint32_t maxMeshes = 4096;
+        uint32_t maxSubmeshes = 16384;
+        uint32_t maxLodRanges = 64 * 1024;            // One per submesh and LOD level
+        uint32_t maxMeshlets = 512 * 1024;
+        uint32_t maxInstances = 256 * 1024;
+        uint32_t maxDraws = 512 * 1024;               // Per culling pass, one draw per visible instance and submesh, or per visible meshlet
+        uint32_t maxClusterJobs = 64 * 1024;          // Per culling pass, submeshes whose meshlets are culled. Those that don't fit are drawn whole.
+        uint32_t maxInstanceUploadsPerFrame = 16384;  // Anything beyond that stays dirty until the next frame
+        uint32_t maxQueuedDraws = 64 * 1024;          // Per frame, instances drawn from a render queue
+    };
+
+    // The std430 structs below must match shaders/include/SceneData.glsl
+    struct GPUMesh {
+        MeshFormat::Bounds bounds;
+        uint32_t firstSubmesh;
+        uint32_t submeshCount;
+        uint32_t firstLodRange; // Submesh i at level l is at firstLodRange + l * submeshCount + i
+        uint32_t lodCount;
+        float lodErrors[MeshFormat::MAX_MESH_LODS];
+    };
+    static_assert(sizeof(GPUMesh) == 80);
+
+    struct GPUSubmesh {
+        uint32_t firstIndex;   // Into the scene's index buffer
+        uint32_t indexCount;
+        int32_t vertexOffset;  // Into the scene's vertex buffer
+        uint32_t materialIndex;
+        uint32_t firstMeshlet; // Into the scene's meshlet buffer
+        uint32_t meshletCount; // 0 when the full detail is always drawn whole
+        uint32_t padding[2];
+    };
+    static_assert(sizeof(GPUSubmesh) == 32);
+
+    // The full detail triangles of a submesh are stored in meshlet order, so every meshlet is an index range of its own
+    struct GPUMeshlet {
+        glm::vec3 center;    // Object space bounding sphere
+        float radius;
+        glm::vec3 coneAxis;  // Object space normal cone, see MeshFormat::Meshlet
+        float coneCutoff;
+        uint32_t firstIndex; // Into the scene's index buffer, drawn with the submesh's vertexOffset
+        uint32_t indexCount;
+        uint32_t padding[2];
+    };
+    static_assert(sizeof(GPUMeshlet) == 48);
+
+    struct GPULodRange {
+        uint32_t firstIndex; // Into the scene's index buffer
+        uint32_t indexCount;
+    };
+    static_assert(sizeof(GPULodRange) == 8);
+
+    struct GPUInstance {
+        glm::mat4 transform;
+        uint32_t meshIndex;    // INVALID_GPU_MESH for free slots
+        uint32_t flags;        // GPUInstanceFlags
+        uint32_t padding[2];
+    };
+    static_assert(sizeof(GPUInstance) == 80);
+
+    // Written by the culling pass next to each draw command, the draw's firstInstance indexes into it
+    struct GPUDrawData {
+        uint32_t instanceIndex;
+        uint32_t materialIndex;
+    };
+    static_assert(sizeof(GPUDrawData) == 8);
+
+    inline constexpr uint32_t INVALID_GPU_MESH = UINT32_MAX;
+
+    enum GPUInstanceFlags : uint32_t {
+        GPU_INSTANCE_QUEUED = 1 << 0, // Skipped by the culling passes, drawn through a RenderQueue instead
+        GPU_INSTANCE_DYNAMIC = 1 << 1 // Expected to move, so it's kept out of anything cached like the static shadow cascades
+    };
+
+    // Two phase occlusion culling. The early pass draws what was visible last frame, its depth is reduced into a pyramid, and the late
+    // pass tests everything against that pyramid and draws what the early pass missed. Each pass has its own draw list.
+    enum class SceneCullPass : uint32_t {
+        Early = 0,
+        Late = 1
+    };
+
+    // What the culling passes look through. projectionScale turns a size at distance 1 into pixels, projection[1][1] * viewport height / 2.
+    struct SceneCullView {
+        glm::mat4 viewProjection;
+        glm::vec3 cameraPosition;
+        float projectionScale;
+        glm::vec2 viewportSize; // Pixels, for the meshlets' small primitive test
+    };
+
+    // A changed instance as Capture hands it over, with the world box the shadow cascades cull it by
+    struct GPUInstanceUpload {
+        GPUInstanceID id;
+        GPUInstance instance;
+        glm::vec3 boundsCenter;
+        glm::vec3 boundsExtents;
+    };
+
+    // What a frame records of the scene's CPU side, filled on the main thread by VulkanGPUScene::Capture and applied on the render thread
+    struct GPUSceneSnapshot {
+        std::vector<GPUInstanceUpload> uploads;
+        uint32_t instanceSlotCount = 0;
+        uint32_t meshletCount = 0;
+        uint32_t staticRevision = 0;
+        float lodErrorThreshold = 1.0f;
+        float lodHysteresis = 0.2f;
+    };
+
+    // Every mesh, instance and draw of the scene lives in GPU buffers. Meshes are appended into one shared vertex and index buffer so the
+    // whole scene can be drawn with a single vkCmdDrawIndexedIndirectCount. Each frame a compute pass culls every instance against the
+    // frustum and compacts a draw command per visible instance and submesh. The CPU only uploads the instances that changed, so its
+    // per frame cost doesn't depend on how many objects there are.
+    //
+    // Culling runs in two passes around a depth pyramid (see SceneCullPass) so hidden instances are skipped without occlusion queries.
+    // Which instances passed the late pass is kept on the GPU and seeds the next frame's early pass.
+    //
+    // Each visible instance draws the coarsest LOD whose error projects to at most the LOD error threshold in pixels. Going coarser than
+    // last frame's LOD needs the error to be below the threshold by the hysteresis fraction, so instances near a switching distance
+    // don't pop back and forth.
+    //
+    // Instances close enough for full detail are where dense meshes put most of their triangles, so there the cooked meshlets of each
+    // submesh are culled too. The instance pass queues a cluster job per such submesh, and a second compute pass tests every meshlet of
+    // the job against the frustum, its normal cone and its projected size, then appends a draw per surviving meshlet to the same draw
+    // list. It's plain compute and indexed draws, no mesh shaders, so it runs on lavapipe as well. Render queues and the shadow cascades
+    // still draw whole submeshes.
+    //
+    // Instances are changed on the main thread while the render thread records the previous frame, so each side has its own copy. The
+    // main thread's changes reach the render thread through Capture and Apply, everything the render thread reads of an instance is
+    // what Apply last brought over. Meshes are shared, the arrays holding them are reserved up front and only appended to.
+    class VulkanGPUScene {
+    public:
+        VulkanGPUScene(std::shared_ptr<VulkanContext> context, VulkanImmediateSubmit& immediateSubmit, uint32_t framesInFlight, const GPUSceneSpecs& specs = {});
+        ~VulkanGPUScene();
+
+        // Meshes are never removed, the geometry buffers are only appended to
+        std::optional<GPUMeshID> AddMesh(const MeshAsset& asset);
+        const MeshFormat::Bounds& GetMeshBounds(GPUMeshID mesh) const { return mMeshes[mesh].bounds; }
+
+        void SetLodSelection(float errorThreshold, float hysteresis) { mLodErrorThreshold = errorThreshold; mLodHysteresis = hysteresis; }
+
+        std::optional<GPUInstanceID> AddInstance(GPUMeshID mesh, const glm::mat4& transform);
+        void SetInstanceTransform(GPUInstanceID instance, const glm::mat4& transform);
+        void RemoveInstance(GPUInstanceID instance);
+        // Takes the instance out of the culling passes so that it's only drawn when queued, or puts it back
+        void SetInstanceQueued(GPUInstanceID instance, bool queued);
+        void SetInstanceDynamic(GPUInstanceID instance, bool dynamic);
+        uint32_t GetInstanceCount() const { return static_cast<uint32_t>(mInstances.size() - mFreeInstances.size()); }
+
+        // Main thread, moves every instance changed since the last call and the LOD selection into the snapshot
+        void Capture(GPUSceneSnapshot& snapshot);
+        // Render thread, called for every captured snapshot in order, also for frames that are skipped
+        void Apply(const GPUSceneSnapshot& snapshot);
+
+        // The rest is for the render thread, it sees the instances as Apply left them.
+        //
+        // World space boxes of every instance slot for CPU side culling, indexed by GPUInstanceID. Free slots keep stale boxes, check
+        // IsDrawnInstanceAlive on the results.
+        const BoundingBoxSoA& GetDrawnInstanceBounds() const { return mDrawnBounds; }
+        bool IsDrawnInstanceAlive(GPUInstanceID instance) const { return mDrawnInstances[instance].meshIndex != INVALID_GPU_MESH; }
+        uint32_t GetDrawnInstanceFlags(GPUInstanceID instance) const { return mDrawnInstances[instance].flags; }
+        // Changes whenever an instance that isn't GPU_INSTANCE_DYNAMIC is added, moved or removed
+        uint32_t GetDrawnStaticRevision() const { return mDrawnStaticRevision; }
+
+        // Uploads the instances applied since the last call, at most maxInstanceUploadsPerFrame, must be recorded before Cull. What the
+        // uploaded instances looked like last frame is kept in the previous instance buffer, for motion vectors.
+        void Update(VkCommandBuffer cmd, uint32_t frameIndex);
+        // Sets the view both culling passes of this frame test against and empties their draw lists
+        void BeginCull(VkCommandBuffer cmd, uint32_t frameIndex, const SceneCullView& view);
+        // Rebuilds the pass's draw list, the outputs are ready for DRAW_INDIRECT and VERTEX_SHADER once this returns. The late pass
+        // needs the pyramid built from the early pass's depth, without one it only frustum culls.
+        void Cull(VkCommandBuffer cmd, SceneCullPass pass, const VulkanDepthPyramid* depthPyramid = nullptr);
+        // Binds the index buffer and issues the pass's indirect draws, the bound pipeline's shaders read the scene through the addresses below
+        void Draw(VkCommandBuffer cmd, SceneCullPass pass) const;
+
+        // Pushes one item per submesh of the instance, keyed by material and GPU submesh index so equal submeshes batch together.
+        // QueueInstance is for the main thread, QueueDrawnInstance for the render thread.
+        void QueueInstance(RenderQueue& queue, GPUInstanceID instance, uint32_t pass, uint32_t pipeline, uint32_t depth) const { QueueMesh(queue, mInstances[instance].meshIndex, instance, pass, pipeline, depth); }
+        void QueueDrawnInstance(RenderQueue& queue, GPUInstanceID instance, uint32_t pass, uint32_t pipeline, uint32_t depth) const { QueueMesh(queue, mDrawnInstances[instance].meshIndex, instance, pass, pipeline, depth); }
+        // Walks a sorted queue and records one instanced draw per batch, always at full detail. The draw data goes into a per frame
+        // buffer at GetQueueDrawDataAddress, which the pipeline bound from onStateChange must read instead of the culled draw data.
+        // Every call appends to that buffer, so several queues can be drawn in one frame.
+        void DrawQueue(VkCommandBuffer cmd, uint32_t frameIndex, const RenderQueue& queue, const std::function<void(uint64_t key, uint32_t changes)>& onStateChange);
+
+        VkDeviceAddress GetVertexBufferAddress() const { return mVertexBuffer->GetBufferInfo().deviceAddress; }
+        VkDeviceAddress GetInstanceBufferAddress() const { return mInstanceBuffer->GetBufferInfo().deviceAddress; }
+        // Every instance as it was drawn last frame. Slots whose mesh differs from the current one had nothing there last frame.
+        VkDeviceAddress GetPreviousInstanceBufferAddress() const { return mPreviousInstanceBuffer->GetBufferInfo().deviceAddress; }
+        VkDeviceAddress GetDrawDataBufferAddress() const { return mDrawDataBuffer->GetBufferInfo().deviceAddress; }
+        VkDeviceAddress GetQueueDrawDataAddress(uint32_t frameIndex) const { return mFrames[frameIndex].queueDrawDataBuffer->GetBufferInfo().deviceAddress; }
+
+    private:
+        void QueueMesh(RenderQueue& queue, GPUMeshID mesh, GPUInstanceID instance, uint32_t pass, uint32_t pipeline, uint32_t depth) const;
+
+    private:
+        struct CullPushConstants {
+            VkDeviceAddress cullData;
+            VkDeviceAddress instances;
+            VkDeviceAddress meshes;
+            VkDeviceAddress submeshes;
+            VkDeviceAddress lodRanges;
+            VkDeviceAddress drawCommands;
+            VkDeviceAddress drawData;
+            VkDeviceAddress drawCount;
+            VkDeviceAddress visibility;
+            VkDeviceAddress depthPyramidInfo;
+            VkDeviceAddress depthPyramid;
+            VkDeviceAddress clusterJobs;
+            VkDeviceAddress clusterDispatch;
+            uint32_t pass;
+            uint32_t occlusionCulling;
+        };
+
+        struct ClusterCullPushConstants {
+            VkDeviceAddress cullData;
+            VkDeviceAddress instances;
+            VkDeviceAddress submeshes;
+            VkDeviceAddress meshlets;
+            VkDeviceAddress clusterJobs;
+            VkDeviceAddress drawCommands;
+            VkDeviceAddress drawData;
+            VkDeviceAddress drawCount;
+            uint32_t pass;
+        };
+
+        // Must match SceneCullData in shaders/include/SceneCulling.glsl
+        struct SceneCullData {
+            glm::mat4 viewProjection;
+            glm::vec4 frustumPlanes[6];
+            glm::vec3 cameraPosition;
+            float lodScale;      // Projection scale over the error threshold, an error of 1 / lodScale at distance 1 is the limit
+            uint32_t instanceCount;
+            uint32_t maxDrawCount;
+            float lodHysteresis;
+            uint32_t maxClusterJobs;
+            glm::vec2 viewportSize;
+            float projectionScale;
+            uint32_t padding;
+        };
+
+        struct SceneFrame {
+            std::unique_ptr<VulkanBuffer> cullDataBuffer;
+            std::unique_ptr<VulkanBuffer> instanceStagingBuffer;
+            std::unique_ptr<VulkanBuffer> queueDrawDataBuffer;
+            uint32_t queueDrawCount = 0;
+        };
+
+    private:
+        std::shared_ptr<VulkanContext> mContext;
+        VulkanImmediateSubmit& mImmediateSubmit;
+        GPUSceneSpecs mSpecs;
+        VulkanComputePipeline mCullPipeline;
+        VulkanComputePipeline mClusterCullPipeline;
+
+        std::unique_ptr<VulkanBuffer> mVertexBuffer;
+        std::unique_ptr<VulkanBuffer> mIndexBuffer;
+        std::unique_ptr<VulkanBuffer> mMeshBuffer;
+        std::unique_ptr<VulkanBuffer> mSubmeshBuffer;
+        std::unique_ptr<VulkanBuffer> mLodRangeBuffer;
+        std::unique_ptr<VulkanBuffer> mMeshletBuffer;
+        std::unique_ptr<VulkanBuffer> mInstanceBuffer;
+        std::unique_ptr<VulkanBuffer> mPreviousInstanceBuffer;
+        std::unique_ptr<VulkanBuffer> mDrawCommandBuffer;
+        std::unique_ptr<VulkanBuffer> mDrawDataBuffer;
+        std::unique_ptr<VulkanBuffer> mDrawCountBuffer;   // One count per pass
+        std::unique_ptr<VulkanBuffer> mVisibilityBuffer;  // uint32_t per instance, bit 0 whether it passed last frame's late pass, LOD above
+        std::unique_ptr<VulkanBuffer> mClusterJobBuffer;  // Instance and submesh of every cluster job, the late pass's jobs start at maxClusterJobs
+        std::unique_ptr<VulkanBuffer> mClusterDispatchBuffer; // One VkDispatchIndirectCommand per pass, a workgroup per cluster job
+        std::vector<SceneFrame> mFrames;
+        uint32_t mCullFrameIndex = 0;
+
+        uint32_t mVertexCount = 0;
+        uint32_t mIndexCount = 0;
+        uint32_t mSubmeshCount = 0;
+        uint32_t mLodRangeCount = 0;
+        uint32_t mMeshletCount = 0;
+        std::vector<GPUMesh> mMeshes;
+        std::vector<GPUSubmesh> mSubmeshes;
+
+        float mLodErrorThreshold = 1.0f; // Pixels
+        float mLodHysteresis = 0.2f;
+
+        // Main thread
+        std::vector<GPUInstance> mInstances;
+        std::vector<GPUInstanceID> mFreeInstances;
+        std::vector<GPUInstanceID> mDirtyInstances;
+        std::vector<bool> mInstanceDirty;
+        BoundingBoxSoA mInstanceBounds;
+        uint32_t mStaticRevision = 0;
+
+        // Render thread
+        std::vector<GPUInstance> mDrawnInstances;
+        BoundingBoxSoA mDrawnBounds;
+        std::vector<GPUInstanceID> mPendingUploads;
+        std::vector<bool> mUploadPending;
+        std::vector<GPUInstanceID> mLastUploadedInstances; // Their previous state is still the one before last frame's upload
+        std::vector<GPUInstanceID> mHistoryInstances;      // Scratch, whose previous state Update refreshes
+        uint32_t mDrawnMeshletCount = 0;
+        uint32_t mDrawnStaticRevision = 0;
+        float mCullLodErrorThreshold = 1.0f;
+        float mCullLodHysteresis = 0.2f;
+    };
+
+}
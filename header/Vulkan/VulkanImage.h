@@ -1,14 +1,24 @@
+#pragma once
+
 #include "VulkanUtils.h"
 #include "VulkanContext.h"
 
+#include <Asset/TextureFormat.h>
+
+#include <utility>
+
 namespace VKRE {
 
     struct ImageInfo {
-        VkImage image;
-        VkImageView imageView;
-        VmaAllocation allocation;
-        VkFormat format;
-        VkExtent3D extent;
+        VkImage image = VK_NULL_HANDLE;
+        VkImageView imageView = VK_NULL_HANDLE;
+        VmaAllocation allocation = VK_NULL_HANDLE;
+        VkFormat format = VK_FORMAT_UNDEFINED;
+        VkExtent3D extent{};
+        uint32_t mipLevels = 1;
+        uint32_t arrayLayers = 1;
+        VkImageUsageFlags usage = 0;
+        VkImageAspectFlags aspectMask = 0;
     };
 
     class VulkanImage2D {
@@ -18,19 +28,40 @@ namespace VKRE {
 
         ImageInfo& GetImageInfo() { return mImageInfo; }
 
-        void CreateImage(VkFormat format, VkImageUsageFlags usageFlags, VkExtent3D extent, VkImageAspectFlags aspectFlags, VmaAllocationCreateInfo& info);
+        // More than one layer makes the view a 2D array
+        void CreateImage(VkFormat format, VkImageUsageFlags usageFlags, VkExtent3D extent, VkImageAspectFlags aspectFlags, VmaAllocationCreateInfo& info, uint32_t mipLevels = 1, uint32_t arrayLayers = 1);
         void Release();
 
+        // Recreates the image and its view on destination, a defragmentation move target, and records copying every mip and layer over.
+        // The image has to be in SHADER_READ_ONLY_OPTIMAL and have been created with TRANSFER_SRC usage, it's back in that layout after the
+        // copy. The old image and view are returned, they stay bound to the old memory and may only go once the copy has finished.
+        std::pair<VkImage, VkImageView> RecordMove(VkCommandBuffer cmd, VmaAllocation destination);
+
+        // Streamed textures only keep the mips from the resident mip down in memory, image mip 0 is mip GetResidentMip() of the source texture.
+        // Sampling needs no adjustment since the hardware derives the LOD from the smaller image, only the streaming feedback has to add it back.
+        uint32_t GetResidentMip() const { return mResidentMip; }
+        void SetResidentMip(uint32_t mip) { mResidentMip = mip; }
+
+    private:
+        VkImageCreateInfo GetCreateInfo() const;
+        void CreateImageView();
+
     private:
         std::shared_ptr<VulkanContext> mContext;
         ImageInfo mImageInfo;
+        uint32_t mResidentMip = 0;
     };
 
 
     namespace ImageUtils {
         void TransitionImage(VkCommandBuffer cmd, VkImage image, VkImageLayout currentLayout, VkImageLayout newLayout);
+        // For layouts that don't tell the aspect apart, like a depth image going to or from a transfer layout
+        void TransitionImage(VkCommandBuffer cmd, VkImage image, VkImageLayout currentLayout, VkImageLayout newLayout, VkImageAspectFlags aspectMask);
         void CopyImage(VkCommandBuffer cmd, VkImage src, VkImage dest, VkExtent2D srcSize, VkExtent2D dstSize);
         VkImageSubresourceRange ImageSubSourceRange(VkImageAspectFlags aspectMask);
+
+        VkFormat GetTextureFormat(TextureFormat::PixelFormat format, bool srgb);
+        bool IsBlockCompressed(VkFormat format);
     };
 
 };
@@ -0,0 +1,26 @@
+#pragma once
+
+#include "VulkanUtils.h"
+#include "VulkanContext.h"
+
+#include <functional>
+#include <memory>
+
+namespace VKRE {
+
+    // Records and submits one-off command buffers (uploads, layout setup) outside of the frame loop and waits for them to finish
+    class VulkanImmediateSubmit {
+    public:
+        VulkanImmediateSubmit(std::shared_ptr<VulkanContext> context);
+        ~VulkanImmediateSubmit();
+
+        void Submit(std::function<void(VkCommandBuffer cmd)>&& function);
+
+    private:
+        std::shared_ptr<VulkanContext> mContext;
+        VkCommandPool mCommandPool = VK_NULL_HANDLE;
+        VkCommandBuffer mCommandBuffer = VK_NULL_HANDLE;
+        VkFence mFence = VK_NULL_HANDLE;
+    };
+
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+#include "VulkanUtils.h"
+#include "VulkanContext.h"
+#include "VulkanBuffer.h"
+#include "VulkanImmediateSubmit.h"
+
+#include <Asset/MeshAsset.h>
+
+#include <memory>
+#include <vector>
+
+namespace VKRE {
+
+    class VulkanMesh {
+    public:
+        VulkanMesh(std::shared_ptr<VulkanContext> context);
+        ~VulkanMesh();
+
+        // Copies the cooked vertex, index and meshlet streams into a staging buffer and from there into device local buffers. Fails for
+        // meshes without vertices or indices, missing meshlet streams are left without a buffer and a meshlet count of 0.
+        bool Upload(VulkanImmediateSubmit& submitter, const MeshAsset& asset);
+        void Release();
+
+        VulkanBuffer& GetVertexBuffer() { return *mVertexBuffer; }
+        VulkanBuffer& GetIndexBuffer() { return *mIndexBuffer; }
+        VkDeviceAddress GetVertexBufferAddress() const { return mVertexBuffer->GetBufferInfo().deviceAddress; }
+        VkDeviceAddress GetMeshletBufferAddress() const { return mMeshletBuffer->GetBufferInfo().deviceAddress; }
+        VkDeviceAddress GetMeshletVertexBufferAddress() const { return mMeshletVertexBuffer->GetBufferInfo().deviceAddress; }
+        VkDeviceAddress GetMeshletTriangleBufferAddress() const { return mMeshletTriangleBuffer->GetBufferInfo().deviceAddress; }
+
+        const std::vector<MeshFormat::Submesh>& GetSubmeshes() const { return mSubmeshes; }
+        const MeshFormat::Bounds& GetBounds() const { return mBounds; }
+        uint32_t GetIndexCount() const { return mIndexCount; }
+        uint32_t GetMeshletCount() const { return mMeshletCount; }
+        uint32_t GetMeshletTriangleCount() const { return mMeshletTriangleCount; }
+
+    private:
+        std::shared_ptr<VulkanContext> mContext;
+        std::unique_ptr<VulkanBuffer> mVertexBuffer;
+        std::unique_ptr<VulkanBuffer> mIndexBuffer;
+        std::unique_ptr<VulkanBuffer> mMeshletBuffer;
+        std::unique_ptr<VulkanBuffer> mMeshletVertexBuffer;
+        std::unique_ptr<VulkanBuffer> mMeshletTriangleBuffer;
+
+        std::vector<MeshFormat::Submesh> mSubmeshes;
+        MeshFormat::Bounds mBounds{};
+        uint32_t mIndexCount = 0;
+        uint32_t mMeshletCount = 0;
+        uint32_t mMeshletTriangleCount = 0;
+    };
+
+}
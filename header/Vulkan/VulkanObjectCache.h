@@ -0,0 +1,76 @@
+#pragma once
+
+#include "VulkanUtils.h"
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <span>
+#include <vector>
+
+namespace VKRE {
+
+    enum class CachedObjectType {
+        SAMPLER, DESCRIPTOR_SET_LAYOUT, PIPELINE_LAYOUT, SHADER_MODULE, COUNT
+    };
+
+    struct ObjectCacheStats {
+        uint64_t hits = 0;
+        uint64_t misses = 0; // Also the number of objects of the type the cache created
+    };
+
+    // Deduplicates immutable Vulkan objects by their create info. Asking twice for an object with the same create info returns the
+    // same handle, which stays valid for as long as the cache lives, so two pipelines built with the same set layouts and push constant
+    // ranges share one layout and their descriptor sets stay compatible. The cache owns everything it hands out, nothing it returns
+    // may be destroyed by the caller.
+    //
+    // Every create info is flattened into a key of 32-bit words. Lookups walk an insert-only bucket chain whose heads are atomics, they
+    // never lock. A miss takes the type's mutex, checks the chain again and creates the object before publishing its entry. Entries
+    // are never removed, so a reader can't see one go away.
+    //
+    // pNext chains may only hold structures that are part of the key, see the .cpp. Anything else aborts.
+    class VulkanObjectCache {
+    public:
+        explicit VulkanObjectCache(VkDevice device);
+        ~VulkanObjectCache();
+
+        VulkanObjectCache(const VulkanObjectCache&) = delete;
+        VulkanObjectCache& operator=(const VulkanObjectCache&) = delete;
+
+        VkSampler GetSampler(const VkSamplerCreateInfo& info);
+        VkDescriptorSetLayout GetDescriptorSetLayout(const VkDescriptorSetLayoutCreateInfo& info);
+        VkPipelineLayout GetPipelineLayout(const VkPipelineLayoutCreateInfo& info);
+        VkShaderModule GetShaderModule(std::span<const uint32_t> code);
+
+        ObjectCacheStats GetStats(CachedObjectType type) const;
+
+    private:
+        static constexpr uint32_t BUCKET_COUNT = 256;
+
+        template <typename Handle> struct Table {
+            struct Entry {
+                uint64_t hash;
+                std::vector<uint32_t> key;
+                Handle handle;
+                Entry* next;
+            };
+
+            std::atomic<Entry*> buckets[BUCKET_COUNT]{};
+            std::mutex insertMutex;
+            std::atomic<uint64_t> hits{ 0 };
+            std::atomic<uint64_t> misses{ 0 };
+        };
+
+        // create is only called on a miss, with the type's mutex held
+        template <typename Handle, typename Create> Handle GetOrCreate(Table<Handle>& table, const std::vector<uint32_t>& key, Create&& create);
+        template <typename Handle, typename Destroy> void DestroyTable(Table<Handle>& table, Destroy&& destroy);
+
+    private:
+        VkDevice mDevice;
+        Table<VkSampler> mSamplers;
+        Table<VkDescriptorSetLayout> mSetLayouts;
+        Table<VkPipelineLayout> mPipelineLayouts;
+        Table<VkShaderModule> mShaderModules;
+    };
+
+}
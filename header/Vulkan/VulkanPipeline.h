@@ -0,0 +1,91 @@
+#pragma once
+
+#include "VulkanUtils.h"
+#include "VulkanContext.h"
+
+#include <filesystem>
+#include <memory>
+#include <span>
+#include <string_view>
+#include <vector>
+
+namespace VKRE {
+
+    namespace PipelineUtils {
+        // Shaders are compiled to SPIR-V by the build into VKRE_SHADER_DIR, name is the source file name, e.g. "ClusterCull.comp"
+        std::filesystem::path GetShaderPath(std::string_view name);
+        // The SPIR-V of a compiled shader, modules are created from it through the context's object cache
+        std::vector<uint32_t> LoadShaderCode(std::string_view name);
+
+        // Reads every compiled shader into memory ahead of pipeline creation, which needs no device and so can run during startup while
+        // the device is being created. LoadShaderCode uses the preloaded code when it's there and reads the file otherwise.
+        void PreloadShaders();
+        void ReleasePreloadedShaders();
+    }
+
+    // All resources are reached through buffer device addresses in the push constants, so most compute pipelines need no descriptor sets.
+    // Pipeline layouts and shader modules come from the context's object cache, pipelines with the same layout share it.
+    class VulkanComputePipeline {
+    public:
+        VulkanComputePipeline(std::shared_ptr<VulkanContext> context);
+        ~VulkanComputePipeline();
+
+        void CreatePipeline(std::string_view shaderName, uint32_t pushConstantSize, std::span<const VkDescriptorSetLayout> setLayouts = {});
+        void Release();
+
+        void Bind(VkCommandBuffer cmd) const;
+        void PushConstants(VkCommandBuffer cmd, const void* data, uint32_t size) const;
+        template <typename T> void PushConstants(VkCommandBuffer cmd, const T& data) const { PushConstants(cmd, &data, sizeof(T)); }
+
+        VkPipeline GetPipeline() const { return mPipeline; }
+        VkPipelineLayout GetLayout() const { return mLayout; }
+
+    private:
+        std::shared_ptr<VulkanContext> mContext;
+        VkPipeline mPipeline = VK_NULL_HANDLE;
+        VkPipelineLayout mLayout = VK_NULL_HANDLE;
+    };
+
+    // Pipelines render with dynamic rendering and pull their vertices through buffer device addresses, so there's no vertex input state
+    // and no render pass. Viewport and scissor are dynamic.
+    struct GraphicsPipelineSpecs {
+        std::string_view vertexShader;
+        std::string_view fragmentShader;           // Left empty for depth only pipelines
+        std::vector<VkFormat> colorFormats;
+        VkFormat depthFormat = VK_FORMAT_UNDEFINED;
+        uint32_t viewMask = 0;                     // Multiview, the pipeline renders once per set bit with that bit's index in gl_ViewIndex
+
+        bool depthTest = true;
+        bool depthWrite = true;
+        VkCompareOp depthCompareOp = VK_COMPARE_OP_LESS_OR_EQUAL;
+        VkCullModeFlags cullMode = VK_CULL_MODE_BACK_BIT;
+        VkFrontFace frontFace = VK_FRONT_FACE_COUNTER_CLOCKWISE; // Camera projections flip y, so counter clockwise stays front facing
+
+        uint32_t pushConstantSize = 0;
+        VkShaderStageFlags pushConstantStages = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT;
+        std::vector<VkDescriptorSetLayout> setLayouts;
+    };
+
+    class VulkanGraphicsPipeline {
+    public:
+        VulkanGraphicsPipeline(std::shared_ptr<VulkanContext> context);
+        ~VulkanGraphicsPipeline();
+
+        void CreatePipeline(const GraphicsPipelineSpecs& specs);
+        void Release();
+
+        void Bind(VkCommandBuffer cmd) const;
+        void PushConstants(VkCommandBuffer cmd, const void* data, uint32_t size) const;
+        template <typename T> void PushConstants(VkCommandBuffer cmd, const T& data) const { PushConstants(cmd, &data, sizeof(T)); }
+
+        VkPipeline GetPipeline() const { return mPipeline; }
+        VkPipelineLayout GetLayout() const { return mLayout; }
+
+    private:
+        std::shared_ptr<VulkanContext> mContext;
+        VkPipeline mPipeline = VK_NULL_HANDLE;
+        VkPipelineLayout mLayout = VK_NULL_HANDLE;
+        VkShaderStageFlags mPushConstantStages = 0;
+    };
+
+}
@@ -5,33 +5,62 @@
 #include "VulkanSwapChain.h"
 #include "VulkanContext.h"
 
+#include <Core/EventBus.h>
 #include <Window/GlfwWindow.h>
+#include <Window/WindowEvents.h>
+
+#include <atomic>
 
 namespace VKRE {
 
+    // A window's surface, swap chain and the semaphores of its frames. Every presenter shares the context's device, the renderer
+    // acquires from all of them, records one command buffer and presents them together.
     class VulkanPresenter {
     public:
-        VulkanPresenter(std::shared_ptr<VulkanContext> context);
+        // The context's own window uses the context's surface, other windows get their own. Must be created on the main thread, the
+        // swap chain is sized from the window's framebuffer.
+        VulkanPresenter(std::shared_ptr<VulkanContext> context, Window& window, EventBus& eventBus, uint32_t framesInFlight);
         ~VulkanPresenter();
 
-        void ResizeSwapChain();
+        // Extents come from the window's framebuffer, which only the main thread may query
+        void ResizeSwapChain(uint32_t width, uint32_t height);
+        // Applies a pending resize and acquires the next image, signalling GetImageAvailableSemaphore(frameIndex). Returns false when
+        // the window has nothing to show this frame, it's minimised, was just resized or its swap chain is out of date.
+        bool AcquireImage(uint32_t frameIndex);
+
         VulkanSwapChain& GetSwapChain() { return mSwapChain; }
+        const Window* GetWindow() const { return mWindow; }
 
         const std::vector<VkImage>& GetImages() const { return mSwapChainImages; }
         const std::vector<VkImageView>& GetImageViews() const { return mSwapChainImageViews; }
+        uint32_t GetImageIndex() const { return mImageIndex; } // Last acquired
 
+        VkSemaphore& GetImageAvailableSemaphore(uint32_t frameIndex) { return mImageAvailableSemaphores[frameIndex]; }
         VkSemaphore& GetRenderCompleteSemaphore(uint32_t index) { return mRenderCompleteSemaphores[index]; }
 
     private:
-        void CreateSwapChain();
+        void CreateSwapChain(uint32_t width, uint32_t height);
         void DestroySwapChain();
 
+        // Run on the thread that dispatches the bus, AcquireImage picks the results up on the render thread
+        void OnFramebufferResize(const FramebufferResizeEvent& event);
+        void OnMinimize(const WindowMinimizeEvent& event);
+
     private:
         std::shared_ptr<VulkanContext> mContext;
+        Window* mWindow;
+        EventBus& mEventBus;
+        VkSurfaceKHR mSurface;
+        bool mOwnsSurface;
         VulkanSwapChain mSwapChain{};
         std::vector<VkImage> mSwapChainImages;
         std::vector<VkImageView> mSwapChainImageViews;
-        std::vector<VkSemaphore> mRenderCompleteSemaphores;
+        std::vector<VkSemaphore> mRenderCompleteSemaphores; // By swap chain image, the present waits on them
+        std::vector<VkSemaphore> mImageAvailableSemaphores; // By frame in flight, the submit waits on them
+        uint32_t mImageIndex = 0;
+
+        std::atomic<uint64_t> mPendingExtent{ 0 }; // Width in the high 32 bits, height in the low ones, 0 when the swap chain is up to date
+        std::atomic<bool> mMinimized{ false };
     };
 
 }
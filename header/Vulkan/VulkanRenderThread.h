@@ -0,0 +1,43 @@
+#pragma once
+
+#include "VulkanRenderer.h"
+
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+namespace VKRE {
+
+    // Runs the renderer on its own thread so the main thread can simulate frame N+1 while frame N is recorded, submitted and presented.
+    // The main thread fills a RenderSnapshot and hands it over with Submit, which captures the main thread's changes into it and swaps
+    // it with the one the render thread last used, so the two are recycled without allocating. Submit only waits for the previous
+    // frame's recording to finish, which is what frees that snapshot. Recording reads nothing but the snapshot and the render
+    // thread's own side of the GPU scene, lights, texture streamer and virtual textures, so the main thread never waits for the CPU
+    // work in it, like shadow caster culling and streaming, unless that takes longer than a whole simulated frame.
+    class VulkanRenderThread {
+    public:
+        explicit VulkanRenderThread(VulkanRenderer& renderer);
+        ~VulkanRenderThread(); // Lets the frame in flight finish submitting
+
+        VulkanRenderThread(const VulkanRenderThread&) = delete;
+        VulkanRenderThread& operator=(const VulkanRenderThread&) = delete;
+
+        // snapshot comes back holding the previous frame's, clear its queue before filling it again. Returns as soon as the previous
+        // frame is recorded, this one is recorded in the background.
+        void Submit(RenderSnapshot& snapshot);
+
+    private:
+        void Loop();
+
+    private:
+        VulkanRenderer& mRenderer;
+        RenderSnapshot mSnapshot;
+
+        std::mutex mMutex;
+        std::condition_variable mCondition;
+        bool mPending = false;  // mSnapshot was handed over and isn't recorded yet
+        bool mStopping = false;
+        std::thread mThread;
+    };
+
+}
@@ -2,30 +2,170 @@
 
 #include "VulkanUtils.h"
 
+#include "VulkanClusteredLighting.h"
 #include "VulkanContext.h"
+#include "VulkanDefragmenter.h"
+#include "VulkanDepthPyramid.h"
+#include "VulkanDescriptorAllocator.h"
+#include "VulkanFrameCapture.h"
 #include "VulkanFrameManager.h"
+#include "VulkanGPUScene.h"
 #include "VulkanPresenter.h"
 #include "VulkanImage.h"
+#include "VulkanImmediateSubmit.h"
+#include "VulkanMesh.h"
+#include "VulkanPipeline.h"
+#include "VulkanShadowCascades.h"
+#include "VulkanTemporalUpscaler.h"
+#include "VulkanTextureStreamer.h"
+#include "VulkanVirtualTextureCache.h"
+
+#include <Asset/ImageAsset.h>
+#include <Asset/TextureAsset.h>
+#include <Core/EventBus.h>
+#include <Core/JobSystem.h>
+#include <Scene/Camera.h>
+#include <Scene/RenderQueue.h>
 
 #include <memory>
+#include <span>
+#include <vector>
 
 namespace VKRE {
 
+    // Pipeline field of the draw keys pushed into the queue given to Render
+    enum RenderQueuePipeline : uint32_t {
+        RENDER_QUEUE_PIPELINE_GEOMETRY = 0
+    };
+
+    struct VulkanRendererSpecs {
+        // Fraction of the main window's resolution the scene is rendered at, per axis. The temporal upscaler reconstructs the rest.
+        float renderScale = 0.67f;
+        TemporalUpscalerSpecs upscaler;
+        FrameCaptureSpecs capture;
+        DefragmenterSpecs defragmenter;
+        VirtualTextureSpecs virtualTextures;
+    };
+
+    // Everything about a frame that the main thread decides, handed over whole so it can move on to the next frame. Camera and queue
+    // are filled by the caller, the rest by VulkanRenderer::Capture.
+    struct RenderSnapshot {
+        Camera camera;
+        RenderQueue queue; // Must be sorted, it's drawn after the culled geometry of the late pass
+
+        GPUSceneSnapshot scene;
+        LightingSnapshot lighting;
+        TextureStreamerSnapshot streamedTextures;
+        VirtualTextureSnapshot virtualTextures;
+        FrameCaptureSnapshot capture;
+        std::vector<std::unique_ptr<VulkanPresenter>> addedPresenters;
+        std::vector<const Window*> removedWindows;
+        glm::vec4 clearColor{ 0.0f };
+        bool depthPrePass = true;
+    };
+
     class VulkanRenderer {
     public:
-        VulkanRenderer(std::shared_ptr<VulkanContext> context);
+        // Presents to the context's window, more can be added with AddWindow. Swap chains follow their window's framebuffer size and
+        // minimised state through the event bus.
+        VulkanRenderer(std::shared_ptr<VulkanContext> context, JobSystem& jobSystem, EventBus& eventBus, const VulkanRendererSpecs& specs = {});
         ~VulkanRenderer();
 
-        void Render();
+        // A frame is split so it can be pipelined with the simulation, see VulkanRenderThread. Capture runs on the main thread and copies
+        // what it changed in the GPU scene, lights, textures and windows into the snapshot. WaitForFrame, RecordFrame and SubmitFrame
+        // run on the render thread and only read the snapshot and the render thread's side of each subsystem, so the main thread can
+        // keep changing its side while they run. RecordFrame applies the snapshot first, even when it returns false because there's
+        // nothing to submit, so a skipped frame loses nothing.
+        void Capture(RenderSnapshot& snapshot);
+        void WaitForFrame();
+        bool RecordFrame(RenderSnapshot& snapshot);
+        void SubmitFrame();
+        // Capture and the three in a row, for single threaded use
+        void Render(RenderSnapshot& snapshot);
+        // At the reduced render resolution, the upscaler's output is what the windows show
         std::shared_ptr<VulkanImage2D> GetDrawImage() { return mDrawImage; }
 
-        void ClearImage(VkCommandBuffer cmd, std::shared_ptr<VulkanImage2D> image);
+        // Every window shows the frame, scaled to its swap chain, and all of them are presented with one vkQueuePresentKHR. Called on
+        // the main thread, the change is captured with the next snapshot. A removed window must outlive the recording of that snapshot,
+        // its surface is destroyed there.
+        void AddWindow(Window& window);
+        void RemoveWindow(const Window& window);
+
+        // Lays down depth for all geometry before shading, so each pixel is only shaded once. Pays off when overdraw is high.
+        void SetDepthPrePass(bool enabled) { mDepthPrePass = enabled; }
+        void SetClearColor(const glm::vec4& color) { mClearColor = color; }
+
+        // Nothing when the mesh is missing streams it can't do without
+        std::shared_ptr<VulkanMesh> UploadMesh(const MeshAsset& asset);
+        std::shared_ptr<VulkanImage2D> UploadTexture(const DecodedImage& image, VkFormat format = VK_FORMAT_R8G8B8A8_UNORM);
+        // Uploads mips [firstMip, mipCount) of a cooked texture, firstMip becomes mip 0 of the created image
+        std::shared_ptr<VulkanImage2D> UploadTexture(const TextureAsset& asset, uint32_t firstMip = 0);
+        VulkanImmediateSubmit& GetImmediateSubmit() { return *mImmediateSubmit; }
+        VulkanTextureStreamer& GetTextureStreamer() { return *mTextureStreamer; }
+        VulkanVirtualTextureCache& GetVirtualTextures() { return *mVirtualTextures; }
+        VulkanDefragmenter& GetDefragmenter() { return *mDefragmenter; }
+        VulkanGPUScene& GetScene() { return *mScene; }
+        VulkanClusteredLighting& GetLighting() { return *mLighting; }
+        VulkanShadowCascades& GetShadows() { return *mShadows; }
+        VulkanTemporalUpscaler& GetUpscaler() { return *mUpscaler; }
+        // Captures the upscaled frame, what the main window shows
+        VulkanFrameCapture& GetFrameCapture() { return *mFrameCapture; }
 
     private:
+        // One dynamic rendering pass over the draw lists of the given culling passes, then the render queue if there is one
+        struct GeometryPass {
+            const VulkanGraphicsPipeline* pipeline;
+            std::span<const SceneCullPass> cullPasses;
+            const RenderQueue* queue = nullptr;
+            bool clearColor = false;
+            bool clearDepth = false;
+            bool depthOnly = false;
+        };
+
+        void DrawGeometry(VkCommandBuffer cmd, const glm::mat4& viewProjection, const GeometryPass& pass);
+        void ApplyWindowChanges(RenderSnapshot& snapshot);
+
+    private:
+        struct GeometryPushConstants {
+            glm::mat4 viewProjection;
+            VkDeviceAddress vertices;
+            VkDeviceAddress instances;
+            VkDeviceAddress draws;
+            VkDeviceAddress lighting;
+            VkDeviceAddress previousInstances;
+            VkDeviceAddress temporalView;
+            VkDeviceAddress virtualTextures; // Past what Scene.vert declares, only the fragment shader reads these
+            VkDeviceAddress streamedTextures;
+        };
+        static_assert(sizeof(GeometryPushConstants) <= 128, "The least maxPushConstantsSize devices have to support");
+
         std::shared_ptr<VulkanContext> mContext;
+        EventBus& mEventBus;
         std::unique_ptr<VulkanFrameManager> mFrameManager;
-        std::unique_ptr<VulkanPresenter> mPresenter;
+        std::vector<std::unique_ptr<VulkanPresenter>> mPresenters; // The context's window first
+        std::vector<VulkanPresenter*> mAcquiredPresenters;          // Acquired by RecordFrame, presented by SubmitFrame
+        std::vector<std::unique_ptr<VulkanPresenter>> mAddedPresenters; // Since the last Capture
+        std::vector<const Window*> mRemovedWindows;
+        std::unique_ptr<VulkanImmediateSubmit> mImmediateSubmit;
+        std::unique_ptr<VulkanDescriptorAllocator> mDescriptorAllocator; // Sets that live for one frame
+        std::unique_ptr<VulkanDefragmenter> mDefragmenter;
+        std::unique_ptr<VulkanTextureStreamer> mTextureStreamer;
+        std::unique_ptr<VulkanVirtualTextureCache> mVirtualTextures;
+        std::unique_ptr<VulkanGPUScene> mScene;
+        std::unique_ptr<VulkanClusteredLighting> mLighting;
+        std::unique_ptr<VulkanShadowCascades> mShadows;
+        std::unique_ptr<VulkanGraphicsPipeline> mGeometryPipeline; // Shades, tests depth with GREATER_OR_EQUAL and writes it
+        std::unique_ptr<VulkanGraphicsPipeline> mDepthPipeline;    // Depth only, for the pre-pass
+        std::unique_ptr<VulkanGraphicsPipeline> mShadingPipeline;  // Shades after the pre-pass, tests for EQUAL depth without writing
         std::shared_ptr<VulkanImage2D> mDrawImage; // TODO: Move to SceneRenderer?
+        std::shared_ptr<VulkanImage2D> mDepthImage;
+        std::shared_ptr<VulkanImage2D> mMotionImage; // Written next to the colour by every shading pass
+        std::unique_ptr<VulkanTemporalUpscaler> mUpscaler;
+        std::unique_ptr<VulkanFrameCapture> mFrameCapture;
+        std::unique_ptr<VulkanDepthPyramid> mDepthPyramid;
+        glm::vec4 mClearColor{ 0.02f, 0.02f, 0.03f, 1.0f };
+        bool mDepthPrePass = true;
+        glm::vec4 mDrawnClearColor{ 0.0f }; // The snapshot's, for the frame being recorded
 
         VulkanUtils::DeletionQueue mDeletionQueue;
     };
@@ -0,0 +1,134 @@
+#pragma once
+
+#include "VulkanUtils.h"
+#include "VulkanContext.h"
+#include "VulkanBuffer.h"
+#include "VulkanGPUScene.h"
+#include "VulkanImage.h"
+#include "VulkanPipeline.h"
+
+#include <Core/JobSystem.h>
+#include <Scene/Frustum.h>
+#include <Scene/RenderQueue.h>
+
+#include <glm/glm.hpp>
+
+#include <memory>
+#include <vector>
+
+namespace VKRE {
+
+    inline constexpr uint32_t MAX_SHADOW_CASCADES = 4;
+
+    struct ShadowCascadeSpecs {
+        uint32_t cascadeCount = 4;     // At most MAX_SHADOW_CASCADES
+        uint32_t resolution = 2048;
+        float shadowDistance = 150.0f; // From the camera, nothing past it is shadowed
+        float splitLambda = 0.75f;     // Blend between logarithmic (1) and uniform (0) cascade splits
+        float cachePadding = 0.25f;    // Cascades cover that much more than their slice of the view, so the camera can move before they're redrawn
+        float casterDistance = 300.0f; // How far towards the sun casters outside a cascade still throw shadows into it
+        float depthBias = 0.0002f;
+        float normalBias = 1.5f;       // In texels
+    };
+
+    // Must match ShadowData in shaders/include/Shadows.glsl
+    struct ShadowData {
+        glm::mat4 viewProjection[MAX_SHADOW_CASCADES];
+        glm::vec4 splitDistances;
+        glm::vec4 texelSizes;
+        uint32_t cascadeCount;
+        float depthBias;
+        float normalBias;
+        uint32_t padding;
+    };
+    static_assert(sizeof(ShadowData) == 304);
+
+    // The camera the cascades are fitted to
+    struct ShadowView {
+        glm::mat4 inverseView;
+        float verticalFov;
+        float aspectRatio;
+        float nearPlane;
+    };
+
+    // Cascaded shadow maps for the sun, split between a cache and the map that's sampled. Static casters are only drawn into the cache,
+    // and only when it's stale: the sun turned, a cascade had to move, or GPUScene's static revision changed. Every frame the cache is
+    // copied into the shadow map and the GPU_INSTANCE_DYNAMIC casters are drawn over it.
+    //
+    // Cascades are bounding spheres of their slice of the view frustum, so their size doesn't change as the camera turns, padded by
+    // cachePadding and snapped to whole texels. A cascade stays where it is until its slice leaves it.
+    //
+    // Casters are culled on the CPU against every cascade with the SoA frustum culling kernels and drawn through a RenderQueue. That
+    // runs on the render thread, against the GPU scene's drawn copy of the instance bounds, not the one the main thread changes. All
+    // cascades are drawn in a single multiview pass, the vertex shader picks the cascade's matrix with gl_ViewIndex.
+    class VulkanShadowCascades {
+    public:
+        VulkanShadowCascades(std::shared_ptr<VulkanContext> context, VulkanGPUScene& scene, JobSystem& jobSystem, uint32_t framesInFlight, const ShadowCascadeSpecs& specs = {});
+        ~VulkanShadowCascades();
+
+        // Must be recorded after GPUScene::Update and outside of rendering. The shadow map is in VK_IMAGE_LAYOUT_DEPTH_READ_ONLY_OPTIMAL
+        // for the fragment shader once this returns.
+        void Render(VkCommandBuffer cmd, uint32_t frameIndex, const ShadowView& view, const glm::vec3& sunDirection);
+        void SetEnabled(bool enabled) { mEnabled = enabled; }
+        // Forces the static casters to be redrawn next frame
+        void Invalidate() { mCacheValid = false; }
+
+        // Set 0 of the shading pipelines, the shadow map as a sampler2DArrayShadow at binding 0
+        VkDescriptorSetLayout GetSetLayout() const { return mSetLayout; }
+        VkDescriptorSet GetDescriptorSet() const { return mDescriptorSet; }
+        VkDeviceAddress GetShadowDataAddress(uint32_t frameIndex) const { return mFrames[frameIndex].dataBuffer->GetBufferInfo().deviceAddress; }
+        uint32_t GetStaticRedrawCount() const { return mStaticRedrawCount; }
+
+    private:
+        struct Cascade {
+            glm::vec3 center{ 0.0f }; // Light space, snapped to the cascade's texels
+            float radius = 0.0f;
+            float splitDistance = 0.0f;
+            glm::mat4 viewProjection{ 1.0f };
+            Frustum frustum{};
+        };
+
+        struct PushConstants {
+            VkDeviceAddress shadows;
+            VkDeviceAddress vertices;
+            VkDeviceAddress instances;
+            VkDeviceAddress draws;
+        };
+
+        struct ShadowFrame {
+            std::unique_ptr<VulkanBuffer> dataBuffer;
+        };
+
+        // Returns whether any cascade had to move
+        bool PlaceCascades(const ShadowView& view, const glm::mat4& lightView);
+        void QueueCasters(bool dynamicCasters);
+        void DrawCasters(VkCommandBuffer cmd, uint32_t frameIndex, VulkanImage2D& target, bool clear);
+
+    private:
+        std::shared_ptr<VulkanContext> mContext;
+        VulkanGPUScene& mScene;
+        JobSystem& mJobSystem;
+        ShadowCascadeSpecs mSpecs;
+        std::unique_ptr<VulkanGraphicsPipeline> mPipeline;
+
+        std::unique_ptr<VulkanImage2D> mStaticCache;
+        std::unique_ptr<VulkanImage2D> mShadowMap;
+        VkSampler mSampler = VK_NULL_HANDLE;
+        VkDescriptorSetLayout mSetLayout = VK_NULL_HANDLE;
+        VkDescriptorPool mDescriptorPool = VK_NULL_HANDLE;
+        VkDescriptorSet mDescriptorSet = VK_NULL_HANDLE;
+        std::vector<ShadowFrame> mFrames;
+
+        Cascade mCascades[MAX_SHADOW_CASCADES];
+        glm::vec3 mSunDirection{ 0.0f };
+        uint32_t mStaticRevision = 0;
+        bool mCacheValid = false;
+        bool mEnabled = true;
+        uint32_t mStaticRedrawCount = 0;
+
+        RenderQueue mCasterQueue;
+        std::vector<uint64_t> mCasterVisibility;
+        std::vector<uint64_t> mCascadeVisibility;
+    };
+
+}
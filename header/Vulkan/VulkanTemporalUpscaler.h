@@ -0,0 +1,98 @@
+#pragma once
+
+#include "VulkanUtils.h"
+#include "VulkanContext.h"
+#include "VulkanBuffer.h"
+#include "VulkanDescriptorAllocator.h"
+#include "VulkanImage.h"
+#include "VulkanPipeline.h"
+
+#include <glm/glm.hpp>
+
+#include <memory>
+#include <vector>
+
+namespace VKRE {
+
+    struct TemporalUpscalerSpecs {
+        float historyBlend = 0.1f;    // Weight of a new sample that lands right on an output pixel, the history keeps the rest
+        float varianceClamp = 1.25f;  // History is clamped to the mean of the new samples' neighbourhood plus this many standard deviations
+    };
+
+    // Must match TemporalView in shaders/include/Temporal.glsl
+    struct TemporalView {
+        glm::mat4 viewProjection;         // Without jitter
+        glm::mat4 previousViewProjection; // Last frame's, without jitter
+        glm::mat4 inverseViewProjection;
+        glm::vec2 jitter;                 // Input pixels, the projection moved the image by this much
+        glm::uvec2 inputSize;
+        glm::uvec2 outputSize;
+        uint32_t resetHistory;
+        float historyBlend;
+        float varianceClamp;
+        uint32_t padding[3];
+    };
+    static_assert(sizeof(TemporalView) == 240, "TemporalView must match the std430 layout used by the shaders");
+
+    // Reconstructs an output resolution image from a scene rendered at a lower resolution. Every frame the projection is moved by a
+    // different sub-pixel offset of a Halton sequence, so over a few frames the input samples cover the output pixels densely. A compute
+    // pass then resolves each output pixel from the nearby input samples, weighted by their distance to it, and blends that with the
+    // history, the last output reprojected with the motion vectors. The history is clamped to the colour range of the new samples around
+    // the pixel, so whatever was disoccluded or changed doesn't ghost.
+    //
+    // The scene writes motion vectors, the screen space change in uv since last frame, see Scene.frag. Pixels nothing was drawn to are
+    // reprojected from the camera alone.
+    class VulkanTemporalUpscaler {
+    public:
+        // The inputs are rendered at their own extent, the output's is given
+        VulkanTemporalUpscaler(std::shared_ptr<VulkanContext> context, VulkanDescriptorAllocator& descriptorAllocator, std::shared_ptr<VulkanImage2D> colorImage, std::shared_ptr<VulkanImage2D> depthImage,
+            std::shared_ptr<VulkanImage2D> motionImage, VkExtent2D outputExtent, uint32_t framesInFlight, const TemporalUpscalerSpecs& specs = {});
+        ~VulkanTemporalUpscaler();
+
+        // Picks this frame's jitter and fills its view, viewProjection is the unjittered one the scene is drawn with
+        void BeginFrame(uint32_t frameIndex, const glm::mat4& viewProjection);
+        // The projection moved by this frame's jitter
+        glm::mat4 Jitter(const glm::mat4& projection) const;
+        // The next frame starts from its own samples only, for camera cuts
+        void ResetHistory() { mHistoryValid = false; }
+
+        // Colour and motion must be in VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL and depth in VK_IMAGE_LAYOUT_DEPTH_READ_ONLY_OPTIMAL. The
+        // output is left in VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL.
+        void Resolve(VkCommandBuffer cmd, uint32_t frameIndex);
+
+        VkDeviceAddress GetViewAddress(uint32_t frameIndex) const { return mViewBuffers[frameIndex]->GetBufferInfo().deviceAddress; }
+        VulkanImage2D& GetOutputImage() { return *mHistoryImages[mOutputIndex]; }
+        VkExtent2D GetOutputExtent() const { return mOutputExtent; }
+
+    private:
+        struct PushConstants {
+            VkDeviceAddress view;
+        };
+
+    private:
+        std::shared_ptr<VulkanContext> mContext;
+        VulkanDescriptorAllocator& mDescriptorAllocator;
+        std::shared_ptr<VulkanImage2D> mColorImage;
+        std::shared_ptr<VulkanImage2D> mDepthImage;
+        std::shared_ptr<VulkanImage2D> mMotionImage;
+        TemporalUpscalerSpecs mSpecs;
+        VulkanComputePipeline mPipeline;
+
+        VkSampler mPointSampler = VK_NULL_HANDLE;
+        VkSampler mLinearSampler = VK_NULL_HANDLE;
+        VkDescriptorSetLayout mSetLayout = VK_NULL_HANDLE; // Allocated per frame, the history images swap roles every frame
+
+        // Each frame's output is the next frame's history, the two swap roles every frame
+        std::unique_ptr<VulkanImage2D> mHistoryImages[2];
+        std::vector<std::unique_ptr<VulkanBuffer>> mViewBuffers;
+        VkExtent2D mInputExtent;
+        VkExtent2D mOutputExtent;
+        uint32_t mOutputIndex = 0;
+        uint32_t mJitterPhaseCount = 8;
+        uint64_t mFrameCount = 0;
+        glm::vec2 mJitter{ 0.0f };
+        glm::mat4 mPreviousViewProjection{ 1.0f };
+        bool mHistoryValid = false;
+    };
+
+}
@@ -0,0 +1,154 @@
+#pragma once
+
+#include "VulkanUtils.h"
+#include "VulkanContext.h"
+#include "VulkanBuffer.h"
+#include "VulkanDefragmenter.h"
+#include "VulkanFrameManager.h"
+#include "VulkanImage.h"
+
+#include <Asset/TextureAsset.h>
+
+#include <atomic>
+#include <memory>
+#include <optional>
+#include <vector>
+
+namespace VKRE {
+
+    using StreamedTextureID = uint32_t;
+
+    struct TextureStreamerSpecs {
+        VkDeviceSize memoryBudget = 512ull * 1024 * 1024;
+        uint32_t maxTextures = 4096;                      // Also the size of the descriptor array the scene shader samples them from
+        uint32_t maxMaterials = 256;                      // Submesh material indices below it can be bound to a streamed texture
+        uint32_t tailMipSize = 128;                       // Mips this size and smaller are loaded on registration and never evicted
+        VkDeviceSize maxUploadBytesPerFrame = 16ull * 1024 * 1024;
+        uint32_t evictAfterFrames = 240;                  // A texture nobody sampled for this long drops back to its tail
+    };
+
+    // Must match StreamedTextureData in shaders/include/TextureStreaming.glsl, followed by maxMaterials texture IDs
+    struct StreamedTextureData {
+        VkDeviceAddress feedback;
+        VkDeviceAddress residency;
+        VkDeviceAddress materials; // The streamed texture of every material, UINT32_MAX for none
+        uint32_t frameNumber;      // Picks the pixels that write feedback
+        uint32_t materialCount;
+    };
+    static_assert(sizeof(StreamedTextureData) == 32);
+
+    // What the main thread changed since the last VulkanTextureStreamer::Capture, applied on the render thread
+    struct TextureStreamerSnapshot {
+        std::vector<TextureAsset> registered;    // In ID order, following the ones applied before
+        std::vector<uint32_t> materialTextures;  // The whole table, indexed by material
+        VkDeviceSize memoryBudget = 0;
+    };
+
+    // Keeps each registered texture resident at the mip the GPU actually asks for, within a memory budget.
+    //
+    // Shaders record the finest mip they sampled per texture with atomicMin into a feedback buffer (shaders/include/TextureStreaming.glsl),
+    // which is copied into a readback buffer at the end of the frame. When that frame slot comes around again its fence has already been
+    // waited on, so the requests are read without stalling. Residency changes reallocate the image with a different mip count: the
+    // mips both images share are copied on the GPU, missing ones are uploaded from the mapped .vktex, and the old image is destroyed
+    // once the frame that last used it has finished. Everything is recorded into the frame's own command buffer.
+    //
+    // Every texture sits at its ID in an array of combined image samplers, one descriptor set per frame in flight. A set is rewritten
+    // in BeginFrame wherever a texture's view changed since the set was last used, after a residency change or a defragmentation move.
+    // The scene shader samples the streamed texture bound to a submesh's material, see BindMaterial, for its albedo.
+    //
+    // Register, BindMaterial and SetMemoryBudget are called on the main thread and only reach the render thread through Capture and
+    // Apply, everything else runs on the render thread.
+    class VulkanTextureStreamer {
+    public:
+        VulkanTextureStreamer(std::shared_ptr<VulkanContext> context, VulkanDefragmenter& defragmenter, uint32_t framesInFlight, const TextureStreamerSpecs& specs = {});
+        ~VulkanTextureStreamer();
+
+        // The mip tail is uploaded by the first frame that applies the registration, the rest streams in once shaders ask for it
+        std::optional<StreamedTextureID> Register(TextureAsset&& asset);
+        // Submeshes with the material are textured with it from the next frame on
+        bool BindMaterial(uint32_t materialIndex, StreamedTextureID texture);
+        void UnbindMaterial(uint32_t materialIndex);
+
+        // Main thread, moves the registrations since the last call into the snapshot
+        void Capture(TextureStreamerSnapshot& snapshot);
+        // Render thread, every captured snapshot in order, including the ones of frames that were never recorded
+        void Apply(TextureStreamerSnapshot& snapshot);
+
+        // Must be recorded after the frame's fence has been waited on, before any draw that samples streamed textures
+        void BeginFrame(VulkanFrameData& frame, uint32_t frameIndex);
+        // Must be recorded after the last draw that writes feedback
+        void EndFrame(VkCommandBuffer cmd, uint32_t frameIndex);
+
+        // uint32_t per texture, the finest source mip requested this frame. Cleared to UINT32_MAX by BeginFrame.
+        VkDeviceAddress GetFeedbackBufferAddress() const { return mFeedbackBuffer->GetBufferInfo().deviceAddress; }
+        // uint32_t per texture, the current resident mip. Shaders add it to the LOD they compute for the feedback.
+        VkDeviceAddress GetResidencyBufferAddress(uint32_t frameIndex) const { return mFrames[frameIndex].residencyBuffer->GetBufferInfo().deviceAddress; }
+        // Both addresses above and the material table, what shaders/include/TextureStreaming.glsl reads as StreamedTextureData
+        VkDeviceAddress GetDataAddress(uint32_t frameIndex) const { return mFrames[frameIndex].dataBuffer->GetBufferInfo().deviceAddress; }
+
+        // Binding 0 is an array of maxTextures textures indexed by StreamedTextureID, only the registered ones are written
+        VkDescriptorSetLayout GetSetLayout() const { return mSetLayout; }
+        VkDescriptorSet GetDescriptorSet(uint32_t frameIndex) const { return mFrames[frameIndex].descriptorSet; }
+
+        void SetMemoryBudget(VkDeviceSize budget) { mSpecs.memoryBudget = budget; }
+        VkDeviceSize GetMemoryBudget() const { return mSpecs.memoryBudget; }
+        // Safe to read from any thread, it trails the render thread by however long the load takes
+        VkDeviceSize GetResidentBytes() const { return mResidentBytes.load(std::memory_order_relaxed); }
+
+    private:
+        struct StreamedTexture {
+            TextureAsset asset;
+            std::shared_ptr<VulkanImage2D> image; // Null until BeginFrame uploads the tail
+            uint32_t residentMip = 0;
+            uint32_t tailMip = 0;
+            uint32_t requestedMip = UINT32_MAX;
+            uint32_t prefetchedMip = UINT32_MAX;  // Requests are prefetched from the file one frame before they're streamed in
+            uint64_t lastRequestedFrame = 0;
+        };
+
+        struct StreamerFrame {
+            std::unique_ptr<VulkanBuffer> readbackBuffer;
+            std::unique_ptr<VulkanBuffer> residencyBuffer;
+            std::unique_ptr<VulkanBuffer> dataBuffer;
+            VkDescriptorSet descriptorSet = VK_NULL_HANDLE;
+            std::vector<VkImageView> writtenViews; // What descriptorSet holds, indexed by texture
+        };
+
+        void UploadTails(VulkanFrameData& frame);
+        void ReadFeedback(uint32_t frameIndex);
+        void UpdateResidency(VulkanFrameData& frame);
+        void UpdateResidencyBuffer(uint32_t frameIndex);
+        void UpdateDataBuffer(uint32_t frameIndex);
+        void UpdateDescriptorSet(uint32_t frameIndex);
+
+        // Reallocates the texture with mips [residentMip, mipCount), recording the copies into cmd
+        void RecordResidencyChange(VkCommandBuffer cmd, VulkanUtils::DeletionQueue& deletionQueue, StreamedTexture& texture, uint32_t residentMip);
+        void EvictFor(VulkanFrameData& frame, VkDeviceSize requiredBytes, StreamedTextureID requester);
+        VkDeviceSize GetMipRangeSize(const StreamedTexture& texture, uint32_t firstMip) const;
+
+    private:
+        std::shared_ptr<VulkanContext> mContext;
+        VulkanDefragmenter& mDefragmenter;
+        TextureStreamerSpecs mSpecs;
+
+        VkSampler mSampler = VK_NULL_HANDLE;
+        VkDescriptorSetLayout mSetLayout = VK_NULL_HANDLE;
+        VkDescriptorPool mDescriptorPool = VK_NULL_HANDLE;
+
+        // Main thread
+        std::vector<TextureAsset> mRegistered;    // Since the last Capture
+        uint32_t mRegisteredCount = 0;
+        std::vector<uint32_t> mMaterialBindings;  // Indexed by material
+
+        // Render thread
+        std::vector<StreamedTexture> mTextures;
+        std::vector<uint32_t> mMaterialTextures;  // Indexed by material
+        VkDeviceSize mMemoryBudget = 0;
+        std::unique_ptr<VulkanBuffer> mFeedbackBuffer;
+        std::vector<StreamerFrame> mFrames;
+
+        std::atomic<VkDeviceSize> mResidentBytes = 0;
+        uint64_t mFrameNumber = 0;
+    };
+
+}
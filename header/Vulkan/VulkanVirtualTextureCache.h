@@ -0,0 +1,209 @@
+#pragma once
+
+#include "VulkanUtils.h"
+#include "VulkanContext.h"
+#include "VulkanBuffer.h"
+#include "VulkanFrameManager.h"
+#include "VulkanImage.h"
+#include "VulkanImmediateSubmit.h"
+
+#include <Asset/TextureAsset.h>
+#include <Core/JobSystem.h>
+
+#include <atomic>
+#include <list>
+#include <memory>
+#include <optional>
+#include <unordered_set>
+#include <vector>
+
+namespace VKRE {
+
+    using VirtualTextureID = uint32_t;
+
+    struct VirtualTextureSpecs {
+        TextureFormat::PixelFormat format = TextureFormat::PixelFormat::BC7; // Every registered texture has to be cooked in it
+        bool srgb = true;
+        uint32_t tileSize = 128;              // Texels, a power of two
+        uint32_t tileBorder = 4;              // Texels each tile repeats of its neighbours on every side, for filtering across tile edges. Multiple of 4.
+        uint32_t cacheTilesPerSide = 32;      // The physical cache holds this many tiles squared
+        uint32_t maxVirtualSize = 32768;      // Largest texture side, together with the tile size it sets the page table's size
+        uint32_t maxTextures = 32;            // At most 256
+        uint32_t maxMaterials = 256;          // Submesh material indices below it can be bound to a virtual texture
+        uint32_t maxFeedbackRequests = 16384; // Per frame, requests past it are dropped and come again next frame
+        uint32_t maxPendingLoads = 64;        // Tiles being read from their files at once
+        uint32_t maxUploadsPerFrame = 32;
+        float loadPriority = 0.0f;            // Of the tile loads on the job system
+    };
+
+    // Must match VirtualTextureInfo in shaders/include/VirtualTexturing.glsl
+    struct GPUVirtualTexture {
+        uint32_t width;
+        uint32_t height;
+        uint32_t tailMip;
+        uint32_t padding;
+    };
+    static_assert(sizeof(GPUVirtualTexture) == 16);
+
+    // Must match VirtualTextureData in shaders/include/VirtualTexturing.glsl, followed by maxTextures GPUVirtualTextures
+    struct VirtualTextureData {
+        VkDeviceAddress feedback;
+        VkDeviceAddress materials; // The virtual texture of every material, UINT32_MAX for none
+        uint32_t feedbackCapacity;
+        uint32_t tileSize;
+        uint32_t tileBorder;
+        uint32_t paddedTileSize;
+        uint32_t cacheSize;        // Texels per side of the physical cache
+        uint32_t textureCount;
+        uint32_t frameNumber;      // Picks the pixels that write feedback
+        uint32_t materialCount;
+    };
+    static_assert(sizeof(VirtualTextureData) == 48);
+
+    // What the main thread changed since the last VulkanVirtualTextureCache::Capture, applied on the render thread
+    struct VirtualTextureSnapshot {
+        std::vector<TextureAsset> registered;    // In ID order, following the ones applied before
+        std::vector<uint32_t> materialTextures;  // The whole table, indexed by material
+    };
+
+    // Virtual texturing without sparse residency, for textures far larger than what fits into memory, like terrain and large decals.
+    //
+    // Every mip of a registered texture down to its tail, the first mip that fits into one tile, is split into tiles. Resident tiles live
+    // in one physical cache image, each with a border of its neighbours' texels so bilinear filtering doesn't need to know where a tile
+    // ends. A page table image, one layer per texture and one mip per texture mip, holds for every page the cache slot of its tile, or
+    // of its nearest resident ancestor's when it isn't resident. Tails are uploaded by the first frame that knows the texture and never
+    // evicted, so every page always resolves to something.
+    //
+    // Shaders sample through shaders/include/VirtualTexturing.glsl, which appends the tile it wanted to a feedback buffer. That buffer is
+    // read back like the texture streamer's. Missing tiles are cut out of the mapped .vktex on the job system, coarser mips first, and
+    // copied into the cache a frame later. When the cache is full the least recently requested tile makes room.
+    //
+    // The scene shader samples the virtual texture bound to a submesh's material, see BindMaterial, for its albedo.
+    //
+    // Register and BindMaterial are called on the main thread and only reach the render thread through Capture and Apply, everything
+    // else runs on the render thread.
+    class VulkanVirtualTextureCache {
+    public:
+        VulkanVirtualTextureCache(std::shared_ptr<VulkanContext> context, VulkanImmediateSubmit& immediateSubmit, JobSystem& jobSystem, uint32_t framesInFlight, const VirtualTextureSpecs& specs = {});
+        // Expects the device to be idle, waits for the loads still running
+        ~VulkanVirtualTextureCache();
+
+        // The tail is uploaded by the first frame that applies the registration, the rest is loaded once shaders ask for it
+        std::optional<VirtualTextureID> Register(TextureAsset&& asset);
+        // Submeshes with the material are textured with it from the next frame on
+        bool BindMaterial(uint32_t materialIndex, VirtualTextureID texture);
+        void UnbindMaterial(uint32_t materialIndex);
+
+        // Main thread, moves the registrations since the last call into the snapshot
+        void Capture(VirtualTextureSnapshot& snapshot);
+        // Render thread, every captured snapshot in order, including the ones of frames that were never recorded
+        void Apply(VirtualTextureSnapshot& snapshot);
+
+        // Must be recorded after the frame's fence has been waited on, before any draw that samples virtual textures
+        void BeginFrame(VulkanFrameData& frame, uint32_t frameIndex);
+        // Must be recorded after the last draw that writes feedback
+        void EndFrame(VkCommandBuffer cmd, uint32_t frameIndex);
+
+        // Binding 0 is the physical cache, binding 1 the page table
+        VkDescriptorSetLayout GetSetLayout() const { return mSetLayout; }
+        VkDescriptorSet GetDescriptorSet() const { return mDescriptorSet; }
+        VkDeviceAddress GetDataAddress(uint32_t frameIndex) const { return mFrames[frameIndex].dataBuffer->GetBufferInfo().deviceAddress; }
+
+    private:
+        struct VirtualMip {
+            uint32_t pagesX;
+            uint32_t pagesY;
+            uint32_t firstPage; // Into pageSlots
+        };
+
+        struct VirtualTexture {
+            TextureAsset asset;
+            uint32_t tailMip = 0;
+            std::vector<VirtualMip> mips;     // Down to the tail
+            std::vector<uint32_t> pageSlots;  // Cache slot of every page of every mip, INVALID_SLOT when it isn't resident
+            bool dirty = true;                // The page table doesn't match pageSlots yet
+            bool tailPending = true;          // Applied, BeginFrame hasn't uploaded the tail yet
+        };
+
+        struct CacheSlot {
+            uint32_t tile;
+            uint64_t lastUsedFrame = 0;
+            bool pinned = false;
+            std::list<uint32_t>::iterator lru;
+        };
+
+        enum class LoadState : uint32_t {
+            FREE, LOADING, LOADED, UPLOADING
+        };
+
+        struct LoadSlot {
+            std::atomic<LoadState> state{ LoadState::FREE };
+            uint32_t tile = 0;
+            uint32_t frameIndex = 0; // That copied it into the cache, while UPLOADING
+        };
+
+        struct VirtualTextureFrame {
+            std::unique_ptr<VulkanBuffer> readbackBuffer;
+            std::unique_ptr<VulkanBuffer> dataBuffer;
+        };
+
+        void UploadTails(VulkanFrameData& frame);
+        void ReadFeedback(uint32_t frameIndex);
+        void StartLoad(LoadSlot& slot, uint32_t tile);
+        void UploadLoadedTiles(VkCommandBuffer cmd, uint32_t frameIndex);
+        void UploadPageTables(VulkanFrameData& frame);
+        void UpdateDataBuffer(uint32_t frameIndex);
+
+        // A free slot, or the least recently used one evicted. Nothing when every tile in the cache was asked for this frame.
+        std::optional<uint32_t> AcquireCacheSlot();
+        void Evict(uint32_t slot);
+        void Touch(uint32_t slot);
+        uint32_t& GetPageSlot(uint32_t tile);
+        // Into pageSlots, the page of ancestorMip that covers page (x, y) of mip, picked the same way SampleVirtualTexture does
+        static uint32_t GetAncestorPage(const VirtualTexture& texture, uint32_t mip, uint32_t x, uint32_t y, uint32_t ancestorMip);
+
+        // Cuts a tile and its border out of the mapped mip, in the layout the cache's copy expects
+        void ExtractTile(uint32_t tile, std::byte* destination) const;
+        VkBufferImageCopy GetTileCopy(uint32_t slot, VkDeviceSize bufferOffset) const;
+
+    private:
+        std::shared_ptr<VulkanContext> mContext;
+        VulkanImmediateSubmit& mImmediateSubmit;
+        JobSystem& mJobSystem;
+        VirtualTextureSpecs mSpecs;
+
+        uint32_t mPaddedTileSize = 0;
+        uint32_t mPageTableSize = 0;  // Pages per side of the page table's first mip
+        VkDeviceSize mTileBytes = 0;
+
+        std::unique_ptr<VulkanImage2D> mCache;
+        std::unique_ptr<VulkanImage2D> mPageTable;
+        VkSampler mCacheSampler = VK_NULL_HANDLE;
+        VkSampler mPageTableSampler = VK_NULL_HANDLE;
+        VkDescriptorSetLayout mSetLayout = VK_NULL_HANDLE;
+        VkDescriptorPool mDescriptorPool = VK_NULL_HANDLE;
+        VkDescriptorSet mDescriptorSet = VK_NULL_HANDLE;
+
+        // Main thread
+        std::vector<TextureAsset> mRegistered;    // Since the last Capture
+        uint32_t mRegisteredCount = 0;
+        std::vector<uint32_t> mMaterialBindings;  // Indexed by material
+
+        // Render thread
+        std::vector<VirtualTexture> mTextures;
+        std::vector<uint32_t> mMaterialTextures;  // Indexed by material
+        std::vector<CacheSlot> mCacheSlots;
+        std::vector<uint32_t> mFreeSlots;
+        std::list<uint32_t> mLru;           // Evictable slots, least recently used first
+
+        std::vector<LoadSlot> mLoadSlots;
+        std::unique_ptr<VulkanBuffer> mLoadBuffer; // One tile per load slot
+        std::unordered_set<uint32_t> mPendingTiles;
+        std::atomic<uint32_t> mOutstandingLoads{ 0 };
+
+        std::unique_ptr<VulkanBuffer> mFeedbackBuffer;
+        std::vector<VirtualTextureFrame> mFrames;
+        uint64_t mFrameNumber = 0;
+    };
+
+}
@@ -1,69 +1,93 @@
 #pragma once
 
 #include <GLFW/glfw3.h>
+
+#include <bitset>
+#include <cstdint>
+#include <span>
 #include <utility>
+#include <vector>
 
 namespace VKRE {
 
+    enum class InputEventType : uint8_t {
+        KEY_PRESS,
+        KEY_REPEAT,
+        KEY_RELEASE,
+        MOUSE_BUTTON_PRESS,
+        MOUSE_BUTTON_RELEASE,
+        CURSOR_MOVE,
+        SCROLL
+    };
+
+    struct InputEvent {
+        double time;         // glfwGetTime when the callback ran, in seconds
+        InputEventType type;
+        int32_t code;        // GLFW key or mouse button, 0 for cursor and scroll events
+        int32_t mods;        // GLFW_MOD_* bits
+        float x, y;          // Cursor position or scroll offset
+    };
+
+    // Input state is driven by GLFW's callbacks, which run inside glfwPollEvents, instead of polling every key each frame. Keys and mouse
+    // buttons are kept in bitsets, pressed/released are found by comparing them with last frame's. Presses and releases that both land
+    // within one frame still show up as pressed and released. Consumers that need the order of events within a frame read GetEvents.
     class Input {
     public:
         static bool KeyPressed(uint32_t key) { return mPressedKeys[key]; }
-        static bool KeyHeld(uint32_t key) { return glfwGetKey(mCurrentWindow, key) == GLFW_PRESS; }
+        static bool KeyHeld(uint32_t key) { return mKeys[key]; }
         static bool KeyReleased(uint32_t key) { return mReleasedKeys[key]; }
 
         static bool MouseButtonPressed(uint32_t button) { return mPressedMouseButtons[button]; }
-        static bool MouseButtonHeld(uint32_t button) { return glfwGetMouseButton(mCurrentWindow, button); }
+        static bool MouseButtonHeld(uint32_t button) { return mMouseButtons[button]; }
         static bool MouseButtonReleased(uint32_t button) { return mReleasedMouseButtons[button]; }
 
         static void LockMouse() { glfwSetInputMode(mCurrentWindow, GLFW_CURSOR, GLFW_CURSOR_DISABLED); };
         static void UnLockMouse() { glfwSetInputMode(mCurrentWindow, GLFW_CURSOR, GLFW_CURSOR_NORMAL); };
         static bool IsMouseLocked() { return glfwGetInputMode(mCurrentWindow, GLFW_CURSOR) == GLFW_CURSOR_DISABLED; }
 
-        static std::pair<float, float> GetMousePosition() {
-            double x, y;
-            glfwGetCursorPos(mCurrentWindow, &x, &y);
-            return std::make_pair(static_cast<float>(x), static_cast<float>(y));
-        }
+        static std::pair<float, float> GetMousePosition() { return mMousePosition; }
+        // Summed over every scroll event of this frame
+        static std::pair<float, float> GetScrollDelta() { return mScrollDelta; }
+
+        // This frame's events in the order they arrived, cleared when the next frame polls
+        static std::span<const InputEvent> GetEvents() { return mEvents; }
 
     protected:
         static void SetCurrentWindow(GLFWwindow* window) { mCurrentWindow = window; }
-        static void OnUpdate() {
-            glfwPollEvents();
-            for (int key = 0; key < NUM_KEYS; key++) {
-                int current_key_state = glfwGetKey(mCurrentWindow, key);
-
-                mPressedKeys[key] =  current_key_state == GLFW_PRESS && mPreviousKeyState[key] == GLFW_RELEASE;
-                mReleasedKeys[key] = current_key_state == GLFW_RELEASE && mPreviousKeyState[key] == GLFW_PRESS;
-
-                mPreviousKeyState[key] = current_key_state;
-            }
+        static void AttachWindow(GLFWwindow* window);
+        static void OnUpdate();
 
-            for (int button = 0; button < NUM_MOUSE_BUTTONS; button++) {
-                int current_button_state = glfwGetMouseButton(mCurrentWindow, button);
-
-                mPressedMouseButtons[button] =  current_button_state == GLFW_PRESS && mPreviousMouseButtonState[button] == GLFW_RELEASE;
-                mReleasedMouseButtons[button] = current_button_state == GLFW_RELEASE && mPreviousMouseButtonState[button] == GLFW_PRESS;
+        inline static GLFWwindow* mCurrentWindow = nullptr;
 
-                mPreviousMouseButtonState[button] = current_button_state;
-            }
-        }
+    private:
+        static void OnKey(GLFWwindow* window, int key, int scancode, int action, int mods);
+        static void OnMouseButton(GLFWwindow* window, int button, int action, int mods);
+        static void OnCursorMove(GLFWwindow* window, double x, double y);
+        static void OnScroll(GLFWwindow* window, double x, double y);
 
-        inline static GLFWwindow* mCurrentWindow = nullptr;
     protected:
-        inline static const int NUM_KEYS = 348;
-        inline static int mPreviousKeyState[NUM_KEYS] = {0};
-        inline static bool mPressedKeys[NUM_KEYS] = {false};
-        inline static bool mReleasedKeys[NUM_KEYS] = {false};
-
-        inline static const int NUM_MOUSE_BUTTONS= 8;
-        inline static int mPreviousMouseButtonState[NUM_MOUSE_BUTTONS] = {0};
-        inline static bool mPressedMouseButtons[NUM_MOUSE_BUTTONS] = {false};
-        inline static bool mReleasedMouseButtons[NUM_MOUSE_BUTTONS] = {false};
+        inline static constexpr int NUM_KEYS = GLFW_KEY_LAST + 1;
+        inline static std::bitset<NUM_KEYS> mKeys;         // Updated as events arrive
+        inline static std::bitset<NUM_KEYS> mPreviousKeys; // As they were when the last frame polled
+        inline static std::bitset<NUM_KEYS> mKeyPressEvents;
+        inline static std::bitset<NUM_KEYS> mKeyReleaseEvents;
+        inline static std::bitset<NUM_KEYS> mPressedKeys;
+        inline static std::bitset<NUM_KEYS> mReleasedKeys;
+
+        inline static constexpr int NUM_MOUSE_BUTTONS = GLFW_MOUSE_BUTTON_LAST + 1;
+        inline static std::bitset<NUM_MOUSE_BUTTONS> mMouseButtons;
+        inline static std::bitset<NUM_MOUSE_BUTTONS> mPreviousMouseButtons;
+        inline static std::bitset<NUM_MOUSE_BUTTONS> mMouseButtonPressEvents;
+        inline static std::bitset<NUM_MOUSE_BUTTONS> mMouseButtonReleaseEvents;
+        inline static std::bitset<NUM_MOUSE_BUTTONS> mPressedMouseButtons;
+        inline static std::bitset<NUM_MOUSE_BUTTONS> mReleasedMouseButtons;
+
+        inline static std::pair<float, float> mMousePosition{ 0.0f, 0.0f };
+        inline static std::pair<float, float> mScrollDelta{ 0.0f, 0.0f };
+        inline static std::vector<InputEvent> mEvents;
+
     private:
         friend class Window;
     };
 
 }
-
-
-
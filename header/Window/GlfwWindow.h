@@ -4,6 +4,9 @@
 #include <GLFW/glfw3.h>
 
 #include "GlfwInput.h"
+#include "WindowEvents.h"
+
+#include <Core/EventBus.h>
 
 #include <string>
 #include <vector>
@@ -21,7 +24,8 @@ namespace VKRE {
 
     class Window {
     public:
-        Window(const WindowSpecs& specs);
+        // Size, minimise and focus changes are posted to the event bus when one is given
+        Window(const WindowSpecs& specs, EventBus* eventBus = nullptr);
         ~Window();
 
         void OnUpdate() const;
@@ -40,13 +44,23 @@ namespace VKRE {
         void Resize(int width, int height);
 
         void Focus() const { Input::SetCurrentWindow(mGLFWwindow); }
-        std::vector<const char*> GetWindowExtensions() const;
+
+        // Initialises GLFW, done by the first window otherwise. Must be called from the main thread, after it the instance extensions
+        // can be queried from any thread while the window is still being created.
+        static void InitBackend();
+        static std::vector<const char*> GetWindowExtensions();
 
         GLFWwindow* GetGLFWwindow() const { return mGLFWwindow; };
 
+    private:
+        void OnFocus(const WindowFocusEvent& event);
+
     protected:
         GLFWwindow* mGLFWwindow;
         WindowSpecs mSpecs;
+        EventBus* mEventBus;
+
+        static inline uint32_t sWindowCount = 0; // Windows are created and destroyed on the main thread only
     };
 
 }
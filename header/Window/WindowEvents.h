@@ -0,0 +1,33 @@
+#pragma once
+
+#include <cstdint>
+
+namespace VKRE {
+
+    class Window;
+
+    // Posted to the engine's EventBus from the window's GLFW callbacks
+
+    // Window size in screen coordinates
+    struct WindowResizeEvent {
+        Window* window;
+        uint32_t width, height;
+    };
+
+    // Framebuffer size in pixels, what the swap chain has to match. 0x0 while minimised on some platforms.
+    struct FramebufferResizeEvent {
+        Window* window;
+        uint32_t width, height;
+    };
+
+    struct WindowMinimizeEvent {
+        Window* window;
+        bool minimized;
+    };
+
+    struct WindowFocusEvent {
+        Window* window;
+        bool focused;
+    };
+
+}
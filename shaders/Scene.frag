@@ -0,0 +1,55 @@
+#version 460
+#extension GL_EXT_buffer_reference : require
+#extension GL_EXT_nonuniform_qualifier : require
+
+#include "SceneData.glsl"
+#include "Lighting.glsl"
+#include "Temporal.glsl"
+#include "VirtualTexturing.glsl"
+
+layout(push_constant) uniform PushConstants {
+    mat4 viewProjection;
+    VertexBuffer vertices;
+    GPUInstanceBuffer instances;
+    GPUDrawDataBuffer draws;
+    LightingData lighting;
+    GPUInstanceBuffer previousInstances;
+    TemporalView temporal;
+    VirtualTextureData virtualTextures;
+    StreamedTextureData streamedTextures;
+} pc;
+
+layout(set = 0, binding = 0) uniform sampler2DArrayShadow shadowMap;
+layout(set = 1, binding = 0) uniform sampler2D virtualTextureCache;
+layout(set = 1, binding = 1) uniform usampler2DArray virtualPageTable;
+layout(set = 2, binding = 0) uniform sampler2D streamedTextures[];
+
+layout(location = 0) in vec3 inNormal;
+layout(location = 1) in vec4 inColor;
+layout(location = 2) in vec2 inUV;
+layout(location = 3) in vec3 inWorldPosition;
+layout(location = 4) in vec4 inCurrentClip;
+layout(location = 5) in vec4 inPreviousClip;
+layout(location = 6) flat in uint inMaterial;
+
+layout(location = 0) out vec4 outColor;
+layout(location = 1) out vec2 outMotion;
+
+void main() {
+    // The material is the same for the whole draw, so the branch doesn't split a quad
+    vec4 albedo = inColor;
+    uint virtualTexture = GetMaterialVirtualTexture(pc.virtualTextures, inMaterial);
+    uint streamedTexture = GetMaterialStreamedTexture(pc.streamedTextures, inMaterial);
+    if (virtualTexture != INVALID_VIRTUAL_TEXTURE) {
+        albedo *= SampleVirtualTexture(pc.virtualTextures, virtualTextureCache, virtualPageTable, virtualTexture, inUV);
+    } else if (streamedTexture != INVALID_STREAMED_TEXTURE) {
+        // Draws of different materials can share a wave, so the index isn't uniform
+        float lod = textureQueryLod(streamedTextures[nonuniformEXT(streamedTexture)], inUV).x;
+        RecordTextureFeedback(pc.streamedTextures.feedback, pc.streamedTextures.residency, streamedTexture, lod, pc.streamedTextures.frameNumber);
+        albedo *= texture(streamedTextures[nonuniformEXT(streamedTexture)], inUV);
+    }
+
+    vec3 color = ShadeClustered(pc.lighting, shadowMap, inWorldPosition, normalize(inNormal), albedo.rgb, gl_FragCoord.xy, gl_FragCoord.z);
+    outColor = vec4(color, albedo.a);
+    outMotion = ComputeMotion(inCurrentClip, inPreviousClip);
+}
@@ -0,0 +1,50 @@
+#version 460
+#extension GL_EXT_buffer_reference : require
+
+#include "SceneData.glsl"
+#include "Lighting.glsl"
+#include "Temporal.glsl"
+
+// Draws come from VulkanGPUScene, each draw's firstInstance is its index into the draw data written by the culling pass
+layout(push_constant) uniform PushConstants {
+    mat4 viewProjection;
+    VertexBuffer vertices;
+    GPUInstanceBuffer instances;
+    GPUDrawDataBuffer draws;
+    LightingData lighting;
+    GPUInstanceBuffer previousInstances;
+    TemporalView temporal;
+    // Followed by the virtual and streamed texture data only the fragment shader reads
+} pc;
+
+// The depth pre-pass and the shading pass run this shader with different pipelines, the shading pass tests for equal depth
+invariant gl_Position;
+
+layout(location = 0) out vec3 outNormal;
+layout(location = 1) out vec4 outColor;
+layout(location = 2) out vec2 outUV;
+layout(location = 3) out vec3 outWorldPosition;
+// Unjittered, for the motion vectors
+layout(location = 4) out vec4 outCurrentClip;
+layout(location = 5) out vec4 outPreviousClip;
+layout(location = 6) flat out uint outMaterial;
+
+void main() {
+    GPUDrawData draw = pc.draws.draws[gl_InstanceIndex];
+    GPUInstance instance = pc.instances.instances[draw.instanceIndex];
+    Vertex vertex = pc.vertices.vertices[gl_VertexIndex];
+
+    vec4 worldPosition = instance.transform * vec4(vertex.position, 1.0);
+    gl_Position = pc.viewProjection * worldPosition;
+    outNormal = mat3(instance.transform) * vertex.normal;
+    outColor = vertex.color;
+    outUV = vec2(vertex.uvX, vertex.uvY);
+    outWorldPosition = worldPosition.xyz;
+    outMaterial = draw.materialIndex;
+
+    // A slot that held another mesh last frame, or nothing, has no motion of its own yet
+    GPUInstance previous = pc.previousInstances.instances[draw.instanceIndex];
+    mat4 previousTransform = previous.meshIndex == instance.meshIndex ? previous.transform : instance.transform;
+    outCurrentClip = pc.temporal.viewProjection * worldPosition;
+    outPreviousClip = pc.temporal.previousViewProjection * (previousTransform * vec4(vertex.position, 1.0));
+}
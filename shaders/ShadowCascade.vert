@@ -0,0 +1,22 @@
+#version 460
+#extension GL_EXT_buffer_reference : require
+#extension GL_EXT_multiview : require
+
+#include "SceneData.glsl"
+#include "Shadows.glsl"
+
+// Draws shadow casters into every cascade at once, multiview runs the shader once per cascade with the cascade in gl_ViewIndex
+layout(push_constant) uniform PushConstants {
+    ShadowData shadows;
+    VertexBuffer vertices;
+    GPUInstanceBuffer instances;
+    GPUDrawDataBuffer draws;
+} pc;
+
+void main() {
+    GPUDrawData draw = pc.draws.draws[gl_InstanceIndex];
+    GPUInstance instance = pc.instances.instances[draw.instanceIndex];
+    Vertex vertex = pc.vertices.vertices[gl_VertexIndex];
+
+    gl_Position = pc.shadows.viewProjection[gl_ViewIndex] * (instance.transform * vec4(vertex.position, 1.0));
+}
@@ -0,0 +1,62 @@
+// GPU side of VulkanDepthPyramid, DepthPyramidInfo must match its C++ counterpart in header/Vulkan/VulkanDepthPyramid.h
+#ifndef DEPTH_PYRAMID_GLSL
+#define DEPTH_PYRAMID_GLSL
+
+#extension GL_EXT_buffer_reference : require
+
+const uint DEPTH_PYRAMID_MAX_LEVELS = 16;
+
+// Neutral element of CombineDepth, depth is always in [0, 1]
+const vec2 EMPTY_DEPTH_RANGE = vec2(1.0, 0.0);
+
+layout(buffer_reference, std430, buffer_reference_align = 16) readonly buffer DepthPyramidInfo {
+    uvec2 depthSize;
+    uint levelCount;
+    uint reverseZ;
+    uvec4 levels[DEPTH_PYRAMID_MAX_LEVELS]; // Width, height and first texel of each level
+};
+
+// Min and max depth per texel
+layout(buffer_reference, std430, buffer_reference_align = 8) coherent buffer DepthPyramidBuffer {
+    vec2 texels[];
+};
+
+vec2 CombineDepth(vec2 a, vec2 b) {
+    return vec2(min(a.x, b.x), max(a.y, b.y));
+}
+
+vec2 LoadDepthRange(DepthPyramidInfo info, DepthPyramidBuffer pyramid, uint level, uvec2 texel) {
+    uvec4 extent = info.levels[level];
+    if (texel.x >= extent.x || texel.y >= extent.y)
+        return EMPTY_DEPTH_RANGE;
+    return pyramid.texels[extent.z + texel.y * extent.x + texel.x];
+}
+
+// Tests a screen rectangle in [0, 1] UV space against the pyramid. nearestDepth is the depth of the object's closest point, the object is
+// hidden when that point is behind the farthest depth drawn over the whole rectangle. The level is picked so the rectangle spans at most
+// 2x2 texels, which together always cover it.
+bool IsOccluded(DepthPyramidInfo info, DepthPyramidBuffer pyramid, vec2 uvMin, vec2 uvMax, float nearestDepth) {
+    vec2 depthSize = vec2(info.depthSize);
+    vec2 pixelMin = clamp(uvMin, 0.0, 1.0) * depthSize;
+    vec2 pixelMax = clamp(uvMax, 0.0, 1.0) * depthSize;
+
+    float extent = max(pixelMax.x - pixelMin.x, pixelMax.y - pixelMin.y);
+    uint level = uint(max(ceil(log2(max(extent, 1.0))) - 1.0, 0.0));
+    level = min(level, info.levelCount - 1u);
+
+    float texelSize = float(2u << level);
+    uvec2 lastTexel = info.levels[level].xy - 1u;
+    uvec2 texelMin = min(uvec2(pixelMin / texelSize), lastTexel);
+    uvec2 texelMax = min(uvec2(pixelMax / texelSize), lastTexel);
+
+    vec2 depthRange = EMPTY_DEPTH_RANGE;
+    for (uint y = texelMin.y; y <= texelMax.y; y++) {
+        for (uint x = texelMin.x; x <= texelMax.x; x++) {
+            depthRange = CombineDepth(depthRange, LoadDepthRange(info, pyramid, level, uvec2(x, y)));
+        }
+    }
+
+    return info.reverseZ != 0u ? nearestDepth < depthRange.x : nearestDepth > depthRange.y;
+}
+
+#endif
@@ -0,0 +1,113 @@
+// GPU side of VulkanClusteredLighting, every struct here must match its C++ counterpart in header/Vulkan/VulkanClusteredLighting.h
+#ifndef LIGHTING_GLSL
+#define LIGHTING_GLSL
+
+#extension GL_EXT_buffer_reference : require
+
+#include "Shadows.glsl"
+
+const uint LIGHT_TYPE_POINT = 0u;
+const uint LIGHT_TYPE_SPOT = 1u;
+
+struct GPULight {
+    vec3 position;      // World space
+    float range;
+    vec3 color;         // Premultiplied by the intensity
+    uint type;
+    vec3 direction;     // World space, spot lights only
+    float innerConeCos;
+    float outerConeCos;
+    uint padding0;
+    uint padding1;
+    uint padding2;
+};
+
+layout(buffer_reference, std430, buffer_reference_align = 16) readonly buffer GPULightBuffer {
+    GPULight lights[];
+};
+
+// Number of lights binned into each cluster
+layout(buffer_reference, std430, buffer_reference_align = 4) buffer ClusterCountBuffer {
+    uint counts[];
+};
+
+// maxLightsPerCluster light indices per cluster, only the first count of them are valid
+layout(buffer_reference, std430, buffer_reference_align = 4) buffer ClusterLightBuffer {
+    uint lights[];
+};
+
+layout(buffer_reference, std430, buffer_reference_align = 16) readonly buffer LightingData {
+    mat4 view;
+    mat4 inverseProjection;
+    vec4 sunDirection;      // World space, towards the sun
+    vec4 sunColor;
+    vec4 ambientColor;
+    uvec4 gridSize;         // Clusters along x, y and depth, w is maxLightsPerCluster
+    vec2 tileSize;          // Pixels covered by one cluster
+    vec2 screenSize;
+    float nearPlane;
+    float farPlane;
+    float sliceScale;       // Depth slice of a view distance d is log(d) * sliceScale + sliceBias
+    float sliceBias;
+    uint lightCount;
+    uint padding0;
+    uint padding1;
+    uint padding2;
+    GPULightBuffer lights;
+    ClusterCountBuffer clusterCounts;
+    ClusterLightBuffer clusterLights;
+    ShadowData shadows;     // Of the sun
+};
+
+// Distance from the camera plane of a reverse-Z depth value, depth 1 is the near plane and 0 the far plane
+float LinearizeDepth(LightingData data, float depth) {
+    return data.nearPlane * data.farPlane / (data.nearPlane + depth * (data.farPlane - data.nearPlane));
+}
+
+uint GetClusterIndex(LightingData data, vec2 fragCoord, float viewDistance) {
+    uvec3 gridSize = data.gridSize.xyz;
+    uvec2 tile = min(uvec2(fragCoord / data.tileSize), gridSize.xy - 1u);
+    float slice = log(viewDistance) * data.sliceScale + data.sliceBias;
+    uint z = min(uint(max(slice, 0.0)), gridSize.z - 1u);
+    return (z * gridSize.y + tile.y) * gridSize.x + tile.x;
+}
+
+// Inverse square falloff windowed to reach zero at the light's range
+float DistanceAttenuation(float distanceSquared, float range) {
+    float ratio = distanceSquared / (range * range);
+    float window = clamp(1.0 - ratio * ratio, 0.0, 1.0);
+    return window * window / max(distanceSquared, 0.0001);
+}
+
+float SpotAttenuation(GPULight light, vec3 toLight) {
+    float cosAngle = dot(-toLight, light.direction);
+    return smoothstep(light.outerConeCos, light.innerConeCos, cosAngle);
+}
+
+// Diffuse lighting from the shadowed sun, the ambient term and every light binned into the fragment's cluster
+vec3 ShadeClustered(LightingData data, sampler2DArrayShadow shadowMap, vec3 worldPosition, vec3 normal, vec3 albedo, vec2 fragCoord, float depth) {
+    float viewDistance = LinearizeDepth(data, depth);
+    float sunLight = max(dot(normal, data.sunDirection.xyz), 0.0);
+    if (sunLight > 0.0)
+        sunLight *= SampleSunShadow(data.shadows, shadowMap, worldPosition, normal, viewDistance);
+    vec3 radiance = data.ambientColor.rgb + data.sunColor.rgb * sunLight;
+
+    uint cluster = GetClusterIndex(data, fragCoord, viewDistance);
+    uint count = data.clusterCounts.counts[cluster];
+    uint first = cluster * data.gridSize.w;
+    for (uint i = 0u; i < count; i++) {
+        GPULight light = data.lights.lights[data.clusterLights.lights[first + i]];
+        vec3 offset = light.position - worldPosition;
+        float distanceSquared = dot(offset, offset);
+        vec3 toLight = offset * inversesqrt(max(distanceSquared, 0.0001));
+
+        float attenuation = DistanceAttenuation(distanceSquared, light.range);
+        if (light.type == LIGHT_TYPE_SPOT)
+            attenuation *= SpotAttenuation(light, toLight);
+        radiance += light.color * attenuation * max(dot(normal, toLight), 0.0);
+    }
+
+    return albedo * radiance;
+}
+
+#endif
@@ -0,0 +1,63 @@
+// GPU side of the cooked mesh layout in header/Asset/MeshFormat.h, every struct here must match its C++ counterpart byte for byte
+#ifndef MESH_DATA_GLSL
+#define MESH_DATA_GLSL
+
+#extension GL_EXT_buffer_reference : require
+
+struct Vertex {
+    vec3 position;
+    float uvX;
+    vec3 normal;
+    float uvY;
+    vec4 color;
+};
+
+struct Bounds {
+    vec3 center;
+    float radius;
+    vec3 extents;
+    float padding;
+};
+
+struct Meshlet {
+    vec3 center;
+    float radius;
+    vec3 coneAxis;
+    float coneCutoff;
+    uint vertexOffset;
+    uint triangleOffset;
+    uint vertexCount;
+    uint triangleCount;
+};
+
+layout(buffer_reference, std430, buffer_reference_align = 16) readonly buffer VertexBuffer {
+    Vertex vertices[];
+};
+
+layout(buffer_reference, std430, buffer_reference_align = 16) readonly buffer MeshletBuffer {
+    Meshlet meshlets[];
+};
+
+layout(buffer_reference, std430, buffer_reference_align = 4) readonly buffer MeshletVertexBuffer {
+    uint vertices[];
+};
+
+// Three 8-bit meshlet local vertex indices per triangle
+layout(buffer_reference, std430, buffer_reference_align = 4) readonly buffer MeshletTriangleBuffer {
+    uint triangles[];
+};
+
+layout(buffer_reference, std430, buffer_reference_align = 4) buffer IndexBuffer {
+    uint indices[];
+};
+
+// VkDrawIndexedIndirectCommand
+struct DrawIndexedCommand {
+    uint indexCount;
+    uint instanceCount;
+    uint firstIndex;
+    int vertexOffset;
+    uint firstInstance;
+};
+
+#endif
@@ -0,0 +1,49 @@
+// What the culling passes of VulkanGPUScene share, SceneCull.comp for the instances and ClusterCull.comp for their meshlets
+#ifndef SCENE_CULLING_GLSL
+#define SCENE_CULLING_GLSL
+
+#extension GL_EXT_buffer_reference : require
+
+#include "SceneData.glsl"
+
+const uint CULL_PASS_EARLY = 0u;
+const uint CULL_PASS_LATE = 1u;
+
+// Must match SceneCullData in VulkanGPUScene.h
+layout(buffer_reference, std430, buffer_reference_align = 16) readonly buffer SceneCullData {
+    mat4 viewProjection;
+    vec4 frustumPlanes[6];  // World space, normals point inside
+    vec3 cameraPosition;
+    float lodScale;         // Pixels per unit of error at distance 1, over the error threshold
+    uint instanceCount;
+    uint maxDrawCount;      // Per pass
+    float lodHysteresis;
+    uint maxClusterJobs;    // Per pass
+    vec2 viewportSize;
+    float projectionScale;  // Pixels covered by one world unit at a view depth of one
+};
+
+layout(buffer_reference, std430, buffer_reference_align = 4) writeonly buffer DrawCommandBuffer {
+    DrawIndexedCommand commands[];
+};
+
+layout(buffer_reference, std430, buffer_reference_align = 4) buffer DrawCountBuffer {
+    uint drawCounts[];
+};
+
+// A submesh of a visible instance whose meshlets are culled one by one
+struct ClusterJob {
+    uint instanceIndex;
+    uint submeshIndex;
+};
+
+layout(buffer_reference, std430, buffer_reference_align = 8) buffer ClusterJobBuffer {
+    ClusterJob jobs[];
+};
+
+// One VkDispatchIndirectCommand per pass packed as three uints, the first of each counts the pass's jobs
+layout(buffer_reference, std430, buffer_reference_align = 4) buffer ClusterDispatchBuffer {
+    uint dispatches[];
+};
+
+#endif
@@ -0,0 +1,90 @@
+// GPU side of VulkanGPUScene, every struct here must match its C++ counterpart in header/Vulkan/VulkanGPUScene.h
+#ifndef SCENE_DATA_GLSL
+#define SCENE_DATA_GLSL
+
+#extension GL_EXT_buffer_reference : require
+
+#include "MeshData.glsl"
+
+const uint INVALID_GPU_MESH = 0xFFFFFFFFu;
+const uint MAX_MESH_LODS = 8u;
+const uint GPU_INSTANCE_QUEUED = 1u;
+
+struct GPUMesh {
+    Bounds bounds;
+    uint firstSubmesh;
+    uint submeshCount;
+    uint firstLodRange;
+    uint lodCount;
+    float lodErrors[MAX_MESH_LODS];
+};
+
+struct GPUSubmesh {
+    uint firstIndex;
+    uint indexCount;
+    int vertexOffset;
+    uint materialIndex;
+    uint firstMeshlet;
+    uint meshletCount;
+    uint padding0;
+    uint padding1;
+};
+
+struct GPUMeshlet {
+    vec3 center;
+    float radius;
+    vec3 coneAxis;
+    float coneCutoff;
+    uint firstIndex;
+    uint indexCount;
+    uint padding0;
+    uint padding1;
+};
+
+struct GPULodRange {
+    uint firstIndex;
+    uint indexCount;
+};
+
+struct GPUInstance {
+    mat4 transform;
+    uint meshIndex;
+    uint flags;
+    uint padding0;
+    uint padding1;
+};
+
+struct GPUDrawData {
+    uint instanceIndex;
+    uint materialIndex;
+};
+
+layout(buffer_reference, std430, buffer_reference_align = 16) readonly buffer GPUMeshBuffer {
+    GPUMesh meshes[];
+};
+
+layout(buffer_reference, std430, buffer_reference_align = 16) readonly buffer GPUSubmeshBuffer {
+    GPUSubmesh submeshes[];
+};
+
+layout(buffer_reference, std430, buffer_reference_align = 16) readonly buffer GPUMeshletBuffer {
+    GPUMeshlet meshlets[];
+};
+
+layout(buffer_reference, std430, buffer_reference_align = 8) readonly buffer GPULodRangeBuffer {
+    GPULodRange lodRanges[];
+};
+
+layout(buffer_reference, std430, buffer_reference_align = 16) readonly buffer GPUInstanceBuffer {
+    GPUInstance instances[];
+};
+
+layout(buffer_reference, std430, buffer_reference_align = 8) buffer GPUDrawDataBuffer {
+    GPUDrawData draws[];
+};
+
+float GetMaxScale(mat4 transform) {
+    return max(length(transform[0].xyz), max(length(transform[1].xyz), length(transform[2].xyz)));
+}
+
+#endif
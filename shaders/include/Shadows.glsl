@@ -0,0 +1,43 @@
+// GPU side of VulkanShadowCascades, ShadowData must match its C++ counterpart in header/Vulkan/VulkanShadowCascades.h
+#ifndef SHADOWS_GLSL
+#define SHADOWS_GLSL
+
+#extension GL_EXT_buffer_reference : require
+
+const uint MAX_SHADOW_CASCADES = 4u;
+
+layout(buffer_reference, std430, buffer_reference_align = 16) readonly buffer ShadowData {
+    mat4 viewProjection[MAX_SHADOW_CASCADES]; // World to cascade clip space, reverse-Z
+    vec4 splitDistances;                      // View distance where each cascade ends
+    vec4 texelSizes;                          // World size of one texel of each cascade
+    uint cascadeCount;                        // 0 turns shadows off
+    float depthBias;
+    float normalBias;                         // In texels
+    uint padding;
+};
+
+// Fraction of the sun's light reaching a point, 3x3 PCF on the cascade covering its view distance. Points past the last cascade are lit.
+float SampleSunShadow(ShadowData shadows, sampler2DArrayShadow shadowMap, vec3 worldPosition, vec3 normal, float viewDistance) {
+    uint cascade = 0u;
+    while (cascade < shadows.cascadeCount && viewDistance > shadows.splitDistances[cascade])
+        cascade++;
+    if (cascade >= shadows.cascadeCount)
+        return 1.0;
+
+    // Moving the lookup off the surface by about a texel keeps it from shadowing itself without a large depth bias
+    vec3 position = worldPosition + normal * shadows.texelSizes[cascade] * shadows.normalBias;
+    vec3 coords = (shadows.viewProjection[cascade] * vec4(position, 1.0)).xyz;
+    vec2 uv = coords.xy * 0.5 + 0.5;
+    // Reverse-Z, nearer the sun is greater and the sampler compares with GREATER_OR_EQUAL
+    float depth = coords.z + shadows.depthBias;
+
+    vec2 texelSize = 1.0 / vec2(textureSize(shadowMap, 0).xy);
+    float lit = 0.0;
+    for (int y = -1; y <= 1; y++) {
+        for (int x = -1; x <= 1; x++)
+            lit += texture(shadowMap, vec4(uv + vec2(x, y) * texelSize, float(cascade), depth));
+    }
+    return lit / 9.0;
+}
+
+#endif
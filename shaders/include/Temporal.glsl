@@ -0,0 +1,24 @@
+// GPU side of VulkanTemporalUpscaler, every struct here must match its C++ counterpart in header/Vulkan/VulkanTemporalUpscaler.h
+#ifndef TEMPORAL_GLSL
+#define TEMPORAL_GLSL
+
+#extension GL_EXT_buffer_reference : require
+
+layout(buffer_reference, std430, buffer_reference_align = 16) readonly buffer TemporalView {
+    mat4 viewProjection;         // Without jitter
+    mat4 previousViewProjection;
+    mat4 inverseViewProjection;
+    vec2 jitter;                 // Input pixels
+    uvec2 inputSize;
+    uvec2 outputSize;
+    uint resetHistory;
+    float historyBlend;
+    float varianceClamp;
+};
+
+// Screen space motion in uv, last frame's uv of the point is uv - motion
+vec2 ComputeMotion(vec4 currentClip, vec4 previousClip) {
+    return (currentClip.xy / currentClip.w - previousClip.xy / previousClip.w) * 0.5;
+}
+
+#endif
@@ -0,0 +1,59 @@
+// Streaming feedback for VulkanTextureStreamer. Include it into any shader that samples streamed textures and call
+// RecordTextureFeedback next to the sample. The two buffer addresses come from VulkanTextureStreamer::GetFeedbackBufferAddress()
+// and GetResidencyBufferAddress(frameIndex), or together with the material table from GetDataAddress(frameIndex) as StreamedTextureData.
+// Scene.frag samples the textures bound to materials out of the streamer's descriptor array.
+#ifndef TEXTURE_STREAMING_GLSL
+#define TEXTURE_STREAMING_GLSL
+
+#extension GL_EXT_buffer_reference : require
+
+layout(buffer_reference, std430, buffer_reference_align = 4) buffer TextureFeedbackBuffer {
+    uint requestedMips[];
+};
+
+layout(buffer_reference, std430, buffer_reference_align = 4) readonly buffer TextureResidencyBuffer {
+    uint residentMips[];
+};
+
+const uint INVALID_STREAMED_TEXTURE = 0xFFFFFFFFu;
+
+layout(buffer_reference, std430, buffer_reference_align = 4) readonly buffer StreamedTextureMaterialBuffer {
+    uint textures[];
+};
+
+// Must match StreamedTextureData in header/Vulkan/VulkanTextureStreamer.h
+layout(buffer_reference, std430, buffer_reference_align = 8) readonly buffer StreamedTextureData {
+    TextureFeedbackBuffer feedback;
+    TextureResidencyBuffer residency;
+    StreamedTextureMaterialBuffer materials; // The streamed texture of every material, INVALID_STREAMED_TEXTURE for none
+    uint frameNumber;                        // Picks the pixels that write feedback
+    uint materialCount;
+};
+
+uint GetMaterialStreamedTexture(StreamedTextureData data, uint materialIndex) {
+    return materialIndex < data.materialCount ? data.materials.textures[materialIndex] : INVALID_STREAMED_TEXTURE;
+}
+
+// Only one pixel of every 8x8 tile writes feedback each frame, rotating through the tile over 64 frames. That keeps the atomics cheap
+// and still covers every texture that takes up more than a handful of pixels within a frame or two.
+bool ShouldRecordTextureFeedback(uint frameNumber) {
+    uvec2 tilePixel = uvec2(gl_FragCoord.xy) & 7u;
+    uint slot = frameNumber & 63u;
+    return tilePixel.x == (slot & 7u) && tilePixel.y == (slot >> 3u);
+}
+
+// The LOD the hardware computes is relative to the resident image, adding the resident mip turns it into a mip of the source texture.
+// Takes the LOD for textures indexed out of a descriptor array, whose query has to carry the nonuniformEXT index itself.
+void RecordTextureFeedback(TextureFeedbackBuffer feedback, TextureResidencyBuffer residency, uint textureId, float lod, uint frameNumber) {
+    if (!ShouldRecordTextureFeedback(frameNumber))
+        return;
+
+    int requestedMip = max(int(floor(lod)) + int(residency.residentMips[textureId]), 0);
+    atomicMin(feedback.requestedMips[textureId], uint(requestedMip));
+}
+
+void RecordTextureFeedback(TextureFeedbackBuffer feedback, TextureResidencyBuffer residency, uint textureId, sampler2D tex, vec2 uv, uint frameNumber) {
+    RecordTextureFeedback(feedback, residency, textureId, textureQueryLod(tex, uv).x, frameNumber);
+}
+
+#endif
@@ -0,0 +1,94 @@
+// GPU side of VulkanVirtualTextureCache, every struct here must match its C++ counterpart in header/Vulkan/VulkanVirtualTextureCache.h.
+// Bind the cache's descriptor set and pass VulkanVirtualTextureCache::GetDataAddress(frameIndex), then sample with SampleVirtualTexture.
+// Scene.frag does both for the textures bound to materials.
+#ifndef VIRTUAL_TEXTURING_GLSL
+#define VIRTUAL_TEXTURING_GLSL
+
+#extension GL_EXT_buffer_reference : require
+
+#include "TextureStreaming.glsl"
+
+const uint INVALID_VIRTUAL_TEXTURE = 0xFFFFFFFFu;
+
+layout(buffer_reference, std430, buffer_reference_align = 4) buffer VirtualTextureFeedbackBuffer {
+    uint count;
+    uint requests[];
+};
+
+layout(buffer_reference, std430, buffer_reference_align = 4) readonly buffer VirtualTextureMaterialBuffer {
+    uint textures[];
+};
+
+struct VirtualTextureInfo {
+    uvec2 size;     // Of mip 0, in texels
+    uint tailMip;   // The first mip that fits into one tile, coarser ones are never sampled
+    uint padding;
+};
+
+layout(buffer_reference, std430, buffer_reference_align = 16) readonly buffer VirtualTextureData {
+    VirtualTextureFeedbackBuffer feedback;
+    VirtualTextureMaterialBuffer materials; // The virtual texture of every material, INVALID_VIRTUAL_TEXTURE for none
+    uint feedbackCapacity;
+    uint tileSize;
+    uint tileBorder;
+    uint paddedTileSize;
+    uint cacheSize;     // Texels per side of the physical cache
+    uint textureCount;
+    uint frameNumber;   // Picks the pixels that write feedback
+    uint materialCount;
+    VirtualTextureInfo textures[];
+};
+
+uint GetMaterialVirtualTexture(VirtualTextureData data, uint materialIndex) {
+    return materialIndex < data.materialCount ? data.materials.textures[materialIndex] : INVALID_VIRTUAL_TEXTURE;
+}
+
+// Same packing as PackTile in src/Vulkan/VulkanVirtualTextureCache.cpp
+uint PackVirtualTile(uint textureId, uint mip, uvec2 page) {
+    return page.x | (page.y << 10u) | (mip << 20u) | (textureId << 24u);
+}
+
+// Sampled with the same rotating pixel as the texture streamer's feedback, a tile that takes up more than a few pixels is asked for
+// within a frame or two
+void RecordVirtualTextureFeedback(VirtualTextureData data, uint tile) {
+    if (!ShouldRecordTextureFeedback(data.frameNumber))
+        return;
+
+    uint index = atomicAdd(data.feedback.count, 1u);
+    if (index < data.feedbackCapacity)
+        data.feedback.requests[index] = tile;
+}
+
+// Samples the mip the derivatives ask for, or the finest resident mip above it while its tile is still loading. Filtering is bilinear
+// within that one mip. uv is clamped to the texture, virtual textures don't repeat. Takes derivatives, so it must be called in uniform
+// control flow or in a branch on something constant across the primitive.
+vec4 SampleVirtualTexture(VirtualTextureData data, sampler2D tileCache, usampler2DArray pageTable, uint textureId, vec2 uv) {
+    VirtualTextureInfo info = data.textures[textureId];
+    uv = clamp(uv, 0.0, 1.0);
+
+    vec2 texel = uv * vec2(info.size);
+    vec2 dx = dFdx(texel);
+    vec2 dy = dFdy(texel);
+    float lod = 0.5 * log2(max(dot(dx, dx), dot(dy, dy)));
+    uint mip = uint(clamp(floor(lod), 0.0, float(info.tailMip)));
+
+    uvec2 mipSize = max(info.size >> mip, uvec2(1u));
+    uvec2 page = min(uvec2(uv * vec2(mipSize)), mipSize - 1u) / data.tileSize;
+    RecordVirtualTextureFeedback(data, PackVirtualTile(textureId, mip, page));
+
+    // Pages that aren't resident hold their nearest resident ancestor's entry
+    uint entry = texelFetch(pageTable, ivec3(page, textureId), int(mip)).r;
+    uvec2 slot = uvec2(entry & 0xFFFu, (entry >> 12u) & 0xFFFu);
+    uint residentMip = entry >> 24u;
+
+    // Half a texel inside the mip, so filtering never reaches past its edge into the part of the tile the mip doesn't cover
+    uvec2 residentSize = max(info.size >> residentMip, uvec2(1u));
+    vec2 residentTexel = clamp(uv * vec2(residentSize), vec2(0.5), vec2(residentSize) - 0.5);
+    // The page the entry is for, found like the cache does. With odd mip sizes the texel can be just outside of it, in the tile's border.
+    uvec2 residentPage = min(page >> (residentMip - mip), (residentSize - 1u) / data.tileSize);
+
+    vec2 cacheTexel = vec2(slot * data.paddedTileSize + data.tileBorder) + residentTexel - vec2(residentPage * data.tileSize);
+    return textureLod(tileCache, cacheTexel / float(data.cacheSize), 0.0);
+}
+
+#endif
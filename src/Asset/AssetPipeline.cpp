@@ -0,0 +1,156 @@
+#include <Asset/AssetPipeline.h>
+
+#include <algorithm>
+#include <print>
+
+namespace VKRE {
+
+    AssetPipeline::AssetPipeline(JobSystem& jobSystem, size_t uploadQueueCapacity)
+        :mJobSystem(jobSystem), mDecodedQueue(uploadQueueCapacity) {}
+
+    AssetPipeline::~AssetPipeline() {
+        {
+            std::lock_guard lock(mPendingMutex);
+            mPending.clear();
+            mPendingCount.store(0, std::memory_order_relaxed);
+        }
+        mDecodedQueue.Close();
+
+        // Jobs that are already queued on the workers still reference this pipeline
+        uint32_t outstanding = mOutstandingJobs.load(std::memory_order_acquire);
+        while (outstanding != 0) {
+            mOutstandingJobs.wait(outstanding, std::memory_order_acquire);
+            outstanding = mOutstandingJobs.load(std::memory_order_acquire);
+        }
+    }
+
+    AssetID AssetPipeline::Request(AssetRequest&& request) {
+        AssetID id;
+        {
+            std::lock_guard lock(mPendingMutex);
+            id = mNextID++;
+            const float priority = ComputePriority(request);
+            mPending.push_back({ id, std::move(request), priority });
+            std::push_heap(mPending.begin(), mPending.end());
+        }
+        mPendingCount.fetch_add(1, std::memory_order_relaxed);
+
+        SubmitJobs();
+        return id;
+    }
+
+    std::optional<DecodedAsset> AssetPipeline::PopDecoded() {
+        std::optional<DecodedAsset> decoded = mDecodedQueue.TryPop();
+        if (!decoded.has_value())
+            return decoded;
+
+        {
+            std::lock_guard lock(mPendingMutex);
+            mInFlight--;
+        }
+        SubmitJobs();
+        return decoded;
+    }
+
+    void AssetPipeline::SubmitJobs() {
+        std::vector<float> priorities;
+        {
+            std::lock_guard lock(mPendingMutex);
+            while (mScheduledJobs < mPending.size() && mInFlight < mDecodedQueue.GetCapacity()) {
+                mScheduledJobs++;
+                mInFlight++;
+                priorities.push_back(mPending.front().priority);
+            }
+        }
+
+        // Every job gets exactly one request, but it decides which one only once it runs
+        for (float priority : priorities) {
+            mOutstandingJobs.fetch_add(1, std::memory_order_relaxed);
+            mJobSystem.Submit([this]() {
+                ProcessNext();
+                if (mOutstandingJobs.fetch_sub(1, std::memory_order_acq_rel) == 1)
+                    mOutstandingJobs.notify_all();
+            }, priority);
+        }
+    }
+
+    void AssetPipeline::SetCamera(const glm::vec3& position, const glm::vec3& forward) {
+        std::lock_guard lock(mPendingMutex);
+        mCameraPosition = position;
+        mCameraForward = glm::normalize(forward);
+        mPrioritiesDirty = true;
+    }
+
+    float AssetPipeline::ComputePriority(const AssetRequest& request) const {
+        glm::vec3 toAsset = request.position - mCameraPosition;
+        float distance = std::max(glm::length(toAsset) - request.radius, 0.01f);
+
+        // Roughly the angular size of the asset, halved for anything behind the camera
+        float priority = request.radius / distance;
+        if (glm::dot(toAsset, mCameraForward) < -request.radius)
+            priority *= 0.5f;
+
+        return priority + request.bias;
+    }
+
+    std::optional<AssetPipeline::PendingRequest> AssetPipeline::PopMostImportant() {
+        std::lock_guard lock(mPendingMutex);
+        mScheduledJobs--;
+        // Only once the destructor has dropped the requests, the job gives its place back
+        if (mPending.empty()) {
+            mInFlight--;
+            return std::nullopt;
+        }
+
+        if (mPrioritiesDirty) {
+            for (auto& pending : mPending) {
+                pending.priority = ComputePriority(pending.request);
+            }
+            std::make_heap(mPending.begin(), mPending.end());
+            mPrioritiesDirty = false;
+        }
+
+        std::pop_heap(mPending.begin(), mPending.end());
+        PendingRequest request = std::move(mPending.back());
+        mPending.pop_back();
+        return request;
+    }
+
+    void AssetPipeline::ProcessNext() {
+        std::optional<PendingRequest> pending = PopMostImportant();
+        if (!pending.has_value())
+            return;
+
+        DecodedAsset decoded;
+        decoded.id = pending->id;
+        decoded.type = pending->request.type;
+        decoded.path = pending->request.path;
+
+        switch (decoded.type) {
+            case AssetType::MESH:
+                // Cooked meshes need no decoding, fault the pages in here so the upload memcpy doesn't have to
+                decoded.mesh = MeshAsset::Load(decoded.path);
+                if (decoded.mesh.has_value())
+                    decoded.mesh->Prefetch();
+                break;
+            case AssetType::TEXTURE:
+                if (decoded.path.extension() == ".vktex") {
+                    decoded.texture = TextureAsset::Load(decoded.path);
+                    if (decoded.texture.has_value())
+                        decoded.texture->Prefetch();
+                } else {
+                    decoded.image = DecodeImage(decoded.path);
+                }
+                break;
+        }
+
+        if (!decoded.IsValid())
+            std::println("Asset Pipeline: failed to load {}", decoded.path.string());
+
+        // Failed loads are still handed over so that whoever is waiting on the id can give up on it.
+        // Never blocks, the job's place in the queue was taken when it was submitted.
+        mDecodedQueue.Push(std::move(decoded));
+        mPendingCount.fetch_sub(1, std::memory_order_relaxed);
+    }
+
+}
@@ -0,0 +1,33 @@
+#include <Asset/ImageAsset.h>
+
+#include <Core/MappedFile.h>
+
+#define STB_IMAGE_IMPLEMENTATION
+#include <stb/stb_image.h>
+
+#include <print>
+
+namespace VKRE {
+
+    std::optional<DecodedImage> DecodeImage(const std::filesystem::path& path) {
+        MappedFile file;
+        if (!file.Open(path)) {
+            std::println("Failed to open image: {}", path.string());
+            return std::nullopt;
+        }
+
+        int width = 0, height = 0, channels = 0;
+        stbi_uc* pixels = stbi_load_from_memory(reinterpret_cast<const stbi_uc*>(file.GetData()), static_cast<int>(file.GetSize()), &width, &height, &channels, STBI_rgb_alpha);
+        if (!pixels) {
+            std::println("Failed to decode image {}: {}", path.string(), stbi_failure_reason());
+            return std::nullopt;
+        }
+
+        DecodedImage image;
+        image.width = static_cast<uint32_t>(width);
+        image.height = static_cast<uint32_t>(height);
+        image.pixels = std::unique_ptr<uint8_t, void(*)(void*)>(pixels, stbi_image_free);
+        return image;
+    }
+
+}
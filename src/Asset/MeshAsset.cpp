@@ -0,0 +1,96 @@
+#include <Asset/MeshAsset.h>
+
+#include <print>
+
+namespace VKRE {
+
+    std::optional<MeshAsset> MeshAsset::Load(const std::filesystem::path& path) {
+        MeshAsset asset;
+        if (!asset.mFile.Open(path)) {
+            std::println("Failed to open mesh asset: {}", path.string());
+            return std::nullopt;
+        }
+
+        std::span<const std::byte> headerData = asset.mFile.GetRange(0, sizeof(MeshFormat::FileHeader));
+        if (headerData.empty()) {
+            std::println("Mesh asset {} is too small to be a cooked mesh!", path.string());
+            return std::nullopt;
+        }
+
+        asset.mHeader = reinterpret_cast<const MeshFormat::FileHeader*>(headerData.data());
+        if (asset.mHeader->magic != MeshFormat::MESH_FILE_MAGIC) {
+            std::println("Mesh asset {} is not a cooked mesh!", path.string());
+            return std::nullopt;
+        }
+
+        if (asset.mHeader->version != MeshFormat::MESH_FILE_VERSION) {
+            std::println("Mesh asset {} has version {}, expected {}. Re-cook it!", path.string(), asset.mHeader->version, MeshFormat::MESH_FILE_VERSION);
+            return std::nullopt;
+        }
+
+        uint64_t sectionTableSize = static_cast<uint64_t>(asset.mHeader->sectionCount) * sizeof(MeshFormat::Section);
+        std::span<const std::byte> sectionData = asset.mFile.GetRange(sizeof(MeshFormat::FileHeader), sectionTableSize);
+        if (sectionData.size() != sectionTableSize) {
+            std::println("Mesh asset {} has a truncated section table!", path.string());
+            return std::nullopt;
+        }
+
+        asset.mSections = std::span<const MeshFormat::Section>(reinterpret_cast<const MeshFormat::Section*>(sectionData.data()), asset.mHeader->sectionCount);
+        for (const auto& section : asset.mSections) {
+            if (asset.mFile.GetRange(section.offset, section.size).size() != section.size || section.size != section.elementCount * section.elementSize) {
+                std::println("Mesh asset {} has a corrupt section (type {})!", path.string(), static_cast<uint32_t>(section.type));
+                return std::nullopt;
+            }
+        }
+
+        return asset;
+    }
+
+    const MeshFormat::Section* MeshAsset::FindSection(MeshFormat::SectionType type) const {
+        for (const auto& section : mSections) {
+            if (section.type == type)
+                return &section;
+        }
+        return nullptr;
+    }
+
+    std::span<const std::byte> MeshAsset::GetSectionData(MeshFormat::SectionType type) const {
+        const MeshFormat::Section* section = FindSection(type);
+        if (!section)
+            return {};
+        return mFile.GetRange(section->offset, section->size);
+    }
+
+    std::span<const MeshFormat::Submesh> MeshAsset::GetSubmeshes() const {
+        return GetSectionAs<MeshFormat::Submesh>(MeshFormat::SectionType::SUBMESHES);
+    }
+
+    std::span<const MeshFormat::Vertex> MeshAsset::GetVertices() const {
+        return GetSectionAs<MeshFormat::Vertex>(MeshFormat::SectionType::VERTICES);
+    }
+
+    std::span<const uint32_t> MeshAsset::GetIndices() const {
+        return GetSectionAs<uint32_t>(MeshFormat::SectionType::INDICES);
+    }
+
+    std::span<const MeshFormat::Meshlet> MeshAsset::GetMeshlets() const {
+        return GetSectionAs<MeshFormat::Meshlet>(MeshFormat::SectionType::MESHLETS);
+    }
+
+    std::span<const uint32_t> MeshAsset::GetMeshletVertices() const {
+        return GetSectionAs<uint32_t>(MeshFormat::SectionType::MESHLET_VERTICES);
+    }
+
+    std::span<const uint32_t> MeshAsset::GetMeshletTriangles() const {
+        return GetSectionAs<uint32_t>(MeshFormat::SectionType::MESHLET_TRIANGLES);
+    }
+
+    std::span<const MeshFormat::Lod> MeshAsset::GetLods() const {
+        return GetSectionAs<MeshFormat::Lod>(MeshFormat::SectionType::LODS);
+    }
+
+    std::span<const MeshFormat::LodRange> MeshAsset::GetLodRanges() const {
+        return GetSectionAs<MeshFormat::LodRange>(MeshFormat::SectionType::LOD_RANGES);
+    }
+
+}
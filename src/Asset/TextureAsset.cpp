@@ -0,0 +1,74 @@
+#include <Asset/TextureAsset.h>
+
+#include <print>
+
+namespace VKRE {
+
+    std::optional<TextureAsset> TextureAsset::Load(const std::filesystem::path& path) {
+        TextureAsset asset;
+        if (!asset.mFile.Open(path)) {
+            std::println("Failed to open texture asset: {}", path.string());
+            return std::nullopt;
+        }
+
+        std::span<const std::byte> headerData = asset.mFile.GetRange(0, sizeof(TextureFormat::FileHeader));
+        if (headerData.empty()) {
+            std::println("Texture asset {} is too small to be a cooked texture!", path.string());
+            return std::nullopt;
+        }
+
+        asset.mHeader = reinterpret_cast<const TextureFormat::FileHeader*>(headerData.data());
+        if (asset.mHeader->magic != TextureFormat::TEXTURE_FILE_MAGIC) {
+            std::println("Texture asset {} is not a cooked texture!", path.string());
+            return std::nullopt;
+        }
+
+        if (asset.mHeader->version != TextureFormat::TEXTURE_FILE_VERSION) {
+            std::println("Texture asset {} has version {}, expected {}. Re-cook it!", path.string(), asset.mHeader->version, TextureFormat::TEXTURE_FILE_VERSION);
+            return std::nullopt;
+        }
+
+        uint64_t mipTableSize = static_cast<uint64_t>(asset.mHeader->mipCount) * sizeof(TextureFormat::MipLevel);
+        std::span<const std::byte> mipData = asset.mFile.GetRange(sizeof(TextureFormat::FileHeader), mipTableSize);
+        if (asset.mHeader->mipCount == 0 || mipData.size() != mipTableSize) {
+            std::println("Texture asset {} has a truncated mip table!", path.string());
+            return std::nullopt;
+        }
+
+        asset.mMipLevels = std::span<const TextureFormat::MipLevel>(reinterpret_cast<const TextureFormat::MipLevel*>(mipData.data()), asset.mHeader->mipCount);
+        for (const auto& mip : asset.mMipLevels) {
+            bool validSize = mip.size == TextureFormat::GetMipSize(asset.mHeader->format, mip.width, mip.height);
+            bool validOffset = mip.offset % TextureFormat::TEXTURE_DATA_ALIGNMENT == 0;
+            if (!validSize || !validOffset || asset.mFile.GetRange(mip.offset, mip.size).size() != mip.size) {
+                std::println("Texture asset {} has a corrupt mip level ({}x{})!", path.string(), mip.width, mip.height);
+                return std::nullopt;
+            }
+        }
+
+        return asset;
+    }
+
+    std::span<const std::byte> TextureAsset::GetMipData(uint32_t mip) const {
+        if (mip >= mMipLevels.size())
+            return {};
+        return mFile.GetRange(mMipLevels[mip].offset, mMipLevels[mip].size);
+    }
+
+    std::span<const std::byte> TextureAsset::GetMipRangeData(uint32_t firstMip, uint32_t mipCount) const {
+        if (mipCount == 0 || firstMip + mipCount > mMipLevels.size())
+            return {};
+
+        const TextureFormat::MipLevel& last = mMipLevels[firstMip + mipCount - 1];
+        uint64_t begin = mMipLevels[firstMip].offset;
+        return mFile.GetRange(begin, last.offset + last.size - begin);
+    }
+
+    void TextureAsset::PrefetchMips(uint32_t firstMip, uint32_t mipCount) const {
+        if (mipCount == 0 || firstMip + mipCount > mMipLevels.size())
+            return;
+
+        const TextureFormat::MipLevel& last = mMipLevels[firstMip + mipCount - 1];
+        mFile.Prefetch(mMipLevels[firstMip].offset, last.offset + last.size - mMipLevels[firstMip].offset);
+    }
+
+}
@@ -0,0 +1,94 @@
+#include <Core/EventBus.h>
+
+#include <algorithm>
+#include <new>
+#include <thread>
+
+namespace VKRE {
+
+    namespace {
+
+        constexpr uint64_t OFFSET_MASK = 0xFFFFFFFFull;
+
+    }
+
+    EventBus::EventBus(const EventBusSpecs& specs)
+        // Whole records only, so every offset left in an arena has room for at least a header
+        :mArenaSize(std::max<size_t>(specs.arenaSize / RECORD_ALIGNMENT, 1) * RECORD_ALIGNMENT) {
+        for (auto& arena : mArenas) {
+            arena = std::make_unique<std::byte[]>(mArenaSize);
+            std::memset(arena.get(), 0, mArenaSize);
+        }
+    }
+
+    bool EventBus::Post(uint32_t type, const void* event, uint32_t size) {
+        const uint32_t recordSize = static_cast<uint32_t>(sizeof(RecordHeader) + (size + RECORD_ALIGNMENT - 1) / RECORD_ALIGNMENT * RECORD_ALIGNMENT);
+        // Acquire pairs with Dispatch's exchange, the arena's clearing happens before anything is written into it again
+        const uint64_t state = mWriteState.fetch_add(recordSize, std::memory_order_acquire);
+        const uint64_t offset = state & OFFSET_MASK;
+        std::byte* arena = mArenas[state >> 32].get();
+        if (offset >= mArenaSize) {
+            mDroppedCount.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+
+        // The arena was zeroed when it was last dispatched, so the ready flag starts out clear
+        RecordHeader* header = std::launder(reinterpret_cast<RecordHeader*>(arena + offset));
+        if (offset + recordSize > mArenaSize) {
+            // The first record that doesn't fit marks the end, every later reservation lands past it
+            header->type = END_OF_ARENA;
+            header->ready.store(1, std::memory_order_release);
+            mDroppedCount.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+
+        header->type = type;
+        header->size = size;
+        std::memcpy(arena + offset + sizeof(RecordHeader), event, size);
+        header->ready.store(1, std::memory_order_release);
+        return true;
+    }
+
+    void EventBus::Dispatch() {
+        const uint64_t state = mWriteState.load(std::memory_order_relaxed);
+        const uint64_t arenaIndex = state >> 32;
+        // From here on producers write into the other arena, which the last Dispatch left empty
+        const uint64_t oldState = mWriteState.exchange((arenaIndex ^ 1) << 32, std::memory_order_acq_rel);
+        const uint64_t end = std::min<uint64_t>(oldState & OFFSET_MASK, mArenaSize);
+        std::byte* arena = mArenas[arenaIndex].get();
+
+        uint64_t offset = 0;
+        while (offset < end) {
+            RecordHeader* header = std::launder(reinterpret_cast<RecordHeader*>(arena + offset));
+            // Producers reserve before they copy, one may still be writing
+            while (header->ready.load(std::memory_order_acquire) == 0)
+                std::this_thread::yield();
+            if (header->type == END_OF_ARENA)
+                break;
+
+            if (header->type < mHandlers.size()) {
+                const void* event = arena + offset + sizeof(RecordHeader);
+                for (const Subscription& subscription : mHandlers[header->type])
+                    subscription.invoker(event, subscription.function, subscription.userData);
+            }
+            offset += sizeof(RecordHeader) + (header->size + RECORD_ALIGNMENT - 1) / RECORD_ALIGNMENT * RECORD_ALIGNMENT;
+        }
+
+        // Clears the ready flags for the arena's next turn
+        std::memset(arena, 0, static_cast<size_t>(std::min<uint64_t>(std::max(offset + sizeof(RecordHeader), end), mArenaSize)));
+    }
+
+    void EventBus::AddHandler(uint32_t type, Invoker invoker, void (*function)(), void* userData) {
+        if (type >= mHandlers.size())
+            mHandlers.resize(type + 1);
+        mHandlers[type].push_back({ invoker, function, userData });
+    }
+
+    void EventBus::RemoveHandlers(uint32_t type, void* userData) {
+        if (type >= mHandlers.size())
+            return;
+
+        std::erase_if(mHandlers[type], [userData](const Subscription& subscription) { return subscription.userData == userData; });
+    }
+
+}
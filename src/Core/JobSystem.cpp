@@ -0,0 +1,131 @@
+#include <Core/JobSystem.h>
+
+#include <algorithm>
+#include <limits>
+#include <memory>
+
+namespace VKRE {
+
+    JobSystem::JobSystem(uint32_t workerCount) {
+        if (workerCount == 0) {
+            uint32_t hardwareThreads = std::thread::hardware_concurrency();
+            workerCount = hardwareThreads > 1 ? hardwareThreads - 1 : 1;
+        }
+
+        mWorkers.reserve(workerCount);
+        for (uint32_t i = 0; i < workerCount; i++) {
+            mWorkers.emplace_back([this]() { WorkerLoop(); });
+        }
+    }
+
+    JobSystem::~JobSystem() {
+        {
+            std::lock_guard lock(mMutex);
+            mShuttingDown = true;
+        }
+        mJobAvailable.notify_all();
+
+        for (auto& worker : mWorkers) {
+            worker.join();
+        }
+    }
+
+    void JobSystem::Submit(Job&& job, float priority) {
+        {
+            std::lock_guard lock(mMutex);
+            mJobs.push({ priority, mNextSequence++, std::move(job) });
+        }
+        mJobAvailable.notify_one();
+    }
+
+    void JobSystem::ParallelFor(uint32_t count, uint32_t batchSize, const std::function<void(uint32_t begin, uint32_t end)>& function) {
+        if (count == 0)
+            return;
+
+        batchSize = std::max(batchSize, 1u);
+        const uint32_t batchCount = (count + batchSize - 1) / batchSize;
+        if (batchCount == 1 || mWorkers.empty()) {
+            function(0, count);
+            return;
+        }
+
+        struct ParallelForState {
+            std::atomic<uint32_t> nextBatch{ 0 };
+            std::atomic<uint32_t> completedBatches{ 0 };
+        };
+        // Helpers that only get scheduled after the caller has finished every batch still touch the state, so it can't live on the stack
+        auto state = std::make_shared<ParallelForState>();
+
+        auto RunBatches = [state, count, batchSize, batchCount, &function]() {
+            uint32_t batch;
+            while ((batch = state->nextBatch.fetch_add(1, std::memory_order_relaxed)) < batchCount) {
+                uint32_t begin = batch * batchSize;
+                function(begin, std::min(begin + batchSize, count));
+                if (state->completedBatches.fetch_add(1, std::memory_order_acq_rel) + 1 == batchCount)
+                    state->completedBatches.notify_all();
+            }
+        };
+
+        // Helpers run ahead of everything else so that the caller isn't left waiting behind long-running jobs
+        uint32_t helperCount = std::min(batchCount - 1, GetWorkerCount());
+        for (uint32_t i = 0; i < helperCount; i++) {
+            Submit([state, batchCount, RunBatches]() {
+                if (state->nextBatch.load(std::memory_order_relaxed) < batchCount)
+                    RunBatches();
+            }, std::numeric_limits<float>::max());
+        }
+
+        RunBatches();
+
+        uint32_t completed = state->completedBatches.load(std::memory_order_acquire);
+        while (completed != batchCount) {
+            state->completedBatches.wait(completed, std::memory_order_acquire);
+            completed = state->completedBatches.load(std::memory_order_acquire);
+        }
+    }
+
+    void JobSystem::WaitIdle() {
+        // Help out instead of sleeping. Must not be called from inside a job since that job counts as active
+        while (TryRunOne()) {}
+
+        std::unique_lock lock(mMutex);
+        mIdle.wait(lock, [this]() { return mJobs.empty() && mActiveJobs == 0; });
+    }
+
+    bool JobSystem::TryRunOne() {
+        Job job;
+        {
+            std::lock_guard lock(mMutex);
+            if (mJobs.empty())
+                return false;
+
+            job = std::move(const_cast<QueuedJob&>(mJobs.top()).job);
+            mJobs.pop();
+            mActiveJobs++;
+        }
+
+        job();
+
+        {
+            std::lock_guard lock(mMutex);
+            mActiveJobs--;
+            if (mJobs.empty() && mActiveJobs == 0)
+                mIdle.notify_all();
+        }
+        return true;
+    }
+
+    void JobSystem::WorkerLoop() {
+        while (true) {
+            {
+                std::unique_lock lock(mMutex);
+                mJobAvailable.wait(lock, [this]() { return mShuttingDown || !mJobs.empty(); });
+                if (mShuttingDown && mJobs.empty())
+                    return;
+            }
+
+            TryRunOne();
+        }
+    }
+
+}
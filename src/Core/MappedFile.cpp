@@ -0,0 +1,143 @@
+#include <Core/MappedFile.h>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include <utility>
+
+namespace VKRE {
+
+    MappedFile::~MappedFile() {
+        Close();
+    }
+
+    MappedFile::MappedFile(MappedFile&& other) noexcept {
+        *this = std::move(other);
+    }
+
+    MappedFile& MappedFile::operator=(MappedFile&& other) noexcept {
+        if (this != &other) {
+            Close();
+            mData = std::exchange(other.mData, nullptr);
+            mSize = std::exchange(other.mSize, 0);
+            #ifdef _WIN32
+            mFileHandle = std::exchange(other.mFileHandle, nullptr);
+            mMappingHandle = std::exchange(other.mMappingHandle, nullptr);
+            #else
+            mFileDescriptor = std::exchange(other.mFileDescriptor, -1);
+            #endif
+        }
+        return *this;
+    }
+
+    bool MappedFile::Open(const std::filesystem::path& path) {
+        Close();
+
+        #ifdef _WIN32
+        HANDLE file = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+        if (file == INVALID_HANDLE_VALUE)
+            return false;
+
+        LARGE_INTEGER fileSize{};
+        if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0) {
+            CloseHandle(file);
+            return false;
+        }
+
+        HANDLE mapping = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (!mapping) {
+            CloseHandle(file);
+            return false;
+        }
+
+        void* view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+        if (!view) {
+            CloseHandle(mapping);
+            CloseHandle(file);
+            return false;
+        }
+
+        mFileHandle = file;
+        mMappingHandle = mapping;
+        mData = static_cast<const std::byte*>(view);
+        mSize = static_cast<size_t>(fileSize.QuadPart);
+        #else
+        int fd = open(path.c_str(), O_RDONLY);
+        if (fd < 0)
+            return false;
+
+        struct stat fileStat{};
+        if (fstat(fd, &fileStat) != 0 || fileStat.st_size == 0) {
+            close(fd);
+            return false;
+        }
+
+        void* view = mmap(nullptr, static_cast<size_t>(fileStat.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+        if (view == MAP_FAILED) {
+            close(fd);
+            return false;
+        }
+
+        // Assets are consumed front to back while being copied into staging memory
+        madvise(view, static_cast<size_t>(fileStat.st_size), MADV_SEQUENTIAL);
+
+        mFileDescriptor = fd;
+        mData = static_cast<const std::byte*>(view);
+        mSize = static_cast<size_t>(fileStat.st_size);
+        #endif
+
+        return true;
+    }
+
+    void MappedFile::Prefetch() const {
+        Prefetch(0, mSize);
+    }
+
+    void MappedFile::Prefetch(uint64_t offset, uint64_t size) const {
+        std::span<const std::byte> range = GetRange(offset, size);
+        if (range.empty())
+            return;
+
+        #ifdef _WIN32
+        WIN32_MEMORY_RANGE_ENTRY entry{};
+        entry.VirtualAddress = const_cast<std::byte*>(range.data());
+        entry.NumberOfBytes = range.size();
+        PrefetchVirtualMemory(GetCurrentProcess(), 1, &entry, 0);
+        #else
+        // madvise wants a page aligned start, the mapping itself always is
+        const uintptr_t pageSize = static_cast<uintptr_t>(sysconf(_SC_PAGESIZE));
+        const uintptr_t begin = reinterpret_cast<uintptr_t>(range.data()) & ~(pageSize - 1);
+        const uintptr_t end = reinterpret_cast<uintptr_t>(range.data()) + range.size();
+        madvise(reinterpret_cast<void*>(begin), end - begin, MADV_WILLNEED);
+        #endif
+    }
+
+    void MappedFile::Close() {
+        if (!mData)
+            return;
+
+        #ifdef _WIN32
+        UnmapViewOfFile(mData);
+        CloseHandle(mMappingHandle);
+        CloseHandle(mFileHandle);
+        mMappingHandle = nullptr;
+        mFileHandle = nullptr;
+        #else
+        munmap(const_cast<std::byte*>(mData), mSize);
+        close(mFileDescriptor);
+        mFileDescriptor = -1;
+        #endif
+
+        mData = nullptr;
+        mSize = 0;
+    }
+
+}
@@ -0,0 +1,106 @@
+#include <Core/StartupGraph.h>
+
+#include <algorithm>
+#include <cassert>
+#include <limits>
+#include <print>
+
+namespace VKRE {
+
+    namespace {
+
+        // Startup stages are what everything else is waiting on, they run ahead of any other queued job
+        constexpr float STAGE_PRIORITY = std::numeric_limits<float>::max();
+
+    }
+
+    StartupStageID StartupGraph::AddStage(std::string name, std::initializer_list<StartupStageID> dependencies, std::function<void()>&& function, StartupThread thread) {
+        const StartupStageID id = static_cast<StartupStageID>(mStages.size());
+        Stage& stage = mStages.emplace_back();
+        stage.name = std::move(name);
+        stage.function = std::move(function);
+        stage.thread = thread;
+
+        for (StartupStageID dependency : dependencies) {
+            assert(dependency < id && "Startup stages can only depend on stages added before them");
+            mStages[dependency].dependents.push_back(id);
+            stage.remainingDependencies++;
+        }
+        return id;
+    }
+
+    void StartupGraph::Run() {
+        mStartTime = std::chrono::steady_clock::now();
+        mFinishedCount = 0;
+
+        std::unique_lock lock(mMutex);
+        for (StartupStageID stage = 0; stage < mStages.size(); stage++) {
+            if (mStages[stage].remainingDependencies == 0)
+                Schedule(stage);
+        }
+
+        const uint32_t stageCount = static_cast<uint32_t>(mStages.size());
+        while (mFinishedCount < stageCount) {
+            mProgress.wait(lock, [&]() { return !mMainThreadReady.empty() || mFinishedCount == stageCount; });
+            if (mMainThreadReady.empty())
+                continue;
+
+            const StartupStageID stage = mMainThreadReady.front();
+            mMainThreadReady.pop();
+            lock.unlock();
+            RunStage(stage);
+            lock.lock();
+        }
+
+        mTotalTime = std::chrono::steady_clock::now() - mStartTime;
+    }
+
+    void StartupGraph::Schedule(StartupStageID stage) {
+        if (mStages[stage].thread == StartupThread::MAIN) {
+            mMainThreadReady.push(stage);
+            mProgress.notify_all();
+            return;
+        }
+
+        mJobSystem.Submit([this, stage]() { RunStage(stage); }, STAGE_PRIORITY);
+    }
+
+    void StartupGraph::RunStage(StartupStageID id) {
+        Stage& stage = mStages[id];
+        stage.start = std::chrono::steady_clock::now();
+        stage.function();
+        stage.end = std::chrono::steady_clock::now();
+
+        std::lock_guard lock(mMutex);
+        for (StartupStageID dependent : stage.dependents) {
+            if (--mStages[dependent].remainingDependencies == 0)
+                Schedule(dependent);
+        }
+        mFinishedCount++;
+        mProgress.notify_all();
+    }
+
+    std::vector<StartupStageTiming> StartupGraph::GetTimings() const {
+        std::vector<StartupStageTiming> timings;
+        timings.reserve(mStages.size());
+        for (const Stage& stage : mStages)
+            timings.push_back({ stage.name, stage.start - mStartTime, stage.end - stage.start, stage.thread });
+
+        std::sort(timings.begin(), timings.end(), [](const StartupStageTiming& a, const StartupStageTiming& b) { return a.start < b.start; });
+        return timings;
+    }
+
+    void StartupGraph::PrintReport() const {
+        std::vector<StartupStageTiming> timings = GetTimings();
+        std::chrono::duration<double, std::milli> stageTotal{ 0.0 };
+        for (const StartupStageTiming& timing : timings)
+            stageTotal += timing.duration;
+
+        std::println("Startup took {:.1f} ms, {:.1f} ms of work across {} stages", mTotalTime.count(), stageTotal.count(), timings.size());
+        for (const StartupStageTiming& timing : timings) {
+            std::println("    {:<24} {:>8.1f} ms at {:>8.1f} ms on {}", timing.name, timing.duration.count(), timing.start.count(),
+                timing.thread == StartupThread::MAIN ? "the main thread" : "a worker");
+        }
+    }
+
+}
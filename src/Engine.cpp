@@ -1,30 +1,228 @@
 #include <Engine.h>
 
+#include <algorithm>
 #include <cassert>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
 #include <memory>
+#include <print>
 
-Engine::Engine() {
+#ifndef VKRE_PIPELINE_CACHE_PATH
+#define VKRE_PIPELINE_CACHE_PATH "pipeline_cache.bin"
+#endif
+
+Engine::Engine(const EngineSpecs& specs) {
     if (mInstance) {
         assert("Engine has already been initialised!");
     }
 
     mInstance = this;
+    mStartTime = std::chrono::steady_clock::now();
+    mPrintStartupReport = specs.printStartupReport;
+    mJobSystem = std::make_unique<VKRE::JobSystem>();
+
+    // GLFW's window functions must stay on the main thread, everything else goes to the workers. The device is the long pole, the
+    // window, shader reads, the pipeline cache read and the startup assets all overlap with it.
+    using VKRE::StartupThread;
+    VKRE::StartupGraph startup(*mJobSystem);
+    std::vector<std::byte> pipelineCacheData;
 
-    mWindow = std::make_shared<VKRE::Window>(VKRE::WindowSpecs{ .resizable = true });
-    mVulkanContext = std::make_shared<VKRE::VulkanContext>(mWindow);
-    mVulkanRenderer = std::make_shared<VKRE::VulkanRenderer>(mVulkanContext);
+    const VKRE::StartupStageID glfw = startup.AddStage("GLFW", {}, []() { VKRE::Window::InitBackend(); }, StartupThread::MAIN);
+    const VKRE::StartupStageID window = startup.AddStage("Window", { glfw }, [&]() {
+        mWindow = std::make_shared<VKRE::Window>(specs.window, &mEventBus);
+    }, StartupThread::MAIN);
+    const VKRE::StartupStageID instance = startup.AddStage("Vulkan instance", { glfw }, []() {
+        VKRE::VulkanContext::CreateInstance(VKRE::Window::GetWindowExtensions());
+    });
+    const VKRE::StartupStageID device = startup.AddStage("Vulkan device", { window, instance }, [&]() {
+        mVulkanContext = std::make_shared<VKRE::VulkanContext>(mWindow);
+    });
+    const VKRE::StartupStageID cacheRead = startup.AddStage("Pipeline cache read", {}, [&]() {
+        pipelineCacheData = VKRE::VulkanContext::ReadPipelineCacheFile(VKRE_PIPELINE_CACHE_PATH);
+    });
+    const VKRE::StartupStageID pipelineCache = startup.AddStage("Pipeline cache", { device, cacheRead }, [&]() {
+        mVulkanContext->CreatePipelineCache(pipelineCacheData);
+    });
+    const VKRE::StartupStageID shaders = startup.AddStage("Shader preload", {}, []() { VKRE::PipelineUtils::PreloadShaders(); });
+    // The swap chain is sized from the window's framebuffer, which GLFW only lets the main thread query
+    startup.AddStage("Renderer", { pipelineCache, shaders }, [&]() {
+        mVulkanRenderer = std::make_shared<VKRE::VulkanRenderer>(mVulkanContext, *mJobSystem, mEventBus, specs.renderer);
+    }, StartupThread::MAIN);
+    // Nothing is uploaded before Run, so the queue holds every startup asset and all of them decode while the device is created.
+    // The pipeline never parks a worker on a full queue either way, the device and renderer stages always get one.
+    startup.AddStage("Startup assets", {}, [&]() {
+        mAssetPipeline = std::make_unique<VKRE::AssetPipeline>(*mJobSystem, std::max<size_t>(specs.startupAssets.size(), DECODED_QUEUE_CAPACITY));
+        mStartupAssets.reserve(specs.startupAssets.size());
+        for (const VKRE::AssetRequest& request : specs.startupAssets)
+            mStartupAssets.push_back(mAssetPipeline->Request(VKRE::AssetRequest(request)));
+    });
+
+    startup.Run();
+    VKRE::PipelineUtils::ReleasePreloadedShaders();
+    mRenderThread = std::make_unique<VKRE::VulkanRenderThread>(*mVulkanRenderer);
+    mStartupTimings = startup.GetTimings();
+    if (mPrintStartupReport)
+        startup.PrintReport();
 }
 
 Engine::~Engine() {
+    mRenderThread.reset();
+    mAssetPipeline.reset();
+    mTextures.clear();
+    mStreamedTextures.clear();
+    mPendingMaterialTextures.clear();
+    mMeshes.clear();
+    mVulkanContext->SavePipelineCache(VKRE_PIPELINE_CACHE_PATH);
     mVulkanRenderer.reset();
+    mJobSystem.reset();
     mVulkanContext.reset();
+    // The renderer has destroyed their surfaces already
+    mWindows.clear();
+    mClosingWindows.clear();
+    mSubmittedClosingWindows.clear();
     mWindow.reset();
 }
 
 void Engine::Run() {
-    // TODO: Change this to close when the engine decides to close, not when ONE WINDOW decides it's done. This will help with multiple windows as well.
+    auto lastFrameTime = std::chrono::steady_clock::now();
+    bool firstFrame = true;
     while (!mWindow->ShouldClose()) {
+        auto frameTime = std::chrono::steady_clock::now();
+        float deltaTime = std::chrono::duration<float>(frameTime - lastFrameTime).count();
+        lastFrameTime = frameTime;
+
+        // Polling is global, it covers every window
         mWindow->OnUpdate();
-        mVulkanRenderer->Render();
+        mEventBus.Dispatch();
+        for (size_t i = mWindows.size(); i-- > 0;) {
+            if (mWindows[i]->ShouldClose())
+                CloseWindow(mWindows[i]);
+        }
+        mCamera.Update(deltaTime);
+        mAssetPipeline->SetCamera(mCamera.GetPosition(), mCamera.GetForward());
+
+        UploadDecodedAssets();
+        mScene.UpdateTransforms(*mJobSystem);
+        SyncScene();
+        GatherLights();
+
+        mSnapshot.camera = mCamera;
+        mSnapshot.queue.Sort(*mJobSystem);
+        // Returns once the previous frame is recorded, recording, submitting and presenting this one overlap with the next iteration
+        mRenderThread->Submit(mSnapshot);
+        mSnapshot.queue.Clear();
+        // Recording the previous frame released the surfaces of the windows closed before it, the ones closed since are released by
+        // the frame just submitted
+        mSubmittedClosingWindows.clear();
+        std::swap(mSubmittedClosingWindows, mClosingWindows);
+
+        if (firstFrame && mPrintStartupReport)
+            std::println("First frame submitted {:.1f} ms after startup", std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - mStartTime).count());
+        firstFrame = false;
+    }
+}
+
+void Engine::AttachMesh(VKRE::Entity entity, VKRE::GPUMeshID mesh, bool dynamic) {
+    VKRE::Registry& registry = mScene.GetRegistry();
+    if (VKRE::MeshRenderer* existing = registry.TryGet<VKRE::MeshRenderer>(entity))
+        mVulkanRenderer->GetScene().RemoveInstance(existing->instance);
+
+    // The world transform may be stale until the next UpdateTransforms, which then uploads the right one
+    std::optional<VKRE::GPUInstanceID> instance = mVulkanRenderer->GetScene().AddInstance(mesh, mScene.GetWorldTransform(entity));
+    if (!instance.has_value()) {
+        registry.Remove<VKRE::MeshRenderer>(entity);
+        return;
+    }
+
+    mVulkanRenderer->GetScene().SetInstanceDynamic(instance.value(), dynamic);
+    registry.Add<VKRE::MeshRenderer>(entity, mesh, instance.value());
+    const VKRE::MeshFormat::Bounds& bounds = mVulkanRenderer->GetScene().GetMeshBounds(mesh);
+    mScene.SetBounds(entity, bounds.center, bounds.extents);
+}
+
+void Engine::BindMaterialTexture(uint32_t materialIndex, VKRE::AssetID texture) {
+    std::erase_if(mPendingMaterialTextures, [&](const std::pair<uint32_t, VKRE::AssetID>& binding) { return binding.first == materialIndex; });
+
+    auto streamed = mStreamedTextures.find(texture);
+    if (streamed != mStreamedTextures.end()) {
+        mVulkanRenderer->GetTextureStreamer().BindMaterial(materialIndex, streamed->second);
+        return;
+    }
+
+    mVulkanRenderer->GetTextureStreamer().UnbindMaterial(materialIndex);
+    mPendingMaterialTextures.emplace_back(materialIndex, texture);
+}
+
+std::shared_ptr<VKRE::Window> Engine::OpenWindow(const VKRE::WindowSpecs& specs) {
+    std::shared_ptr<VKRE::Window> window = std::make_shared<VKRE::Window>(specs, &mEventBus);
+    mVulkanRenderer->AddWindow(*window);
+    mWindows.push_back(window);
+    return window;
+}
+
+void Engine::CloseWindow(const std::shared_ptr<VKRE::Window>& window) {
+    auto it = std::find(mWindows.begin(), mWindows.end(), window);
+    if (it == mWindows.end())
+        return;
+
+    mVulkanRenderer->RemoveWindow(*window);
+    mClosingWindows.push_back(std::move(*it));
+    mWindows.erase(it);
+}
+
+void Engine::SyncScene() {
+    VKRE::VulkanGPUScene& gpuScene = mVulkanRenderer->GetScene();
+    for (const VKRE::MeshRenderer& renderer : mScene.TakeDestroyedMeshRenderers())
+        gpuScene.RemoveInstance(renderer.instance);
+
+    // Only entities whose world transform changed this frame are visited, untouched instances cost nothing
+    VKRE::Registry& registry = mScene.GetRegistry();
+    for (VKRE::Entity entity : mScene.GetChangedEntities()) {
+        if (const VKRE::MeshRenderer* renderer = registry.TryGet<VKRE::MeshRenderer>(entity))
+            gpuScene.SetInstanceTransform(renderer->instance, mScene.GetWorldTransform(entity));
+    }
+}
+
+void Engine::GatherLights() {
+    VKRE::VulkanClusteredLighting& lighting = mVulkanRenderer->GetLighting();
+    lighting.ClearLights();
+    mScene.GetRegistry().Each<VKRE::Light, VKRE::WorldTransform>([&](VKRE::Entity, const VKRE::Light& light, const VKRE::WorldTransform& transform) {
+        VKRE::GPULight gpuLight{};
+        gpuLight.position = glm::vec3(transform.matrix[3]);
+        gpuLight.range = light.range;
+        gpuLight.color = light.color * light.intensity;
+        gpuLight.type = light.type;
+        gpuLight.direction = -glm::normalize(glm::vec3(transform.matrix[2]));
+        gpuLight.innerConeCos = std::cos(light.innerConeAngle);
+        gpuLight.outerConeCos = std::cos(light.outerConeAngle);
+        lighting.AddLight(gpuLight);
+    });
+}
+
+void Engine::UploadDecodedAssets() {
+    for (uint32_t i = 0; i < MAX_UPLOADS_PER_FRAME; i++) {
+        std::optional<VKRE::DecodedAsset> decoded = mAssetPipeline->PopDecoded();
+        if (!decoded.has_value())
+            break;
+
+        if (decoded->mesh.has_value()) {
+            std::optional<VKRE::GPUMeshID> mesh = mVulkanRenderer->GetScene().AddMesh(decoded->mesh.value());
+            if (mesh.has_value())
+                mMeshes[decoded->id] = mesh.value();
+        } else if (decoded->texture.has_value()) {
+            std::optional<VKRE::StreamedTextureID> texture = mVulkanRenderer->GetTextureStreamer().Register(std::move(decoded->texture.value()));
+            if (texture.has_value()) {
+                mStreamedTextures[decoded->id] = texture.value();
+                std::erase_if(mPendingMaterialTextures, [&](const std::pair<uint32_t, VKRE::AssetID>& binding) {
+                    if (binding.second != decoded->id)
+                        return false;
+                    mVulkanRenderer->GetTextureStreamer().BindMaterial(binding.first, texture.value());
+                    return true;
+                });
+            }
+        } else if (decoded->image.has_value()) {
+            mTextures[decoded->id] = mVulkanRenderer->UploadTexture(decoded->image.value());
+        }
     }
 }
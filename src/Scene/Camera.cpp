@@ -0,0 +1,62 @@
+#include <Scene/Camera.h>
+
+#include <Window/GlfwWindow.h>
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <algorithm>
+#include <cmath>
+
+namespace VKRE {
+
+    void Camera::Update(float deltaTime) {
+        auto [mouseX, mouseY] = Input::GetMousePosition();
+        glm::vec2 mousePosition(mouseX, mouseY);
+
+        if (Input::MouseButtonHeld(GLFW_MOUSE_BUTTON_RIGHT)) {
+            // The first frame of a drag only records where it started, otherwise the camera jumps
+            if (mLooking) {
+                glm::vec2 delta = mousePosition - mLastMousePosition;
+                mYaw += delta.x * mLookSpeed;
+                mPitch = std::clamp(mPitch - delta.y * mLookSpeed, -glm::radians(89.0f), glm::radians(89.0f));
+            }
+            mLooking = true;
+        } else {
+            mLooking = false;
+        }
+        mLastMousePosition = mousePosition;
+
+        const glm::vec3 forward = GetForward();
+        const glm::vec3 right = glm::normalize(glm::cross(forward, glm::vec3(0.0f, 1.0f, 0.0f)));
+        const glm::vec3 up(0.0f, 1.0f, 0.0f);
+
+        glm::vec3 movement(0.0f);
+        if (Input::KeyHeld(GLFW_KEY_W)) movement += forward;
+        if (Input::KeyHeld(GLFW_KEY_S)) movement -= forward;
+        if (Input::KeyHeld(GLFW_KEY_D)) movement += right;
+        if (Input::KeyHeld(GLFW_KEY_A)) movement -= right;
+        if (Input::KeyHeld(GLFW_KEY_E)) movement += up;
+        if (Input::KeyHeld(GLFW_KEY_Q)) movement -= up;
+
+        if (glm::dot(movement, movement) > 0.0f) {
+            float speed = Input::KeyHeld(GLFW_KEY_LEFT_SHIFT) ? mMoveSpeed * 4.0f : mMoveSpeed;
+            mPosition += glm::normalize(movement) * speed * deltaTime;
+        }
+    }
+
+    glm::vec3 Camera::GetForward() const {
+        return glm::vec3(std::cos(mPitch) * std::sin(mYaw), std::sin(mPitch), -std::cos(mPitch) * std::cos(mYaw));
+    }
+
+    glm::mat4 Camera::GetView() const {
+        return glm::lookAt(mPosition, mPosition + GetForward(), glm::vec3(0.0f, 1.0f, 0.0f));
+    }
+
+    glm::mat4 Camera::GetProjection(float aspectRatio) const {
+        // Swapping the planes maps the near plane to depth 1
+        glm::mat4 projection = glm::perspectiveRH_ZO(mVerticalFov, aspectRatio, mFarPlane, mNearPlane);
+        projection[1][1] *= -1.0f;
+        return projection;
+    }
+
+}
@@ -0,0 +1,222 @@
+#include <Scene/DynamicBVH.h>
+
+namespace VKRE {
+
+    AABB AABB::Transform(const glm::mat4& transform, const glm::vec3& center, const glm::vec3& extents) {
+        const glm::vec3 worldCenter = glm::vec3(transform * glm::vec4(center, 1.0f));
+        const glm::mat3 absolute = glm::mat3(glm::abs(glm::vec3(transform[0])), glm::abs(glm::vec3(transform[1])), glm::abs(glm::vec3(transform[2])));
+        return FromCenterExtents(worldCenter, absolute * extents);
+    }
+
+    DynamicBVH::DynamicBVH(float margin)
+        :mMargin(margin) {}
+
+    uint32_t DynamicBVH::CreateProxy(const AABB& bounds, uint32_t userData) {
+        const uint32_t proxy = AllocateNode();
+        Node& node = mNodes[proxy];
+        node.SetBounds({ bounds.min - mMargin, bounds.max + mMargin });
+        node.userData = userData;
+        node.height = 0;
+
+        InsertLeaf(proxy);
+        mProxyCount++;
+        return proxy;
+    }
+
+    void DynamicBVH::DestroyProxy(uint32_t proxy) {
+        RemoveLeaf(proxy);
+        FreeNode(proxy);
+        mProxyCount--;
+    }
+
+    bool DynamicBVH::MoveProxy(uint32_t proxy, const AABB& bounds) {
+        const AABB oldBounds = mNodes[proxy].GetBounds();
+        if (oldBounds.Contains(bounds))
+            return false;
+
+        const AABB fatBounds = { bounds.min - mMargin, bounds.max + mMargin };
+        mNodes[proxy].SetBounds(fatBounds);
+
+        // A proxy that jumped somewhere else entirely would drag its ancestors along, it's cheaper to insert it again where it landed
+        if (!oldBounds.Overlaps(fatBounds)) {
+            RemoveLeaf(proxy);
+            InsertLeaf(proxy);
+        } else {
+            RefitAncestors(mNodes[proxy].parent);
+        }
+        return true;
+    }
+
+    uint32_t DynamicBVH::AllocateNode() {
+        if (mFreeList == NULL_NODE) {
+            mNodes.emplace_back();
+            return static_cast<uint32_t>(mNodes.size() - 1);
+        }
+
+        const uint32_t node = mFreeList;
+        mFreeList = mNodes[node].parent;
+        mNodes[node] = Node{};
+        return node;
+    }
+
+    void DynamicBVH::FreeNode(uint32_t node) {
+        mNodes[node] = Node{};
+        mNodes[node].parent = mFreeList;
+        mNodes[node].height = UINT32_MAX;
+        mFreeList = node;
+    }
+
+    void DynamicBVH::InsertLeaf(uint32_t leaf) {
+        if (mRoot == NULL_NODE) {
+            mRoot = leaf;
+            mNodes[leaf].parent = NULL_NODE;
+            return;
+        }
+
+        // Walk down to the sibling with the lowest cost: the area of the new parent, plus the growth it causes in every ancestor
+        const AABB leafBounds = mNodes[leaf].GetBounds();
+        uint32_t index = mRoot;
+        while (!mNodes[index].IsLeaf()) {
+            const Node& node = mNodes[index];
+            const AABB bounds = node.GetBounds();
+            const float area = bounds.GetArea();
+            const float combinedArea = AABB::Union(bounds, leafBounds).GetArea();
+
+            const float cost = 2.0f * combinedArea;
+            const float inheritanceCost = 2.0f * (combinedArea - area);
+
+            auto GetDescendCost = [&](uint32_t child) {
+                const AABB childBounds = mNodes[child].GetBounds();
+                const float newArea = AABB::Union(childBounds, leafBounds).GetArea();
+                return (mNodes[child].IsLeaf() ? newArea : newArea - childBounds.GetArea()) + inheritanceCost;
+            };
+            const float cost1 = GetDescendCost(node.child1);
+            const float cost2 = GetDescendCost(node.child2);
+
+            if (cost < cost1 && cost < cost2)
+                break;
+            index = cost1 < cost2 ? node.child1 : node.child2;
+        }
+
+        const uint32_t sibling = index;
+        const uint32_t oldParent = mNodes[sibling].parent;
+        const uint32_t newParent = AllocateNode();
+        mNodes[newParent].parent = oldParent;
+        mNodes[newParent].SetBounds(AABB::Union(leafBounds, mNodes[sibling].GetBounds()));
+        mNodes[newParent].height = mNodes[sibling].height + 1;
+        mNodes[newParent].child1 = sibling;
+        mNodes[newParent].child2 = leaf;
+        mNodes[sibling].parent = newParent;
+        mNodes[leaf].parent = newParent;
+
+        if (oldParent == NULL_NODE) {
+            mRoot = newParent;
+        } else if (mNodes[oldParent].child1 == sibling) {
+            mNodes[oldParent].child1 = newParent;
+        } else {
+            mNodes[oldParent].child2 = newParent;
+        }
+
+        RefitAncestors(oldParent);
+    }
+
+    void DynamicBVH::RemoveLeaf(uint32_t leaf) {
+        if (leaf == mRoot) {
+            mRoot = NULL_NODE;
+            return;
+        }
+
+        const uint32_t parent = mNodes[leaf].parent;
+        const uint32_t grandParent = mNodes[parent].parent;
+        const uint32_t sibling = mNodes[parent].child1 == leaf ? mNodes[parent].child2 : mNodes[parent].child1;
+
+        if (grandParent == NULL_NODE) {
+            mRoot = sibling;
+            mNodes[sibling].parent = NULL_NODE;
+        } else {
+            if (mNodes[grandParent].child1 == parent)
+                mNodes[grandParent].child1 = sibling;
+            else
+                mNodes[grandParent].child2 = sibling;
+            mNodes[sibling].parent = grandParent;
+        }
+
+        FreeNode(parent);
+        mNodes[leaf].parent = NULL_NODE;
+        RefitAncestors(grandParent);
+    }
+
+    void DynamicBVH::RefitAncestors(uint32_t node) {
+        while (node != NULL_NODE) {
+            Node& current = mNodes[node];
+            current.SetBounds(AABB::Union(mNodes[current.child1].GetBounds(), mNodes[current.child2].GetBounds()));
+            current.height = 1 + std::max(mNodes[current.child1].height, mNodes[current.child2].height);
+
+            RotateNodes(node);
+            node = mNodes[node].parent;
+        }
+    }
+
+    void DynamicBVH::RotateNodes(uint32_t node) {
+        Node& a = mNodes[node];
+        if (a.height < 2)
+            return;
+
+        // Swapping a child of A with a grandchild under A's other child leaves A's bounds alone and only changes the bounds of that
+        // other child. The rotation that shrinks it the most is applied, if any does.
+        struct Rotation {
+            uint32_t child;       // Child of A that moves down
+            uint32_t other;       // A's other child, whose bounds change
+            uint32_t grandChild;  // Child of other that moves up
+            uint32_t remaining;   // Child of other that stays
+        };
+
+        Rotation best{};
+        float bestGain = 0.0f;
+        auto Consider = [&](uint32_t child, uint32_t other) {
+            const Node& otherNode = mNodes[other];
+            if (otherNode.IsLeaf())
+                return;
+
+            const float otherArea = otherNode.GetBounds().GetArea();
+            const AABB childBounds = mNodes[child].GetBounds();
+            const uint32_t grandChildren[2] = { otherNode.child1, otherNode.child2 };
+            for (int i = 0; i < 2; i++) {
+                const uint32_t remaining = grandChildren[1 - i];
+                const float gain = otherArea - AABB::Union(childBounds, mNodes[remaining].GetBounds()).GetArea();
+                if (gain > bestGain) {
+                    bestGain = gain;
+                    best = { child, other, grandChildren[i], remaining };
+                }
+            }
+        };
+        Consider(a.child1, a.child2);
+        Consider(a.child2, a.child1);
+
+        if (bestGain <= 0.0f)
+            return;
+
+        Node& other = mNodes[best.other];
+        if (a.child1 == best.child)
+            a.child1 = best.grandChild;
+        else
+            a.child2 = best.grandChild;
+
+        if (other.child1 == best.grandChild)
+            other.child1 = best.child;
+        else
+            other.child2 = best.child;
+
+        mNodes[best.grandChild].parent = node;
+        mNodes[best.child].parent = best.other;
+
+        other.SetBounds(AABB::Union(mNodes[best.child].GetBounds(), mNodes[best.remaining].GetBounds()));
+        other.height = 1 + std::max(mNodes[best.child].height, mNodes[best.remaining].height);
+        a.height = 1 + std::max(mNodes[a.child1].height, mNodes[a.child2].height);
+    }
+
+    DynamicBVH::RayData DynamicBVH::PrepareRay(const Ray& ray) {
+        return { glm::vec4(ray.origin, 0.0f), glm::vec4(1.0f / ray.direction, 0.0f) };
+    }
+
+}
@@ -0,0 +1,39 @@
+#include <Scene/Frustum.h>
+
+namespace VKRE {
+
+    namespace {
+
+        glm::vec4 NormalizePlane(const glm::vec4& plane) {
+            float length = glm::length(glm::vec3(plane));
+            // A plane that everything is in front of keeps degenerate planes out of the way
+            if (length < 1e-6f)
+                return glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
+            return plane / length;
+        }
+
+    }
+
+    Frustum Frustum::FromMatrix(const glm::mat4& viewProjection) {
+        // Gribb-Hartmann, every clip plane is a sum or difference of two rows of the matrix
+        const glm::mat4 rows = glm::transpose(viewProjection);
+
+        Frustum frustum;
+        frustum.planes[0] = NormalizePlane(rows[3] + rows[0]);
+        frustum.planes[1] = NormalizePlane(rows[3] - rows[0]);
+        frustum.planes[2] = NormalizePlane(rows[3] + rows[1]);
+        frustum.planes[3] = NormalizePlane(rows[3] - rows[1]);
+        frustum.planes[4] = NormalizePlane(rows[2]);
+        frustum.planes[5] = NormalizePlane(rows[3] - rows[2]);
+        return frustum;
+    }
+
+    bool Frustum::IntersectsSphere(const glm::vec3& center, float radius) const {
+        for (const glm::vec4& plane : planes) {
+            if (glm::dot(glm::vec3(plane), center) + plane.w < -radius)
+                return false;
+        }
+        return true;
+    }
+
+}
@@ -0,0 +1,360 @@
+#include <Scene/FrustumCulling.h>
+
+#include <algorithm>
+#include <cmath>
+
+#if defined(__x86_64__) || defined(_M_X64)
+    #define VKRE_CULLING_X86
+    #include <immintrin.h>
+    #ifdef _MSC_VER
+        #include <intrin.h>
+        #define VKRE_TARGET_AVX2
+    #else
+        #define VKRE_TARGET_AVX2 __attribute__((target("avx2,fma")))
+    #endif
+#endif
+
+namespace VKRE {
+
+    namespace {
+
+        // Volumes per job, a multiple of 64 so every job owns whole visibility words
+        constexpr uint32_t CULLING_JOB_SIZE = 16384;
+
+        uint32_t GetPaddedCount(uint32_t count) {
+            return (count + FRUSTUM_CULLING_BATCH - 1) / FRUSTUM_CULLING_BATCH * FRUSTUM_CULLING_BATCH;
+        }
+
+        // The frustum transposed into one array per plane component, ready to be broadcast
+        struct FrustumPlanes {
+            float x[6];
+            float y[6];
+            float z[6];
+            float w[6];
+            float absX[6];
+            float absY[6];
+            float absZ[6];
+
+            explicit FrustumPlanes(const Frustum& frustum) {
+                for (int i = 0; i < 6; i++) {
+                    x[i] = frustum.planes[i].x;
+                    y[i] = frustum.planes[i].y;
+                    z[i] = frustum.planes[i].z;
+                    w[i] = frustum.planes[i].w;
+                    absX[i] = std::abs(x[i]);
+                    absY[i] = std::abs(y[i]);
+                    absZ[i] = std::abs(z[i]);
+                }
+            }
+        };
+
+        // Padding lanes past the last volume are tested like any other, their bits are dropped here
+        void StoreWord(std::span<uint64_t> visibility, uint32_t wordBegin, uint32_t end, uint64_t bits) {
+            if (end - wordBegin < 64)
+                bits &= (uint64_t(1) << (end - wordBegin)) - 1;
+            visibility[wordBegin / 64] = bits;
+        }
+
+        void CullSpheresScalar(const FrustumPlanes& planes, const BoundingSphereSoA& spheres, uint32_t begin, uint32_t end, std::span<uint64_t> visibility) {
+            for (uint32_t wordBegin = begin; wordBegin < end; wordBegin += 64) {
+                uint64_t bits = 0;
+                const uint32_t wordEnd = std::min(wordBegin + 64, end);
+                for (uint32_t i = wordBegin; i < wordEnd; i++) {
+                    bool visible = true;
+                    for (int p = 0; p < 6; p++) {
+                        const float distance = planes.x[p] * spheres.GetCenterX()[i] + planes.y[p] * spheres.GetCenterY()[i] + planes.z[p] * spheres.GetCenterZ()[i] + planes.w[p];
+                        visible &= distance + spheres.GetRadius()[i] >= 0.0f;
+                    }
+                    bits |= uint64_t(visible) << (i - wordBegin);
+                }
+                StoreWord(visibility, wordBegin, end, bits);
+            }
+        }
+
+        void CullBoxesScalar(const FrustumPlanes& planes, const BoundingBoxSoA& boxes, uint32_t begin, uint32_t end, std::span<uint64_t> visibility) {
+            for (uint32_t wordBegin = begin; wordBegin < end; wordBegin += 64) {
+                uint64_t bits = 0;
+                const uint32_t wordEnd = std::min(wordBegin + 64, end);
+                for (uint32_t i = wordBegin; i < wordEnd; i++) {
+                    bool visible = true;
+                    for (int p = 0; p < 6; p++) {
+                        const float distance = planes.x[p] * boxes.GetCenterX()[i] + planes.y[p] * boxes.GetCenterY()[i] + planes.z[p] * boxes.GetCenterZ()[i] + planes.w[p];
+                        const float radius = planes.absX[p] * boxes.GetExtentX()[i] + planes.absY[p] * boxes.GetExtentY()[i] + planes.absZ[p] * boxes.GetExtentZ()[i];
+                        visible &= distance + radius >= 0.0f;
+                    }
+                    bits |= uint64_t(visible) << (i - wordBegin);
+                }
+                StoreWord(visibility, wordBegin, end, bits);
+            }
+        }
+
+#ifdef VKRE_CULLING_X86
+        // Only needs SSE2, which is part of x86-64, so this path never needs a runtime check
+        void CullSpheresSSE(const FrustumPlanes& planes, const BoundingSphereSoA& spheres, uint32_t begin, uint32_t end, std::span<uint64_t> visibility) {
+            for (uint32_t wordBegin = begin; wordBegin < end; wordBegin += 64) {
+                uint64_t bits = 0;
+                const uint32_t wordEnd = std::min(wordBegin + 64, end);
+                for (uint32_t i = wordBegin; i < wordEnd; i += 4) {
+                    const __m128 x = _mm_loadu_ps(spheres.GetCenterX() + i);
+                    const __m128 y = _mm_loadu_ps(spheres.GetCenterY() + i);
+                    const __m128 z = _mm_loadu_ps(spheres.GetCenterZ() + i);
+                    const __m128 radius = _mm_loadu_ps(spheres.GetRadius() + i);
+
+                    __m128 visible = _mm_castsi128_ps(_mm_set1_epi32(-1));
+                    for (int p = 0; p < 6; p++) {
+                        __m128 distance = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(planes.x[p]), x), _mm_set1_ps(planes.w[p]));
+                        distance = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(planes.y[p]), y), distance);
+                        distance = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(planes.z[p]), z), distance);
+                        visible = _mm_and_ps(visible, _mm_cmpge_ps(_mm_add_ps(distance, radius), _mm_setzero_ps()));
+                    }
+                    bits |= uint64_t(_mm_movemask_ps(visible)) << (i - wordBegin);
+                }
+                StoreWord(visibility, wordBegin, end, bits);
+            }
+        }
+
+        void CullBoxesSSE(const FrustumPlanes& planes, const BoundingBoxSoA& boxes, uint32_t begin, uint32_t end, std::span<uint64_t> visibility) {
+            for (uint32_t wordBegin = begin; wordBegin < end; wordBegin += 64) {
+                uint64_t bits = 0;
+                const uint32_t wordEnd = std::min(wordBegin + 64, end);
+                for (uint32_t i = wordBegin; i < wordEnd; i += 4) {
+                    const __m128 x = _mm_loadu_ps(boxes.GetCenterX() + i);
+                    const __m128 y = _mm_loadu_ps(boxes.GetCenterY() + i);
+                    const __m128 z = _mm_loadu_ps(boxes.GetCenterZ() + i);
+                    const __m128 extentX = _mm_loadu_ps(boxes.GetExtentX() + i);
+                    const __m128 extentY = _mm_loadu_ps(boxes.GetExtentY() + i);
+                    const __m128 extentZ = _mm_loadu_ps(boxes.GetExtentZ() + i);
+
+                    __m128 visible = _mm_castsi128_ps(_mm_set1_epi32(-1));
+                    for (int p = 0; p < 6; p++) {
+                        __m128 distance = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(planes.x[p]), x), _mm_set1_ps(planes.w[p]));
+                        distance = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(planes.y[p]), y), distance);
+                        distance = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(planes.z[p]), z), distance);
+                        distance = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(planes.absX[p]), extentX), distance);
+                        distance = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(planes.absY[p]), extentY), distance);
+                        distance = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(planes.absZ[p]), extentZ), distance);
+                        visible = _mm_and_ps(visible, _mm_cmpge_ps(distance, _mm_setzero_ps()));
+                    }
+                    bits |= uint64_t(_mm_movemask_ps(visible)) << (i - wordBegin);
+                }
+                StoreWord(visibility, wordBegin, end, bits);
+            }
+        }
+
+        VKRE_TARGET_AVX2 void CullSpheresAVX2(const FrustumPlanes& planes, const BoundingSphereSoA& spheres, uint32_t begin, uint32_t end, std::span<uint64_t> visibility) {
+            for (uint32_t wordBegin = begin; wordBegin < end; wordBegin += 64) {
+                uint64_t bits = 0;
+                const uint32_t wordEnd = std::min(wordBegin + 64, end);
+                for (uint32_t i = wordBegin; i < wordEnd; i += 8) {
+                    const __m256 x = _mm256_loadu_ps(spheres.GetCenterX() + i);
+                    const __m256 y = _mm256_loadu_ps(spheres.GetCenterY() + i);
+                    const __m256 z = _mm256_loadu_ps(spheres.GetCenterZ() + i);
+                    const __m256 radius = _mm256_loadu_ps(spheres.GetRadius() + i);
+
+                    __m256 visible = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+                    for (int p = 0; p < 6; p++) {
+                        __m256 distance = _mm256_fmadd_ps(_mm256_set1_ps(planes.x[p]), x, _mm256_set1_ps(planes.w[p]));
+                        distance = _mm256_fmadd_ps(_mm256_set1_ps(planes.y[p]), y, distance);
+                        distance = _mm256_fmadd_ps(_mm256_set1_ps(planes.z[p]), z, distance);
+                        visible = _mm256_and_ps(visible, _mm256_cmp_ps(_mm256_add_ps(distance, radius), _mm256_setzero_ps(), _CMP_GE_OQ));
+                    }
+                    bits |= uint64_t(_mm256_movemask_ps(visible)) << (i - wordBegin);
+                }
+                StoreWord(visibility, wordBegin, end, bits);
+            }
+        }
+
+        VKRE_TARGET_AVX2 void CullBoxesAVX2(const FrustumPlanes& planes, const BoundingBoxSoA& boxes, uint32_t begin, uint32_t end, std::span<uint64_t> visibility) {
+            for (uint32_t wordBegin = begin; wordBegin < end; wordBegin += 64) {
+                uint64_t bits = 0;
+                const uint32_t wordEnd = std::min(wordBegin + 64, end);
+                for (uint32_t i = wordBegin; i < wordEnd; i += 8) {
+                    const __m256 x = _mm256_loadu_ps(boxes.GetCenterX() + i);
+                    const __m256 y = _mm256_loadu_ps(boxes.GetCenterY() + i);
+                    const __m256 z = _mm256_loadu_ps(boxes.GetCenterZ() + i);
+                    const __m256 extentX = _mm256_loadu_ps(boxes.GetExtentX() + i);
+                    const __m256 extentY = _mm256_loadu_ps(boxes.GetExtentY() + i);
+                    const __m256 extentZ = _mm256_loadu_ps(boxes.GetExtentZ() + i);
+
+                    __m256 visible = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+                    for (int p = 0; p < 6; p++) {
+                        __m256 distance = _mm256_fmadd_ps(_mm256_set1_ps(planes.x[p]), x, _mm256_set1_ps(planes.w[p]));
+                        distance = _mm256_fmadd_ps(_mm256_set1_ps(planes.y[p]), y, distance);
+                        distance = _mm256_fmadd_ps(_mm256_set1_ps(planes.z[p]), z, distance);
+                        distance = _mm256_fmadd_ps(_mm256_set1_ps(planes.absX[p]), extentX, distance);
+                        distance = _mm256_fmadd_ps(_mm256_set1_ps(planes.absY[p]), extentY, distance);
+                        distance = _mm256_fmadd_ps(_mm256_set1_ps(planes.absZ[p]), extentZ, distance);
+                        visible = _mm256_and_ps(visible, _mm256_cmp_ps(distance, _mm256_setzero_ps(), _CMP_GE_OQ));
+                    }
+                    bits |= uint64_t(_mm256_movemask_ps(visible)) << (i - wordBegin);
+                }
+                StoreWord(visibility, wordBegin, end, bits);
+            }
+        }
+
+        bool SupportsAVX2() {
+            #ifdef _MSC_VER
+                int info[4];
+                __cpuid(info, 0);
+                if (info[0] < 7)
+                    return false;
+
+                __cpuid(info, 1);
+                const bool fma = (info[2] & (1 << 12)) != 0;
+                const bool osxsave = (info[2] & (1 << 27)) != 0;
+                const bool avx = (info[2] & (1 << 28)) != 0;
+                // The OS has to save the YMM registers on context switches too
+                if (!fma || !osxsave || !avx || (_xgetbv(0) & 0x6) != 0x6)
+                    return false;
+
+                __cpuidex(info, 7, 0);
+                return (info[1] & (1 << 5)) != 0;
+            #else
+                return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+            #endif
+        }
+#endif
+
+        FrustumCulling::Kernel DetectKernel() {
+            #ifdef VKRE_CULLING_X86
+                return SupportsAVX2() ? FrustumCulling::Kernel::AVX2 : FrustumCulling::Kernel::SSE;
+            #else
+                return FrustumCulling::Kernel::Scalar;
+            #endif
+        }
+
+    }
+
+    uint32_t BoundingSphereSoA::Add(const glm::vec3& center, float radius) {
+        const uint32_t index = mCount++;
+        if (mCount > mRadius.size()) {
+            const size_t paddedCount = GetPaddedCount(mCount);
+            mCenterX.resize(paddedCount, 0.0f);
+            mCenterY.resize(paddedCount, 0.0f);
+            mCenterZ.resize(paddedCount, 0.0f);
+            mRadius.resize(paddedCount, 0.0f);
+        }
+        Set(index, center, radius);
+        return index;
+    }
+
+    void BoundingSphereSoA::Set(uint32_t index, const glm::vec3& center, float radius) {
+        mCenterX[index] = center.x;
+        mCenterY[index] = center.y;
+        mCenterZ[index] = center.z;
+        mRadius[index] = radius;
+    }
+
+    void BoundingSphereSoA::Reserve(uint32_t count) {
+        const size_t paddedCount = GetPaddedCount(count);
+        mCenterX.reserve(paddedCount);
+        mCenterY.reserve(paddedCount);
+        mCenterZ.reserve(paddedCount);
+        mRadius.reserve(paddedCount);
+    }
+
+    void BoundingSphereSoA::Clear() {
+        mCenterX.clear();
+        mCenterY.clear();
+        mCenterZ.clear();
+        mRadius.clear();
+        mCount = 0;
+    }
+
+    uint32_t BoundingBoxSoA::Add(const glm::vec3& center, const glm::vec3& extents) {
+        const uint32_t index = mCount++;
+        if (mCount > mExtentX.size()) {
+            const size_t paddedCount = GetPaddedCount(mCount);
+            mCenterX.resize(paddedCount, 0.0f);
+            mCenterY.resize(paddedCount, 0.0f);
+            mCenterZ.resize(paddedCount, 0.0f);
+            mExtentX.resize(paddedCount, 0.0f);
+            mExtentY.resize(paddedCount, 0.0f);
+            mExtentZ.resize(paddedCount, 0.0f);
+        }
+        Set(index, center, extents);
+        return index;
+    }
+
+    void BoundingBoxSoA::Set(uint32_t index, const glm::vec3& center, const glm::vec3& extents) {
+        mCenterX[index] = center.x;
+        mCenterY[index] = center.y;
+        mCenterZ[index] = center.z;
+        mExtentX[index] = extents.x;
+        mExtentY[index] = extents.y;
+        mExtentZ[index] = extents.z;
+    }
+
+    void BoundingBoxSoA::Reserve(uint32_t count) {
+        const size_t paddedCount = GetPaddedCount(count);
+        mCenterX.reserve(paddedCount);
+        mCenterY.reserve(paddedCount);
+        mCenterZ.reserve(paddedCount);
+        mExtentX.reserve(paddedCount);
+        mExtentY.reserve(paddedCount);
+        mExtentZ.reserve(paddedCount);
+    }
+
+    void BoundingBoxSoA::Clear() {
+        mCenterX.clear();
+        mCenterY.clear();
+        mCenterZ.clear();
+        mExtentX.clear();
+        mExtentY.clear();
+        mExtentZ.clear();
+        mCount = 0;
+    }
+
+    namespace FrustumCulling {
+        Kernel GetKernel() {
+            static const Kernel kernel = DetectKernel();
+            return kernel;
+        }
+
+        const char* GetKernelName(Kernel kernel) {
+            switch (kernel) {
+                case Kernel::Scalar: return "Scalar";
+                case Kernel::SSE: return "SSE";
+                case Kernel::AVX2: return "AVX2";
+            }
+            return "Unknown";
+        }
+
+        void CullSpheres(const Frustum& frustum, const BoundingSphereSoA& spheres, uint32_t begin, uint32_t end, std::span<uint64_t> visibility) {
+            const FrustumPlanes planes(frustum);
+            end = std::min(end, spheres.GetCount());
+            switch (GetKernel()) {
+                #ifdef VKRE_CULLING_X86
+                case Kernel::AVX2: CullSpheresAVX2(planes, spheres, begin, end, visibility); break;
+                case Kernel::SSE: CullSpheresSSE(planes, spheres, begin, end, visibility); break;
+                #endif
+                default: CullSpheresScalar(planes, spheres, begin, end, visibility); break;
+            }
+        }
+
+        void CullBoxes(const Frustum& frustum, const BoundingBoxSoA& boxes, uint32_t begin, uint32_t end, std::span<uint64_t> visibility) {
+            const FrustumPlanes planes(frustum);
+            end = std::min(end, boxes.GetCount());
+            switch (GetKernel()) {
+                #ifdef VKRE_CULLING_X86
+                case Kernel::AVX2: CullBoxesAVX2(planes, boxes, begin, end, visibility); break;
+                case Kernel::SSE: CullBoxesSSE(planes, boxes, begin, end, visibility); break;
+                #endif
+                default: CullBoxesScalar(planes, boxes, begin, end, visibility); break;
+            }
+        }
+
+        void CullSpheres(JobSystem& jobSystem, const Frustum& frustum, const BoundingSphereSoA& spheres, std::span<uint64_t> visibility) {
+            jobSystem.ParallelFor(spheres.GetCount(), CULLING_JOB_SIZE, [&](uint32_t begin, uint32_t end) {
+                CullSpheres(frustum, spheres, begin, end, visibility);
+            });
+        }
+
+        void CullBoxes(JobSystem& jobSystem, const Frustum& frustum, const BoundingBoxSoA& boxes, std::span<uint64_t> visibility) {
+            jobSystem.ParallelFor(boxes.GetCount(), CULLING_JOB_SIZE, [&](uint32_t begin, uint32_t end) {
+                CullBoxes(frustum, boxes, begin, end, visibility);
+            });
+        }
+    }
+
+}
@@ -0,0 +1,88 @@
+#include <Scene/RenderQueue.h>
+
+#include <algorithm>
+#include <array>
+
+namespace VKRE {
+
+    namespace {
+
+        constexpr uint32_t RADIX_BITS = 8;
+        constexpr uint32_t RADIX_SIZE = 1 << RADIX_BITS;
+        constexpr uint32_t DIGIT_COUNT = 64 / RADIX_BITS;
+        // Items per histogram and scatter job. Each chunk scatters its items in order, which keeps every pass stable.
+        constexpr uint32_t SORT_CHUNK_SIZE = 16384;
+
+        uint32_t GetDigit(uint64_t key, uint32_t digit) { return static_cast<uint32_t>(key >> (digit * RADIX_BITS)) & (RADIX_SIZE - 1); }
+
+    }
+
+    uint32_t DrawKey::QuantizeDepth(float depth, float maxDepth, bool backToFront) {
+        constexpr uint32_t MAX_DEPTH_VALUE = (1u << DEPTH_BITS) - 1;
+        const float normalized = maxDepth > 0.0f ? std::clamp(depth / maxDepth, 0.0f, 1.0f) : 0.0f;
+        const uint32_t quantized = static_cast<uint32_t>(normalized * static_cast<float>(MAX_DEPTH_VALUE));
+        return backToFront ? MAX_DEPTH_VALUE - quantized : quantized;
+    }
+
+    void RenderQueue::Reserve(uint32_t count) {
+        mKeys.reserve(count);
+        mPayloads.reserve(count);
+    }
+
+    void RenderQueue::Clear() {
+        mKeys.clear();
+        mPayloads.clear();
+    }
+
+    void RenderQueue::Sort(JobSystem& jobSystem) {
+        const uint32_t count = static_cast<uint32_t>(mKeys.size());
+        if (count < 2)
+            return;
+
+        // Bits that differ between any two keys, digits outside of them would be a pass that moves nothing
+        uint64_t differingBits = 0;
+        for (uint64_t key : mKeys)
+            differingBits |= key ^ mKeys[0];
+
+        const uint32_t chunkCount = (count + SORT_CHUNK_SIZE - 1) / SORT_CHUNK_SIZE;
+        mScratchKeys.resize(count);
+        mScratchPayloads.resize(count);
+        mChunkHistograms.resize(static_cast<size_t>(chunkCount) * RADIX_SIZE);
+
+        for (uint32_t digit = 0; digit < DIGIT_COUNT; digit++) {
+            if (GetDigit(differingBits, digit) == 0)
+                continue;
+
+            jobSystem.ParallelFor(count, SORT_CHUNK_SIZE, [&](uint32_t begin, uint32_t end) {
+                uint32_t* histogram = mChunkHistograms.data() + static_cast<size_t>(begin / SORT_CHUNK_SIZE) * RADIX_SIZE;
+                std::fill(histogram, histogram + RADIX_SIZE, 0u);
+                for (uint32_t i = begin; i < end; i++)
+                    histogram[GetDigit(mKeys[i], digit)]++;
+            });
+
+            // Exclusive prefix sum ordered by digit, then by chunk, turns each chunk's counts into its write offsets
+            uint32_t offset = 0;
+            for (uint32_t bucket = 0; bucket < RADIX_SIZE; bucket++) {
+                for (uint32_t chunk = 0; chunk < chunkCount; chunk++) {
+                    uint32_t& counter = mChunkHistograms[static_cast<size_t>(chunk) * RADIX_SIZE + bucket];
+                    const uint32_t bucketCount = counter;
+                    counter = offset;
+                    offset += bucketCount;
+                }
+            }
+
+            jobSystem.ParallelFor(count, SORT_CHUNK_SIZE, [&](uint32_t begin, uint32_t end) {
+                uint32_t* offsets = mChunkHistograms.data() + static_cast<size_t>(begin / SORT_CHUNK_SIZE) * RADIX_SIZE;
+                for (uint32_t i = begin; i < end; i++) {
+                    const uint32_t destination = offsets[GetDigit(mKeys[i], digit)]++;
+                    mScratchKeys[destination] = mKeys[i];
+                    mScratchPayloads[destination] = mPayloads[i];
+                }
+            });
+
+            mKeys.swap(mScratchKeys);
+            mPayloads.swap(mScratchPayloads);
+        }
+    }
+
+}
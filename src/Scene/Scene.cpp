@@ -0,0 +1,232 @@
+#include <Scene/Scene.h>
+
+#include <algorithm>
+
+namespace VKRE {
+
+    namespace {
+
+        constexpr uint32_t TRANSFORM_BATCH_SIZE = 2048;
+        constexpr uint32_t NO_PARENT = UINT32_MAX;
+
+    }
+
+    Entity Scene::CreateEntity(const LocalTransform& transform, Entity parent) {
+        const Entity entity = mRegistry.Create();
+        mRegistry.Add<LocalTransform>(entity, transform);
+        mRegistry.Add<WorldTransform>(entity);
+        mRegistry.Add<Hierarchy>(entity);
+        mLevelsDirty = true;
+
+        if (mRegistry.IsAlive(parent))
+            SetParent(entity, parent);
+        MarkTransformDirty(entity);
+        return entity;
+    }
+
+    void Scene::DestroyEntity(Entity entity) {
+        if (!mRegistry.IsAlive(entity))
+            return;
+
+        Unlink(entity);
+
+        std::vector<Entity> stack = { entity };
+        while (!stack.empty()) {
+            const Entity current = stack.back();
+            stack.pop_back();
+
+            for (Entity child = mRegistry.Get<Hierarchy>(current).firstChild; child != NULL_ENTITY; child = mRegistry.Get<Hierarchy>(child).nextSibling)
+                stack.push_back(child);
+
+            if (const MeshRenderer* renderer = mRegistry.TryGet<MeshRenderer>(current))
+                mDestroyedMeshRenderers.push_back(*renderer);
+            if (const SpatialBounds* bounds = mRegistry.TryGet<SpatialBounds>(current))
+                mSpatialIndex.DestroyProxy(bounds->proxy);
+
+            if (GetEntityIndex(current) < mDirty.size())
+                mDirty[GetEntityIndex(current)] = 0;
+            mRegistry.Destroy(current);
+        }
+
+        mLevelsDirty = true;
+    }
+
+    bool Scene::SetParent(Entity entity, Entity parent) {
+        if (parent != NULL_ENTITY) {
+            if (!mRegistry.IsAlive(parent))
+                return false;
+
+            for (Entity ancestor = parent; ancestor != NULL_ENTITY; ancestor = mRegistry.Get<Hierarchy>(ancestor).parent) {
+                if (ancestor == entity)
+                    return false;
+            }
+        }
+
+        Unlink(entity);
+
+        Hierarchy& hierarchy = mRegistry.Get<Hierarchy>(entity);
+        hierarchy.parent = parent;
+        if (parent != NULL_ENTITY) {
+            Hierarchy& parentHierarchy = mRegistry.Get<Hierarchy>(parent);
+            hierarchy.nextSibling = parentHierarchy.firstChild;
+            if (parentHierarchy.firstChild != NULL_ENTITY)
+                mRegistry.Get<Hierarchy>(parentHierarchy.firstChild).previousSibling = entity;
+            parentHierarchy.firstChild = entity;
+        }
+
+        UpdateDepths(entity);
+        MarkTransformDirty(entity);
+        mLevelsDirty = true;
+        return true;
+    }
+
+    void Scene::SetLocalTransform(Entity entity, const LocalTransform& transform) {
+        mRegistry.Get<LocalTransform>(entity) = transform;
+        MarkTransformDirty(entity);
+    }
+
+    void Scene::MarkTransformDirty(Entity entity) {
+        const uint32_t index = GetEntityIndex(entity);
+        if (index >= mDirty.size())
+            mDirty.resize(mRegistry.GetEntityCapacity(), 0);
+
+        mDirty[index] = 1;
+        mAnyDirty = true;
+    }
+
+    void Scene::SetBounds(Entity entity, const glm::vec3& center, const glm::vec3& extents) {
+        const AABB worldBounds = AABB::Transform(GetWorldTransform(entity), center, extents);
+        if (SpatialBounds* existing = mRegistry.TryGet<SpatialBounds>(entity)) {
+            existing->center = center;
+            existing->extents = extents;
+            mSpatialIndex.MoveProxy(existing->proxy, worldBounds);
+        } else {
+            mRegistry.Add<SpatialBounds>(entity, center, extents, mSpatialIndex.CreateProxy(worldBounds, entity));
+        }
+
+        // The world transform may be stale, the next UpdateTransforms moves the proxy to where it belongs
+        MarkTransformDirty(entity);
+    }
+
+    void Scene::RemoveBounds(Entity entity) {
+        if (const SpatialBounds* bounds = mRegistry.TryGet<SpatialBounds>(entity)) {
+            mSpatialIndex.DestroyProxy(bounds->proxy);
+            mRegistry.Remove<SpatialBounds>(entity);
+        }
+    }
+
+    void Scene::UpdateTransforms(JobSystem& jobSystem) {
+        mChangedEntities.clear();
+        if (mLevelsDirty)
+            RebuildLevels();
+        if (!mAnyDirty)
+            return;
+
+        std::span<const LocalTransform> locals = mRegistry.GetPool<LocalTransform>().GetComponents();
+        std::span<WorldTransform> worlds = mRegistry.GetPool<WorldTransform>().GetComponents();
+
+        // Levels run in order, a node only reads its parent's flag and matrix, which the previous level has finished writing
+        for (const std::vector<TransformNode>& level : mLevels) {
+            jobSystem.ParallelFor(static_cast<uint32_t>(level.size()), TRANSFORM_BATCH_SIZE, [&](uint32_t begin, uint32_t end) {
+                for (uint32_t i = begin; i < end; i++) {
+                    const TransformNode& node = level[i];
+                    uint8_t& dirty = mDirty[GetEntityIndex(node.entity)];
+                    if (node.parent != NULL_ENTITY && mDirty[GetEntityIndex(node.parent)])
+                        dirty = 1;
+                    if (!dirty)
+                        continue;
+
+                    const glm::mat4 local = locals[node.localIndex].ToMatrix();
+                    worlds[node.worldIndex].matrix = node.parentWorldIndex == NO_PARENT ? local : worlds[node.parentWorldIndex].matrix * local;
+                }
+            });
+        }
+
+        for (const std::vector<TransformNode>& level : mLevels) {
+            for (const TransformNode& node : level) {
+                uint8_t& dirty = mDirty[GetEntityIndex(node.entity)];
+                if (dirty) {
+                    mChangedEntities.push_back(node.entity);
+                    dirty = 0;
+                }
+            }
+        }
+        mAnyDirty = false;
+
+        UpdateSpatialIndex();
+    }
+
+    void Scene::UpdateSpatialIndex() {
+        // The tree isn't thread safe to modify, but with the fat margins most moves return before touching it
+        ComponentPool<SpatialBounds>& boundsPool = mRegistry.GetPool<SpatialBounds>();
+        if (boundsPool.GetSize() == 0)
+            return;
+
+        for (Entity entity : mChangedEntities) {
+            if (const SpatialBounds* bounds = boundsPool.TryGet(entity))
+                mSpatialIndex.MoveProxy(bounds->proxy, AABB::Transform(GetWorldTransform(entity), bounds->center, bounds->extents));
+        }
+    }
+
+    void Scene::Unlink(Entity entity) {
+        Hierarchy& hierarchy = mRegistry.Get<Hierarchy>(entity);
+        if (hierarchy.parent == NULL_ENTITY)
+            return;
+
+        if (hierarchy.previousSibling != NULL_ENTITY)
+            mRegistry.Get<Hierarchy>(hierarchy.previousSibling).nextSibling = hierarchy.nextSibling;
+        else
+            mRegistry.Get<Hierarchy>(hierarchy.parent).firstChild = hierarchy.nextSibling;
+
+        if (hierarchy.nextSibling != NULL_ENTITY)
+            mRegistry.Get<Hierarchy>(hierarchy.nextSibling).previousSibling = hierarchy.previousSibling;
+
+        hierarchy.parent = NULL_ENTITY;
+        hierarchy.nextSibling = NULL_ENTITY;
+        hierarchy.previousSibling = NULL_ENTITY;
+        hierarchy.depth = 0;
+    }
+
+    void Scene::UpdateDepths(Entity root) {
+        std::vector<Entity> stack = { root };
+        while (!stack.empty()) {
+            const Entity current = stack.back();
+            stack.pop_back();
+
+            Hierarchy& hierarchy = mRegistry.Get<Hierarchy>(current);
+            hierarchy.depth = hierarchy.parent == NULL_ENTITY ? 0 : mRegistry.Get<Hierarchy>(hierarchy.parent).depth + 1;
+            for (Entity child = hierarchy.firstChild; child != NULL_ENTITY; child = mRegistry.Get<Hierarchy>(child).nextSibling)
+                stack.push_back(child);
+        }
+    }
+
+    void Scene::RebuildLevels() {
+        for (std::vector<TransformNode>& level : mLevels)
+            level.clear();
+
+        const ComponentPool<Hierarchy>& hierarchies = mRegistry.GetPool<Hierarchy>();
+        const ComponentPool<LocalTransform>& locals = mRegistry.GetPool<LocalTransform>();
+        const ComponentPool<WorldTransform>& worlds = mRegistry.GetPool<WorldTransform>();
+
+        uint32_t levelCount = 0;
+        std::span<const Entity> entities = hierarchies.GetEntities();
+        std::span<const Hierarchy> components = hierarchies.GetComponents();
+        for (size_t i = 0; i < entities.size(); i++) {
+            const Hierarchy& hierarchy = components[i];
+            if (hierarchy.depth >= mLevels.size())
+                mLevels.resize(hierarchy.depth + 1);
+            levelCount = std::max(levelCount, hierarchy.depth + 1);
+
+            const uint32_t parentWorldIndex = hierarchy.parent == NULL_ENTITY ? NO_PARENT : worlds.GetDenseIndex(hierarchy.parent);
+            mLevels[hierarchy.depth].push_back({ entities[i], hierarchy.parent, locals.GetDenseIndex(entities[i]), worlds.GetDenseIndex(entities[i]), parentWorldIndex });
+        }
+        mLevels.resize(levelCount);
+
+        // Walk each level in the order the world transforms are laid out in memory
+        for (std::vector<TransformNode>& level : mLevels)
+            std::sort(level.begin(), level.end(), [](const TransformNode& a, const TransformNode& b) { return a.worldIndex < b.worldIndex; });
+
+        mLevelsDirty = false;
+    }
+
+}
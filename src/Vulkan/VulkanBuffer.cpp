@@ -0,0 +1,62 @@
+#include <Vulkan/VulkanBuffer.h>
+
+namespace VKRE {
+
+    VulkanBuffer::VulkanBuffer(std::shared_ptr<VulkanContext> context)
+        :mContext(context) {}
+
+    VulkanBuffer::~VulkanBuffer() {
+        Release();
+    }
+
+    void VulkanBuffer::CreateBuffer(VkDeviceSize size, VkBufferUsageFlags usageFlags, VmaMemoryUsage memoryUsage, VmaAllocationCreateFlags allocationFlags) {
+        Release();
+
+        VkBufferCreateInfo info = {};
+        info.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+        info.pNext = nullptr;
+        info.size = size;
+        info.usage = usageFlags;
+
+        VmaAllocationCreateInfo allocInfo = {};
+        allocInfo.usage = memoryUsage;
+        allocInfo.flags = allocationFlags;
+        if (memoryUsage == VMA_MEMORY_USAGE_CPU_ONLY || memoryUsage == VMA_MEMORY_USAGE_CPU_TO_GPU || memoryUsage == VMA_MEMORY_USAGE_GPU_TO_CPU) {
+            allocInfo.flags |= VMA_ALLOCATION_CREATE_MAPPED_BIT;
+        }
+
+        VK_CHECK(vmaCreateBuffer(mContext->GetAllocator(), &info, &allocInfo, &mBufferInfo.buffer, &mBufferInfo.allocation, &mBufferInfo.allocationInfo));
+        mBufferInfo.size = size;
+
+        if (usageFlags & VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT) {
+            VkBufferDeviceAddressInfo addressInfo{};
+            addressInfo.sType = VK_STRUCTURE_TYPE_BUFFER_DEVICE_ADDRESS_INFO;
+            addressInfo.buffer = mBufferInfo.buffer;
+            mBufferInfo.deviceAddress = vkGetBufferDeviceAddress(mContext->GetLogicalDevice().handle, &addressInfo);
+        }
+    }
+
+    void VulkanBuffer::Release() {
+        if (mBufferInfo.buffer) {
+            vmaDestroyBuffer(mContext->GetAllocator(), mBufferInfo.buffer, mBufferInfo.allocation);
+        }
+
+        mBufferInfo = {};
+    }
+
+    namespace BufferUtils {
+        void GlobalBarrier(VkCommandBuffer cmd, VkPipelineStageFlags2 srcStage, VkAccessFlags2 srcAccess, VkPipelineStageFlags2 dstStage, VkAccessFlags2 dstAccess) {
+            VkMemoryBarrier2 barrier{ .sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER_2 };
+            barrier.srcStageMask = srcStage;
+            barrier.srcAccessMask = srcAccess;
+            barrier.dstStageMask = dstStage;
+            barrier.dstAccessMask = dstAccess;
+
+            VkDependencyInfo depInfo{ .sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO };
+            depInfo.memoryBarrierCount = 1;
+            depInfo.pMemoryBarriers = &barrier;
+            vkCmdPipelineBarrier2(cmd, &depInfo);
+        }
+    }
+
+}
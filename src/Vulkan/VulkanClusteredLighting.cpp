@@ -0,0 +1,99 @@
+#include <Vulkan/VulkanClusteredLighting.h>
+
+#include <cmath>
+#include <cstring>
+
+namespace VKRE {
+
+    namespace {
+
+        constexpr uint32_t CULL_WORKGROUP_SIZE = 64;
+
+    }
+
+    VulkanClusteredLighting::VulkanClusteredLighting(std::shared_ptr<VulkanContext> context, uint32_t framesInFlight, const ClusteredLightingSpecs& specs)
+        :mContext(context), mSpecs(specs), mCullPipeline(context), mFrames(framesInFlight) {
+        const VkBufferUsageFlags storageUsage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT;
+        const VkDeviceSize clusterCount = static_cast<VkDeviceSize>(mSpecs.gridSize.x) * mSpecs.gridSize.y * mSpecs.gridSize.z;
+
+        // Written and read within a frame, the next frame's binning waits for this one's shading in Cull
+        mClusterCountBuffer = std::make_unique<VulkanBuffer>(mContext);
+        mClusterCountBuffer->CreateBuffer(clusterCount * sizeof(uint32_t), storageUsage, VMA_MEMORY_USAGE_GPU_ONLY);
+        mClusterLightBuffer = std::make_unique<VulkanBuffer>(mContext);
+        mClusterLightBuffer->CreateBuffer(clusterCount * mSpecs.maxLightsPerCluster * sizeof(uint32_t), storageUsage, VMA_MEMORY_USAGE_GPU_ONLY);
+
+        for (auto& frame : mFrames) {
+            frame.dataBuffer = std::make_unique<VulkanBuffer>(mContext);
+            frame.dataBuffer->CreateBuffer(sizeof(LightingData), storageUsage, VMA_MEMORY_USAGE_CPU_TO_GPU);
+            frame.lightBuffer = std::make_unique<VulkanBuffer>(mContext);
+            frame.lightBuffer->CreateBuffer(static_cast<VkDeviceSize>(mSpecs.maxLights) * sizeof(GPULight), storageUsage, VMA_MEMORY_USAGE_CPU_TO_GPU);
+        }
+
+        mCullPipeline.CreatePipeline("LightCull.comp", sizeof(PushConstants));
+        mLights.reserve(mSpecs.maxLights);
+    }
+
+    VulkanClusteredLighting::~VulkanClusteredLighting() {
+        mFrames.clear();
+        mCullPipeline.Release();
+    }
+
+    bool VulkanClusteredLighting::AddLight(const GPULight& light) {
+        if (mLights.size() >= mSpecs.maxLights)
+            return false;
+
+        mLights.push_back(light);
+        return true;
+    }
+
+    void VulkanClusteredLighting::Capture(LightingSnapshot& snapshot) const {
+        // The snapshot keeps its capacity, so this doesn't allocate once it has seen the most lights
+        snapshot.lights.assign(mLights.begin(), mLights.end());
+        snapshot.sunDirection = mSunDirection;
+        snapshot.sunColor = mSunColor;
+        snapshot.ambientColor = mAmbientColor;
+    }
+
+    void VulkanClusteredLighting::Cull(VkCommandBuffer cmd, uint32_t frameIndex, const LightingView& view, const LightingSnapshot& lights) {
+        LightingFrame& frame = mFrames[frameIndex];
+        memcpy(frame.lightBuffer->GetMappedData(), lights.lights.data(), lights.lights.size() * sizeof(GPULight));
+
+        // Slices are spaced so that log(distance) maps linearly onto [0, gridSize.z) between the near and far planes
+        const float logDepthRange = std::log(view.farPlane / view.nearPlane);
+        LightingData data{};
+        data.view = view.view;
+        data.inverseProjection = glm::inverse(view.projection);
+        data.sunDirection = glm::vec4(lights.sunDirection, 0.0f);
+        data.sunColor = glm::vec4(lights.sunColor, 0.0f);
+        data.ambientColor = glm::vec4(lights.ambientColor, 0.0f);
+        data.gridSize = glm::uvec4(mSpecs.gridSize, mSpecs.maxLightsPerCluster);
+        data.screenSize = glm::vec2(view.screenSize);
+        data.tileSize = glm::ceil(data.screenSize / glm::vec2(mSpecs.gridSize.x, mSpecs.gridSize.y));
+        data.nearPlane = view.nearPlane;
+        data.farPlane = view.farPlane;
+        data.sliceScale = static_cast<float>(mSpecs.gridSize.z) / logDepthRange;
+        data.sliceBias = -static_cast<float>(mSpecs.gridSize.z) * std::log(view.nearPlane) / logDepthRange;
+        data.lightCount = static_cast<uint32_t>(lights.lights.size());
+        data.lights = frame.lightBuffer->GetBufferInfo().deviceAddress;
+        data.clusterCounts = mClusterCountBuffer->GetBufferInfo().deviceAddress;
+        data.clusterLights = mClusterLightBuffer->GetBufferInfo().deviceAddress;
+        data.shadows = view.shadowData;
+        memcpy(frame.dataBuffer->GetMappedData(), &data, sizeof(LightingData));
+
+        // The previous frame's shading may still be reading the cluster lists
+        BufferUtils::GlobalBarrier(cmd, VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT, VK_ACCESS_2_SHADER_STORAGE_READ_BIT,
+            VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT);
+
+        PushConstants pushConstants{};
+        pushConstants.data = frame.dataBuffer->GetBufferInfo().deviceAddress;
+
+        const uint32_t clusterCount = mSpecs.gridSize.x * mSpecs.gridSize.y * mSpecs.gridSize.z;
+        mCullPipeline.Bind(cmd);
+        mCullPipeline.PushConstants(cmd, pushConstants);
+        vkCmdDispatch(cmd, (clusterCount + CULL_WORKGROUP_SIZE - 1) / CULL_WORKGROUP_SIZE, 1, 1);
+
+        BufferUtils::GlobalBarrier(cmd, VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT,
+            VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT, VK_ACCESS_2_SHADER_STORAGE_READ_BIT);
+    }
+
+}
@@ -7,46 +7,13 @@
 #include <GLFW/glfw3.h>
 
 #include <cstring>
+#include <fstream>
 
 namespace VKRE {
 
     VulkanContext::VulkanContext(std::shared_ptr<Window> window) {
-        if (mEnableValidationLayers && !VulkanUtils::CheckValidationLayerSupport(mValidationLayers)) {
-            std::println("Failed to create Vulkan Instance: Validation Layers are not supported!");
-            abort();
-        }
-
         mWindow = window;
-
-        if (!sInstance) {
-            VkApplicationInfo appInfo{};
-            appInfo.sType = VK_STRUCTURE_TYPE_APPLICATION_INFO;
-            appInfo.pApplicationName = "VK Rendering Engine";
-            appInfo.applicationVersion = VK_MAKE_VERSION(1, 0 , 0);
-            appInfo.pEngineName = "No Engine";
-            appInfo.engineVersion = VK_MAKE_VERSION(1, 0, 0);
-            appInfo.apiVersion = VK_MAKE_API_VERSION(0, 1, 3, 0);
-
-            // TODO: Check if all required extensions are available
-            std::vector<const char*> extensions = window->GetWindowExtensions();
-            extensions.emplace_back(VK_KHR_PORTABILITY_ENUMERATION_EXTENSION_NAME);
-
-            VkInstanceCreateInfo createInfo{};
-            createInfo.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
-            createInfo.pApplicationInfo = &appInfo;
-            createInfo.flags |= VK_INSTANCE_CREATE_ENUMERATE_PORTABILITY_BIT_KHR;
-            createInfo.enabledExtensionCount = static_cast<uint32_t>(extensions.size());
-            createInfo.ppEnabledExtensionNames = extensions.data();
-            if (mEnableValidationLayers) {
-                createInfo.enabledLayerCount = static_cast<uint32_t>(mValidationLayers.size());
-                createInfo.ppEnabledLayerNames = mValidationLayers.data();
-            } else {
-                createInfo.enabledLayerCount = 0;
-                createInfo.ppEnabledLayerNames = nullptr;
-            }
-
-            VK_CHECK(vkCreateInstance(&createInfo, nullptr, &sInstance));
-        }
+        CreateInstance(window->GetWindowExtensions());
 
         // TODO: Change this to be API agnostic
         GLFWwindow* glfwWindow = window->GetGLFWwindow();
@@ -59,8 +26,10 @@ namespace VKRE {
         std::optional<VulkanPhysicalDevice> physicalDevice = deviceSelector.SetName("Main Rendering Device")
                                                             .SetRequiredQueueFamilies({ VK_QUEUE_GRAPHICS_BIT })
                                                             .SetRequiredExtensions({ VK_KHR_SWAPCHAIN_EXTENSION_NAME })
+                                                            .SetRequiredFeatures({ .multiDrawIndirect = true, .drawIndirectFirstInstance = true, .textureCompressionBC = true, .fragmentStoresAndAtomics = true })
+                                                            .SetRequiredFeatures11({ .multiview = true })
                                                             .SetRequiredFeatures13({ .synchronization2 = true, .dynamicRendering = true })
-                                                            .SetRequiredFeatures12({ .descriptorIndexing = true, .bufferDeviceAddress = true })
+                                                            .SetRequiredFeatures12({ .drawIndirectCount = true, .descriptorIndexing = true, .shaderSampledImageArrayNonUniformIndexing = true, .descriptorBindingPartiallyBound = true, .runtimeDescriptorArray = true, .bufferDeviceAddress = true })
                                                             .Select();
         if (physicalDevice.has_value()) {
             mPhysicalDevice = physicalDevice.value();
@@ -85,9 +54,130 @@ namespace VKRE {
         allocatorInfo.flags = VMA_ALLOCATOR_CREATE_BUFFER_DEVICE_ADDRESS_BIT;
         vmaCreateAllocator(&allocatorInfo, &mAllocator);
         mDeletionQueue.PushDeleteFunc([&]() { vmaDestroyAllocator(mAllocator); });
+        mObjectCache = std::make_unique<VulkanObjectCache>(mLogicalDevice.handle);
+    }
+
+    VkSurfaceKHR VulkanContext::CreateSurface(const Window& window) const {
+        VkSurfaceKHR surface = VK_NULL_HANDLE;
+        if (glfwCreateWindowSurface(sInstance, window.GetGLFWwindow(), nullptr, &surface) != VK_SUCCESS) {
+            std::println("Failed to create Vulkan Surface!");
+            abort();
+        }
+
+        // Every window is presented from the graphics queue, in one batch
+        VkBool32 presentSupport = VK_FALSE;
+        VK_CHECK(vkGetPhysicalDeviceSurfaceSupportKHR(mPhysicalDevice.handle, GetQueueFamilies().graphicsFamily.value(), surface, &presentSupport));
+        if (!presentSupport) {
+            std::println("Failed to create Vulkan Surface: the graphics queue can't present to it!");
+            abort();
+        }
+        return surface;
+    }
+
+    void VulkanContext::CreateInstance(const std::vector<const char*>& windowExtensions) {
+        if (sInstance)
+            return;
+
+        if (sEnableValidationLayers && !VulkanUtils::CheckValidationLayerSupport(sValidationLayers)) {
+            std::println("Failed to create Vulkan Instance: Validation Layers are not supported!");
+            abort();
+        }
+
+        VkApplicationInfo appInfo{};
+        appInfo.sType = VK_STRUCTURE_TYPE_APPLICATION_INFO;
+        appInfo.pApplicationName = "VK Rendering Engine";
+        appInfo.applicationVersion = VK_MAKE_VERSION(1, 0 , 0);
+        appInfo.pEngineName = "No Engine";
+        appInfo.engineVersion = VK_MAKE_VERSION(1, 0, 0);
+        appInfo.apiVersion = VK_MAKE_API_VERSION(0, 1, 3, 0);
+
+        // TODO: Check if all required extensions are available
+        std::vector<const char*> extensions = windowExtensions;
+        extensions.emplace_back(VK_KHR_PORTABILITY_ENUMERATION_EXTENSION_NAME);
+
+        VkInstanceCreateInfo createInfo{};
+        createInfo.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
+        createInfo.pApplicationInfo = &appInfo;
+        createInfo.flags |= VK_INSTANCE_CREATE_ENUMERATE_PORTABILITY_BIT_KHR;
+        createInfo.enabledExtensionCount = static_cast<uint32_t>(extensions.size());
+        createInfo.ppEnabledExtensionNames = extensions.data();
+        if (sEnableValidationLayers) {
+            createInfo.enabledLayerCount = static_cast<uint32_t>(sValidationLayers.size());
+            createInfo.ppEnabledLayerNames = sValidationLayers.data();
+        } else {
+            createInfo.enabledLayerCount = 0;
+            createInfo.ppEnabledLayerNames = nullptr;
+        }
+
+        VK_CHECK(vkCreateInstance(&createInfo, nullptr, &sInstance));
+    }
+
+    std::vector<std::byte> VulkanContext::ReadPipelineCacheFile(const std::filesystem::path& path) {
+        std::ifstream file(path, std::ios::binary | std::ios::ate);
+        if (!file)
+            return {};
+
+        std::vector<std::byte> data(static_cast<size_t>(file.tellg()));
+        file.seekg(0);
+        file.read(reinterpret_cast<char*>(data.data()), static_cast<std::streamsize>(data.size()));
+        if (!file)
+            return {};
+        return data;
+    }
+
+    void VulkanContext::CreatePipelineCache(std::span<const std::byte> initialData) {
+        // Drivers have to reject incompatible data themselves, but checking the header keeps a stale file from another GPU out entirely
+        VkPipelineCacheHeaderVersionOne header{};
+        if (initialData.size() >= sizeof(header)) {
+            memcpy(&header, initialData.data(), sizeof(header));
+            const VkPhysicalDeviceProperties& properties = mPhysicalDevice.properties;
+            const bool compatible = header.headerVersion == VK_PIPELINE_CACHE_HEADER_VERSION_ONE && header.vendorID == properties.vendorID
+                && header.deviceID == properties.deviceID && memcmp(header.pipelineCacheUUID, properties.pipelineCacheUUID, VK_UUID_SIZE) == 0;
+            if (!compatible)
+                initialData = {};
+        } else {
+            initialData = {};
+        }
+
+        VkPipelineCacheCreateInfo createInfo{};
+        createInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+        createInfo.pNext = nullptr;
+        createInfo.initialDataSize = initialData.size();
+        createInfo.pInitialData = initialData.data();
+        VK_CHECK(vkCreatePipelineCache(mLogicalDevice.handle, &createInfo, nullptr, &mPipelineCache));
+    }
+
+    void VulkanContext::SavePipelineCache(const std::filesystem::path& path) const {
+        if (!mPipelineCache)
+            return;
+
+        size_t size = 0;
+        VK_CHECK(vkGetPipelineCacheData(mLogicalDevice.handle, mPipelineCache, &size, nullptr));
+        std::vector<std::byte> data(size);
+        VK_CHECK(vkGetPipelineCacheData(mLogicalDevice.handle, mPipelineCache, &size, data.data()));
+
+        // Written next to the old file and renamed over it, so a crash mid-write can't leave a truncated cache behind
+        std::filesystem::path temporaryPath = path;
+        temporaryPath += ".tmp";
+        {
+            std::ofstream file(temporaryPath, std::ios::binary | std::ios::trunc);
+            if (!file) {
+                std::println("Failed to save the pipeline cache to {}", path.string());
+                return;
+            }
+            file.write(reinterpret_cast<const char*>(data.data()), static_cast<std::streamsize>(size));
+        }
+
+        std::error_code error;
+        std::filesystem::rename(temporaryPath, path, error);
+        if (error)
+            std::println("Failed to save the pipeline cache to {}: {}", path.string(), error.message());
     }
 
     VulkanContext::~VulkanContext() {
+        if (mPipelineCache)
+            vkDestroyPipelineCache(mLogicalDevice.handle, mPipelineCache, nullptr);
+        mObjectCache.reset();
         mDeletionQueue.Flush();
         mLogicalDevice.Destroy();
         vkDestroySurfaceKHR(sInstance, mSurface, nullptr);
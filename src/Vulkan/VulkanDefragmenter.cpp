@@ -0,0 +1,214 @@
+#include <Vulkan/VulkanDefragmenter.h>
+
+#include <cassert>
+
+namespace VKRE {
+
+    namespace {
+
+        // Passes whose moves were all ignored have nothing to wait for, up to this many follow each other within a frame
+        constexpr uint32_t MAX_PASSES_PER_FRAME = 8;
+
+        VkImageCreateInfo GetProbeImageInfo(VkFormat format, VkImageUsageFlags usage) {
+            VkImageCreateInfo imageInfo = { .sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO };
+            imageInfo.imageType = VK_IMAGE_TYPE_2D;
+            imageInfo.format = format;
+            imageInfo.extent = { 4, 4, 1 }; // One block of the compressed formats
+            imageInfo.mipLevels = 1;
+            imageInfo.arrayLayers = 1;
+            imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+            imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+            imageInfo.usage = usage;
+            imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+            return imageInfo;
+        }
+
+        VmaAllocationCreateInfo GetDeviceLocalAllocationInfo() {
+            VmaAllocationCreateInfo allocInfo = {};
+            allocInfo.usage = VMA_MEMORY_USAGE_GPU_ONLY;
+            allocInfo.requiredFlags = VkMemoryPropertyFlags(VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+            return allocInfo;
+        }
+
+    }
+
+    VulkanDefragmenter::VulkanDefragmenter(std::shared_ptr<VulkanContext> context, const DefragmenterSpecs& specs)
+        :mContext(context), mSpecs(specs) {
+        // The memory type is picked for a typical texture. Formats that can't live in it are checked for in GetAllocationCreateInfo.
+        const VkImageCreateInfo imageInfo = GetProbeImageInfo(VK_FORMAT_R8G8B8A8_UNORM, VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT);
+        const VmaAllocationCreateInfo allocInfo = GetDeviceLocalAllocationInfo();
+        VK_CHECK(vmaFindMemoryTypeIndexForImageInfo(mContext->GetAllocator(), &imageInfo, &allocInfo, &mMemoryTypeIndex));
+
+        VmaPoolCreateInfo poolInfo = {};
+        poolInfo.memoryTypeIndex = mMemoryTypeIndex;
+        VK_CHECK(vmaCreatePool(mContext->GetAllocator(), &poolInfo, &mPool));
+    }
+
+    VulkanDefragmenter::~VulkanDefragmenter() {
+        if (mPass.inFlight)
+            EndPass();
+        if (mDefragmentation)
+            EndDefragmentation();
+        vmaDestroyPool(mContext->GetAllocator(), mPool);
+    }
+
+    VmaAllocationCreateInfo VulkanDefragmenter::GetAllocationCreateInfo(VkFormat format, VkImageUsageFlags usage) const {
+        VmaAllocationCreateInfo allocInfo = GetDeviceLocalAllocationInfo();
+
+        // Images of the format and usage have the same memory requirements whatever their size
+        const VkImageCreateInfo imageInfo = GetProbeImageInfo(format, usage);
+        VkDeviceImageMemoryRequirements requirementsInfo = { .sType = VK_STRUCTURE_TYPE_DEVICE_IMAGE_MEMORY_REQUIREMENTS };
+        requirementsInfo.pCreateInfo = &imageInfo;
+        VkMemoryRequirements2 requirements = { .sType = VK_STRUCTURE_TYPE_MEMORY_REQUIREMENTS_2 };
+        vkGetDeviceImageMemoryRequirements(mContext->GetLogicalDevice().handle, &requirementsInfo, &requirements);
+
+        if (IsPoolCompatible(requirements.memoryRequirements.memoryTypeBits))
+            allocInfo.pool = mPool;
+        return allocInfo;
+    }
+
+    void VulkanDefragmenter::Register(const std::shared_ptr<VulkanImage2D>& image) {
+        assert((image->GetImageInfo().usage & VK_IMAGE_USAGE_TRANSFER_SRC_BIT) && "Moving an image copies out of it");
+
+        // GetAllocationCreateInfo put it into the default pools, which are never defragmented
+        VkMemoryRequirements requirements;
+        vkGetImageMemoryRequirements(mContext->GetLogicalDevice().handle, image->GetImageInfo().image, &requirements);
+        if (!IsPoolCompatible(requirements.memoryTypeBits))
+            return;
+
+        // Allocation handles are reused once freed, a newer image simply takes the entry over
+        std::lock_guard lock(mRegistryMutex);
+        mRegistry[image->GetImageInfo().allocation] = image;
+    }
+
+    void VulkanDefragmenter::BeginFrame(VkCommandBuffer cmd, uint32_t frameIndex) {
+        mFrameNumber++;
+
+        if (mPass.inFlight) {
+            if (mPass.frameIndex != frameIndex)
+                return;
+            if (EndPass()) {
+                EndDefragmentation();
+                return;
+            }
+        }
+
+        if (!mDefragmentation) {
+            if (!ShouldStart())
+                return;
+
+            VmaDefragmentationInfo info = {};
+            info.flags = 0; // Balanced
+            info.pool = mPool;
+            info.maxBytesPerPass = mSpecs.maxBytesPerPass;
+            info.maxAllocationsPerPass = mSpecs.maxAllocationsPerPass;
+            VK_CHECK(vmaBeginDefragmentation(mContext->GetAllocator(), &info, &mDefragmentation));
+        }
+
+        for (uint32_t pass = 0; pass < MAX_PASSES_PER_FRAME; pass++) {
+            const PassResult result = BeginPass(cmd, frameIndex);
+            if (result == PassResult::MOVING)
+                return;
+            if (result == PassResult::FINISHED) {
+                EndDefragmentation();
+                return;
+            }
+        }
+        // Still open, the next frame carries on with the next pass
+    }
+
+    bool VulkanDefragmenter::ShouldStart() {
+        if (mFrameNumber - mLastCheckFrame < mSpecs.checkIntervalFrames)
+            return false;
+        mLastCheckFrame = mFrameNumber;
+
+        {
+            std::lock_guard lock(mRegistryMutex);
+            std::erase_if(mRegistry, [](const auto& entry) { return entry.second.expired(); });
+            if (mRegistry.empty())
+                return false;
+        }
+
+        VmaStatistics statistics;
+        vmaGetPoolStatistics(mContext->GetAllocator(), mPool, &statistics);
+        const VkDeviceSize blockBytes = statistics.blockBytes;
+        const VkDeviceSize freeBytes = blockBytes - statistics.allocationBytes;
+        return freeBytes >= mSpecs.minFreeBytes && static_cast<float>(freeBytes) >= mSpecs.minFreeRatio * static_cast<float>(blockBytes);
+    }
+
+    VulkanDefragmenter::PassResult VulkanDefragmenter::BeginPass(VkCommandBuffer cmd, uint32_t frameIndex) {
+        const VkResult result = vmaBeginDefragmentationPass(mContext->GetAllocator(), mDefragmentation, &mPass.moves);
+        if (result == VK_SUCCESS)
+            return PassResult::FINISHED;
+        if (result != VK_INCOMPLETE) {
+            VK_CHECK(result);
+            return PassResult::FINISHED;
+        }
+
+        {
+            std::lock_guard lock(mRegistryMutex);
+            for (uint32_t i = 0; i < mPass.moves.moveCount; i++) {
+                VmaDefragmentationMove& move = mPass.moves.pMoves[i];
+                auto entry = mRegistry.find(move.srcAllocation);
+                std::shared_ptr<VulkanImage2D> image = entry != mRegistry.end() ? entry->second.lock() : nullptr;
+
+                // Only an image created in the pool but not registered yet, or released while the pass was being prepared, gets here
+                if (!image || image->GetImageInfo().allocation != move.srcAllocation) {
+                    move.operation = VMA_DEFRAGMENTATION_MOVE_OPERATION_IGNORE;
+                    continue;
+                }
+
+                move.operation = VMA_DEFRAGMENTATION_MOVE_OPERATION_COPY;
+                mPass.oldImages.push_back(image->RecordMove(cmd, move.dstTmpAllocation));
+                mPass.movedImages.push_back(std::move(image));
+            }
+        }
+
+        // Nothing recorded, so nothing to wait for, the ignored allocations stay where they are and the next pass proposes others
+        if (mPass.movedImages.empty()) {
+            const VkResult endResult = vmaEndDefragmentationPass(mContext->GetAllocator(), mDefragmentation, &mPass.moves);
+            if (endResult == VK_SUCCESS)
+                return PassResult::FINISHED;
+            if (endResult != VK_INCOMPLETE)
+                VK_CHECK(endResult);
+            return PassResult::NOTHING_MOVED;
+        }
+
+        mPass.frameIndex = frameIndex;
+        mPass.inFlight = true;
+        return PassResult::MOVING;
+    }
+
+    bool VulkanDefragmenter::EndPass() {
+        VkDevice device = mContext->GetLogicalDevice().handle;
+        for (auto [image, imageView] : mPass.oldImages) {
+            vkDestroyImageView(device, imageView, nullptr);
+            vkDestroyImage(device, image, nullptr);
+        }
+
+        // Frees the memory the images moved out of, their allocations now point at where they moved to
+        const VkResult result = vmaEndDefragmentationPass(mContext->GetAllocator(), mDefragmentation, &mPass.moves);
+        mPass.oldImages.clear();
+        mPass.movedImages.clear();
+        mPass.inFlight = false;
+
+        if (result == VK_SUCCESS)
+            return true;
+        if (result != VK_INCOMPLETE)
+            VK_CHECK(result);
+        return false;
+    }
+
+    void VulkanDefragmenter::EndDefragmentation() {
+        VmaDefragmentationStats stats = {};
+        vmaEndDefragmentation(mContext->GetAllocator(), mDefragmentation, &stats);
+        mDefragmentation = VK_NULL_HANDLE;
+        mLastCheckFrame = mFrameNumber;
+
+        mStats.bytesMoved += stats.bytesMoved;
+        mStats.bytesFreed += stats.bytesFreed;
+        mStats.allocationsMoved += stats.allocationsMoved;
+        mStats.deviceMemoryBlocksFreed += stats.deviceMemoryBlocksFreed;
+    }
+
+}
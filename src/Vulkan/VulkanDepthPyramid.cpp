@@ -0,0 +1,136 @@
+#include <Vulkan/VulkanDepthPyramid.h>
+
+#include <cstring>
+
+namespace VKRE {
+
+    namespace {
+
+        // Every workgroup reduces a 64x64 pixel tile, which is 32x32 texels of level 0, down to level 5 in shared memory
+        constexpr uint32_t LEVEL_0_TEXELS_PER_GROUP = 32;
+
+    }
+
+    VulkanDepthPyramid::VulkanDepthPyramid(std::shared_ptr<VulkanContext> context, std::shared_ptr<VulkanImage2D> depthImage, bool reverseZ)
+        :mContext(context), mDepthImage(depthImage), mPipeline(context) {
+        VkDevice device = mContext->GetLogicalDevice().handle;
+
+        const VkExtent3D depthExtent = mDepthImage->GetImageInfo().extent;
+        mInfo.depthSize = { depthExtent.width, depthExtent.height };
+        mInfo.reverseZ = reverseZ ? 1 : 0;
+
+        uint32_t width = (depthExtent.width + 1) / 2;
+        uint32_t height = (depthExtent.height + 1) / 2;
+        uint32_t texelCount = 0;
+        for (;;) {
+            mInfo.levels[mInfo.levelCount++] = { width, height, texelCount, 0 };
+            texelCount += width * height;
+            if ((width == 1 && height == 1) || mInfo.levelCount == DEPTH_PYRAMID_MAX_LEVELS)
+                break;
+
+            width = (width + 1) / 2;
+            height = (height + 1) / 2;
+        }
+        mGroupCount = { (mInfo.levels[0].x + LEVEL_0_TEXELS_PER_GROUP - 1) / LEVEL_0_TEXELS_PER_GROUP, (mInfo.levels[0].y + LEVEL_0_TEXELS_PER_GROUP - 1) / LEVEL_0_TEXELS_PER_GROUP };
+
+        const VkBufferUsageFlags storageUsage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT;
+        mInfoBuffer = std::make_unique<VulkanBuffer>(mContext);
+        mInfoBuffer->CreateBuffer(sizeof(DepthPyramidInfo), storageUsage, VMA_MEMORY_USAGE_CPU_TO_GPU);
+        memcpy(mInfoBuffer->GetMappedData(), &mInfo, sizeof(DepthPyramidInfo));
+
+        mPyramidBuffer = std::make_unique<VulkanBuffer>(mContext);
+        mPyramidBuffer->CreateBuffer(static_cast<VkDeviceSize>(texelCount) * sizeof(glm::vec2), storageUsage, VMA_MEMORY_USAGE_GPU_ONLY);
+        mCounterBuffer = std::make_unique<VulkanBuffer>(mContext);
+        mCounterBuffer->CreateBuffer(sizeof(uint32_t), storageUsage | VK_BUFFER_USAGE_TRANSFER_DST_BIT, VMA_MEMORY_USAGE_GPU_ONLY);
+
+        // Depth is read with texelFetch, the sampler only exists because depth images can't be bound as storage images
+        VkSamplerCreateInfo samplerInfo{};
+        samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+        samplerInfo.pNext = nullptr;
+        samplerInfo.magFilter = VK_FILTER_NEAREST;
+        samplerInfo.minFilter = VK_FILTER_NEAREST;
+        samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+        samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+        samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+        samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+        samplerInfo.maxLod = 0.0f;
+        mSampler = mContext->GetObjectCache().GetSampler(samplerInfo);
+
+        VkDescriptorSetLayoutBinding binding{};
+        binding.binding = 0;
+        binding.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+        binding.descriptorCount = 1;
+        binding.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+
+        VkDescriptorSetLayoutCreateInfo layoutInfo{};
+        layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+        layoutInfo.pNext = nullptr;
+        layoutInfo.bindingCount = 1;
+        layoutInfo.pBindings = &binding;
+        mSetLayout = mContext->GetObjectCache().GetDescriptorSetLayout(layoutInfo);
+
+        VkDescriptorPoolSize poolSize{ VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1 };
+        VkDescriptorPoolCreateInfo poolInfo{};
+        poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+        poolInfo.pNext = nullptr;
+        poolInfo.maxSets = 1;
+        poolInfo.poolSizeCount = 1;
+        poolInfo.pPoolSizes = &poolSize;
+        VK_CHECK(vkCreateDescriptorPool(device, &poolInfo, nullptr, &mDescriptorPool));
+
+        VkDescriptorSetAllocateInfo allocInfo{};
+        allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+        allocInfo.pNext = nullptr;
+        allocInfo.descriptorPool = mDescriptorPool;
+        allocInfo.descriptorSetCount = 1;
+        allocInfo.pSetLayouts = &mSetLayout;
+        VK_CHECK(vkAllocateDescriptorSets(device, &allocInfo, &mDescriptorSet));
+
+        VkDescriptorImageInfo imageInfo{};
+        imageInfo.sampler = mSampler;
+        imageInfo.imageView = mDepthImage->GetImageInfo().imageView;
+        imageInfo.imageLayout = VK_IMAGE_LAYOUT_DEPTH_READ_ONLY_OPTIMAL;
+
+        VkWriteDescriptorSet write{};
+        write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        write.pNext = nullptr;
+        write.dstSet = mDescriptorSet;
+        write.dstBinding = 0;
+        write.descriptorCount = 1;
+        write.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+        write.pImageInfo = &imageInfo;
+        vkUpdateDescriptorSets(device, 1, &write, 0, nullptr);
+
+        mPipeline.CreatePipeline("DepthPyramid.comp", sizeof(PushConstants), std::span(&mSetLayout, 1));
+    }
+
+    VulkanDepthPyramid::~VulkanDepthPyramid() {
+        VkDevice device = mContext->GetLogicalDevice().handle;
+        mPipeline.Release();
+        vkDestroyDescriptorPool(device, mDescriptorPool, nullptr);
+    }
+
+    void VulkanDepthPyramid::Build(VkCommandBuffer cmd) {
+        // The previous build's last workgroup and the culling that read its pyramid may still be running
+        BufferUtils::GlobalBarrier(cmd, VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT,
+            VK_PIPELINE_STAGE_2_TRANSFER_BIT | VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_TRANSFER_WRITE_BIT | VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT);
+        vkCmdFillBuffer(cmd, mCounterBuffer->GetBufferInfo().buffer, 0, sizeof(uint32_t), 0);
+        BufferUtils::GlobalBarrier(cmd, VK_PIPELINE_STAGE_2_TRANSFER_BIT, VK_ACCESS_2_TRANSFER_WRITE_BIT,
+            VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_STORAGE_READ_BIT | VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT);
+
+        PushConstants pushConstants{};
+        pushConstants.info = mInfoBuffer->GetBufferInfo().deviceAddress;
+        pushConstants.pyramid = mPyramidBuffer->GetBufferInfo().deviceAddress;
+        pushConstants.counter = mCounterBuffer->GetBufferInfo().deviceAddress;
+        pushConstants.groupCount = mGroupCount.x * mGroupCount.y;
+
+        mPipeline.Bind(cmd);
+        vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, mPipeline.GetLayout(), 0, 1, &mDescriptorSet, 0, nullptr);
+        mPipeline.PushConstants(cmd, pushConstants);
+        vkCmdDispatch(cmd, mGroupCount.x, mGroupCount.y, 1);
+
+        BufferUtils::GlobalBarrier(cmd, VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT,
+            VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_STORAGE_READ_BIT);
+    }
+
+}
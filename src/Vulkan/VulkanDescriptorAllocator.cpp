@@ -0,0 +1,102 @@
+#include <Vulkan/VulkanDescriptorAllocator.h>
+
+#include <algorithm>
+#include <cmath>
+#include <thread>
+
+namespace VKRE {
+
+    VulkanDescriptorAllocator::VulkanDescriptorAllocator(std::shared_ptr<VulkanContext> context, uint32_t framesInFlight, const DescriptorAllocatorSpecs& specs)
+        :mContext(context), mSpecs(specs), mFramesInFlight(framesInFlight) {
+        mLaneCount = mSpecs.laneCount != 0 ? mSpecs.laneCount : std::max(std::thread::hardware_concurrency(), 1u) + 1;
+        mSpecs.initialSetsPerPool = std::max(mSpecs.initialSetsPerPool, 1u);
+        mSpecs.maxSetsPerPool = std::max(mSpecs.maxSetsPerPool, mSpecs.initialSetsPerPool);
+
+        mLanes = std::make_unique<Lane[]>(static_cast<size_t>(mLaneCount) * mFramesInFlight);
+        for (uint32_t i = 0; i < mLaneCount * mFramesInFlight; i++)
+            mLanes[i].setsPerPool = mSpecs.initialSetsPerPool;
+    }
+
+    VulkanDescriptorAllocator::~VulkanDescriptorAllocator() {
+        VkDevice device = mContext->GetLogicalDevice().handle;
+        for (uint32_t i = 0; i < mLaneCount * mFramesInFlight; i++) {
+            for (VkDescriptorPool pool : mLanes[i].freePools)
+                vkDestroyDescriptorPool(device, pool, nullptr);
+            for (VkDescriptorPool pool : mLanes[i].usedPools)
+                vkDestroyDescriptorPool(device, pool, nullptr);
+        }
+    }
+
+    void VulkanDescriptorAllocator::BeginFrame(uint32_t frameIndex) {
+        VkDevice device = mContext->GetLogicalDevice().handle;
+        for (uint32_t i = 0; i < mLaneCount; i++) {
+            Lane& lane = mLanes[frameIndex * mLaneCount + i];
+            std::lock_guard lock(lane.mutex);
+            for (VkDescriptorPool pool : lane.usedPools) {
+                VK_CHECK(vkResetDescriptorPool(device, pool, 0));
+                lane.freePools.push_back(pool);
+            }
+            lane.usedPools.clear();
+        }
+    }
+
+    VkDescriptorSet VulkanDescriptorAllocator::Allocate(uint32_t frameIndex, VkDescriptorSetLayout layout) {
+        Lane& lane = GetLane(frameIndex);
+        std::lock_guard lock(lane.mutex);
+
+        VkDescriptorSetAllocateInfo allocInfo{};
+        allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+        allocInfo.pNext = nullptr;
+        allocInfo.descriptorPool = lane.usedPools.empty() ? NextPool(lane) : lane.usedPools.back();
+        allocInfo.descriptorSetCount = 1;
+        allocInfo.pSetLayouts = &layout;
+
+        VkDescriptorSet set = VK_NULL_HANDLE;
+        VkResult result = vkAllocateDescriptorSets(mContext->GetLogicalDevice().handle, &allocInfo, &set);
+        if (result == VK_ERROR_OUT_OF_POOL_MEMORY || result == VK_ERROR_FRAGMENTED_POOL) {
+            // The full pool stays in usedPools until the frame retires, the lane moves on to a fresh one
+            allocInfo.descriptorPool = NextPool(lane);
+            result = vkAllocateDescriptorSets(mContext->GetLogicalDevice().handle, &allocInfo, &set);
+        }
+        VK_CHECK(result);
+        return set;
+    }
+
+    VulkanDescriptorAllocator::Lane& VulkanDescriptorAllocator::GetLane(uint32_t frameIndex) {
+        thread_local const uint32_t threadLane = sNextThreadLane.fetch_add(1, std::memory_order_relaxed);
+        return mLanes[frameIndex * mLaneCount + threadLane % mLaneCount];
+    }
+
+    VkDescriptorPool VulkanDescriptorAllocator::NextPool(Lane& lane) {
+        VkDescriptorPool pool;
+        if (!lane.freePools.empty()) {
+            pool = lane.freePools.back();
+            lane.freePools.pop_back();
+        } else {
+            pool = CreatePool(lane.setsPerPool);
+            lane.setsPerPool = std::min(static_cast<uint32_t>(std::ceil(static_cast<float>(lane.setsPerPool) * mSpecs.growthFactor)), mSpecs.maxSetsPerPool);
+        }
+        lane.usedPools.push_back(pool);
+        return pool;
+    }
+
+    VkDescriptorPool VulkanDescriptorAllocator::CreatePool(uint32_t setCount) {
+        std::vector<VkDescriptorPoolSize> poolSizes;
+        poolSizes.reserve(mSpecs.ratios.size());
+        for (const DescriptorPoolRatio& ratio : mSpecs.ratios)
+            poolSizes.push_back({ ratio.type, std::max(static_cast<uint32_t>(ratio.ratio * static_cast<float>(setCount)), 1u) });
+
+        VkDescriptorPoolCreateInfo poolInfo{};
+        poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+        poolInfo.pNext = nullptr;
+        poolInfo.flags = 0;
+        poolInfo.maxSets = setCount;
+        poolInfo.poolSizeCount = static_cast<uint32_t>(poolSizes.size());
+        poolInfo.pPoolSizes = poolSizes.data();
+
+        VkDescriptorPool pool;
+        VK_CHECK(vkCreateDescriptorPool(mContext->GetLogicalDevice().handle, &poolInfo, nullptr, &pool));
+        return pool;
+    }
+
+}
@@ -0,0 +1,196 @@
+#include <Vulkan/VulkanFrameCapture.h>
+
+#define STB_IMAGE_WRITE_IMPLEMENTATION
+#include <stb/stb_image_write.h>
+
+#include <algorithm>
+#include <format>
+#include <fstream>
+#include <print>
+#include <utility>
+
+namespace VKRE {
+
+    namespace {
+
+        constexpr VkFormat CAPTURE_FORMAT = VK_FORMAT_R8G8B8A8_SRGB;
+        constexpr uint32_t CAPTURE_PIXEL_SIZE = 4;
+
+    }
+
+    VulkanFrameCapture::VulkanFrameCapture(std::shared_ptr<VulkanContext> context, JobSystem& jobSystem, VkExtent2D extent, uint32_t framesInFlight, const FrameCaptureSpecs& specs)
+        // Capturing every frame keeps one buffer per frame in flight busy before the encodes even start
+        :mContext(context), mJobSystem(jobSystem), mSpecs(specs), mExtent(extent), mSlots(std::max(specs.readbackBufferCount, framesInFlight + 1)) {
+        VmaAllocationCreateInfo allocInfo = {};
+        allocInfo.usage = VMA_MEMORY_USAGE_GPU_ONLY;
+        allocInfo.requiredFlags = VkMemoryPropertyFlags(VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+
+        mConvertImage = std::make_unique<VulkanImage2D>(mContext);
+        mConvertImage->CreateImage(CAPTURE_FORMAT, VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT, { mExtent.width, mExtent.height, 1 }, VK_IMAGE_ASPECT_COLOR_BIT, allocInfo);
+
+        const VkDeviceSize frameSize = static_cast<VkDeviceSize>(mExtent.width) * mExtent.height * CAPTURE_PIXEL_SIZE;
+        for (ReadbackSlot& slot : mSlots) {
+            slot.buffer = std::make_unique<VulkanBuffer>(mContext);
+            slot.buffer->CreateBuffer(frameSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT, VMA_MEMORY_USAGE_GPU_TO_CPU);
+        }
+    }
+
+    VulkanFrameCapture::~VulkanFrameCapture() {
+        for (ReadbackSlot& slot : mSlots) {
+            if (slot.inFlight)
+                Retire(slot);
+        }
+
+        // The encodes read the buffers, which go away with the slots
+        uint32_t outstanding = mOutstandingEncodes.load(std::memory_order_acquire);
+        while (outstanding != 0) {
+            mOutstandingEncodes.wait(outstanding, std::memory_order_acquire);
+            outstanding = mOutstandingEncodes.load(std::memory_order_acquire);
+        }
+
+        for (ReadbackSlot& slot : mSlots)
+            slot.buffer->Release();
+        mConvertImage->Release();
+    }
+
+    void VulkanFrameCapture::Screenshot(const std::filesystem::path& path) {
+        mRequestedScreenshot = path;
+    }
+
+    void VulkanFrameCapture::StartSession(const std::filesystem::path& directory, CaptureFormat format) {
+        std::error_code error;
+        std::filesystem::create_directories(directory, error);
+        if (error) {
+            std::println("Failed to create capture directory {}: {}", directory.string(), error.message());
+            return;
+        }
+
+        mRequestedSession = CaptureSession{ directory, format };
+        mSessionRevision++;
+    }
+
+    void VulkanFrameCapture::StopSession() {
+        mRequestedSession.reset();
+        mSessionRevision++;
+    }
+
+    void VulkanFrameCapture::Capture(FrameCaptureSnapshot& snapshot) {
+        snapshot.screenshot = std::exchange(mRequestedScreenshot, std::nullopt);
+        snapshot.sessionDirectory.reset();
+        if (mRequestedSession.has_value()) {
+            snapshot.sessionDirectory = mRequestedSession->directory;
+            snapshot.sessionFormat = mRequestedSession->format;
+        }
+        snapshot.sessionRevision = mSessionRevision;
+    }
+
+    void VulkanFrameCapture::Apply(const FrameCaptureSnapshot& snapshot) {
+        // A screenshot asked for during a skipped frame is taken by the next one that's recorded
+        if (snapshot.screenshot.has_value())
+            mScreenshotPath = snapshot.screenshot;
+
+        // Restarting a session numbers its frames from 0 again
+        if (snapshot.sessionRevision != mAppliedSessionRevision) {
+            mAppliedSessionRevision = snapshot.sessionRevision;
+            mSession.reset();
+            if (snapshot.sessionDirectory.has_value())
+                mSession = CaptureSession{ snapshot.sessionDirectory.value(), snapshot.sessionFormat };
+        }
+    }
+
+    void VulkanFrameCapture::BeginFrame(uint32_t frameIndex) {
+        for (ReadbackSlot& slot : mSlots) {
+            if (slot.inFlight && slot.frameIndex == frameIndex)
+                Retire(slot);
+        }
+    }
+
+    void VulkanFrameCapture::Record(VkCommandBuffer cmd, uint32_t frameIndex, VulkanImage2D& source) {
+        std::optional<std::filesystem::path> path;
+        CaptureFormat format = CaptureFormat::PNG;
+        if (mScreenshotPath.has_value()) {
+            path = std::exchange(mScreenshotPath, std::nullopt);
+        } else if (mSession.has_value()) {
+            // Numbered even when the frame is dropped, so gaps in the sequence show where it was
+            format = mSession->format;
+            path = mSession->directory / std::format("{:06}.{}", mSession->nextFrame++, format == CaptureFormat::PNG ? "png" : "rgba");
+        } else {
+            return;
+        }
+
+        ReadbackSlot* slot = AcquireSlot();
+        if (!slot) {
+            mDroppedFrames++;
+            return;
+        }
+
+        slot->path = std::move(path.value());
+        slot->format = format;
+        slot->frameIndex = frameIndex;
+        slot->inFlight = true;
+
+        const ImageInfo& sourceInfo = source.GetImageInfo();
+        VkImage convertImage = mConvertImage->GetImageInfo().image;
+        ImageUtils::TransitionImage(cmd, convertImage, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
+        ImageUtils::CopyImage(cmd, sourceInfo.image, convertImage, { sourceInfo.extent.width, sourceInfo.extent.height }, mExtent);
+        ImageUtils::TransitionImage(cmd, convertImage, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL);
+
+        // Tightly packed rows, which is what both encoders want
+        VkBufferImageCopy copyRegion = {};
+        copyRegion.bufferOffset = 0;
+        copyRegion.bufferRowLength = 0;
+        copyRegion.bufferImageHeight = 0;
+        copyRegion.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+        copyRegion.imageSubresource.mipLevel = 0;
+        copyRegion.imageSubresource.baseArrayLayer = 0;
+        copyRegion.imageSubresource.layerCount = 1;
+        copyRegion.imageExtent = { mExtent.width, mExtent.height, 1 };
+        vkCmdCopyImageToBuffer(cmd, convertImage, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, slot->buffer->GetBufferInfo().buffer, 1, &copyRegion);
+
+        BufferUtils::GlobalBarrier(cmd, VK_PIPELINE_STAGE_2_TRANSFER_BIT, VK_ACCESS_2_TRANSFER_WRITE_BIT, VK_PIPELINE_STAGE_2_HOST_BIT, VK_ACCESS_2_HOST_READ_BIT);
+    }
+
+    VulkanFrameCapture::ReadbackSlot* VulkanFrameCapture::AcquireSlot() {
+        for (ReadbackSlot& slot : mSlots) {
+            if (!slot.inFlight && !slot.encoding.load(std::memory_order_acquire))
+                return &slot;
+        }
+        return nullptr;
+    }
+
+    void VulkanFrameCapture::Retire(ReadbackSlot& slot) {
+        VK_CHECK(vmaInvalidateAllocation(mContext->GetAllocator(), slot.buffer->GetBufferInfo().allocation, 0, VK_WHOLE_SIZE));
+        slot.inFlight = false;
+        slot.encoding.store(true, std::memory_order_relaxed);
+        mOutstandingEncodes.fetch_add(1, std::memory_order_relaxed);
+
+        mJobSystem.Submit([this, &slot]() {
+            Encode(slot);
+            // Release hands the buffer back to AcquireSlot only after the encode has finished reading it
+            slot.encoding.store(false, std::memory_order_release);
+            if (mOutstandingEncodes.fetch_sub(1, std::memory_order_acq_rel) == 1)
+                mOutstandingEncodes.notify_all();
+        }, mSpecs.encodePriority);
+    }
+
+    void VulkanFrameCapture::Encode(ReadbackSlot& slot) {
+        uint8_t* pixels = static_cast<uint8_t*>(slot.buffer->GetMappedData());
+        const size_t pixelCount = static_cast<size_t>(mExtent.width) * mExtent.height;
+        // Nothing writes meaningful alpha, the frame is opaque on screen and should be in the file too
+        for (size_t i = 0; i < pixelCount; i++)
+            pixels[i * CAPTURE_PIXEL_SIZE + 3] = 0xFF;
+
+        if (slot.format == CaptureFormat::PNG) {
+            const int stride = static_cast<int>(mExtent.width * CAPTURE_PIXEL_SIZE);
+            if (!stbi_write_png(slot.path.string().c_str(), static_cast<int>(mExtent.width), static_cast<int>(mExtent.height), CAPTURE_PIXEL_SIZE, pixels, stride))
+                std::println("Failed to write capture {}", slot.path.string());
+            return;
+        }
+
+        std::ofstream file(slot.path, std::ios::binary | std::ios::trunc);
+        file.write(reinterpret_cast<const char*>(pixels), static_cast<std::streamsize>(pixelCount * CAPTURE_PIXEL_SIZE));
+        if (!file)
+            std::println("Failed to write capture {}", slot.path.string());
+    }
+
+}
@@ -19,7 +19,6 @@ namespace VKRE {
             VK_CHECK(vkResetFences(mContext->GetLogicalDevice().handle, 1, &frame.waitFence));
 
             vkDestroyCommandPool(device, frame.commandPool, nullptr);
-            vkDestroySemaphore(device, frame.presentCompleteSemaphore, nullptr);
             vkDestroyFence(device, frame.waitFence, nullptr);
             frame.deletionQueue.Flush();
         }
@@ -49,12 +48,8 @@ namespace VKRE {
         fenceCreateInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
         fenceCreateInfo.flags = VK_FENCE_CREATE_SIGNALED_BIT;
 
-        VkSemaphoreCreateInfo semaphoreCreateInfo{};
-        semaphoreCreateInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
-
         for (auto& frame : mFrames) {
             VK_CHECK(vkCreateFence(mContext->GetLogicalDevice().handle, &fenceCreateInfo, nullptr, &frame.waitFence));
-            VK_CHECK(vkCreateSemaphore(mContext->GetLogicalDevice().handle, &semaphoreCreateInfo, nullptr, &frame.presentCompleteSemaphore));
         }
     }
 
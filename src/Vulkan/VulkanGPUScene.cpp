@@ -0,0 +1,533 @@
+#include <Vulkan/VulkanGPUScene.h>
+
+#include <algorithm>
+#include <cstring>
+
+namespace VKRE {
+
+    namespace {
+
+        constexpr uint32_t CULL_WORKGROUP_SIZE = 64;
+        constexpr uint32_t CULL_PASS_COUNT = 2;
+        constexpr VkDeviceSize CLUSTER_JOB_SIZE = 2 * sizeof(uint32_t); // Instance and submesh index
+
+        // Reorders the full detail triangles of a submesh so that each of its meshlets is a contiguous index range, and appends the
+        // meshlets. The triangles are the same, only their order changes, so the submesh and its LOD 0 range stay valid.
+        bool AppendMeshlets(const MeshAsset& asset, size_t submeshIndex, uint32_t firstSceneIndex, std::span<uint32_t> indices, std::vector<GPUMeshlet>& gpuMeshlets) {
+            const MeshFormat::Submesh& submesh = asset.GetSubmeshes()[submeshIndex];
+            const MeshFormat::LodRange& lodRange = asset.GetLodRanges()[submeshIndex];
+            std::span<const MeshFormat::Meshlet> meshlets = asset.GetMeshlets();
+            std::span<const uint32_t> meshletVertices = asset.GetMeshletVertices();
+            std::span<const uint32_t> meshletTriangles = asset.GetMeshletTriangles();
+
+            if (lodRange.firstIndex != submesh.firstIndex || lodRange.indexCount != submesh.indexCount
+                || static_cast<size_t>(submesh.firstMeshlet) + submesh.meshletCount > meshlets.size()
+                || static_cast<size_t>(submesh.firstIndex) + submesh.indexCount > indices.size())
+                return false;
+
+            uint64_t triangleCount = 0;
+            for (const auto& meshlet : meshlets.subspan(submesh.firstMeshlet, submesh.meshletCount)) {
+                if (meshlet.vertexCount > MeshFormat::MAX_MESHLET_VERTICES || static_cast<size_t>(meshlet.vertexOffset) + meshlet.vertexCount > meshletVertices.size()
+                    || static_cast<size_t>(meshlet.triangleOffset) + meshlet.triangleCount > meshletTriangles.size())
+                    return false;
+                for (uint32_t i = 0; i < meshlet.vertexCount; i++) {
+                    if (meshletVertices[meshlet.vertexOffset + i] < static_cast<uint32_t>(submesh.vertexOffset))
+                        return false;
+                }
+                for (uint32_t i = 0; i < meshlet.triangleCount; i++) {
+                    const uint32_t packed = meshletTriangles[meshlet.triangleOffset + i];
+                    if ((packed & 0xFF) >= meshlet.vertexCount || ((packed >> 8) & 0xFF) >= meshlet.vertexCount || ((packed >> 16) & 0xFF) >= meshlet.vertexCount)
+                        return false;
+                }
+                triangleCount += meshlet.triangleCount;
+            }
+            if (triangleCount * 3 != submesh.indexCount)
+                return false;
+
+            // Meshlet vertices index the whole mesh, the submesh's indices are relative to its vertexOffset
+            uint32_t index = submesh.firstIndex;
+            for (const auto& meshlet : meshlets.subspan(submesh.firstMeshlet, submesh.meshletCount)) {
+                gpuMeshlets.push_back({ meshlet.center, meshlet.radius, meshlet.coneAxis, meshlet.coneCutoff, firstSceneIndex + index, meshlet.triangleCount * 3, {} });
+                for (uint32_t i = 0; i < meshlet.triangleCount; i++) {
+                    const uint32_t packed = meshletTriangles[meshlet.triangleOffset + i];
+                    for (uint32_t corner = 0; corner < 3; corner++)
+                        indices[index++] = meshletVertices[meshlet.vertexOffset + ((packed >> (corner * 8)) & 0xFF)] - static_cast<uint32_t>(submesh.vertexOffset);
+                }
+            }
+            return true;
+        }
+
+        void SetWorldBounds(BoundingBoxSoA& bounds, uint32_t index, const MeshFormat::Bounds& local, const glm::mat4& transform) {
+            // The box around the transformed box: every world axis gathers the absolute contribution of each local axis
+            const glm::vec3 center = glm::vec3(transform * glm::vec4(local.center, 1.0f));
+            const glm::mat3 absolute(glm::abs(glm::vec3(transform[0])), glm::abs(glm::vec3(transform[1])), glm::abs(glm::vec3(transform[2])));
+            if (index == bounds.GetCount())
+                bounds.Add(center, absolute * local.extents);
+            else
+                bounds.Set(index, center, absolute * local.extents);
+        }
+
+    }
+
+    VulkanGPUScene::VulkanGPUScene(std::shared_ptr<VulkanContext> context, VulkanImmediateSubmit& immediateSubmit, uint32_t framesInFlight, const GPUSceneSpecs& specs)
+        :mContext(context), mImmediateSubmit(immediateSubmit), mSpecs(specs), mCullPipeline(context), mClusterCullPipeline(context), mFrames(framesInFlight) {
+        // The cluster pass runs one workgroup per job in a single row
+        const uint32_t maxWorkGroups = mContext->GetPhysicalDevice().properties.limits.maxComputeWorkGroupCount[0];
+        if (mSpecs.maxClusterJobs > maxWorkGroups) {
+            std::println("GPU scene capped at {} cluster jobs per pass, the device can't dispatch more workgroups!", maxWorkGroups);
+            mSpecs.maxClusterJobs = maxWorkGroups;
+        }
+
+        const VkBufferUsageFlags storageUsage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT;
+
+        mVertexBuffer = std::make_unique<VulkanBuffer>(mContext);
+        mVertexBuffer->CreateBuffer(static_cast<VkDeviceSize>(mSpecs.maxVertices) * sizeof(MeshFormat::Vertex), storageUsage | VK_BUFFER_USAGE_TRANSFER_DST_BIT, VMA_MEMORY_USAGE_GPU_ONLY);
+        mIndexBuffer = std::make_unique<VulkanBuffer>(mContext);
+        mIndexBuffer->CreateBuffer(static_cast<VkDeviceSize>(mSpecs.maxIndices) * sizeof(uint32_t), VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, VMA_MEMORY_USAGE_GPU_ONLY);
+        mMeshBuffer = std::make_unique<VulkanBuffer>(mContext);
+        mMeshBuffer->CreateBuffer(static_cast<VkDeviceSize>(mSpecs.maxMeshes) * sizeof(GPUMesh), storageUsage | VK_BUFFER_USAGE_TRANSFER_DST_BIT, VMA_MEMORY_USAGE_GPU_ONLY);
+        mSubmeshBuffer = std::make_unique<VulkanBuffer>(mContext);
+        mSubmeshBuffer->CreateBuffer(static_cast<VkDeviceSize>(mSpecs.maxSubmeshes) * sizeof(GPUSubmesh), storageUsage | VK_BUFFER_USAGE_TRANSFER_DST_BIT, VMA_MEMORY_USAGE_GPU_ONLY);
+        mLodRangeBuffer = std::make_unique<VulkanBuffer>(mContext);
+        mLodRangeBuffer->CreateBuffer(static_cast<VkDeviceSize>(mSpecs.maxLodRanges) * sizeof(GPULodRange), storageUsage | VK_BUFFER_USAGE_TRANSFER_DST_BIT, VMA_MEMORY_USAGE_GPU_ONLY);
+        mMeshletBuffer = std::make_unique<VulkanBuffer>(mContext);
+        mMeshletBuffer->CreateBuffer(static_cast<VkDeviceSize>(mSpecs.maxMeshlets) * sizeof(GPUMeshlet), storageUsage | VK_BUFFER_USAGE_TRANSFER_DST_BIT, VMA_MEMORY_USAGE_GPU_ONLY);
+        mInstanceBuffer = std::make_unique<VulkanBuffer>(mContext);
+        mInstanceBuffer->CreateBuffer(static_cast<VkDeviceSize>(mSpecs.maxInstances) * sizeof(GPUInstance), storageUsage | VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, VMA_MEMORY_USAGE_GPU_ONLY);
+        mPreviousInstanceBuffer = std::make_unique<VulkanBuffer>(mContext);
+        mPreviousInstanceBuffer->CreateBuffer(static_cast<VkDeviceSize>(mSpecs.maxInstances) * sizeof(GPUInstance), storageUsage | VK_BUFFER_USAGE_TRANSFER_DST_BIT, VMA_MEMORY_USAGE_GPU_ONLY);
+
+        // The draw lists of both culling passes share these buffers, the late pass's list starts at maxDraws
+        mDrawCommandBuffer = std::make_unique<VulkanBuffer>(mContext);
+        mDrawCommandBuffer->CreateBuffer(static_cast<VkDeviceSize>(mSpecs.maxDraws) * CULL_PASS_COUNT * sizeof(VkDrawIndexedIndirectCommand), storageUsage | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT, VMA_MEMORY_USAGE_GPU_ONLY);
+        mDrawDataBuffer = std::make_unique<VulkanBuffer>(mContext);
+        mDrawDataBuffer->CreateBuffer(static_cast<VkDeviceSize>(mSpecs.maxDraws) * CULL_PASS_COUNT * sizeof(GPUDrawData), storageUsage, VMA_MEMORY_USAGE_GPU_ONLY);
+        mDrawCountBuffer = std::make_unique<VulkanBuffer>(mContext);
+        mDrawCountBuffer->CreateBuffer(CULL_PASS_COUNT * sizeof(uint32_t), storageUsage | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, VMA_MEMORY_USAGE_GPU_ONLY);
+        mVisibilityBuffer = std::make_unique<VulkanBuffer>(mContext);
+        mVisibilityBuffer->CreateBuffer(static_cast<VkDeviceSize>(mSpecs.maxInstances) * sizeof(uint32_t), storageUsage | VK_BUFFER_USAGE_TRANSFER_DST_BIT, VMA_MEMORY_USAGE_GPU_ONLY);
+        mClusterJobBuffer = std::make_unique<VulkanBuffer>(mContext);
+        mClusterJobBuffer->CreateBuffer(static_cast<VkDeviceSize>(std::max(mSpecs.maxClusterJobs, 1u)) * CULL_PASS_COUNT * CLUSTER_JOB_SIZE, storageUsage, VMA_MEMORY_USAGE_GPU_ONLY);
+        mClusterDispatchBuffer = std::make_unique<VulkanBuffer>(mContext);
+        mClusterDispatchBuffer->CreateBuffer(CULL_PASS_COUNT * sizeof(VkDispatchIndirectCommand), storageUsage | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, VMA_MEMORY_USAGE_GPU_ONLY);
+
+        // Nothing was visible before the first frame, so everything goes through the late pass once. Nothing existed either, all ones
+        // is INVALID_GPU_MESH in every previous instance.
+        mImmediateSubmit.Submit([&](VkCommandBuffer cmd) {
+            vkCmdFillBuffer(cmd, mVisibilityBuffer->GetBufferInfo().buffer, 0, VK_WHOLE_SIZE, 0);
+            vkCmdFillBuffer(cmd, mPreviousInstanceBuffer->GetBufferInfo().buffer, 0, VK_WHOLE_SIZE, UINT32_MAX);
+        });
+
+        for (auto& frame : mFrames) {
+            frame.cullDataBuffer = std::make_unique<VulkanBuffer>(mContext);
+            frame.cullDataBuffer->CreateBuffer(sizeof(SceneCullData), storageUsage, VMA_MEMORY_USAGE_CPU_TO_GPU);
+            frame.instanceStagingBuffer = std::make_unique<VulkanBuffer>(mContext);
+            frame.instanceStagingBuffer->CreateBuffer(static_cast<VkDeviceSize>(mSpecs.maxInstanceUploadsPerFrame) * sizeof(GPUInstance), VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VMA_MEMORY_USAGE_CPU_ONLY);
+            frame.queueDrawDataBuffer = std::make_unique<VulkanBuffer>(mContext);
+            frame.queueDrawDataBuffer->CreateBuffer(static_cast<VkDeviceSize>(mSpecs.maxQueuedDraws) * sizeof(GPUDrawData), storageUsage, VMA_MEMORY_USAGE_CPU_TO_GPU);
+        }
+
+        mCullPipeline.CreatePipeline("SceneCull.comp", sizeof(CullPushConstants));
+        mClusterCullPipeline.CreatePipeline("ClusterCull.comp", sizeof(ClusterCullPushConstants));
+        mMeshes.reserve(mSpecs.maxMeshes);
+        mSubmeshes.reserve(mSpecs.maxSubmeshes);
+    }
+
+    VulkanGPUScene::~VulkanGPUScene() {
+        mFrames.clear();
+        mCullPipeline.Release();
+        mClusterCullPipeline.Release();
+    }
+
+    std::optional<GPUMeshID> VulkanGPUScene::AddMesh(const MeshAsset& asset) {
+        std::span<const MeshFormat::Vertex> vertices = asset.GetVertices();
+        std::span<const uint32_t> indices = asset.GetIndices();
+        std::span<const MeshFormat::Submesh> submeshes = asset.GetSubmeshes();
+        std::span<const MeshFormat::Lod> lods = asset.GetLods();
+        std::span<const MeshFormat::LodRange> lodRanges = asset.GetLodRanges();
+
+        if (lods.empty() || lods.size() > MeshFormat::MAX_MESH_LODS || lodRanges.size() != lods.size() * submeshes.size()) {
+            std::println("Mesh has {} LODs over {} ranges for {} submeshes!", lods.size(), lodRanges.size(), submeshes.size());
+            return std::nullopt;
+        }
+
+        if (mMeshes.size() >= mSpecs.maxMeshes || mSubmeshCount + submeshes.size() > mSpecs.maxSubmeshes || mLodRangeCount + lodRanges.size() > mSpecs.maxLodRanges
+            || mVertexCount + vertices.size() > mSpecs.maxVertices || mIndexCount + indices.size() > mSpecs.maxIndices) {
+            std::println("GPU scene is out of space for another mesh!");
+            return std::nullopt;
+        }
+
+        // Without room for its meshlets the mesh is still added, it's just always drawn whole
+        const bool cullMeshlets = mMeshletCount + asset.GetMeshlets().size() <= mSpecs.maxMeshlets;
+        if (!cullMeshlets)
+            std::println("GPU scene is out of meshlets, a mesh with {} is drawn without meshlet culling!", asset.GetMeshlets().size());
+
+        std::vector<uint32_t> sceneIndices(indices.begin(), indices.end());
+        std::vector<GPUMeshlet> gpuMeshlets;
+        std::vector<GPUSubmesh> gpuSubmeshes;
+        gpuSubmeshes.reserve(submeshes.size());
+        for (size_t i = 0; i < submeshes.size(); i++) {
+            const MeshFormat::Submesh& submesh = submeshes[i];
+            gpuSubmeshes.push_back({ mIndexCount + submesh.firstIndex, submesh.indexCount, static_cast<int32_t>(mVertexCount) + submesh.vertexOffset, submesh.materialIndex });
+            GPUSubmesh& gpuSubmesh = gpuSubmeshes.back();
+            gpuSubmesh.firstMeshlet = mMeshletCount + static_cast<uint32_t>(gpuMeshlets.size());
+            if (!cullMeshlets || submesh.meshletCount == 0)
+                continue;
+
+            if (AppendMeshlets(asset, i, mIndexCount, sceneIndices, gpuMeshlets))
+                gpuSubmesh.meshletCount = submesh.meshletCount;
+            else
+                std::println("Meshlets of submesh {} don't cover its triangles, it's drawn without meshlet culling!", i);
+        }
+
+        std::vector<GPULodRange> gpuLodRanges;
+        gpuLodRanges.reserve(lodRanges.size());
+        for (const auto& range : lodRanges) {
+            gpuLodRanges.push_back({ mIndexCount + range.firstIndex, range.indexCount });
+        }
+
+        GPUMesh mesh{};
+        mesh.bounds = asset.GetBounds();
+        mesh.firstSubmesh = mSubmeshCount;
+        mesh.submeshCount = static_cast<uint32_t>(submeshes.size());
+        mesh.firstLodRange = mLodRangeCount;
+        mesh.lodCount = static_cast<uint32_t>(lods.size());
+        for (size_t i = 0; i < lods.size(); i++)
+            mesh.lodErrors[i] = lods[i].error;
+
+        const VkDeviceSize vertexSize = vertices.size_bytes();
+        const VkDeviceSize indexSize = indices.size_bytes();
+        const VkDeviceSize submeshSize = gpuSubmeshes.size() * sizeof(GPUSubmesh);
+        const VkDeviceSize lodRangeSize = gpuLodRanges.size() * sizeof(GPULodRange);
+        const VkDeviceSize lodRangeOffset = vertexSize + indexSize + submeshSize;
+        const VkDeviceSize meshletSize = gpuMeshlets.size() * sizeof(GPUMeshlet);
+        const VkDeviceSize meshletOffset = lodRangeOffset + lodRangeSize;
+        const VkDeviceSize meshOffset = meshletOffset + meshletSize;
+
+        VulkanBuffer staging(mContext);
+        staging.CreateBuffer(meshOffset + sizeof(GPUMesh), VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VMA_MEMORY_USAGE_CPU_ONLY);
+        std::byte* stagingData = static_cast<std::byte*>(staging.GetMappedData());
+        memcpy(stagingData, vertices.data(), vertexSize);
+        memcpy(stagingData + vertexSize, sceneIndices.data(), indexSize);
+        memcpy(stagingData + vertexSize + indexSize, gpuSubmeshes.data(), submeshSize);
+        memcpy(stagingData + lodRangeOffset, gpuLodRanges.data(), lodRangeSize);
+        memcpy(stagingData + meshletOffset, gpuMeshlets.data(), meshletSize);
+        memcpy(stagingData + meshOffset, &mesh, sizeof(GPUMesh));
+
+        const GPUMeshID id = static_cast<GPUMeshID>(mMeshes.size());
+        mImmediateSubmit.Submit([&](VkCommandBuffer cmd) {
+            VkBuffer source = staging.GetBufferInfo().buffer;
+
+            VkBufferCopy vertexCopy{ 0, static_cast<VkDeviceSize>(mVertexCount) * sizeof(MeshFormat::Vertex), vertexSize };
+            vkCmdCopyBuffer(cmd, source, mVertexBuffer->GetBufferInfo().buffer, 1, &vertexCopy);
+
+            VkBufferCopy indexCopy{ vertexSize, static_cast<VkDeviceSize>(mIndexCount) * sizeof(uint32_t), indexSize };
+            vkCmdCopyBuffer(cmd, source, mIndexBuffer->GetBufferInfo().buffer, 1, &indexCopy);
+
+            VkBufferCopy submeshCopy{ vertexSize + indexSize, static_cast<VkDeviceSize>(mSubmeshCount) * sizeof(GPUSubmesh), submeshSize };
+            vkCmdCopyBuffer(cmd, source, mSubmeshBuffer->GetBufferInfo().buffer, 1, &submeshCopy);
+
+            VkBufferCopy lodRangeCopy{ lodRangeOffset, static_cast<VkDeviceSize>(mLodRangeCount) * sizeof(GPULodRange), lodRangeSize };
+            vkCmdCopyBuffer(cmd, source, mLodRangeBuffer->GetBufferInfo().buffer, 1, &lodRangeCopy);
+
+            if (meshletSize > 0) {
+                VkBufferCopy meshletCopy{ meshletOffset, static_cast<VkDeviceSize>(mMeshletCount) * sizeof(GPUMeshlet), meshletSize };
+                vkCmdCopyBuffer(cmd, source, mMeshletBuffer->GetBufferInfo().buffer, 1, &meshletCopy);
+            }
+
+            VkBufferCopy meshCopy{ meshOffset, static_cast<VkDeviceSize>(id) * sizeof(GPUMesh), sizeof(GPUMesh) };
+            vkCmdCopyBuffer(cmd, source, mMeshBuffer->GetBufferInfo().buffer, 1, &meshCopy);
+        });
+
+        mVertexCount += static_cast<uint32_t>(vertices.size());
+        mIndexCount += static_cast<uint32_t>(indices.size());
+        mSubmeshCount += static_cast<uint32_t>(submeshes.size());
+        mLodRangeCount += static_cast<uint32_t>(gpuLodRanges.size());
+        mMeshletCount += static_cast<uint32_t>(gpuMeshlets.size());
+        mMeshes.push_back(mesh);
+        mSubmeshes.insert(mSubmeshes.end(), gpuSubmeshes.begin(), gpuSubmeshes.end());
+        return id;
+    }
+
+    std::optional<GPUInstanceID> VulkanGPUScene::AddInstance(GPUMeshID mesh, const glm::mat4& transform) {
+        GPUInstanceID id;
+        if (!mFreeInstances.empty()) {
+            id = mFreeInstances.back();
+            mFreeInstances.pop_back();
+        } else if (mInstances.size() < mSpecs.maxInstances) {
+            id = static_cast<GPUInstanceID>(mInstances.size());
+            mInstances.emplace_back();
+            mInstanceDirty.push_back(false);
+        } else {
+            std::println("GPU scene is out of instances, {} allowed!", mSpecs.maxInstances);
+            return std::nullopt;
+        }
+
+        mInstances[id] = { transform, mesh, 0, {} };
+        SetWorldBounds(mInstanceBounds, id, mMeshes[mesh].bounds, transform);
+        mStaticRevision++;
+        if (!mInstanceDirty[id]) {
+            mInstanceDirty[id] = true;
+            mDirtyInstances.push_back(id);
+        }
+        return id;
+    }
+
+    void VulkanGPUScene::SetInstanceTransform(GPUInstanceID instance, const glm::mat4& transform) {
+        mInstances[instance].transform = transform;
+        SetWorldBounds(mInstanceBounds, instance, mMeshes[mInstances[instance].meshIndex].bounds, transform);
+        if (!(mInstances[instance].flags & GPU_INSTANCE_DYNAMIC))
+            mStaticRevision++;
+        if (!mInstanceDirty[instance]) {
+            mInstanceDirty[instance] = true;
+            mDirtyInstances.push_back(instance);
+        }
+    }
+
+    void VulkanGPUScene::RemoveInstance(GPUInstanceID instance) {
+        // The slot is kept and skipped by the culling pass until it's reused
+        if (!(mInstances[instance].flags & GPU_INSTANCE_DYNAMIC))
+            mStaticRevision++;
+        mInstances[instance].meshIndex = INVALID_GPU_MESH;
+        mFreeInstances.push_back(instance);
+        if (!mInstanceDirty[instance]) {
+            mInstanceDirty[instance] = true;
+            mDirtyInstances.push_back(instance);
+        }
+    }
+
+    void VulkanGPUScene::SetInstanceQueued(GPUInstanceID instance, bool queued) {
+        uint32_t& flags = mInstances[instance].flags;
+        flags = queued ? flags | GPU_INSTANCE_QUEUED : flags & ~GPU_INSTANCE_QUEUED;
+        if (!mInstanceDirty[instance]) {
+            mInstanceDirty[instance] = true;
+            mDirtyInstances.push_back(instance);
+        }
+    }
+
+    void VulkanGPUScene::SetInstanceDynamic(GPUInstanceID instance, bool dynamic) {
+        uint32_t& flags = mInstances[instance].flags;
+        flags = dynamic ? flags | GPU_INSTANCE_DYNAMIC : flags & ~GPU_INSTANCE_DYNAMIC;
+        // Either way the instance joins or leaves the static set
+        mStaticRevision++;
+        if (!mInstanceDirty[instance]) {
+            mInstanceDirty[instance] = true;
+            mDirtyInstances.push_back(instance);
+        }
+    }
+
+    void VulkanGPUScene::Capture(GPUSceneSnapshot& snapshot) {
+        snapshot.uploads.clear();
+        for (GPUInstanceID id : mDirtyInstances) {
+            const glm::vec3 center(mInstanceBounds.GetCenterX()[id], mInstanceBounds.GetCenterY()[id], mInstanceBounds.GetCenterZ()[id]);
+            const glm::vec3 extents(mInstanceBounds.GetExtentX()[id], mInstanceBounds.GetExtentY()[id], mInstanceBounds.GetExtentZ()[id]);
+            snapshot.uploads.push_back({ id, mInstances[id], center, extents });
+            mInstanceDirty[id] = false;
+        }
+        mDirtyInstances.clear();
+
+        snapshot.instanceSlotCount = static_cast<uint32_t>(mInstances.size());
+        snapshot.meshletCount = mMeshletCount;
+        snapshot.staticRevision = mStaticRevision;
+        snapshot.lodErrorThreshold = mLodErrorThreshold;
+        snapshot.lodHysteresis = mLodHysteresis;
+    }
+
+    void VulkanGPUScene::Apply(const GPUSceneSnapshot& snapshot) {
+        // Slots are never given back, the copy only grows
+        if (mDrawnInstances.size() < snapshot.instanceSlotCount) {
+            mDrawnInstances.resize(snapshot.instanceSlotCount, GPUInstance{ glm::mat4(1.0f), INVALID_GPU_MESH, 0, {} });
+            mUploadPending.resize(snapshot.instanceSlotCount, false);
+        }
+        while (mDrawnBounds.GetCount() < snapshot.instanceSlotCount)
+            mDrawnBounds.Add(glm::vec3(0.0f), glm::vec3(0.0f));
+
+        // Uploads left over from a skipped or busy frame just get the newer state
+        for (const GPUInstanceUpload& upload : snapshot.uploads) {
+            mDrawnInstances[upload.id] = upload.instance;
+            mDrawnBounds.Set(upload.id, upload.boundsCenter, upload.boundsExtents);
+            if (!mUploadPending[upload.id]) {
+                mUploadPending[upload.id] = true;
+                mPendingUploads.push_back(upload.id);
+            }
+        }
+
+        mDrawnMeshletCount = snapshot.meshletCount;
+        mDrawnStaticRevision = snapshot.staticRevision;
+        mCullLodErrorThreshold = snapshot.lodErrorThreshold;
+        mCullLodHysteresis = snapshot.lodHysteresis;
+    }
+
+    void VulkanGPUScene::Update(VkCommandBuffer cmd, uint32_t frameIndex) {
+        mFrames[frameIndex].queueDrawCount = 0;
+        if (mPendingUploads.empty() && mLastUploadedInstances.empty())
+            return;
+
+        // Sorted so that neighbouring instances collapse into one copy region
+        std::sort(mPendingUploads.begin(), mPendingUploads.end());
+        const size_t uploadCount = std::min<size_t>(mPendingUploads.size(), mSpecs.maxInstanceUploadsPerFrame);
+
+        // Before they're overwritten, the instances uploaded now get their last frame's state saved. Those uploaded last frame get it
+        // too, they haven't moved since and their saved state is from the frame before.
+        mHistoryInstances.assign(mLastUploadedInstances.begin(), mLastUploadedInstances.end());
+        mHistoryInstances.insert(mHistoryInstances.end(), mPendingUploads.begin(), mPendingUploads.begin() + static_cast<std::ptrdiff_t>(uploadCount));
+        std::sort(mHistoryInstances.begin(), mHistoryInstances.end());
+        mHistoryInstances.erase(std::unique(mHistoryInstances.begin(), mHistoryInstances.end()), mHistoryInstances.end());
+
+        std::vector<VkBufferCopy> historyRegions;
+        for (GPUInstanceID id : mHistoryInstances) {
+            const VkDeviceSize offset = static_cast<VkDeviceSize>(id) * sizeof(GPUInstance);
+            if (!historyRegions.empty() && historyRegions.back().dstOffset + historyRegions.back().size == offset) {
+                historyRegions.back().size += sizeof(GPUInstance);
+            } else {
+                historyRegions.push_back({ offset, offset, sizeof(GPUInstance) });
+            }
+        }
+
+        VulkanBuffer& staging = *mFrames[frameIndex].instanceStagingBuffer;
+        GPUInstance* stagingInstances = static_cast<GPUInstance*>(staging.GetMappedData());
+
+        std::vector<VkBufferCopy> regions;
+        for (size_t i = 0; i < uploadCount; i++) {
+            const GPUInstanceID id = mPendingUploads[i];
+            stagingInstances[i] = mDrawnInstances[id];
+            mUploadPending[id] = false;
+
+            const VkDeviceSize dstOffset = static_cast<VkDeviceSize>(id) * sizeof(GPUInstance);
+            if (!regions.empty() && regions.back().dstOffset + regions.back().size == dstOffset) {
+                regions.back().size += sizeof(GPUInstance);
+            } else {
+                regions.push_back({ i * sizeof(GPUInstance), dstOffset, sizeof(GPUInstance) });
+            }
+        }
+        mLastUploadedInstances.assign(mPendingUploads.begin(), mPendingUploads.begin() + static_cast<std::ptrdiff_t>(uploadCount));
+        mPendingUploads.erase(mPendingUploads.begin(), mPendingUploads.begin() + static_cast<std::ptrdiff_t>(uploadCount));
+
+        // The previous frame's culling and vertex shaders may still be reading the instances
+        BufferUtils::GlobalBarrier(cmd, VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_2_VERTEX_SHADER_BIT, VK_ACCESS_2_NONE,
+            VK_PIPELINE_STAGE_2_TRANSFER_BIT, VK_ACCESS_2_NONE);
+        vkCmdCopyBuffer(cmd, mInstanceBuffer->GetBufferInfo().buffer, mPreviousInstanceBuffer->GetBufferInfo().buffer, static_cast<uint32_t>(historyRegions.size()), historyRegions.data());
+        if (!regions.empty()) {
+            // The upload overwrites what the history copy reads
+            BufferUtils::GlobalBarrier(cmd, VK_PIPELINE_STAGE_2_TRANSFER_BIT, VK_ACCESS_2_NONE, VK_PIPELINE_STAGE_2_TRANSFER_BIT, VK_ACCESS_2_NONE);
+            vkCmdCopyBuffer(cmd, staging.GetBufferInfo().buffer, mInstanceBuffer->GetBufferInfo().buffer, static_cast<uint32_t>(regions.size()), regions.data());
+        }
+        BufferUtils::GlobalBarrier(cmd, VK_PIPELINE_STAGE_2_TRANSFER_BIT, VK_ACCESS_2_TRANSFER_WRITE_BIT,
+            VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_2_VERTEX_SHADER_BIT, VK_ACCESS_2_SHADER_STORAGE_READ_BIT);
+    }
+
+    void VulkanGPUScene::BeginCull(VkCommandBuffer cmd, uint32_t frameIndex, const SceneCullView& view) {
+        mCullFrameIndex = frameIndex;
+
+        SceneCullData* cullData = static_cast<SceneCullData*>(mFrames[frameIndex].cullDataBuffer->GetMappedData());
+        const Frustum frustum = Frustum::FromMatrix(view.viewProjection);
+        cullData->viewProjection = view.viewProjection;
+        std::copy(std::begin(frustum.planes), std::end(frustum.planes), cullData->frustumPlanes);
+        cullData->cameraPosition = view.cameraPosition;
+        cullData->lodScale = view.projectionScale / std::max(mCullLodErrorThreshold, 0.001f);
+        cullData->instanceCount = static_cast<uint32_t>(mDrawnInstances.size());
+        cullData->maxDrawCount = mSpecs.maxDraws;
+        cullData->lodHysteresis = std::clamp(mCullLodHysteresis, 0.0f, 0.99f);
+        cullData->maxClusterJobs = mSpecs.maxClusterJobs;
+        cullData->viewportSize = view.viewportSize;
+        cullData->projectionScale = view.projectionScale;
+
+        // Last frame's indirect draws may still be reading the draw lists, and its late pass may still be writing the visibility
+        BufferUtils::GlobalBarrier(cmd, VK_PIPELINE_STAGE_2_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_2_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT,
+            VK_PIPELINE_STAGE_2_TRANSFER_BIT | VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_STORAGE_READ_BIT | VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT);
+        vkCmdFillBuffer(cmd, mDrawCountBuffer->GetBufferInfo().buffer, 0, CULL_PASS_COUNT * sizeof(uint32_t), 0);
+        const VkDispatchIndirectCommand emptyDispatches[CULL_PASS_COUNT] = { { 0, 1, 1 }, { 0, 1, 1 } };
+        vkCmdUpdateBuffer(cmd, mClusterDispatchBuffer->GetBufferInfo().buffer, 0, sizeof(emptyDispatches), emptyDispatches);
+        BufferUtils::GlobalBarrier(cmd, VK_PIPELINE_STAGE_2_TRANSFER_BIT, VK_ACCESS_2_TRANSFER_WRITE_BIT,
+            VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_STORAGE_READ_BIT | VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT);
+    }
+
+    void VulkanGPUScene::Cull(VkCommandBuffer cmd, SceneCullPass pass, const VulkanDepthPyramid* depthPyramid) {
+        if (!mDrawnInstances.empty()) {
+            CullPushConstants pushConstants{};
+            pushConstants.cullData = mFrames[mCullFrameIndex].cullDataBuffer->GetBufferInfo().deviceAddress;
+            pushConstants.instances = mInstanceBuffer->GetBufferInfo().deviceAddress;
+            pushConstants.meshes = mMeshBuffer->GetBufferInfo().deviceAddress;
+            pushConstants.submeshes = mSubmeshBuffer->GetBufferInfo().deviceAddress;
+            pushConstants.lodRanges = mLodRangeBuffer->GetBufferInfo().deviceAddress;
+            pushConstants.drawCommands = mDrawCommandBuffer->GetBufferInfo().deviceAddress;
+            pushConstants.drawData = mDrawDataBuffer->GetBufferInfo().deviceAddress;
+            pushConstants.drawCount = mDrawCountBuffer->GetBufferInfo().deviceAddress;
+            pushConstants.visibility = mVisibilityBuffer->GetBufferInfo().deviceAddress;
+            pushConstants.clusterJobs = mClusterJobBuffer->GetBufferInfo().deviceAddress;
+            pushConstants.clusterDispatch = mClusterDispatchBuffer->GetBufferInfo().deviceAddress;
+            pushConstants.pass = static_cast<uint32_t>(pass);
+            if (depthPyramid) {
+                pushConstants.depthPyramidInfo = depthPyramid->GetInfoAddress();
+                pushConstants.depthPyramid = depthPyramid->GetPyramidAddress();
+                pushConstants.occlusionCulling = 1;
+            }
+
+            mCullPipeline.Bind(cmd);
+            mCullPipeline.PushConstants(cmd, pushConstants);
+            vkCmdDispatch(cmd, (static_cast<uint32_t>(mDrawnInstances.size()) + CULL_WORKGROUP_SIZE - 1) / CULL_WORKGROUP_SIZE, 1, 1);
+
+            if (mDrawnMeshletCount > 0) {
+                // The jobs and their count come from the instance pass, the draw count keeps growing
+                BufferUtils::GlobalBarrier(cmd, VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT,
+                    VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_2_DRAW_INDIRECT_BIT, VK_ACCESS_2_SHADER_STORAGE_READ_BIT | VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT | VK_ACCESS_2_INDIRECT_COMMAND_READ_BIT);
+
+                ClusterCullPushConstants clusterPushConstants{};
+                clusterPushConstants.cullData = pushConstants.cullData;
+                clusterPushConstants.instances = pushConstants.instances;
+                clusterPushConstants.submeshes = pushConstants.submeshes;
+                clusterPushConstants.meshlets = mMeshletBuffer->GetBufferInfo().deviceAddress;
+                clusterPushConstants.clusterJobs = pushConstants.clusterJobs;
+                clusterPushConstants.drawCommands = pushConstants.drawCommands;
+                clusterPushConstants.drawData = pushConstants.drawData;
+                clusterPushConstants.drawCount = pushConstants.drawCount;
+                clusterPushConstants.pass = pushConstants.pass;
+
+                mClusterCullPipeline.Bind(cmd);
+                mClusterCullPipeline.PushConstants(cmd, clusterPushConstants);
+                vkCmdDispatchIndirect(cmd, mClusterDispatchBuffer->GetBufferInfo().buffer, static_cast<VkDeviceSize>(pass) * sizeof(VkDispatchIndirectCommand));
+            }
+        }
+
+        BufferUtils::GlobalBarrier(cmd, VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT,
+            VK_PIPELINE_STAGE_2_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_2_VERTEX_SHADER_BIT, VK_ACCESS_2_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_2_SHADER_STORAGE_READ_BIT);
+    }
+
+    void VulkanGPUScene::Draw(VkCommandBuffer cmd, SceneCullPass pass) const {
+        const VkDeviceSize passIndex = static_cast<VkDeviceSize>(pass);
+        vkCmdBindIndexBuffer(cmd, mIndexBuffer->GetBufferInfo().buffer, 0, VK_INDEX_TYPE_UINT32);
+        vkCmdDrawIndexedIndirectCount(cmd, mDrawCommandBuffer->GetBufferInfo().buffer, passIndex * mSpecs.maxDraws * sizeof(VkDrawIndexedIndirectCommand),
+            mDrawCountBuffer->GetBufferInfo().buffer, passIndex * sizeof(uint32_t), mSpecs.maxDraws, sizeof(VkDrawIndexedIndirectCommand));
+    }
+
+    void VulkanGPUScene::QueueMesh(RenderQueue& queue, GPUMeshID meshIndex, GPUInstanceID instance, uint32_t pass, uint32_t pipeline, uint32_t depth) const {
+        const GPUMesh& mesh = mMeshes[meshIndex];
+        for (uint32_t i = 0; i < mesh.submeshCount; i++) {
+            const uint32_t submesh = mesh.firstSubmesh + i;
+            queue.Push(DrawKey::Make(pass, pipeline, mSubmeshes[submesh].materialIndex, submesh, depth), instance);
+        }
+    }
+
+    void VulkanGPUScene::DrawQueue(VkCommandBuffer cmd, uint32_t frameIndex, const RenderQueue& queue, const std::function<void(uint64_t key, uint32_t changes)>& onStateChange) {
+        SceneFrame& frame = mFrames[frameIndex];
+        GPUDrawData* drawData = static_cast<GPUDrawData*>(frame.queueDrawDataBuffer->GetMappedData());
+        std::span<const uint32_t> payloads = queue.GetPayloads();
+        uint32_t& drawCount = frame.queueDrawCount;
+
+        vkCmdBindIndexBuffer(cmd, mIndexBuffer->GetBufferInfo().buffer, 0, VK_INDEX_TYPE_UINT32);
+        queue.Walk(onStateChange, [&](const DrawBatch& batch) {
+            const uint32_t instanceCount = std::min(batch.itemCount, mSpecs.maxQueuedDraws - drawCount);
+            if (instanceCount == 0)
+                return;
+
+            // Every instance of the batch gets its own draw data, the vertex shader finds it through gl_InstanceIndex
+            const GPUSubmesh& submesh = mSubmeshes[DrawKey::GetMesh(batch.key)];
+            for (uint32_t i = 0; i < instanceCount; i++)
+                drawData[drawCount + i] = { payloads[batch.firstItem + i], submesh.materialIndex };
+
+            vkCmdDrawIndexed(cmd, submesh.indexCount, instanceCount, submesh.firstIndex, submesh.vertexOffset, drawCount);
+            drawCount += instanceCount;
+        });
+    }
+
+}
@@ -1,5 +1,8 @@
 #include <Vulkan/VulkanImage.h>
 
+#include <algorithm>
+#include <vector>
+
 namespace VKRE {
 
     VulkanImage2D::VulkanImage2D(std::shared_ptr<VulkanContext> context)
@@ -9,54 +12,102 @@ namespace VKRE {
         Release();
     }
 
-    void VulkanImage2D::CreateImage(VkFormat format, VkImageUsageFlags usageFlags, VkExtent3D extent, VkImageAspectFlags aspectFlags, VmaAllocationCreateInfo& allocInfo) {
+    void VulkanImage2D::CreateImage(VkFormat format, VkImageUsageFlags usageFlags, VkExtent3D extent, VkImageAspectFlags aspectFlags, VmaAllocationCreateInfo& allocInfo, uint32_t mipLevels, uint32_t arrayLayers) {
         // TODO: First make sure that we have deleted the image
 
+        mImageInfo.extent = extent;
+        mImageInfo.format = format;
+        mImageInfo.mipLevels = mipLevels;
+        mImageInfo.arrayLayers = arrayLayers;
+        mImageInfo.usage = usageFlags;
+        mImageInfo.aspectMask = aspectFlags;
+
+        VkImageCreateInfo info = GetCreateInfo();
+        VK_CHECK(vmaCreateImage(mContext->GetAllocator(), &info, &allocInfo, &mImageInfo.image, &mImageInfo.allocation, nullptr));
+        CreateImageView();
+    }
+
+    std::pair<VkImage, VkImageView> VulkanImage2D::RecordMove(VkCommandBuffer cmd, VmaAllocation destination) {
+        const std::pair<VkImage, VkImageView> oldImage = { mImageInfo.image, mImageInfo.imageView };
+
+        // Same create info, so the memory requirements are the ones the destination was allocated for
+        VkImageCreateInfo info = GetCreateInfo();
+        VK_CHECK(vkCreateImage(mContext->GetLogicalDevice().handle, &info, nullptr, &mImageInfo.image));
+        VK_CHECK(vmaBindImageMemory(mContext->GetAllocator(), destination, mImageInfo.image));
+        CreateImageView();
+
+        std::vector<VkImageCopy> copyRegions(mImageInfo.mipLevels);
+        for (uint32_t mip = 0; mip < mImageInfo.mipLevels; mip++) {
+            VkImageCopy& copyRegion = copyRegions[mip];
+            copyRegion = {};
+            copyRegion.srcSubresource = { mImageInfo.aspectMask, mip, 0, mImageInfo.arrayLayers };
+            copyRegion.dstSubresource = { mImageInfo.aspectMask, mip, 0, mImageInfo.arrayLayers };
+            copyRegion.extent = { std::max(mImageInfo.extent.width >> mip, 1u), std::max(mImageInfo.extent.height >> mip, 1u), 1 };
+        }
+
+        // Frames still in flight read the old image, the barrier's source scope covers them too
+        ImageUtils::TransitionImage(cmd, oldImage.first, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, mImageInfo.aspectMask);
+        ImageUtils::TransitionImage(cmd, mImageInfo.image, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, mImageInfo.aspectMask);
+        vkCmdCopyImage(cmd, oldImage.first, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, mImageInfo.image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, static_cast<uint32_t>(copyRegions.size()), copyRegions.data());
+        ImageUtils::TransitionImage(cmd, mImageInfo.image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, mImageInfo.aspectMask);
+
+        return oldImage;
+    }
+
+    VkImageCreateInfo VulkanImage2D::GetCreateInfo() const {
         VkImageCreateInfo info = {};
         info.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
         info.pNext = nullptr;
 
         info.imageType = VK_IMAGE_TYPE_2D;
-        info.format = format;
-        info.extent = extent;
-        info.mipLevels = 1;
-        info.arrayLayers = 1;
+        info.format = mImageInfo.format;
+        info.extent = mImageInfo.extent;
+        info.mipLevels = mImageInfo.mipLevels;
+        info.arrayLayers = mImageInfo.arrayLayers;
         info.samples = VK_SAMPLE_COUNT_1_BIT;
         info.tiling = VK_IMAGE_TILING_OPTIMAL;
-        info.usage = usageFlags;
+        info.usage = mImageInfo.usage;
 
-        VK_CHECK(vmaCreateImage(mContext->GetAllocator(), &info, &allocInfo, &mImageInfo.image, &mImageInfo.allocation, nullptr));
-        mImageInfo.extent = extent;
-        mImageInfo.format = format;
+        return info;
+    }
 
+    void VulkanImage2D::CreateImageView() {
         VkImageViewCreateInfo imageViewCreateInfo = {};
         imageViewCreateInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
         imageViewCreateInfo.pNext = nullptr;
 
-        imageViewCreateInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+        imageViewCreateInfo.viewType = mImageInfo.arrayLayers > 1 ? VK_IMAGE_VIEW_TYPE_2D_ARRAY : VK_IMAGE_VIEW_TYPE_2D;
         imageViewCreateInfo.image = mImageInfo.image;
-        imageViewCreateInfo.format = format;
+        imageViewCreateInfo.format = mImageInfo.format;
         imageViewCreateInfo.subresourceRange.baseMipLevel = 0;
-        imageViewCreateInfo.subresourceRange.levelCount = 1;
+        imageViewCreateInfo.subresourceRange.levelCount = mImageInfo.mipLevels;
         imageViewCreateInfo.subresourceRange.baseArrayLayer = 0;
-        imageViewCreateInfo.subresourceRange.layerCount = 1;
-        imageViewCreateInfo.subresourceRange.aspectMask = aspectFlags;
+        imageViewCreateInfo.subresourceRange.layerCount = mImageInfo.arrayLayers;
+        imageViewCreateInfo.subresourceRange.aspectMask = mImageInfo.aspectMask;
 
         VK_CHECK(vkCreateImageView(mContext->GetLogicalDevice().handle, &imageViewCreateInfo, nullptr, &mImageInfo.imageView));
     }
 
     void VulkanImage2D::Release() {
+        if (mImageInfo.imageView) {
+            vkDestroyImageView(mContext->GetLogicalDevice().handle, mImageInfo.imageView, nullptr);
+        }
+
         if (mImageInfo.image) {
             vmaDestroyImage(mContext->GetAllocator(), mImageInfo.image, mImageInfo.allocation);
         }
 
-        if (mImageInfo.imageView) {
-            vkDestroyImageView(mContext->GetLogicalDevice().handle, mImageInfo.imageView, nullptr);
-        }
+        mImageInfo = {};
     }
 
     namespace ImageUtils {
         void TransitionImage(VkCommandBuffer cmd, VkImage image, VkImageLayout currentLayout, VkImageLayout newLayout) {
+            const bool isDepth = newLayout == VK_IMAGE_LAYOUT_DEPTH_ATTACHMENT_OPTIMAL || newLayout == VK_IMAGE_LAYOUT_DEPTH_READ_ONLY_OPTIMAL
+                || currentLayout == VK_IMAGE_LAYOUT_DEPTH_ATTACHMENT_OPTIMAL || currentLayout == VK_IMAGE_LAYOUT_DEPTH_READ_ONLY_OPTIMAL;
+            TransitionImage(cmd, image, currentLayout, newLayout, isDepth ? VK_IMAGE_ASPECT_DEPTH_BIT : VK_IMAGE_ASPECT_COLOR_BIT);
+        }
+
+        void TransitionImage(VkCommandBuffer cmd, VkImage image, VkImageLayout currentLayout, VkImageLayout newLayout, VkImageAspectFlags aspectMask) {
             VkImageMemoryBarrier2 imageBarrier {.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2};
             imageBarrier.pNext = nullptr;
 
@@ -67,8 +118,6 @@ namespace VKRE {
 
             imageBarrier.oldLayout = currentLayout;
             imageBarrier.newLayout = newLayout;
-
-            VkImageAspectFlags aspectMask = (newLayout == VK_IMAGE_LAYOUT_DEPTH_ATTACHMENT_OPTIMAL) ? VK_IMAGE_ASPECT_DEPTH_BIT : VK_IMAGE_ASPECT_COLOR_BIT;
             imageBarrier.subresourceRange = ImageSubSourceRange(aspectMask);
             imageBarrier.image = image;
 
@@ -125,5 +174,21 @@ namespace VKRE {
 
             return subImage;
         }
+
+        VkFormat GetTextureFormat(TextureFormat::PixelFormat format, bool srgb) {
+            switch (format) {
+                case TextureFormat::PixelFormat::RGBA8: return srgb ? VK_FORMAT_R8G8B8A8_SRGB : VK_FORMAT_R8G8B8A8_UNORM;
+                case TextureFormat::PixelFormat::BC1: return srgb ? VK_FORMAT_BC1_RGB_SRGB_BLOCK : VK_FORMAT_BC1_RGB_UNORM_BLOCK;
+                case TextureFormat::PixelFormat::BC3: return srgb ? VK_FORMAT_BC3_SRGB_BLOCK : VK_FORMAT_BC3_UNORM_BLOCK;
+                case TextureFormat::PixelFormat::BC4: return VK_FORMAT_BC4_UNORM_BLOCK;
+                case TextureFormat::PixelFormat::BC5: return VK_FORMAT_BC5_UNORM_BLOCK;
+                case TextureFormat::PixelFormat::BC7: return srgb ? VK_FORMAT_BC7_SRGB_BLOCK : VK_FORMAT_BC7_UNORM_BLOCK;
+            }
+            return VK_FORMAT_UNDEFINED;
+        }
+
+        bool IsBlockCompressed(VkFormat format) {
+            return format >= VK_FORMAT_BC1_RGB_UNORM_BLOCK && format <= VK_FORMAT_BC7_SRGB_BLOCK;
+        }
     }
 }
@@ -0,0 +1,66 @@
+#include <Vulkan/VulkanImmediateSubmit.h>
+
+#include <mutex>
+
+namespace VKRE {
+
+    VulkanImmediateSubmit::VulkanImmediateSubmit(std::shared_ptr<VulkanContext> context)
+        :mContext(context) {
+        VkDevice device = mContext->GetLogicalDevice().handle;
+
+        VkCommandPoolCreateInfo poolInfo{};
+        poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+        poolInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+        poolInfo.queueFamilyIndex = mContext->GetQueueFamilies().graphicsFamily.value();
+        VK_CHECK(vkCreateCommandPool(device, &poolInfo, nullptr, &mCommandPool));
+
+        VkCommandBufferAllocateInfo allocInfo{};
+        allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+        allocInfo.commandPool = mCommandPool;
+        allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+        allocInfo.commandBufferCount = 1;
+        VK_CHECK(vkAllocateCommandBuffers(device, &allocInfo, &mCommandBuffer));
+
+        VkFenceCreateInfo fenceCreateInfo{};
+        fenceCreateInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+        VK_CHECK(vkCreateFence(device, &fenceCreateInfo, nullptr, &mFence));
+    }
+
+    VulkanImmediateSubmit::~VulkanImmediateSubmit() {
+        VkDevice device = mContext->GetLogicalDevice().handle;
+        vkDestroyFence(device, mFence, nullptr);
+        vkDestroyCommandPool(device, mCommandPool, nullptr);
+    }
+
+    void VulkanImmediateSubmit::Submit(std::function<void(VkCommandBuffer cmd)>&& function) {
+        VkDevice device = mContext->GetLogicalDevice().handle;
+        VK_CHECK(vkResetCommandBuffer(mCommandBuffer, 0));
+
+        VkCommandBufferBeginInfo cmdBufferBeginInfo{};
+        cmdBufferBeginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+        cmdBufferBeginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+        VK_CHECK(vkBeginCommandBuffer(mCommandBuffer, &cmdBufferBeginInfo));
+
+        function(mCommandBuffer);
+
+        VK_CHECK(vkEndCommandBuffer(mCommandBuffer));
+
+        VkCommandBufferSubmitInfo cmdSubmitInfo{};
+        cmdSubmitInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_SUBMIT_INFO;
+        cmdSubmitInfo.commandBuffer = mCommandBuffer;
+        cmdSubmitInfo.deviceMask = 0;
+
+        VkSubmitInfo2 info{};
+        info.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO_2;
+        info.commandBufferInfoCount = 1;
+        info.pCommandBufferInfos = &cmdSubmitInfo;
+
+        {
+            std::lock_guard lock(mContext->GetQueueMutex());
+            VK_CHECK(vkQueueSubmit2(mContext->GetGraphicsQueue(), 1, &info, mFence));
+        }
+        VK_CHECK(vkWaitForFences(device, 1, &mFence, true, UINT64_MAX));
+        VK_CHECK(vkResetFences(device, 1, &mFence));
+    }
+
+}
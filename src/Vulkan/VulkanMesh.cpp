@@ -0,0 +1,104 @@
+#include <Vulkan/VulkanMesh.h>
+
+#include <cstring>
+#include <iterator>
+#include <print>
+
+namespace VKRE {
+
+    VulkanMesh::VulkanMesh(std::shared_ptr<VulkanContext> context)
+        :mContext(context) {
+        mVertexBuffer = std::make_unique<VulkanBuffer>(context);
+        mIndexBuffer = std::make_unique<VulkanBuffer>(context);
+        mMeshletBuffer = std::make_unique<VulkanBuffer>(context);
+        mMeshletVertexBuffer = std::make_unique<VulkanBuffer>(context);
+        mMeshletTriangleBuffer = std::make_unique<VulkanBuffer>(context);
+    }
+
+    VulkanMesh::~VulkanMesh() {
+        Release();
+    }
+
+    bool VulkanMesh::Upload(VulkanImmediateSubmit& submitter, const MeshAsset& asset) {
+        if (asset.GetVertices().empty() || asset.GetIndices().empty()) {
+            std::println("Mesh has no vertices or indices, or they were cooked with another layout!");
+            return false;
+        }
+
+        struct Stream {
+            std::span<const std::byte> data;
+            VulkanBuffer& buffer;
+            VkBufferUsageFlags usage;
+        };
+
+        // Meshlet streams are only ever read by the culling compute pass, the index buffer is also what non culled draws use
+        const Stream streams[] = {
+            { std::as_bytes(asset.GetVertices()), *mVertexBuffer, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT },
+            { std::as_bytes(asset.GetIndices()), *mIndexBuffer, VK_BUFFER_USAGE_INDEX_BUFFER_BIT },
+            { std::as_bytes(asset.GetMeshlets()), *mMeshletBuffer, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT },
+            { std::as_bytes(asset.GetMeshletVertices()), *mMeshletVertexBuffer, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT },
+            { std::as_bytes(asset.GetMeshletTriangles()), *mMeshletTriangleBuffer, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT },
+        };
+
+        // Zero sized buffers aren't allowed, an empty stream keeps a null buffer and address
+        VkDeviceSize stagingSize = 0;
+        for (const Stream& stream : streams) {
+            if (stream.data.empty())
+                continue;
+            stream.buffer.CreateBuffer(stream.data.size(), stream.usage | VK_BUFFER_USAGE_TRANSFER_DST_BIT, VMA_MEMORY_USAGE_GPU_ONLY);
+            stagingSize += stream.data.size();
+        }
+
+        // The streams are already laid out the way the GPU reads them, so the staging copy is a memcpy per stream straight out of the mapped file
+        VulkanBuffer staging(mContext);
+        staging.CreateBuffer(stagingSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VMA_MEMORY_USAGE_CPU_ONLY);
+        std::byte* stagingData = static_cast<std::byte*>(staging.GetMappedData());
+
+        VkDeviceSize stagingOffset = 0;
+        std::vector<VkDeviceSize> stagingOffsets;
+        for (const Stream& stream : streams) {
+            stagingOffsets.push_back(stagingOffset);
+            if (stream.data.empty())
+                continue;
+            memcpy(stagingData + stagingOffset, stream.data.data(), stream.data.size());
+            stagingOffset += stream.data.size();
+        }
+
+        submitter.Submit([&](VkCommandBuffer cmd) {
+            for (size_t i = 0; i < std::size(streams); i++) {
+                if (streams[i].data.empty())
+                    continue;
+                VkBufferCopy copy{ 0 };
+                copy.srcOffset = stagingOffsets[i];
+                copy.dstOffset = 0;
+                copy.size = streams[i].data.size();
+                vkCmdCopyBuffer(cmd, staging.GetBufferInfo().buffer, streams[i].buffer.GetBufferInfo().buffer, 1, &copy);
+            }
+        });
+
+        std::span<const MeshFormat::Submesh> submeshes = asset.GetSubmeshes();
+        mSubmeshes.assign(submeshes.begin(), submeshes.end());
+        mBounds = asset.GetBounds();
+        mIndexCount = static_cast<uint32_t>(asset.GetIndices().size());
+        mMeshletCount = static_cast<uint32_t>(asset.GetMeshlets().size());
+        mMeshletTriangleCount = static_cast<uint32_t>(asset.GetMeshletTriangles().size());
+
+        // Meshlets without their vertex and triangle streams can't be culled, so they count as absent
+        if (asset.GetMeshletVertices().empty() || asset.GetMeshletTriangles().empty())
+            mMeshletCount = 0;
+        return true;
+    }
+
+    void VulkanMesh::Release() {
+        mVertexBuffer->Release();
+        mIndexBuffer->Release();
+        mMeshletBuffer->Release();
+        mMeshletVertexBuffer->Release();
+        mMeshletTriangleBuffer->Release();
+        mSubmeshes.clear();
+        mIndexCount = 0;
+        mMeshletCount = 0;
+        mMeshletTriangleCount = 0;
+    }
+
+}
@@ -0,0 +1,233 @@
+#include <Vulkan/VulkanObjectCache.h>
+
+#include <bit>
+#include <print>
+#include <type_traits>
+
+namespace VKRE {
+
+    namespace {
+
+        // Flattens create infos into words, every field that changes the object goes in, sType and pNext of the base structure don't
+        class KeyWriter {
+        public:
+            void Add(uint32_t value) { mWords.push_back(value); }
+            void Add(int32_t value) { mWords.push_back(static_cast<uint32_t>(value)); }
+            void Add(float value) { mWords.push_back(std::bit_cast<uint32_t>(value)); }
+            void Add(uint64_t value) {
+                mWords.push_back(static_cast<uint32_t>(value));
+                mWords.push_back(static_cast<uint32_t>(value >> 32));
+            }
+            template <typename Enum> requires std::is_enum_v<Enum> void Add(Enum value) { Add(static_cast<uint32_t>(value)); }
+
+            // Non-dispatchable handles are pointers on 64-bit platforms and uint64_t elsewhere
+            template <typename Handle> void AddHandle(Handle handle) {
+                if constexpr (std::is_pointer_v<Handle>)
+                    Add(static_cast<uint64_t>(reinterpret_cast<uintptr_t>(handle)));
+                else
+                    Add(static_cast<uint64_t>(handle));
+            }
+
+            std::vector<uint32_t>& GetWords() { return mWords; }
+
+        private:
+            std::vector<uint32_t> mWords;
+        };
+
+        uint64_t HashKey(const std::vector<uint32_t>& key) {
+            // FNV-1a over the words, with a final mix so the low bits that pick the bucket depend on all of them
+            uint64_t hash = 0xCBF29CE484222325ull;
+            for (uint32_t word : key) {
+                hash ^= word;
+                hash *= 0x100000001B3ull;
+            }
+            hash ^= hash >> 33;
+            hash *= 0xFF51AFD7ED558CCDull;
+            hash ^= hash >> 33;
+            return hash;
+        }
+
+        [[noreturn]] void UnsupportedChain(const char* objectName, VkStructureType type) {
+            std::println("The object cache doesn't know how to key a {} with structure type {} in its pNext chain!", objectName, static_cast<int32_t>(type));
+            abort();
+        }
+
+    }
+
+    VulkanObjectCache::VulkanObjectCache(VkDevice device)
+        :mDevice(device) {}
+
+    VulkanObjectCache::~VulkanObjectCache() {
+        // Pipeline layouts reference set layouts, they go first
+        DestroyTable(mPipelineLayouts, [this](VkPipelineLayout layout) { vkDestroyPipelineLayout(mDevice, layout, nullptr); });
+        DestroyTable(mSetLayouts, [this](VkDescriptorSetLayout layout) { vkDestroyDescriptorSetLayout(mDevice, layout, nullptr); });
+        DestroyTable(mSamplers, [this](VkSampler sampler) { vkDestroySampler(mDevice, sampler, nullptr); });
+        DestroyTable(mShaderModules, [this](VkShaderModule module) { vkDestroyShaderModule(mDevice, module, nullptr); });
+    }
+
+    VkSampler VulkanObjectCache::GetSampler(const VkSamplerCreateInfo& info) {
+        KeyWriter key;
+        key.Add(info.flags);
+        key.Add(info.magFilter);
+        key.Add(info.minFilter);
+        key.Add(info.mipmapMode);
+        key.Add(info.addressModeU);
+        key.Add(info.addressModeV);
+        key.Add(info.addressModeW);
+        key.Add(info.mipLodBias);
+        key.Add(info.anisotropyEnable);
+        key.Add(info.maxAnisotropy);
+        key.Add(info.compareEnable);
+        key.Add(info.compareOp);
+        key.Add(info.minLod);
+        key.Add(info.maxLod);
+        key.Add(info.borderColor);
+        key.Add(info.unnormalizedCoordinates);
+        for (const VkBaseInStructure* next = static_cast<const VkBaseInStructure*>(info.pNext); next; next = next->pNext) {
+            if (next->sType != VK_STRUCTURE_TYPE_SAMPLER_REDUCTION_MODE_CREATE_INFO)
+                UnsupportedChain("sampler", next->sType);
+            key.Add(next->sType);
+            key.Add(reinterpret_cast<const VkSamplerReductionModeCreateInfo*>(next)->reductionMode);
+        }
+
+        return GetOrCreate(mSamplers, key.GetWords(), [&]() {
+            VkSampler sampler = VK_NULL_HANDLE;
+            VK_CHECK(vkCreateSampler(mDevice, &info, nullptr, &sampler));
+            return sampler;
+        });
+    }
+
+    VkDescriptorSetLayout VulkanObjectCache::GetDescriptorSetLayout(const VkDescriptorSetLayoutCreateInfo& info) {
+        KeyWriter key;
+        key.Add(info.flags);
+        key.Add(info.bindingCount);
+        for (uint32_t i = 0; i < info.bindingCount; i++) {
+            const VkDescriptorSetLayoutBinding& binding = info.pBindings[i];
+            key.Add(binding.binding);
+            key.Add(binding.descriptorType);
+            key.Add(binding.descriptorCount);
+            key.Add(binding.stageFlags);
+            // Immutable samplers are part of the layout, and being cached themselves, equal ones have equal handles
+            key.Add(binding.pImmutableSamplers ? 1u : 0u);
+            if (binding.pImmutableSamplers) {
+                for (uint32_t j = 0; j < binding.descriptorCount; j++)
+                    key.AddHandle(binding.pImmutableSamplers[j]);
+            }
+        }
+        for (const VkBaseInStructure* next = static_cast<const VkBaseInStructure*>(info.pNext); next; next = next->pNext) {
+            if (next->sType != VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO)
+                UnsupportedChain("descriptor set layout", next->sType);
+            const auto* bindingFlags = reinterpret_cast<const VkDescriptorSetLayoutBindingFlagsCreateInfo*>(next);
+            key.Add(next->sType);
+            key.Add(bindingFlags->bindingCount);
+            for (uint32_t i = 0; i < bindingFlags->bindingCount; i++)
+                key.Add(bindingFlags->pBindingFlags[i]);
+        }
+
+        return GetOrCreate(mSetLayouts, key.GetWords(), [&]() {
+            VkDescriptorSetLayout layout = VK_NULL_HANDLE;
+            VK_CHECK(vkCreateDescriptorSetLayout(mDevice, &info, nullptr, &layout));
+            return layout;
+        });
+    }
+
+    VkPipelineLayout VulkanObjectCache::GetPipelineLayout(const VkPipelineLayoutCreateInfo& info) {
+        if (info.pNext)
+            UnsupportedChain("pipeline layout", static_cast<const VkBaseInStructure*>(info.pNext)->sType);
+
+        KeyWriter key;
+        key.Add(info.flags);
+        key.Add(info.setLayoutCount);
+        for (uint32_t i = 0; i < info.setLayoutCount; i++)
+            key.AddHandle(info.pSetLayouts[i]);
+        key.Add(info.pushConstantRangeCount);
+        for (uint32_t i = 0; i < info.pushConstantRangeCount; i++) {
+            key.Add(info.pPushConstantRanges[i].stageFlags);
+            key.Add(info.pPushConstantRanges[i].offset);
+            key.Add(info.pPushConstantRanges[i].size);
+        }
+
+        return GetOrCreate(mPipelineLayouts, key.GetWords(), [&]() {
+            VkPipelineLayout layout = VK_NULL_HANDLE;
+            VK_CHECK(vkCreatePipelineLayout(mDevice, &info, nullptr, &layout));
+            return layout;
+        });
+    }
+
+    VkShaderModule VulkanObjectCache::GetShaderModule(std::span<const uint32_t> code) {
+        std::vector<uint32_t> key(code.begin(), code.end());
+        return GetOrCreate(mShaderModules, key, [&]() {
+            VkShaderModuleCreateInfo info{};
+            info.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+            info.pNext = nullptr;
+            info.codeSize = code.size_bytes();
+            info.pCode = code.data();
+
+            VkShaderModule module = VK_NULL_HANDLE;
+            VK_CHECK(vkCreateShaderModule(mDevice, &info, nullptr, &module));
+            return module;
+        });
+    }
+
+    ObjectCacheStats VulkanObjectCache::GetStats(CachedObjectType type) const {
+        auto read = [](const auto& table) {
+            return ObjectCacheStats{ table.hits.load(std::memory_order_relaxed), table.misses.load(std::memory_order_relaxed) };
+        };
+
+        switch (type) {
+            case CachedObjectType::SAMPLER: return read(mSamplers);
+            case CachedObjectType::DESCRIPTOR_SET_LAYOUT: return read(mSetLayouts);
+            case CachedObjectType::PIPELINE_LAYOUT: return read(mPipelineLayouts);
+            case CachedObjectType::SHADER_MODULE: return read(mShaderModules);
+            default: return {};
+        }
+    }
+
+    template <typename Handle, typename Create>
+    Handle VulkanObjectCache::GetOrCreate(Table<Handle>& table, const std::vector<uint32_t>& key, Create&& create) {
+        using Entry = typename Table<Handle>::Entry;
+        const uint64_t hash = HashKey(key);
+        std::atomic<Entry*>& bucket = table.buckets[hash % BUCKET_COUNT];
+
+        // Acquire pairs with the insert's release, an entry is complete before it's reachable
+        auto find = [&]() -> Entry* {
+            for (Entry* entry = bucket.load(std::memory_order_acquire); entry; entry = entry->next) {
+                if (entry->hash == hash && entry->key == key)
+                    return entry;
+            }
+            return nullptr;
+        };
+
+        if (Entry* entry = find()) {
+            table.hits.fetch_add(1, std::memory_order_relaxed);
+            return entry->handle;
+        }
+
+        std::lock_guard lock(table.insertMutex);
+        // Another thread may have created it while this one waited for the lock
+        if (Entry* entry = find()) {
+            table.hits.fetch_add(1, std::memory_order_relaxed);
+            return entry->handle;
+        }
+
+        Entry* entry = new Entry{ hash, key, create(), bucket.load(std::memory_order_relaxed) };
+        bucket.store(entry, std::memory_order_release);
+        table.misses.fetch_add(1, std::memory_order_relaxed);
+        return entry->handle;
+    }
+
+    template <typename Handle, typename Destroy>
+    void VulkanObjectCache::DestroyTable(Table<Handle>& table, Destroy&& destroy) {
+        for (auto& bucket : table.buckets) {
+            auto* entry = bucket.load(std::memory_order_relaxed);
+            while (entry) {
+                auto* next = entry->next;
+                destroy(entry->handle);
+                delete entry;
+                entry = next;
+            }
+            bucket.store(nullptr, std::memory_order_relaxed);
+        }
+    }
+
+}
@@ -0,0 +1,285 @@
+#include <Vulkan/VulkanPipeline.h>
+
+#include <fstream>
+#include <iterator>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#ifndef VKRE_SHADER_DIR
+#define VKRE_SHADER_DIR "shaders/"
+#endif
+
+namespace VKRE {
+
+    namespace {
+
+        std::mutex sPreloadMutex;
+        std::unordered_map<std::string, std::vector<uint32_t>> sPreloadedShaders; // By shader name, e.g. "Scene.vert"
+
+        std::optional<std::vector<uint32_t>> ReadShaderCode(const std::filesystem::path& path) {
+            std::ifstream file(path, std::ios::binary | std::ios::ate);
+            if (!file)
+                return std::nullopt;
+
+            size_t size = static_cast<size_t>(file.tellg());
+            std::vector<uint32_t> code(size / sizeof(uint32_t));
+            file.seekg(0);
+            file.read(reinterpret_cast<char*>(code.data()), static_cast<std::streamsize>(code.size() * sizeof(uint32_t)));
+            return code;
+        }
+
+    }
+
+    namespace PipelineUtils {
+        std::filesystem::path GetShaderPath(std::string_view name) {
+            std::filesystem::path path = std::filesystem::path(VKRE_SHADER_DIR) / name;
+            path += ".spv";
+            return path;
+        }
+
+        std::vector<uint32_t> LoadShaderCode(std::string_view name) {
+            std::optional<std::vector<uint32_t>> code;
+            {
+                std::lock_guard lock(sPreloadMutex);
+                auto it = sPreloadedShaders.find(std::string(name));
+                if (it != sPreloadedShaders.end())
+                    code = it->second;
+            }
+
+            if (!code.has_value()) {
+                std::filesystem::path path = GetShaderPath(name);
+                code = ReadShaderCode(path);
+                if (!code.has_value()) {
+                    std::println("Failed to open shader {}, was it compiled?", path.string());
+                    abort();
+                }
+            }
+
+            return std::move(code.value());
+        }
+
+        void PreloadShaders() {
+            std::error_code error;
+            std::filesystem::directory_iterator directory(VKRE_SHADER_DIR, error);
+            if (error)
+                return;
+
+            std::unordered_map<std::string, std::vector<uint32_t>> shaders;
+            for (const std::filesystem::directory_entry& entry : directory) {
+                const std::filesystem::path& path = entry.path();
+                if (!entry.is_regular_file() || path.extension() != ".spv")
+                    continue;
+
+                // "Scene.vert.spv" is loaded as "Scene.vert"
+                if (std::optional<std::vector<uint32_t>> code = ReadShaderCode(path))
+                    shaders.emplace(path.stem().string(), std::move(code.value()));
+            }
+
+            std::lock_guard lock(sPreloadMutex);
+            sPreloadedShaders.merge(shaders);
+        }
+
+        void ReleasePreloadedShaders() {
+            std::lock_guard lock(sPreloadMutex);
+            sPreloadedShaders.clear();
+        }
+    }
+
+    VulkanComputePipeline::VulkanComputePipeline(std::shared_ptr<VulkanContext> context)
+        :mContext(context) {}
+
+    VulkanComputePipeline::~VulkanComputePipeline() {
+        Release();
+    }
+
+    void VulkanComputePipeline::CreatePipeline(std::string_view shaderName, uint32_t pushConstantSize, std::span<const VkDescriptorSetLayout> setLayouts) {
+        Release();
+        VkDevice device = mContext->GetLogicalDevice().handle;
+
+        VkPushConstantRange pushConstantRange{};
+        pushConstantRange.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+        pushConstantRange.offset = 0;
+        pushConstantRange.size = pushConstantSize;
+
+        VkPipelineLayoutCreateInfo layoutInfo{};
+        layoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+        layoutInfo.pNext = nullptr;
+        layoutInfo.setLayoutCount = static_cast<uint32_t>(setLayouts.size());
+        layoutInfo.pSetLayouts = setLayouts.data();
+        layoutInfo.pushConstantRangeCount = pushConstantSize > 0 ? 1 : 0;
+        layoutInfo.pPushConstantRanges = &pushConstantRange;
+        mLayout = mContext->GetObjectCache().GetPipelineLayout(layoutInfo);
+
+        VkShaderModule module = mContext->GetObjectCache().GetShaderModule(PipelineUtils::LoadShaderCode(shaderName));
+
+        VkPipelineShaderStageCreateInfo stageInfo{};
+        stageInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+        stageInfo.pNext = nullptr;
+        stageInfo.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+        stageInfo.module = module;
+        stageInfo.pName = "main";
+
+        VkComputePipelineCreateInfo pipelineInfo{};
+        pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+        pipelineInfo.pNext = nullptr;
+        pipelineInfo.stage = stageInfo;
+        pipelineInfo.layout = mLayout;
+        VK_CHECK(vkCreateComputePipelines(device, mContext->GetPipelineCache(), 1, &pipelineInfo, nullptr, &mPipeline));
+    }
+
+    void VulkanComputePipeline::Release() {
+        VkDevice device = mContext->GetLogicalDevice().handle;
+        if (mPipeline)
+            vkDestroyPipeline(device, mPipeline, nullptr);
+
+        // The layout belongs to the object cache
+        mPipeline = VK_NULL_HANDLE;
+        mLayout = VK_NULL_HANDLE;
+    }
+
+    void VulkanComputePipeline::Bind(VkCommandBuffer cmd) const {
+        vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, mPipeline);
+    }
+
+    void VulkanComputePipeline::PushConstants(VkCommandBuffer cmd, const void* data, uint32_t size) const {
+        vkCmdPushConstants(cmd, mLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, size, data);
+    }
+
+    VulkanGraphicsPipeline::VulkanGraphicsPipeline(std::shared_ptr<VulkanContext> context)
+        :mContext(context) {}
+
+    VulkanGraphicsPipeline::~VulkanGraphicsPipeline() {
+        Release();
+    }
+
+    void VulkanGraphicsPipeline::CreatePipeline(const GraphicsPipelineSpecs& specs) {
+        Release();
+        VkDevice device = mContext->GetLogicalDevice().handle;
+        mPushConstantStages = specs.pushConstantStages;
+
+        VkPushConstantRange pushConstantRange{};
+        pushConstantRange.stageFlags = specs.pushConstantStages;
+        pushConstantRange.offset = 0;
+        pushConstantRange.size = specs.pushConstantSize;
+
+        VkPipelineLayoutCreateInfo layoutInfo{};
+        layoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+        layoutInfo.pNext = nullptr;
+        layoutInfo.setLayoutCount = static_cast<uint32_t>(specs.setLayouts.size());
+        layoutInfo.pSetLayouts = specs.setLayouts.data();
+        layoutInfo.pushConstantRangeCount = specs.pushConstantSize > 0 ? 1 : 0;
+        layoutInfo.pPushConstantRanges = &pushConstantRange;
+        mLayout = mContext->GetObjectCache().GetPipelineLayout(layoutInfo);
+
+        std::vector<VkPipelineShaderStageCreateInfo> stages;
+        auto addStage = [&](VkShaderStageFlagBits stage, std::string_view name) {
+            VkPipelineShaderStageCreateInfo stageInfo{};
+            stageInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+            stageInfo.pNext = nullptr;
+            stageInfo.stage = stage;
+            stageInfo.module = mContext->GetObjectCache().GetShaderModule(PipelineUtils::LoadShaderCode(name));
+            stageInfo.pName = "main";
+            stages.push_back(stageInfo);
+        };
+
+        addStage(VK_SHADER_STAGE_VERTEX_BIT, specs.vertexShader);
+        if (!specs.fragmentShader.empty())
+            addStage(VK_SHADER_STAGE_FRAGMENT_BIT, specs.fragmentShader);
+
+        VkPipelineVertexInputStateCreateInfo vertexInput{};
+        vertexInput.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
+
+        VkPipelineInputAssemblyStateCreateInfo inputAssembly{};
+        inputAssembly.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
+        inputAssembly.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+        inputAssembly.primitiveRestartEnable = VK_FALSE;
+
+        VkPipelineViewportStateCreateInfo viewportState{};
+        viewportState.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
+        viewportState.viewportCount = 1;
+        viewportState.scissorCount = 1;
+
+        VkPipelineRasterizationStateCreateInfo rasterizer{};
+        rasterizer.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
+        rasterizer.polygonMode = VK_POLYGON_MODE_FILL;
+        rasterizer.cullMode = specs.cullMode;
+        rasterizer.frontFace = specs.frontFace;
+        rasterizer.lineWidth = 1.0f;
+
+        VkPipelineMultisampleStateCreateInfo multisampling{};
+        multisampling.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
+        multisampling.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
+        multisampling.minSampleShading = 1.0f;
+
+        VkPipelineDepthStencilStateCreateInfo depthStencil{};
+        depthStencil.sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
+        depthStencil.depthTestEnable = specs.depthTest ? VK_TRUE : VK_FALSE;
+        depthStencil.depthWriteEnable = specs.depthWrite ? VK_TRUE : VK_FALSE;
+        depthStencil.depthCompareOp = specs.depthTest ? specs.depthCompareOp : VK_COMPARE_OP_ALWAYS;
+        depthStencil.minDepthBounds = 0.0f;
+        depthStencil.maxDepthBounds = 1.0f;
+
+        std::vector<VkPipelineColorBlendAttachmentState> blendAttachments(specs.colorFormats.size());
+        for (auto& attachment : blendAttachments) {
+            attachment = {};
+            attachment.colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
+            attachment.blendEnable = VK_FALSE;
+        }
+
+        VkPipelineColorBlendStateCreateInfo colorBlending{};
+        colorBlending.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
+        colorBlending.attachmentCount = static_cast<uint32_t>(blendAttachments.size());
+        colorBlending.pAttachments = blendAttachments.data();
+
+        const VkDynamicState dynamicStates[] = { VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR };
+        VkPipelineDynamicStateCreateInfo dynamicState{};
+        dynamicState.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
+        dynamicState.dynamicStateCount = static_cast<uint32_t>(std::size(dynamicStates));
+        dynamicState.pDynamicStates = dynamicStates;
+
+        VkPipelineRenderingCreateInfo renderingInfo{};
+        renderingInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_RENDERING_CREATE_INFO;
+        renderingInfo.colorAttachmentCount = static_cast<uint32_t>(specs.colorFormats.size());
+        renderingInfo.pColorAttachmentFormats = specs.colorFormats.data();
+        renderingInfo.depthAttachmentFormat = specs.depthFormat;
+        renderingInfo.viewMask = specs.viewMask;
+
+        VkGraphicsPipelineCreateInfo pipelineInfo{};
+        pipelineInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+        pipelineInfo.pNext = &renderingInfo;
+        pipelineInfo.stageCount = static_cast<uint32_t>(stages.size());
+        pipelineInfo.pStages = stages.data();
+        pipelineInfo.pVertexInputState = &vertexInput;
+        pipelineInfo.pInputAssemblyState = &inputAssembly;
+        pipelineInfo.pViewportState = &viewportState;
+        pipelineInfo.pRasterizationState = &rasterizer;
+        pipelineInfo.pMultisampleState = &multisampling;
+        pipelineInfo.pDepthStencilState = &depthStencil;
+        pipelineInfo.pColorBlendState = &colorBlending;
+        pipelineInfo.pDynamicState = &dynamicState;
+        pipelineInfo.layout = mLayout;
+        VK_CHECK(vkCreateGraphicsPipelines(device, mContext->GetPipelineCache(), 1, &pipelineInfo, nullptr, &mPipeline));
+    }
+
+    void VulkanGraphicsPipeline::Release() {
+        VkDevice device = mContext->GetLogicalDevice().handle;
+        if (mPipeline)
+            vkDestroyPipeline(device, mPipeline, nullptr);
+
+        // The layout belongs to the object cache
+        mPipeline = VK_NULL_HANDLE;
+        mLayout = VK_NULL_HANDLE;
+    }
+
+    void VulkanGraphicsPipeline::Bind(VkCommandBuffer cmd) const {
+        vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, mPipeline);
+    }
+
+    void VulkanGraphicsPipeline::PushConstants(VkCommandBuffer cmd, const void* data, uint32_t size) const {
+        vkCmdPushConstants(cmd, mLayout, mPushConstantStages, 0, size, data);
+    }
+
+}
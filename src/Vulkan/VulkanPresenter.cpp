@@ -1,22 +1,43 @@
 #include <Vulkan/VulkanPresenter.h>
 
 #include <cassert>
+#include <mutex>
 
 namespace  VKRE {
 
-    VulkanPresenter::VulkanPresenter(std::shared_ptr<VulkanContext> context)
-        :mContext(context) {
-        CreateSwapChain();
+    VulkanPresenter::VulkanPresenter(std::shared_ptr<VulkanContext> context, Window& window, EventBus& eventBus, uint32_t framesInFlight)
+        :mContext(context), mWindow(&window), mEventBus(eventBus) {
+        mOwnsSurface = mContext->GetWindowContext().get() != mWindow;
+        mSurface = mOwnsSurface ? mContext->CreateSurface(window) : mContext->GetSurface();
+
+        VkSemaphoreCreateInfo semaphoreCreateInfo{};
+        semaphoreCreateInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+        mImageAvailableSemaphores.resize(framesInFlight);
+        for (auto& semaphore : mImageAvailableSemaphores) {
+            VK_CHECK(vkCreateSemaphore(mContext->GetLogicalDevice().handle, &semaphoreCreateInfo, nullptr, &semaphore));
+        }
+
+        auto [width, height] = mWindow->GetFrameBufferExtents();
+        CreateSwapChain(static_cast<uint32_t>(width), static_cast<uint32_t>(height));
+
+        mEventBus.Subscribe<FramebufferResizeEvent, &VulkanPresenter::OnFramebufferResize>(this);
+        mEventBus.Subscribe<WindowMinimizeEvent, &VulkanPresenter::OnMinimize>(this);
     }
 
     VulkanPresenter::~VulkanPresenter() {
+        mEventBus.Unsubscribe<FramebufferResizeEvent>(this);
+        mEventBus.Unsubscribe<WindowMinimizeEvent>(this);
+
         DestroySwapChain();
+        for (auto& semaphore : mImageAvailableSemaphores) {
+            vkDestroySemaphore(mContext->GetLogicalDevice().handle, semaphore, nullptr);
+        }
+        if (mOwnsSurface)
+            vkDestroySurfaceKHR(mContext->GetInstance(), mSurface, nullptr);
     }
 
-    void VulkanPresenter::CreateSwapChain() {
-        auto [width, height] = mContext->GetWindowContext()->GetFrameBufferExtents();
-
-        VulkanSwapChainBuilder swapChainBuilder(mContext->GetInstance(), mContext->GetSurface(), mContext->GetPhysicalDevice(), mContext->GetLogicalDevice());
+    void VulkanPresenter::CreateSwapChain(uint32_t width, uint32_t height) {
+        VulkanSwapChainBuilder swapChainBuilder(mContext->GetInstance(), mSurface, mContext->GetPhysicalDevice(), mContext->GetLogicalDevice());
         std::optional<VulkanSwapChain> swapChain = swapChainBuilder.SetDesiredExtent(width, height)
                                                     .SetDesiredImageUsage(VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT)
                                                     .SetDesiredFormat(VkSurfaceFormatKHR{ VK_FORMAT_B8G8R8A8_SRGB, VK_COLOR_SPACE_SRGB_NONLINEAR_KHR })
@@ -43,7 +64,11 @@ namespace  VKRE {
     }
 
     void VulkanPresenter::DestroySwapChain() {
-        vkDeviceWaitIdle(mSwapChain.deviceHandle);
+        {
+            // Waiting for the device needs every queue to itself
+            std::lock_guard lock(mContext->GetQueueMutex());
+            vkDeviceWaitIdle(mSwapChain.deviceHandle);
+        }
         for (auto& semaphore : mRenderCompleteSemaphores) {
             vkDestroySemaphore(mSwapChain.deviceHandle, semaphore, nullptr);
         }
@@ -51,9 +76,44 @@ namespace  VKRE {
         mSwapChain.Destroy();
     }
 
-    void VulkanPresenter::ResizeSwapChain() {
+    void VulkanPresenter::ResizeSwapChain(uint32_t width, uint32_t height) {
         DestroySwapChain();
-        CreateSwapChain();
+        CreateSwapChain(width, height);
     }
-}
 
+    bool VulkanPresenter::AcquireImage(uint32_t frameIndex) {
+        // Nothing is presented while minimised, the swap chain can't have a zero sized extent either
+        if (mMinimized.load(std::memory_order_relaxed))
+            return false;
+        if (const uint64_t extent = mPendingExtent.exchange(0, std::memory_order_relaxed)) {
+            ResizeSwapChain(static_cast<uint32_t>(extent >> 32), static_cast<uint32_t>(extent));
+            return false;
+        }
+
+        // Out of date means a resize event is on its way, the window sits this frame out until it arrives
+        const VkResult result = vkAcquireNextImageKHR(mContext->GetLogicalDevice().handle, mSwapChain.handle, UINT64_MAX, mImageAvailableSemaphores[frameIndex], nullptr, &mImageIndex);
+        if (result == VK_ERROR_OUT_OF_DATE_KHR)
+            return false;
+        if (result != VK_SUBOPTIMAL_KHR)
+            VK_CHECK(result);
+        return true;
+    }
+
+    void VulkanPresenter::OnFramebufferResize(const FramebufferResizeEvent& event) {
+        if (event.window != mWindow)
+            return;
+
+        // Only the latest size matters, a resize still pending is simply replaced
+        if (event.width == 0 || event.height == 0)
+            mMinimized.store(true, std::memory_order_relaxed);
+        else {
+            mPendingExtent.store((static_cast<uint64_t>(event.width) << 32) | event.height, std::memory_order_relaxed);
+            mMinimized.store(false, std::memory_order_relaxed);
+        }
+    }
+
+    void VulkanPresenter::OnMinimize(const WindowMinimizeEvent& event) {
+        if (event.window == mWindow)
+            mMinimized.store(event.minimized, std::memory_order_relaxed);
+    }
+}
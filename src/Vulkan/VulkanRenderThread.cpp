@@ -0,0 +1,56 @@
+#include <Vulkan/VulkanRenderThread.h>
+
+#include <utility>
+
+namespace VKRE {
+
+    VulkanRenderThread::VulkanRenderThread(VulkanRenderer& renderer)
+        :mRenderer(renderer), mThread([this]() { Loop(); }) {}
+
+    VulkanRenderThread::~VulkanRenderThread() {
+        {
+            std::lock_guard lock(mMutex);
+            mStopping = true;
+        }
+        mCondition.notify_all();
+        mThread.join();
+    }
+
+    void VulkanRenderThread::Submit(RenderSnapshot& snapshot) {
+        // Only touches the main thread's side of the renderer, the previous frame may still be recording
+        mRenderer.Capture(snapshot);
+
+        std::unique_lock lock(mMutex);
+        // Only recording reads mSnapshot, once the previous frame's is done it's free to swap
+        mCondition.wait(lock, [this]() { return !mPending; });
+        std::swap(mSnapshot, snapshot);
+        mPending = true;
+        mCondition.notify_all();
+    }
+
+    void VulkanRenderThread::Loop() {
+        while (true) {
+            // The fence wait overlaps with the main thread's simulation
+            mRenderer.WaitForFrame();
+
+            {
+                std::unique_lock lock(mMutex);
+                mCondition.wait(lock, [this]() { return mPending || mStopping; });
+                if (!mPending)
+                    return;
+            }
+
+            const bool recorded = mRenderer.RecordFrame(mSnapshot);
+
+            {
+                std::lock_guard lock(mMutex);
+                mPending = false;
+            }
+            mCondition.notify_all();
+
+            if (recorded)
+                mRenderer.SubmitFrame();
+        }
+    }
+
+}
@@ -1,27 +1,44 @@
 #include <Vulkan/VulkanRenderer.h>
 
-#include <Engine.h>
 #include <glm/glm.hpp>
 
+#include <algorithm>
 #include <cassert>
+#include <cmath>
+#include <cstring>
 #include <memory>
+#include <mutex>
 #include <vulkan/vulkan_core.h>
 
 namespace VKRE {
 
-    VulkanRenderer::VulkanRenderer(std::shared_ptr<VulkanContext> context)
-    :mContext(context) {
+    VulkanRenderer::VulkanRenderer(std::shared_ptr<VulkanContext> context, JobSystem& jobSystem, EventBus& eventBus, const VulkanRendererSpecs& specs)
+    :mContext(context), mEventBus(eventBus) {
         mFrameManager = std::make_unique<VulkanFrameManager>(context);
-        mPresenter = std::make_unique<VulkanPresenter>(context);
+        mPresenters.push_back(std::make_unique<VulkanPresenter>(context, *context->GetWindowContext(), eventBus, mFrameManager->GetFramesInFlight()));
+        mImmediateSubmit = std::make_unique<VulkanImmediateSubmit>(context);
+        mDescriptorAllocator = std::make_unique<VulkanDescriptorAllocator>(context, mFrameManager->GetFramesInFlight());
+        mDefragmenter = std::make_unique<VulkanDefragmenter>(context, specs.defragmenter);
+        mTextureStreamer = std::make_unique<VulkanTextureStreamer>(context, *mDefragmenter, mFrameManager->GetFramesInFlight());
+        mVirtualTextures = std::make_unique<VulkanVirtualTextureCache>(context, *mImmediateSubmit, jobSystem, mFrameManager->GetFramesInFlight(), specs.virtualTextures);
+        mScene = std::make_unique<VulkanGPUScene>(context, *mImmediateSubmit, mFrameManager->GetFramesInFlight());
+        mLighting = std::make_unique<VulkanClusteredLighting>(context, mFrameManager->GetFramesInFlight());
+        mShadows = std::make_unique<VulkanShadowCascades>(context, *mScene, jobSystem, mFrameManager->GetFramesInFlight());
 
+        // The scene renders at a fraction of the window's resolution, the upscaler's output matches the window
         auto [width, height] = mContext->GetWindowContext()->GetFrameBufferExtents();
-        VkExtent3D drawImageExtent = { static_cast<uint32_t>(width), static_cast<uint32_t>(height), 1 };
+        const VkExtent2D outputExtent = { static_cast<uint32_t>(width), static_cast<uint32_t>(height) };
+        const float renderScale = std::clamp(specs.renderScale, 0.25f, 1.0f);
+        VkExtent3D drawImageExtent = {
+            std::max(static_cast<uint32_t>(std::lround(static_cast<float>(outputExtent.width) * renderScale)), 1u),
+            std::max(static_cast<uint32_t>(std::lround(static_cast<float>(outputExtent.height) * renderScale)), 1u), 1 };
         VkFormat format = VK_FORMAT_R16G16B16A16_SFLOAT;
         VkImageUsageFlags drawImageUsages{};
         drawImageUsages |= VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
         drawImageUsages |= VK_IMAGE_USAGE_TRANSFER_DST_BIT;
         drawImageUsages |= VK_IMAGE_USAGE_STORAGE_BIT;
         drawImageUsages |= VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
+        drawImageUsages |= VK_IMAGE_USAGE_SAMPLED_BIT;
 
         VmaAllocationCreateInfo drawImageAllocInfo = {};
         drawImageAllocInfo.usage = VMA_MEMORY_USAGE_GPU_ONLY;
@@ -30,28 +47,147 @@ namespace VKRE {
         mDrawImage = std::make_unique<VulkanImage2D>(context);
         mDrawImage->CreateImage(format, drawImageUsages, drawImageExtent, VK_IMAGE_ASPECT_COLOR_BIT, drawImageAllocInfo);
 
+        mDepthImage = std::make_unique<VulkanImage2D>(context);
+        mDepthImage->CreateImage(VK_FORMAT_D32_SFLOAT, VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, drawImageExtent, VK_IMAGE_ASPECT_DEPTH_BIT, drawImageAllocInfo);
+        mDepthPyramid = std::make_unique<VulkanDepthPyramid>(context, mDepthImage, true);
+
+        mMotionImage = std::make_unique<VulkanImage2D>(context);
+        mMotionImage->CreateImage(VK_FORMAT_R16G16_SFLOAT, VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, drawImageExtent, VK_IMAGE_ASPECT_COLOR_BIT, drawImageAllocInfo);
+        mUpscaler = std::make_unique<VulkanTemporalUpscaler>(context, *mDescriptorAllocator, mDrawImage, mDepthImage, mMotionImage, outputExtent, mFrameManager->GetFramesInFlight(), specs.upscaler);
+        mFrameCapture = std::make_unique<VulkanFrameCapture>(context, jobSystem, outputExtent, mFrameManager->GetFramesInFlight(), specs.capture);
+
+        // Camera projections are reverse-Z, nearer is greater
+        mGeometryPipeline = std::make_unique<VulkanGraphicsPipeline>(context);
+        mGeometryPipeline->CreatePipeline({
+            .vertexShader = "Scene.vert",
+            .fragmentShader = "Scene.frag",
+            .colorFormats = { format, mMotionImage->GetImageInfo().format },
+            .depthFormat = mDepthImage->GetImageInfo().format,
+            .depthCompareOp = VK_COMPARE_OP_GREATER_OR_EQUAL,
+            .pushConstantSize = sizeof(GeometryPushConstants),
+            .setLayouts = { mShadows->GetSetLayout(), mVirtualTextures->GetSetLayout(), mTextureStreamer->GetSetLayout() },
+        });
+        mDepthPipeline = std::make_unique<VulkanGraphicsPipeline>(context);
+        mDepthPipeline->CreatePipeline({
+            .vertexShader = "Scene.vert",
+            .depthFormat = mDepthImage->GetImageInfo().format,
+            .depthCompareOp = VK_COMPARE_OP_GREATER_OR_EQUAL,
+            .pushConstantSize = sizeof(GeometryPushConstants),
+        });
+        mShadingPipeline = std::make_unique<VulkanGraphicsPipeline>(context);
+        mShadingPipeline->CreatePipeline({
+            .vertexShader = "Scene.vert",
+            .fragmentShader = "Scene.frag",
+            .colorFormats = { format, mMotionImage->GetImageInfo().format },
+            .depthFormat = mDepthImage->GetImageInfo().format,
+            .depthWrite = false,
+            .depthCompareOp = VK_COMPARE_OP_EQUAL,
+            .pushConstantSize = sizeof(GeometryPushConstants),
+            .setLayouts = { mShadows->GetSetLayout(), mVirtualTextures->GetSetLayout(), mTextureStreamer->GetSetLayout() },
+        });
+
         mDeletionQueue.PushDeleteFunc([this]() { mDrawImage->Release(); });
+        mDeletionQueue.PushDeleteFunc([this]() { mDepthImage->Release(); });
+        mDeletionQueue.PushDeleteFunc([this]() { mMotionImage->Release(); });
     }
 
     VulkanRenderer::~VulkanRenderer() {
-        mPresenter.reset();
+        mImmediateSubmit.reset();
+        mAddedPresenters.clear();
+        mPresenters.clear();
+        // Destroying the last swap chain waited for the device, the capture's last frames can be read
+        mFrameCapture.reset();
         mFrameManager.reset();
+        mTextureStreamer.reset();
+        mVirtualTextures.reset();
+        // After the streamer, its textures live in the defragmenter's pool
+        mDefragmenter.reset();
+        mScene.reset();
+        mLighting.reset();
+        mShadows.reset();
+        mDepthPyramid.reset();
+        mUpscaler.reset();
+        mDescriptorAllocator.reset();
+        mGeometryPipeline.reset();
+        mDepthPipeline.reset();
+        mShadingPipeline.reset();
     }
 
-    void VulkanRenderer::Render() {
-        VulkanFrameData& frame = mFrameManager->GetCurrentFrame();
+    void VulkanRenderer::Render(RenderSnapshot& snapshot) {
+        Capture(snapshot);
+        WaitForFrame();
+        if (RecordFrame(snapshot))
+            SubmitFrame();
+    }
+
+    void VulkanRenderer::AddWindow(Window& window) {
+        mAddedPresenters.push_back(std::make_unique<VulkanPresenter>(mContext, window, mEventBus, mFrameManager->GetFramesInFlight()));
+    }
+
+    void VulkanRenderer::RemoveWindow(const Window& window) {
+        assert(&window != mContext->GetWindowContext().get() && "The context's window is presented for as long as the renderer lives");
+        std::erase_if(mAddedPresenters, [&](const std::unique_ptr<VulkanPresenter>& presenter) { return presenter->GetWindow() == &window; });
+        mRemovedWindows.push_back(&window);
+    }
 
+    void VulkanRenderer::Capture(RenderSnapshot& snapshot) {
+        mScene->Capture(snapshot.scene);
+        mLighting->Capture(snapshot.lighting);
+        mTextureStreamer->Capture(snapshot.streamedTextures);
+        mVirtualTextures->Capture(snapshot.virtualTextures);
+        mFrameCapture->Capture(snapshot.capture);
+
+        // The previous snapshot in this one was applied, so its lists are empty
+        for (std::unique_ptr<VulkanPresenter>& presenter : mAddedPresenters)
+            snapshot.addedPresenters.push_back(std::move(presenter));
+        mAddedPresenters.clear();
+        snapshot.removedWindows.insert(snapshot.removedWindows.end(), mRemovedWindows.begin(), mRemovedWindows.end());
+        mRemovedWindows.clear();
+
+        snapshot.clearColor = mClearColor;
+        snapshot.depthPrePass = mDepthPrePass;
+    }
+
+    void VulkanRenderer::ApplyWindowChanges(RenderSnapshot& snapshot) {
+        // Nothing acquired from a removed window is in flight anymore, WaitForFrame waited for the last frame that used this slot and
+        // destroying the swap chain waits for the device
+        for (const Window* window : snapshot.removedWindows)
+            std::erase_if(mPresenters, [&](const std::unique_ptr<VulkanPresenter>& presenter) { return presenter->GetWindow() == window; });
+        snapshot.removedWindows.clear();
+
+        for (std::unique_ptr<VulkanPresenter>& presenter : snapshot.addedPresenters)
+            mPresenters.push_back(std::move(presenter));
+        snapshot.addedPresenters.clear();
+    }
+
+    void VulkanRenderer::WaitForFrame() {
+        VulkanFrameData& frame = mFrameManager->GetCurrentFrame();
         VK_CHECK(vkWaitForFences(mContext->GetLogicalDevice().handle, 1, &frame.waitFence, true, UINT64_MAX));
         frame.deletionQueue.Flush();
+    }
 
-        if (Engine::GetInstance().hasResized) {
-            mPresenter->ResizeSwapChain();
-            Engine::GetInstance().hasResized = false;
-            return;
-        }
+    bool VulkanRenderer::RecordFrame(RenderSnapshot& snapshot) {
+        VulkanFrameData& frame = mFrameManager->GetCurrentFrame();
+        const Camera& camera = snapshot.camera;
+        const RenderQueue* queue = &snapshot.queue;
 
-        uint32_t swapchainImageIndex = 0;
-        VK_CHECK(vkAcquireNextImageKHR(mContext->GetLogicalDevice().handle, mPresenter->GetSwapChain().handle, UINT64_MAX, frame.presentCompleteSemaphore, nullptr, &swapchainImageIndex));
+        // Before anything can skip the frame, the next snapshot only holds what changed after this one
+        ApplyWindowChanges(snapshot);
+        mScene->Apply(snapshot.scene);
+        mTextureStreamer->Apply(snapshot.streamedTextures);
+        mVirtualTextures->Apply(snapshot.virtualTextures);
+        mFrameCapture->Apply(snapshot.capture);
+        mDrawnClearColor = snapshot.clearColor;
+        const bool depthPrePass = snapshot.depthPrePass;
+
+        // Windows that are minimised or being resized sit the frame out, it's only skipped when none of them can show it
+        mAcquiredPresenters.clear();
+        for (std::unique_ptr<VulkanPresenter>& presenter : mPresenters) {
+            if (presenter->AcquireImage(mFrameManager->GetCurrentFrameIndex()))
+                mAcquiredPresenters.push_back(presenter.get());
+        }
+        if (mAcquiredPresenters.empty())
+            return false;
 
         VK_CHECK(vkResetFences(mContext->GetLogicalDevice().handle, 1, &frame.waitFence));
 
@@ -67,62 +203,297 @@ namespace VKRE {
 
         VK_CHECK(vkBeginCommandBuffer(cmd, &cmdBufferBeginInfo));
 
-        ImageUtils::TransitionImage(cmd, mDrawImage->GetImageInfo().image, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_GENERAL);
-        ClearImage(cmd, mDrawImage);
-        ImageUtils::TransitionImage(cmd, mDrawImage->GetImageInfo().image,VK_IMAGE_LAYOUT_GENERAL, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL); VkImage swapChainImage = mPresenter->GetImages()[swapchainImageIndex];
+        mDescriptorAllocator->BeginFrame(mFrameManager->GetCurrentFrameIndex());
+        // Moves go first, everything after samples the textures where they moved to
+        mDefragmenter->BeginFrame(cmd, mFrameManager->GetCurrentFrameIndex());
+        mTextureStreamer->BeginFrame(frame, mFrameManager->GetCurrentFrameIndex());
+        mVirtualTextures->BeginFrame(frame, mFrameManager->GetCurrentFrameIndex());
+        mFrameCapture->BeginFrame(mFrameManager->GetCurrentFrameIndex());
+
+        VkExtent3D drawExtent = mDrawImage->GetImageInfo().extent;
+        const float aspectRatio = static_cast<float>(drawExtent.width) / static_cast<float>(drawExtent.height);
+        const glm::mat4 projection = camera.GetProjection(aspectRatio);
+        const glm::mat4 view = camera.GetView();
+        // Everything is drawn and culled jittered, the motion vectors and the upscaler work without it
+        mUpscaler->BeginFrame(mFrameManager->GetCurrentFrameIndex(), projection * view);
+        const glm::mat4 viewProjection = mUpscaler->Jitter(projection) * view;
+        mScene->Update(cmd, mFrameManager->GetCurrentFrameIndex());
+        mShadows->Render(cmd, mFrameManager->GetCurrentFrameIndex(), { glm::inverse(view), camera.GetVerticalFov(), aspectRatio, camera.GetNearPlane() }, snapshot.lighting.sunDirection);
+        // The y axis is flipped for Vulkan, its scale is negative
+        mScene->BeginCull(cmd, mFrameManager->GetCurrentFrameIndex(), { viewProjection, camera.GetPosition(), std::abs(projection[1][1]) * static_cast<float>(drawExtent.height) * 0.5f,
+            { static_cast<float>(drawExtent.width), static_cast<float>(drawExtent.height) } });
+        mScene->Cull(cmd, SceneCullPass::Early);
+        mLighting->Cull(cmd, mFrameManager->GetCurrentFrameIndex(), { view, projection, camera.GetNearPlane(), camera.GetFarPlane(), { drawExtent.width, drawExtent.height }, mShadows->GetShadowDataAddress(mFrameManager->GetCurrentFrameIndex()) }, snapshot.lighting);
+
+        ImageUtils::TransitionImage(cmd, mDrawImage->GetImageInfo().image, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL);
+        ImageUtils::TransitionImage(cmd, mMotionImage->GetImageInfo().image, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL);
+        ImageUtils::TransitionImage(cmd, mDepthImage->GetImageInfo().image, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_DEPTH_ATTACHMENT_OPTIMAL);
+
+        // Without the pre-pass both culling passes shade as they draw. With it they only lay down depth, and a single shading pass then
+        // replays both draw lists against the finished depth buffer.
+        constexpr SceneCullPass EARLY_PASS[] = { SceneCullPass::Early };
+        constexpr SceneCullPass LATE_PASS[] = { SceneCullPass::Late };
+        constexpr SceneCullPass BOTH_PASSES[] = { SceneCullPass::Early, SceneCullPass::Late };
+        const VulkanGraphicsPipeline* cullPassPipeline = depthPrePass ? mDepthPipeline.get() : mGeometryPipeline.get();
+        DrawGeometry(cmd, viewProjection, { .pipeline = cullPassPipeline, .cullPasses = EARLY_PASS, .clearColor = !depthPrePass, .clearDepth = true, .depthOnly = depthPrePass });
+
+        ImageUtils::TransitionImage(cmd, mDepthImage->GetImageInfo().image, VK_IMAGE_LAYOUT_DEPTH_ATTACHMENT_OPTIMAL, VK_IMAGE_LAYOUT_DEPTH_READ_ONLY_OPTIMAL);
+        mDepthPyramid->Build(cmd);
+        ImageUtils::TransitionImage(cmd, mDepthImage->GetImageInfo().image, VK_IMAGE_LAYOUT_DEPTH_READ_ONLY_OPTIMAL, VK_IMAGE_LAYOUT_DEPTH_ATTACHMENT_OPTIMAL);
+        mScene->Cull(cmd, SceneCullPass::Late, mDepthPyramid.get());
+        DrawGeometry(cmd, viewProjection, { .pipeline = cullPassPipeline, .cullPasses = LATE_PASS, .queue = queue, .depthOnly = depthPrePass });
+
+        if (depthPrePass)
+            DrawGeometry(cmd, viewProjection, { .pipeline = mShadingPipeline.get(), .cullPasses = BOTH_PASSES, .queue = queue, .clearColor = true });
 
-        VkExtent2D drawImageExtent = { mDrawImage->GetImageInfo().extent.width, mDrawImage->GetImageInfo().extent.height };
-        ImageUtils::TransitionImage(cmd, swapChainImage, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
-        ImageUtils::CopyImage(cmd, mDrawImage->GetImageInfo().image, swapChainImage, drawImageExtent, mPresenter->GetSwapChain().extent);
-        ImageUtils::TransitionImage(cmd, mPresenter->GetImages()[swapchainImageIndex], VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_PRESENT_SRC_KHR);
+        ImageUtils::TransitionImage(cmd, mDrawImage->GetImageInfo().image, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+        ImageUtils::TransitionImage(cmd, mMotionImage->GetImageInfo().image, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+        ImageUtils::TransitionImage(cmd, mDepthImage->GetImageInfo().image, VK_IMAGE_LAYOUT_DEPTH_ATTACHMENT_OPTIMAL, VK_IMAGE_LAYOUT_DEPTH_READ_ONLY_OPTIMAL);
+        mUpscaler->Resolve(cmd, mFrameManager->GetCurrentFrameIndex());
+        mFrameCapture->Record(cmd, mFrameManager->GetCurrentFrameIndex(), mUpscaler->GetOutputImage());
+
+        // The upscaled image already has the main window's resolution, for it the blit only converts to the swap chain's format. Other
+        // windows get it scaled.
+        VkImage outputImage = mUpscaler->GetOutputImage().GetImageInfo().image;
+        for (VulkanPresenter* presenter : mAcquiredPresenters) {
+            VkImage swapChainImage = presenter->GetImages()[presenter->GetImageIndex()];
+            ImageUtils::TransitionImage(cmd, swapChainImage, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
+            ImageUtils::CopyImage(cmd, outputImage, swapChainImage, mUpscaler->GetOutputExtent(), presenter->GetSwapChain().extent);
+            ImageUtils::TransitionImage(cmd, swapChainImage, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_PRESENT_SRC_KHR);
+        }
+
+        mTextureStreamer->EndFrame(cmd, mFrameManager->GetCurrentFrameIndex());
+        mVirtualTextures->EndFrame(cmd, mFrameManager->GetCurrentFrameIndex());
 
         VK_CHECK(vkEndCommandBuffer(cmd));
+        return true;
+    }
 
-        VkSemaphoreSubmitInfo presentCompleteSemaphoreSubmitInfo{};
-        presentCompleteSemaphoreSubmitInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO;
-        presentCompleteSemaphoreSubmitInfo.semaphore = frame.presentCompleteSemaphore;
-        presentCompleteSemaphoreSubmitInfo.stageMask = VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT_KHR;
+    void VulkanRenderer::SubmitFrame() {
+        VulkanFrameData& frame = mFrameManager->GetCurrentFrame();
+        const uint32_t frameIndex = mFrameManager->GetCurrentFrameIndex();
+
+        // One submit waits for every window's image and signals every window's render complete semaphore
+        const size_t windowCount = mAcquiredPresenters.size();
+        std::vector<VkSemaphoreSubmitInfo> waitSemaphoreInfos(windowCount, { .sType = VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO });
+        std::vector<VkSemaphoreSubmitInfo> signalSemaphoreInfos(windowCount, { .sType = VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO });
+        std::vector<VkSwapchainKHR> swapChains(windowCount);
+        std::vector<VkSemaphore> renderCompleteSemaphores(windowCount);
+        std::vector<uint32_t> imageIndices(windowCount);
+        std::vector<VkResult> presentResults(windowCount);
+        for (size_t i = 0; i < windowCount; i++) {
+            VulkanPresenter& presenter = *mAcquiredPresenters[i];
+            imageIndices[i] = presenter.GetImageIndex();
+            swapChains[i] = presenter.GetSwapChain().handle;
+            renderCompleteSemaphores[i] = presenter.GetRenderCompleteSemaphore(imageIndices[i]);
 
-        VkSemaphoreSubmitInfo renderCompleteSemaphoreSubmitInfo{};
-        renderCompleteSemaphoreSubmitInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO;
-        renderCompleteSemaphoreSubmitInfo.semaphore = mPresenter->GetRenderCompleteSemaphore(swapchainImageIndex);
-        renderCompleteSemaphoreSubmitInfo.stageMask = VK_PIPELINE_STAGE_2_ALL_GRAPHICS_BIT;
+            // The copies into the swap chain images are transfers
+            waitSemaphoreInfos[i].semaphore = presenter.GetImageAvailableSemaphore(frameIndex);
+            waitSemaphoreInfos[i].stageMask = VK_PIPELINE_STAGE_2_ALL_TRANSFER_BIT;
+            signalSemaphoreInfos[i].semaphore = renderCompleteSemaphores[i];
+            signalSemaphoreInfos[i].stageMask = VK_PIPELINE_STAGE_2_ALL_GRAPHICS_BIT;
+        }
 
         VkCommandBufferSubmitInfo cmdSubmitInfo;
         cmdSubmitInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_SUBMIT_INFO;
         cmdSubmitInfo.pNext = nullptr;
-        cmdSubmitInfo.commandBuffer = cmd;
+        cmdSubmitInfo.commandBuffer = frame.commandBuffer;
         cmdSubmitInfo.deviceMask = 0;
 
         VkSubmitInfo2 info = {};
         info.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO_2;
         info.pNext = nullptr;
-        info.waitSemaphoreInfoCount = 1;
-        info.pWaitSemaphoreInfos = &presentCompleteSemaphoreSubmitInfo;
-        info.signalSemaphoreInfoCount = 1;
-        info.pSignalSemaphoreInfos = &renderCompleteSemaphoreSubmitInfo;
+        info.waitSemaphoreInfoCount = static_cast<uint32_t>(windowCount);
+        info.pWaitSemaphoreInfos = waitSemaphoreInfos.data();
+        info.signalSemaphoreInfoCount = static_cast<uint32_t>(windowCount);
+        info.pSignalSemaphoreInfos = signalSemaphoreInfos.data();
         info.commandBufferInfoCount = 1;
         info.pCommandBufferInfos = &cmdSubmitInfo;
 
+        // Uploads from other threads go through the same queue
+        std::lock_guard lock(mContext->GetQueueMutex());
         VK_CHECK(vkQueueSubmit2(mContext->GetGraphicsQueue(), 1, &info, frame.waitFence));
+
+        // All windows in one present, the driver can flip them together instead of taking a round trip each
         VkPresentInfoKHR presentInfo = {};
         presentInfo.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
         presentInfo.pNext = nullptr;
-        presentInfo.pSwapchains = &mPresenter->GetSwapChain().handle;
-        presentInfo.swapchainCount = 1;
-        presentInfo.pWaitSemaphores = &mPresenter->GetRenderCompleteSemaphore(swapchainImageIndex);
-        presentInfo.waitSemaphoreCount = 1;
-        presentInfo.pImageIndices = &swapchainImageIndex;
-        VK_CHECK(vkQueuePresentKHR(mContext->GetGraphicsQueue(), &presentInfo));
+        presentInfo.pSwapchains = swapChains.data();
+        presentInfo.swapchainCount = static_cast<uint32_t>(windowCount);
+        presentInfo.pWaitSemaphores = renderCompleteSemaphores.data();
+        presentInfo.waitSemaphoreCount = static_cast<uint32_t>(windowCount);
+        presentInfo.pImageIndices = imageIndices.data();
+        presentInfo.pResults = presentResults.data();
+        vkQueuePresentKHR(mContext->GetGraphicsQueue(), &presentInfo);
+        // A window that went out of date is resized once its event arrives, anything else is fatal
+        for (VkResult result : presentResults) {
+            if (result != VK_ERROR_OUT_OF_DATE_KHR && result != VK_SUBOPTIMAL_KHR)
+                VK_CHECK(result);
+        }
 
         mFrameManager->AdvanceFrame();
     }
 
-    void VulkanRenderer::ClearImage(VkCommandBuffer cmd, std::shared_ptr<VulkanImage2D> image) {
-        VkClearColorValue clearValue;
-        clearValue = { { 0.0f, 0.0f, 1.0f, 1.0f } };
-        VkImageSubresourceRange clearRange = ImageUtils::ImageSubSourceRange(VK_IMAGE_ASPECT_COLOR_BIT);
-        vkCmdClearColorImage(cmd, image->GetImageInfo().image, VK_IMAGE_LAYOUT_GENERAL, &clearValue, 1, &clearRange);
+    void VulkanRenderer::DrawGeometry(VkCommandBuffer cmd, const glm::mat4& viewProjection, const GeometryPass& pass) {
+        VkExtent2D extent = { mDrawImage->GetImageInfo().extent.width, mDrawImage->GetImageInfo().extent.height };
+
+        VkRenderingAttachmentInfo colorAttachment{ .sType = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO };
+        colorAttachment.imageView = mDrawImage->GetImageInfo().imageView;
+        colorAttachment.imageLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+        colorAttachment.loadOp = pass.clearColor ? VK_ATTACHMENT_LOAD_OP_CLEAR : VK_ATTACHMENT_LOAD_OP_LOAD;
+        colorAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+        colorAttachment.clearValue.color = { { mDrawnClearColor.r, mDrawnClearColor.g, mDrawnClearColor.b, mDrawnClearColor.a } };
+
+        // Cleared to no motion, pixels nothing is drawn to are reprojected by the upscaler from the camera
+        VkRenderingAttachmentInfo motionAttachment = colorAttachment;
+        motionAttachment.imageView = mMotionImage->GetImageInfo().imageView;
+        motionAttachment.clearValue.color = { { 0.0f, 0.0f, 0.0f, 0.0f } };
+        const VkRenderingAttachmentInfo colorAttachments[] = { colorAttachment, motionAttachment };
+
+        VkRenderingAttachmentInfo depthAttachment{ .sType = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO };
+        depthAttachment.imageView = mDepthImage->GetImageInfo().imageView;
+        depthAttachment.imageLayout = VK_IMAGE_LAYOUT_DEPTH_ATTACHMENT_OPTIMAL;
+        depthAttachment.loadOp = pass.clearDepth ? VK_ATTACHMENT_LOAD_OP_CLEAR : VK_ATTACHMENT_LOAD_OP_LOAD;
+        depthAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+        // Reverse-Z, the far plane is at 0
+        depthAttachment.clearValue.depthStencil.depth = 0.0f;
+
+        VkRenderingInfo renderingInfo{ .sType = VK_STRUCTURE_TYPE_RENDERING_INFO };
+        renderingInfo.renderArea = { { 0, 0 }, extent };
+        renderingInfo.layerCount = 1;
+        renderingInfo.colorAttachmentCount = pass.depthOnly ? 0 : 2;
+        renderingInfo.pColorAttachments = pass.depthOnly ? nullptr : colorAttachments;
+        renderingInfo.pDepthAttachment = &depthAttachment;
+        vkCmdBeginRendering(cmd, &renderingInfo);
+
+        VkViewport viewport{ 0.0f, 0.0f, static_cast<float>(extent.width), static_cast<float>(extent.height), 0.0f, 1.0f };
+        VkRect2D scissor{ { 0, 0 }, extent };
+        vkCmdSetViewport(cmd, 0, 1, &viewport);
+        vkCmdSetScissor(cmd, 0, 1, &scissor);
+
+        GeometryPushConstants pushConstants{};
+        pushConstants.viewProjection = viewProjection;
+        pushConstants.vertices = mScene->GetVertexBufferAddress();
+        pushConstants.instances = mScene->GetInstanceBufferAddress();
+        pushConstants.draws = mScene->GetDrawDataBufferAddress();
+        pushConstants.lighting = mLighting->GetLightingDataAddress(mFrameManager->GetCurrentFrameIndex());
+        pushConstants.previousInstances = mScene->GetPreviousInstanceBufferAddress();
+        pushConstants.temporalView = mUpscaler->GetViewAddress(mFrameManager->GetCurrentFrameIndex());
+        pushConstants.virtualTextures = mVirtualTextures->GetDataAddress(mFrameManager->GetCurrentFrameIndex());
+        pushConstants.streamedTextures = mTextureStreamer->GetDataAddress(mFrameManager->GetCurrentFrameIndex());
+
+        pass.pipeline->Bind(cmd);
+        pass.pipeline->PushConstants(cmd, pushConstants);
+        if (!pass.depthOnly) {
+            const VkDescriptorSet sets[] = { mShadows->GetDescriptorSet(), mVirtualTextures->GetDescriptorSet(), mTextureStreamer->GetDescriptorSet(mFrameManager->GetCurrentFrameIndex()) };
+            vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, pass.pipeline->GetLayout(), 0, static_cast<uint32_t>(std::size(sets)), sets, 0, nullptr);
+        }
+        for (SceneCullPass cullPass : pass.cullPasses)
+            mScene->Draw(cmd, cullPass);
+
+        if (pass.queue && !pass.queue->IsEmpty()) {
+            pushConstants.draws = mScene->GetQueueDrawDataAddress(mFrameManager->GetCurrentFrameIndex());
+            mScene->DrawQueue(cmd, mFrameManager->GetCurrentFrameIndex(), *pass.queue, [&](uint64_t key, uint32_t changes) {
+                if (!(changes & RENDER_STATE_PIPELINE))
+                    return;
+
+                // Only the geometry pipeline exists so far, every key is drawn with the pass's pipeline
+                assert(DrawKey::GetPipeline(key) == RENDER_QUEUE_PIPELINE_GEOMETRY);
+                pass.pipeline->Bind(cmd);
+                pass.pipeline->PushConstants(cmd, pushConstants);
+            });
+        }
+
+        vkCmdEndRendering(cmd);
+    }
+
+    std::shared_ptr<VulkanMesh> VulkanRenderer::UploadMesh(const MeshAsset& asset) {
+        std::shared_ptr<VulkanMesh> mesh = std::make_shared<VulkanMesh>(mContext);
+        if (!mesh->Upload(*mImmediateSubmit, asset))
+            return nullptr;
+        return mesh;
+    }
+
+    std::shared_ptr<VulkanImage2D> VulkanRenderer::UploadTexture(const DecodedImage& image, VkFormat format) {
+        VkExtent3D extent = { image.width, image.height, 1 };
+
+        // Registered with the defragmenter below, so it comes from its pool if the format allows
+        const VkImageUsageFlags usage = VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+        VmaAllocationCreateInfo allocInfo = mDefragmenter->GetAllocationCreateInfo(format, usage);
+
+        std::shared_ptr<VulkanImage2D> texture = std::make_shared<VulkanImage2D>(mContext);
+        texture->CreateImage(format, usage, extent, VK_IMAGE_ASPECT_COLOR_BIT, allocInfo);
+
+        VulkanBuffer staging(mContext);
+        staging.CreateBuffer(image.GetSize(), VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VMA_MEMORY_USAGE_CPU_ONLY);
+        memcpy(staging.GetMappedData(), image.pixels.get(), image.GetSize());
+
+        mImmediateSubmit->Submit([&](VkCommandBuffer cmd) {
+            ImageUtils::TransitionImage(cmd, texture->GetImageInfo().image, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
+
+            VkBufferImageCopy copyRegion = {};
+            copyRegion.bufferOffset = 0;
+            copyRegion.bufferRowLength = 0;
+            copyRegion.bufferImageHeight = 0;
+            copyRegion.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+            copyRegion.imageSubresource.mipLevel = 0;
+            copyRegion.imageSubresource.baseArrayLayer = 0;
+            copyRegion.imageSubresource.layerCount = 1;
+            copyRegion.imageExtent = extent;
+            vkCmdCopyBufferToImage(cmd, staging.GetBufferInfo().buffer, texture->GetImageInfo().image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &copyRegion);
+
+            ImageUtils::TransitionImage(cmd, texture->GetImageInfo().image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+        });
+
+        mDefragmenter->Register(texture);
+        return texture;
+    }
+
+    std::shared_ptr<VulkanImage2D> VulkanRenderer::UploadTexture(const TextureAsset& asset, uint32_t firstMip) {
+        firstMip = std::min(firstMip, asset.GetMipCount() - 1);
+        const uint32_t mipCount = asset.GetMipCount() - firstMip;
+        std::span<const TextureFormat::MipLevel> mips = asset.GetMipLevels().subspan(firstMip);
+
+        VkExtent3D extent = { mips[0].width, mips[0].height, 1 };
+        VkFormat format = ImageUtils::GetTextureFormat(asset.GetFormat(), asset.IsSRGB());
+
+        // Registered with the defragmenter below, so it comes from its pool if the format allows
+        const VkImageUsageFlags usage = VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+        VmaAllocationCreateInfo allocInfo = mDefragmenter->GetAllocationCreateInfo(format, usage);
+
+        std::shared_ptr<VulkanImage2D> texture = std::make_shared<VulkanImage2D>(mContext);
+        texture->CreateImage(format, usage, extent, VK_IMAGE_ASPECT_COLOR_BIT, allocInfo, mipCount);
+
+        // The mips are stored back to back in upload layout, so the whole chain is one memcpy
+        std::span<const std::byte> data = asset.GetMipRangeData(firstMip, mipCount);
+        VulkanBuffer staging(mContext);
+        staging.CreateBuffer(data.size(), VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VMA_MEMORY_USAGE_CPU_ONLY);
+        memcpy(staging.GetMappedData(), data.data(), data.size());
+
+        std::vector<VkBufferImageCopy> copyRegions(mipCount);
+        for (uint32_t mip = 0; mip < mipCount; mip++) {
+            VkBufferImageCopy& copyRegion = copyRegions[mip];
+            copyRegion = {};
+            copyRegion.bufferOffset = mips[mip].offset - mips[0].offset;
+            copyRegion.bufferRowLength = 0;
+            copyRegion.bufferImageHeight = 0;
+            copyRegion.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+            copyRegion.imageSubresource.mipLevel = mip;
+            copyRegion.imageSubresource.baseArrayLayer = 0;
+            copyRegion.imageSubresource.layerCount = 1;
+            copyRegion.imageExtent = { mips[mip].width, mips[mip].height, 1 };
+        }
+
+        texture->SetResidentMip(firstMip);
+
+        mImmediateSubmit->Submit([&](VkCommandBuffer cmd) {
+            ImageUtils::TransitionImage(cmd, texture->GetImageInfo().image, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
+            vkCmdCopyBufferToImage(cmd, staging.GetBufferInfo().buffer, texture->GetImageInfo().image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, static_cast<uint32_t>(copyRegions.size()), copyRegions.data());
+            ImageUtils::TransitionImage(cmd, texture->GetImageInfo().image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+        });
+
+        mDefragmenter->Register(texture);
+        return texture;
     }
 
 }
@@ -0,0 +1,303 @@
+#include <Vulkan/VulkanShadowCascades.h>
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <cstring>
+
+namespace VKRE {
+
+    namespace {
+
+        constexpr VkFormat SHADOW_MAP_FORMAT = VK_FORMAT_D32_SFLOAT;
+        // Below this the sun counts as having turned and every cascade is placed again
+        constexpr float SUN_DIRECTION_TOLERANCE = 0.99999f;
+
+        // Smallest sphere around the part of a symmetric view frustum between two view distances, as (distance of its center, radius).
+        // tanSquared is the squared tangent of the angle between the view axis and the frustum's corner edges.
+        glm::vec2 GetSliceSphere(float nearDistance, float farDistance, float tanSquared) {
+            if (tanSquared >= (farDistance - nearDistance) / (farDistance + nearDistance))
+                return { farDistance, farDistance * std::sqrt(tanSquared) };
+
+            const float center = 0.5f * (farDistance + nearDistance) * (1.0f + tanSquared);
+            const float lengthSquared = nearDistance * nearDistance + farDistance * farDistance;
+            const float radius = 0.5f * std::sqrt((farDistance - nearDistance) * (farDistance - nearDistance) + 2.0f * lengthSquared * tanSquared
+                + (farDistance + nearDistance) * (farDistance + nearDistance) * tanSquared * tanSquared);
+            return { center, radius };
+        }
+
+    }
+
+    VulkanShadowCascades::VulkanShadowCascades(std::shared_ptr<VulkanContext> context, VulkanGPUScene& scene, JobSystem& jobSystem, uint32_t framesInFlight, const ShadowCascadeSpecs& specs)
+        :mContext(context), mScene(scene), mJobSystem(jobSystem), mSpecs(specs), mFrames(framesInFlight) {
+        VkDevice device = mContext->GetLogicalDevice().handle;
+        mSpecs.cascadeCount = std::clamp(mSpecs.cascadeCount, 1u, MAX_SHADOW_CASCADES);
+
+        VmaAllocationCreateInfo allocInfo = {};
+        allocInfo.usage = VMA_MEMORY_USAGE_GPU_ONLY;
+        allocInfo.requiredFlags = VkMemoryPropertyFlags(VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+
+        const VkExtent3D extent = { mSpecs.resolution, mSpecs.resolution, 1 };
+        mStaticCache = std::make_unique<VulkanImage2D>(mContext);
+        mStaticCache->CreateImage(SHADOW_MAP_FORMAT, VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT, extent, VK_IMAGE_ASPECT_DEPTH_BIT, allocInfo, 1, mSpecs.cascadeCount);
+        mShadowMap = std::make_unique<VulkanImage2D>(mContext);
+        mShadowMap->CreateImage(SHADOW_MAP_FORMAT, VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, extent, VK_IMAGE_ASPECT_DEPTH_BIT, allocInfo, 1, mSpecs.cascadeCount);
+
+        const VkBufferUsageFlags storageUsage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT;
+        for (auto& frame : mFrames) {
+            frame.dataBuffer = std::make_unique<VulkanBuffer>(mContext);
+            frame.dataBuffer->CreateBuffer(sizeof(ShadowData), storageUsage, VMA_MEMORY_USAGE_CPU_TO_GPU);
+        }
+
+        // Reverse-Z, a point is lit when it's at least as near the sun as what the map holds
+        VkSamplerCreateInfo samplerInfo{};
+        samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+        samplerInfo.pNext = nullptr;
+        samplerInfo.magFilter = VK_FILTER_LINEAR;
+        samplerInfo.minFilter = VK_FILTER_LINEAR;
+        samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+        samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+        samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+        samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+        samplerInfo.compareEnable = VK_TRUE;
+        samplerInfo.compareOp = VK_COMPARE_OP_GREATER_OR_EQUAL;
+        samplerInfo.maxLod = 0.0f;
+        mSampler = mContext->GetObjectCache().GetSampler(samplerInfo);
+
+        VkDescriptorSetLayoutBinding binding{};
+        binding.binding = 0;
+        binding.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+        binding.descriptorCount = 1;
+        binding.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+
+        VkDescriptorSetLayoutCreateInfo layoutInfo{};
+        layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+        layoutInfo.pNext = nullptr;
+        layoutInfo.bindingCount = 1;
+        layoutInfo.pBindings = &binding;
+        mSetLayout = mContext->GetObjectCache().GetDescriptorSetLayout(layoutInfo);
+
+        VkDescriptorPoolSize poolSize{ VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1 };
+        VkDescriptorPoolCreateInfo poolInfo{};
+        poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+        poolInfo.pNext = nullptr;
+        poolInfo.maxSets = 1;
+        poolInfo.poolSizeCount = 1;
+        poolInfo.pPoolSizes = &poolSize;
+        VK_CHECK(vkCreateDescriptorPool(device, &poolInfo, nullptr, &mDescriptorPool));
+
+        VkDescriptorSetAllocateInfo setAllocInfo{};
+        setAllocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+        setAllocInfo.pNext = nullptr;
+        setAllocInfo.descriptorPool = mDescriptorPool;
+        setAllocInfo.descriptorSetCount = 1;
+        setAllocInfo.pSetLayouts = &mSetLayout;
+        VK_CHECK(vkAllocateDescriptorSets(device, &setAllocInfo, &mDescriptorSet));
+
+        VkDescriptorImageInfo imageInfo{};
+        imageInfo.sampler = mSampler;
+        imageInfo.imageView = mShadowMap->GetImageInfo().imageView;
+        imageInfo.imageLayout = VK_IMAGE_LAYOUT_DEPTH_READ_ONLY_OPTIMAL;
+
+        VkWriteDescriptorSet write{};
+        write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        write.pNext = nullptr;
+        write.dstSet = mDescriptorSet;
+        write.dstBinding = 0;
+        write.descriptorCount = 1;
+        write.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+        write.pImageInfo = &imageInfo;
+        vkUpdateDescriptorSets(device, 1, &write, 0, nullptr);
+
+        // Casters are often single sided or open, so both faces are drawn
+        mPipeline = std::make_unique<VulkanGraphicsPipeline>(mContext);
+        mPipeline->CreatePipeline({
+            .vertexShader = "ShadowCascade.vert",
+            .depthFormat = SHADOW_MAP_FORMAT,
+            .viewMask = (1u << mSpecs.cascadeCount) - 1,
+            .depthCompareOp = VK_COMPARE_OP_GREATER_OR_EQUAL,
+            .cullMode = VK_CULL_MODE_NONE,
+            .pushConstantSize = sizeof(PushConstants),
+            .pushConstantStages = VK_SHADER_STAGE_VERTEX_BIT,
+        });
+    }
+
+    VulkanShadowCascades::~VulkanShadowCascades() {
+        VkDevice device = mContext->GetLogicalDevice().handle;
+        mPipeline.reset();
+        mFrames.clear();
+        mStaticCache.reset();
+        mShadowMap.reset();
+        vkDestroyDescriptorPool(device, mDescriptorPool, nullptr);
+    }
+
+    void VulkanShadowCascades::Render(VkCommandBuffer cmd, uint32_t frameIndex, const ShadowView& view, const glm::vec3& sunDirection) {
+        ShadowData data{};
+        data.depthBias = mSpecs.depthBias;
+        data.normalBias = mSpecs.normalBias;
+
+        VkImage shadowMap = mShadowMap->GetImageInfo().image;
+        if (!mEnabled) {
+            // Never sampled with no cascades, the layout only has to match the descriptor
+            data.cascadeCount = 0;
+            memcpy(mFrames[frameIndex].dataBuffer->GetMappedData(), &data, sizeof(ShadowData));
+            ImageUtils::TransitionImage(cmd, shadowMap, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_DEPTH_READ_ONLY_OPTIMAL);
+            return;
+        }
+
+        const glm::vec3 direction = glm::normalize(sunDirection);
+        const bool sunTurned = glm::dot(direction, mSunDirection) < SUN_DIRECTION_TOLERANCE;
+        if (sunTurned) {
+            mSunDirection = direction;
+            mCacheValid = false;
+        }
+
+        // The light looks down the sun's rays, so towards the sun is +Z in light space
+        const glm::vec3 up = std::abs(mSunDirection.y) > 0.99f ? glm::vec3(0.0f, 0.0f, 1.0f) : glm::vec3(0.0f, 1.0f, 0.0f);
+        const glm::mat4 lightView = glm::lookAt(glm::vec3(0.0f), -mSunDirection, up);
+        if (PlaceCascades(view, lightView) || mScene.GetDrawnStaticRevision() != mStaticRevision)
+            mCacheValid = false;
+
+        data.cascadeCount = mSpecs.cascadeCount;
+        for (uint32_t i = 0; i < mSpecs.cascadeCount; i++) {
+            data.viewProjection[i] = mCascades[i].viewProjection;
+            data.splitDistances[i] = mCascades[i].splitDistance;
+            data.texelSizes[i] = 2.0f * mCascades[i].radius / static_cast<float>(mSpecs.resolution);
+        }
+        memcpy(mFrames[frameIndex].dataBuffer->GetMappedData(), &data, sizeof(ShadowData));
+
+        VkImage staticCache = mStaticCache->GetImageInfo().image;
+        if (!mCacheValid) {
+            mStaticRevision = mScene.GetDrawnStaticRevision();
+            QueueCasters(false);
+            ImageUtils::TransitionImage(cmd, staticCache, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_DEPTH_ATTACHMENT_OPTIMAL);
+            DrawCasters(cmd, frameIndex, *mStaticCache, true);
+            ImageUtils::TransitionImage(cmd, staticCache, VK_IMAGE_LAYOUT_DEPTH_ATTACHMENT_OPTIMAL, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, VK_IMAGE_ASPECT_DEPTH_BIT);
+            mCacheValid = true;
+            mStaticRedrawCount++;
+        }
+
+        ImageUtils::TransitionImage(cmd, shadowMap, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_ASPECT_DEPTH_BIT);
+        VkImageCopy copy{};
+        copy.srcSubresource = { VK_IMAGE_ASPECT_DEPTH_BIT, 0, 0, mSpecs.cascadeCount };
+        copy.dstSubresource = { VK_IMAGE_ASPECT_DEPTH_BIT, 0, 0, mSpecs.cascadeCount };
+        copy.extent = { mSpecs.resolution, mSpecs.resolution, 1 };
+        vkCmdCopyImage(cmd, staticCache, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, shadowMap, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &copy);
+        ImageUtils::TransitionImage(cmd, shadowMap, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_DEPTH_ATTACHMENT_OPTIMAL, VK_IMAGE_ASPECT_DEPTH_BIT);
+
+        QueueCasters(true);
+        if (!mCasterQueue.IsEmpty())
+            DrawCasters(cmd, frameIndex, *mShadowMap, false);
+        ImageUtils::TransitionImage(cmd, shadowMap, VK_IMAGE_LAYOUT_DEPTH_ATTACHMENT_OPTIMAL, VK_IMAGE_LAYOUT_DEPTH_READ_ONLY_OPTIMAL);
+    }
+
+    bool VulkanShadowCascades::PlaceCascades(const ShadowView& view, const glm::mat4& lightView) {
+        const float tanHalfFov = std::tan(view.verticalFov * 0.5f);
+        const float tanSquared = tanHalfFov * tanHalfFov * (1.0f + view.aspectRatio * view.aspectRatio);
+        const float nearPlane = view.nearPlane;
+        const float farPlane = std::max(mSpecs.shadowDistance, nearPlane * 2.0f);
+        const float cascadeCount = static_cast<float>(mSpecs.cascadeCount);
+
+        bool moved = !mCacheValid;
+        float sliceNear = nearPlane;
+        for (uint32_t i = 0; i < mSpecs.cascadeCount; i++) {
+            const float fraction = static_cast<float>(i + 1) / cascadeCount;
+            const float uniformSplit = nearPlane + (farPlane - nearPlane) * fraction;
+            const float logSplit = nearPlane * std::pow(farPlane / nearPlane, fraction);
+            const float sliceFar = uniformSplit + (logSplit - uniformSplit) * mSpecs.splitLambda;
+
+            const glm::vec2 sphere = GetSliceSphere(sliceNear, sliceFar, tanSquared);
+            const glm::vec3 worldCenter = glm::vec3(view.inverseView * glm::vec4(0.0f, 0.0f, -sphere.x, 1.0f));
+            const glm::vec3 lightCenter = glm::vec3(lightView * glm::vec4(worldCenter, 1.0f));
+            const float radius = sphere.y * (1.0f + mSpecs.cachePadding);
+
+            Cascade& cascade = mCascades[i];
+            cascade.splitDistance = sliceFar;
+            sliceNear = sliceFar;
+            if (mCacheValid && cascade.radius == radius && glm::distance(lightCenter, cascade.center) + sphere.y <= radius)
+                continue;
+
+            // Whole texel steps keep the shadow edges of a moving camera from crawling
+            const float texelSize = 2.0f * radius / static_cast<float>(mSpecs.resolution);
+            cascade.center = glm::vec3(glm::floor(glm::vec2(lightCenter) / texelSize) * texelSize, lightCenter.z);
+            cascade.radius = radius;
+
+            // Reverse-Z with the far side of the sphere at 0 and the casters casterDistance towards the sun at 1
+            const glm::vec3& center = cascade.center;
+            const glm::mat4 projection = glm::orthoRH_ZO(center.x - radius, center.x + radius, center.y - radius, center.y + radius,
+                -(center.z - radius), -(center.z + radius + mSpecs.casterDistance));
+            cascade.viewProjection = projection * lightView;
+            cascade.frustum = Frustum::FromMatrix(cascade.viewProjection);
+            moved = true;
+        }
+        return moved;
+    }
+
+    void VulkanShadowCascades::QueueCasters(bool dynamicCasters) {
+        const BoundingBoxSoA& bounds = mScene.GetDrawnInstanceBounds();
+        const uint32_t wordCount = FrustumCulling::GetVisibilityWordCount(bounds.GetCount());
+        mCasterVisibility.assign(wordCount, 0);
+        mCascadeVisibility.resize(wordCount);
+        for (uint32_t i = 0; i < mSpecs.cascadeCount; i++) {
+            FrustumCulling::CullBoxes(mJobSystem, mCascades[i].frustum, bounds, mCascadeVisibility);
+            for (uint32_t word = 0; word < wordCount; word++)
+                mCasterVisibility[word] |= mCascadeVisibility[word];
+        }
+
+        mCasterQueue.Clear();
+        for (uint32_t word = 0; word < wordCount; word++) {
+            for (uint64_t bits = mCasterVisibility[word]; bits != 0; bits &= bits - 1) {
+                const GPUInstanceID instance = word * 64 + static_cast<uint32_t>(std::countr_zero(bits));
+                if (instance >= bounds.GetCount() || !mScene.IsDrawnInstanceAlive(instance))
+                    continue;
+                if (((mScene.GetDrawnInstanceFlags(instance) & GPU_INSTANCE_DYNAMIC) != 0) == dynamicCasters)
+                    mScene.QueueDrawnInstance(mCasterQueue, instance, 0, 0, 0);
+            }
+        }
+        mCasterQueue.Sort(mJobSystem);
+    }
+
+    void VulkanShadowCascades::DrawCasters(VkCommandBuffer cmd, uint32_t frameIndex, VulkanImage2D& target, bool clear) {
+        const VkExtent2D extent = { mSpecs.resolution, mSpecs.resolution };
+
+        VkRenderingAttachmentInfo depthAttachment{ .sType = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO };
+        depthAttachment.imageView = target.GetImageInfo().imageView;
+        depthAttachment.imageLayout = VK_IMAGE_LAYOUT_DEPTH_ATTACHMENT_OPTIMAL;
+        depthAttachment.loadOp = clear ? VK_ATTACHMENT_LOAD_OP_CLEAR : VK_ATTACHMENT_LOAD_OP_LOAD;
+        depthAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+        depthAttachment.clearValue.depthStencil.depth = 0.0f;
+
+        VkRenderingInfo renderingInfo{ .sType = VK_STRUCTURE_TYPE_RENDERING_INFO };
+        renderingInfo.renderArea = { { 0, 0 }, extent };
+        renderingInfo.layerCount = 1;
+        renderingInfo.viewMask = (1u << mSpecs.cascadeCount) - 1;
+        renderingInfo.pDepthAttachment = &depthAttachment;
+        vkCmdBeginRendering(cmd, &renderingInfo);
+
+        VkViewport viewport{ 0.0f, 0.0f, static_cast<float>(extent.width), static_cast<float>(extent.height), 0.0f, 1.0f };
+        VkRect2D scissor{ { 0, 0 }, extent };
+        vkCmdSetViewport(cmd, 0, 1, &viewport);
+        vkCmdSetScissor(cmd, 0, 1, &scissor);
+
+        PushConstants pushConstants{};
+        pushConstants.shadows = mFrames[frameIndex].dataBuffer->GetBufferInfo().deviceAddress;
+        pushConstants.vertices = mScene.GetVertexBufferAddress();
+        pushConstants.instances = mScene.GetInstanceBufferAddress();
+        pushConstants.draws = mScene.GetQueueDrawDataAddress(frameIndex);
+
+        if (!mCasterQueue.IsEmpty()) {
+            mScene.DrawQueue(cmd, frameIndex, mCasterQueue, [&](uint64_t, uint32_t changes) {
+                if (!(changes & RENDER_STATE_PIPELINE))
+                    return;
+
+                mPipeline->Bind(cmd);
+                mPipeline->PushConstants(cmd, pushConstants);
+            });
+        }
+
+        vkCmdEndRendering(cmd);
+    }
+
+}
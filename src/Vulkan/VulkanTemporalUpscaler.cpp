@@ -0,0 +1,161 @@
+#include <Vulkan/VulkanTemporalUpscaler.h>
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace VKRE {
+
+    namespace {
+
+        constexpr uint32_t GROUP_SIZE = 8;
+        constexpr uint32_t BINDING_COUNT = 5;
+
+        float Halton(uint32_t index, uint32_t base) {
+            float result = 0.0f;
+            float fraction = 1.0f;
+            while (index > 0) {
+                fraction /= static_cast<float>(base);
+                result += fraction * static_cast<float>(index % base);
+                index /= base;
+            }
+            return result;
+        }
+
+    }
+
+    VulkanTemporalUpscaler::VulkanTemporalUpscaler(std::shared_ptr<VulkanContext> context, VulkanDescriptorAllocator& descriptorAllocator, std::shared_ptr<VulkanImage2D> colorImage, std::shared_ptr<VulkanImage2D> depthImage,
+        std::shared_ptr<VulkanImage2D> motionImage, VkExtent2D outputExtent, uint32_t framesInFlight, const TemporalUpscalerSpecs& specs)
+        :mContext(context), mDescriptorAllocator(descriptorAllocator), mColorImage(colorImage), mDepthImage(depthImage), mMotionImage(motionImage), mSpecs(specs), mPipeline(context), mOutputExtent(outputExtent) {
+        mInputExtent = { mColorImage->GetImageInfo().extent.width, mColorImage->GetImageInfo().extent.height };
+
+        // An output pixel gets a sample of its own about every (output / input)^2 frames, the sequence is made long enough to give each
+        // of them several
+        const float upscaleArea = (static_cast<float>(mOutputExtent.width) * static_cast<float>(mOutputExtent.height))
+            / (static_cast<float>(mInputExtent.width) * static_cast<float>(mInputExtent.height));
+        mJitterPhaseCount = static_cast<uint32_t>(std::ceil(8.0f * std::max(upscaleArea, 1.0f)));
+
+        VmaAllocationCreateInfo allocInfo = {};
+        allocInfo.usage = VMA_MEMORY_USAGE_GPU_ONLY;
+        allocInfo.requiredFlags = VkMemoryPropertyFlags(VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+        for (auto& image : mHistoryImages) {
+            image = std::make_unique<VulkanImage2D>(mContext);
+            image->CreateImage(VK_FORMAT_R16G16B16A16_SFLOAT, VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT,
+                { mOutputExtent.width, mOutputExtent.height, 1 }, VK_IMAGE_ASPECT_COLOR_BIT, allocInfo);
+        }
+
+        mViewBuffers.resize(framesInFlight);
+        for (auto& buffer : mViewBuffers) {
+            buffer = std::make_unique<VulkanBuffer>(mContext);
+            buffer->CreateBuffer(sizeof(TemporalView), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT, VMA_MEMORY_USAGE_CPU_TO_GPU);
+        }
+
+        // The inputs are read texel by texel, only the history is filtered
+        VkSamplerCreateInfo samplerInfo{};
+        samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+        samplerInfo.pNext = nullptr;
+        samplerInfo.magFilter = VK_FILTER_NEAREST;
+        samplerInfo.minFilter = VK_FILTER_NEAREST;
+        samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+        samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+        samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+        samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+        samplerInfo.maxLod = 0.0f;
+        mPointSampler = mContext->GetObjectCache().GetSampler(samplerInfo);
+        samplerInfo.magFilter = VK_FILTER_LINEAR;
+        samplerInfo.minFilter = VK_FILTER_LINEAR;
+        mLinearSampler = mContext->GetObjectCache().GetSampler(samplerInfo);
+
+        VkDescriptorSetLayoutBinding bindings[BINDING_COUNT]{};
+        for (uint32_t i = 0; i < BINDING_COUNT; i++) {
+            bindings[i].binding = i;
+            bindings[i].descriptorType = i == BINDING_COUNT - 1 ? VK_DESCRIPTOR_TYPE_STORAGE_IMAGE : VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+            bindings[i].descriptorCount = 1;
+            bindings[i].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+        }
+
+        VkDescriptorSetLayoutCreateInfo layoutInfo{};
+        layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+        layoutInfo.pNext = nullptr;
+        layoutInfo.bindingCount = BINDING_COUNT;
+        layoutInfo.pBindings = bindings;
+        mSetLayout = mContext->GetObjectCache().GetDescriptorSetLayout(layoutInfo);
+
+        mPipeline.CreatePipeline("TemporalUpscale.comp", sizeof(PushConstants), std::span(&mSetLayout, 1));
+    }
+
+    VulkanTemporalUpscaler::~VulkanTemporalUpscaler() {
+        mPipeline.Release();
+    }
+
+    void VulkanTemporalUpscaler::BeginFrame(uint32_t frameIndex, const glm::mat4& viewProjection) {
+        // Halton(2, 3) covers the pixel evenly for any prefix of the sequence, index 0 is skipped since it's the same in both bases
+        const uint32_t phase = static_cast<uint32_t>(mFrameCount % mJitterPhaseCount) + 1;
+        mJitter = { Halton(phase, 2) - 0.5f, Halton(phase, 3) - 0.5f };
+        mFrameCount++;
+
+        TemporalView view{};
+        view.viewProjection = viewProjection;
+        view.previousViewProjection = mHistoryValid ? mPreviousViewProjection : viewProjection;
+        view.inverseViewProjection = glm::inverse(viewProjection);
+        view.jitter = mJitter;
+        view.inputSize = { mInputExtent.width, mInputExtent.height };
+        view.outputSize = { mOutputExtent.width, mOutputExtent.height };
+        view.resetHistory = mHistoryValid ? 0 : 1;
+        view.historyBlend = mSpecs.historyBlend;
+        view.varianceClamp = mSpecs.varianceClamp;
+        memcpy(mViewBuffers[frameIndex]->GetMappedData(), &view, sizeof(TemporalView));
+        mPreviousViewProjection = viewProjection;
+    }
+
+    glm::mat4 VulkanTemporalUpscaler::Jitter(const glm::mat4& projection) const {
+        // A clip space offset of 2 / size is one pixel once divided by w
+        const glm::vec2 offset = mJitter * 2.0f / glm::vec2(mInputExtent.width, mInputExtent.height);
+        return glm::translate(glm::mat4(1.0f), glm::vec3(offset, 0.0f)) * projection;
+    }
+
+    void VulkanTemporalUpscaler::Resolve(VkCommandBuffer cmd, uint32_t frameIndex) {
+        mOutputIndex ^= 1;
+        VulkanImage2D& output = *mHistoryImages[mOutputIndex];
+        VulkanImage2D& history = *mHistoryImages[mOutputIndex ^ 1];
+
+        // Last frame's output was left for the transfer to the swap chains, without history it's undefined
+        ImageUtils::TransitionImage(cmd, history.GetImageInfo().image, mHistoryValid ? VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL : VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+        ImageUtils::TransitionImage(cmd, output.GetImageInfo().image, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_GENERAL);
+
+        PushConstants pushConstants{};
+        pushConstants.view = GetViewAddress(frameIndex);
+
+        const VkDescriptorImageInfo imageInfos[BINDING_COUNT] = {
+            { mPointSampler, mColorImage->GetImageInfo().imageView, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL },
+            { mPointSampler, mDepthImage->GetImageInfo().imageView, VK_IMAGE_LAYOUT_DEPTH_READ_ONLY_OPTIMAL },
+            { mPointSampler, mMotionImage->GetImageInfo().imageView, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL },
+            { mLinearSampler, history.GetImageInfo().imageView, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL },
+            { VK_NULL_HANDLE, output.GetImageInfo().imageView, VK_IMAGE_LAYOUT_GENERAL }
+        };
+
+        VkDescriptorSet set = mDescriptorAllocator.Allocate(frameIndex, mSetLayout);
+        VkWriteDescriptorSet writes[BINDING_COUNT]{};
+        for (uint32_t i = 0; i < BINDING_COUNT; i++) {
+            writes[i].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+            writes[i].pNext = nullptr;
+            writes[i].dstSet = set;
+            writes[i].dstBinding = i;
+            writes[i].descriptorCount = 1;
+            writes[i].descriptorType = i == BINDING_COUNT - 1 ? VK_DESCRIPTOR_TYPE_STORAGE_IMAGE : VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+            writes[i].pImageInfo = &imageInfos[i];
+        }
+        vkUpdateDescriptorSets(mContext->GetLogicalDevice().handle, BINDING_COUNT, writes, 0, nullptr);
+
+        mPipeline.Bind(cmd);
+        vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, mPipeline.GetLayout(), 0, 1, &set, 0, nullptr);
+        mPipeline.PushConstants(cmd, pushConstants);
+        vkCmdDispatch(cmd, (mOutputExtent.width + GROUP_SIZE - 1) / GROUP_SIZE, (mOutputExtent.height + GROUP_SIZE - 1) / GROUP_SIZE, 1);
+
+        ImageUtils::TransitionImage(cmd, output.GetImageInfo().image, VK_IMAGE_LAYOUT_GENERAL, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL);
+        mHistoryValid = true;
+    }
+
+}
@@ -0,0 +1,441 @@
+#include <Vulkan/VulkanTextureStreamer.h>
+
+#include <algorithm>
+#include <cstring>
+#include <print>
+
+namespace VKRE {
+
+    namespace {
+
+        constexpr uint32_t INVALID_TEXTURE = UINT32_MAX; // Same as INVALID_STREAMED_TEXTURE in TextureStreaming.glsl
+        // The scene shader's shadow map and virtual texture samplers count against the same per stage limit
+        constexpr uint32_t RESERVED_SAMPLERS = 3;
+
+    }
+
+    VulkanTextureStreamer::VulkanTextureStreamer(std::shared_ptr<VulkanContext> context, VulkanDefragmenter& defragmenter, uint32_t framesInFlight, const TextureStreamerSpecs& specs)
+        :mContext(context), mDefragmenter(defragmenter), mSpecs(specs), mFrames(framesInFlight) {
+        VkDevice device = mContext->GetLogicalDevice().handle;
+
+        const VkPhysicalDeviceLimits& limits = mContext->GetPhysicalDevice().properties.limits;
+        const uint32_t maxSamplers = std::min({ limits.maxPerStageDescriptorSamplers, limits.maxPerStageDescriptorSampledImages, limits.maxDescriptorSetSamplers, limits.maxDescriptorSetSampledImages });
+        if (mSpecs.maxTextures > maxSamplers - RESERVED_SAMPLERS) {
+            std::println("Texture streamer capped at {} textures, the device can't sample more in one shader!", maxSamplers - RESERVED_SAMPLERS);
+            mSpecs.maxTextures = maxSamplers - RESERVED_SAMPLERS;
+        }
+        mMaterialBindings.assign(mSpecs.maxMaterials, INVALID_TEXTURE);
+        mMaterialTextures.assign(mSpecs.maxMaterials, INVALID_TEXTURE);
+        mMemoryBudget = mSpecs.memoryBudget;
+
+        const VkDeviceSize tableSize = static_cast<VkDeviceSize>(mSpecs.maxTextures) * sizeof(uint32_t);
+        mTextures.reserve(mSpecs.maxTextures);
+
+        mFeedbackBuffer = std::make_unique<VulkanBuffer>(mContext);
+        mFeedbackBuffer->CreateBuffer(tableSize, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT, VMA_MEMORY_USAGE_GPU_ONLY);
+
+        for (auto& frame : mFrames) {
+            frame.readbackBuffer = std::make_unique<VulkanBuffer>(mContext);
+            frame.readbackBuffer->CreateBuffer(tableSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT, VMA_MEMORY_USAGE_GPU_TO_CPU);
+            memset(frame.readbackBuffer->GetMappedData(), 0xFF, tableSize);
+
+            frame.residencyBuffer = std::make_unique<VulkanBuffer>(mContext);
+            frame.residencyBuffer->CreateBuffer(tableSize, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT, VMA_MEMORY_USAGE_CPU_TO_GPU);
+
+            frame.dataBuffer = std::make_unique<VulkanBuffer>(mContext);
+            frame.dataBuffer->CreateBuffer(sizeof(StreamedTextureData) + static_cast<VkDeviceSize>(mSpecs.maxMaterials) * sizeof(uint32_t),
+                VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT, VMA_MEMORY_USAGE_CPU_TO_GPU);
+        }
+
+        VkSamplerCreateInfo samplerInfo{};
+        samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+        samplerInfo.pNext = nullptr;
+        samplerInfo.magFilter = VK_FILTER_LINEAR;
+        samplerInfo.minFilter = VK_FILTER_LINEAR;
+        samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_LINEAR;
+        samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+        samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+        samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+        samplerInfo.maxLod = VK_LOD_CLAMP_NONE;
+        mSampler = mContext->GetObjectCache().GetSampler(samplerInfo);
+
+        // Only the registered textures are ever written, and the shader only indexes those
+        VkDescriptorSetLayoutBinding binding{};
+        binding.binding = 0;
+        binding.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+        binding.descriptorCount = mSpecs.maxTextures;
+        binding.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+
+        const VkDescriptorBindingFlags bindingFlags = VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT;
+        VkDescriptorSetLayoutBindingFlagsCreateInfo bindingFlagsInfo{};
+        bindingFlagsInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO;
+        bindingFlagsInfo.pNext = nullptr;
+        bindingFlagsInfo.bindingCount = 1;
+        bindingFlagsInfo.pBindingFlags = &bindingFlags;
+
+        VkDescriptorSetLayoutCreateInfo layoutInfo{};
+        layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+        layoutInfo.pNext = &bindingFlagsInfo;
+        layoutInfo.bindingCount = 1;
+        layoutInfo.pBindings = &binding;
+        mSetLayout = mContext->GetObjectCache().GetDescriptorSetLayout(layoutInfo);
+
+        VkDescriptorPoolSize poolSize{ VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, mSpecs.maxTextures * framesInFlight };
+        VkDescriptorPoolCreateInfo poolInfo{};
+        poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+        poolInfo.pNext = nullptr;
+        poolInfo.maxSets = framesInFlight;
+        poolInfo.poolSizeCount = 1;
+        poolInfo.pPoolSizes = &poolSize;
+        VK_CHECK(vkCreateDescriptorPool(device, &poolInfo, nullptr, &mDescriptorPool));
+
+        for (auto& frame : mFrames) {
+            VkDescriptorSetAllocateInfo setAllocInfo{};
+            setAllocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+            setAllocInfo.pNext = nullptr;
+            setAllocInfo.descriptorPool = mDescriptorPool;
+            setAllocInfo.descriptorSetCount = 1;
+            setAllocInfo.pSetLayouts = &mSetLayout;
+            VK_CHECK(vkAllocateDescriptorSets(device, &setAllocInfo, &frame.descriptorSet));
+            frame.writtenViews.reserve(mSpecs.maxTextures);
+        }
+    }
+
+    VulkanTextureStreamer::~VulkanTextureStreamer() {
+        mTextures.clear();
+        mFrames.clear();
+        mFeedbackBuffer.reset();
+        vkDestroyDescriptorPool(mContext->GetLogicalDevice().handle, mDescriptorPool, nullptr);
+    }
+
+    std::optional<StreamedTextureID> VulkanTextureStreamer::Register(TextureAsset&& asset) {
+        if (mRegisteredCount >= mSpecs.maxTextures) {
+            std::println("Texture streamer is full ({} textures)!", mSpecs.maxTextures);
+            return std::nullopt;
+        }
+
+        mRegistered.push_back(std::move(asset));
+        return mRegisteredCount++;
+    }
+
+    bool VulkanTextureStreamer::BindMaterial(uint32_t materialIndex, StreamedTextureID texture) {
+        if (materialIndex >= mMaterialBindings.size() || texture >= mRegisteredCount) {
+            std::println("Can't bind streamed texture {} to material {}, {} textures and {} materials exist!", texture, materialIndex, mRegisteredCount, mMaterialBindings.size());
+            return false;
+        }
+
+        mMaterialBindings[materialIndex] = texture;
+        return true;
+    }
+
+    void VulkanTextureStreamer::UnbindMaterial(uint32_t materialIndex) {
+        if (materialIndex < mMaterialBindings.size())
+            mMaterialBindings[materialIndex] = INVALID_TEXTURE;
+    }
+
+    void VulkanTextureStreamer::Capture(TextureStreamerSnapshot& snapshot) {
+        // A snapshot that was never applied still holds its registrations, they go in front of the new ones
+        for (auto& asset : mRegistered)
+            snapshot.registered.push_back(std::move(asset));
+        mRegistered.clear();
+
+        snapshot.materialTextures.assign(mMaterialBindings.begin(), mMaterialBindings.end());
+        snapshot.memoryBudget = mSpecs.memoryBudget;
+    }
+
+    void VulkanTextureStreamer::Apply(TextureStreamerSnapshot& snapshot) {
+        for (auto& asset : snapshot.registered) {
+            StreamedTexture& texture = mTextures.emplace_back(StreamedTexture{ .asset = std::move(asset), .lastRequestedFrame = mFrameNumber });
+
+            // Nothing is resident until the tail goes up
+            std::span<const TextureFormat::MipLevel> mips = texture.asset.GetMipLevels();
+            texture.residentMip = static_cast<uint32_t>(mips.size());
+            texture.tailMip = static_cast<uint32_t>(mips.size()) - 1;
+            for (uint32_t mip = 0; mip < mips.size(); mip++) {
+                if (std::max(mips[mip].width, mips[mip].height) <= mSpecs.tailMipSize) {
+                    texture.tailMip = mip;
+                    break;
+                }
+            }
+        }
+        snapshot.registered.clear();
+
+        mMaterialTextures.assign(snapshot.materialTextures.begin(), snapshot.materialTextures.end());
+        mMemoryBudget = snapshot.memoryBudget;
+    }
+
+    void VulkanTextureStreamer::BeginFrame(VulkanFrameData& frame, uint32_t frameIndex) {
+        mFrameNumber++;
+
+        // Every other step expects each texture to have an image
+        UploadTails(frame);
+        // Act on the requests prefetched last frame before reading new ones, so the file reads get a frame to complete in the background
+        UpdateResidency(frame);
+        ReadFeedback(frameIndex);
+        UpdateResidencyBuffer(frameIndex);
+        UpdateDataBuffer(frameIndex);
+        // After the residency changes above and after the defragmenter's BeginFrame, whose moves also replace views
+        UpdateDescriptorSet(frameIndex);
+
+        // The previous frame's copy out of the feedback buffer has to finish before it's cleared
+        BufferUtils::GlobalBarrier(frame.commandBuffer, VK_PIPELINE_STAGE_2_TRANSFER_BIT, VK_ACCESS_2_TRANSFER_READ_BIT, VK_PIPELINE_STAGE_2_TRANSFER_BIT, VK_ACCESS_2_TRANSFER_WRITE_BIT);
+        vkCmdFillBuffer(frame.commandBuffer, mFeedbackBuffer->GetBufferInfo().buffer, 0, VK_WHOLE_SIZE, UINT32_MAX);
+        BufferUtils::GlobalBarrier(frame.commandBuffer, VK_PIPELINE_STAGE_2_TRANSFER_BIT, VK_ACCESS_2_TRANSFER_WRITE_BIT,
+            VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_STORAGE_READ_BIT | VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT);
+    }
+
+    void VulkanTextureStreamer::EndFrame(VkCommandBuffer cmd, uint32_t frameIndex) {
+        if (mTextures.empty())
+            return;
+
+        BufferUtils::GlobalBarrier(cmd, VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT, VK_PIPELINE_STAGE_2_TRANSFER_BIT, VK_ACCESS_2_TRANSFER_READ_BIT);
+
+        VkBufferCopy copyRegion{};
+        copyRegion.size = mTextures.size() * sizeof(uint32_t);
+        vkCmdCopyBuffer(cmd, mFeedbackBuffer->GetBufferInfo().buffer, mFrames[frameIndex].readbackBuffer->GetBufferInfo().buffer, 1, &copyRegion);
+
+        BufferUtils::GlobalBarrier(cmd, VK_PIPELINE_STAGE_2_TRANSFER_BIT, VK_ACCESS_2_TRANSFER_WRITE_BIT, VK_PIPELINE_STAGE_2_HOST_BIT, VK_ACCESS_2_HOST_READ_BIT);
+    }
+
+    void VulkanTextureStreamer::UploadTails(VulkanFrameData& frame) {
+        // Tails are small and always resident, so they don't count against the per frame upload limit
+        for (auto& texture : mTextures) {
+            if (!texture.image)
+                RecordResidencyChange(frame.commandBuffer, frame.deletionQueue, texture, texture.tailMip);
+        }
+    }
+
+    void VulkanTextureStreamer::ReadFeedback(uint32_t frameIndex) {
+        VulkanBuffer& readback = *mFrames[frameIndex].readbackBuffer;
+        VK_CHECK(vmaInvalidateAllocation(mContext->GetAllocator(), readback.GetBufferInfo().allocation, 0, VK_WHOLE_SIZE));
+        const uint32_t* requests = static_cast<const uint32_t*>(readback.GetMappedData());
+
+        for (size_t i = 0; i < mTextures.size(); i++) {
+            StreamedTexture& texture = mTextures[i];
+            const uint32_t requestedMip = requests[i];
+            if (requestedMip == UINT32_MAX)
+                continue;
+
+            texture.requestedMip = requestedMip;
+            texture.lastRequestedFrame = mFrameNumber;
+
+            const uint32_t targetMip = std::min(requestedMip, texture.tailMip);
+            if (targetMip < texture.residentMip && targetMip < texture.prefetchedMip) {
+                texture.asset.PrefetchMips(targetMip, texture.residentMip - targetMip);
+                texture.prefetchedMip = targetMip;
+            }
+        }
+    }
+
+    void VulkanTextureStreamer::UpdateResidency(VulkanFrameData& frame) {
+        // Textures nobody has sampled in a while go back to their tail, which is what keeps room in the budget for the visible ones
+        for (auto& texture : mTextures) {
+            if (texture.residentMip < texture.tailMip && mFrameNumber - texture.lastRequestedFrame > mSpecs.evictAfterFrames)
+                RecordResidencyChange(frame.commandBuffer, frame.deletionQueue, texture, texture.tailMip);
+        }
+
+        std::vector<StreamedTextureID> candidates;
+        for (StreamedTextureID id = 0; id < mTextures.size(); id++) {
+            if (std::min(mTextures[id].prefetchedMip, mTextures[id].tailMip) < mTextures[id].residentMip)
+                candidates.push_back(id);
+        }
+
+        // The most starved textures go first
+        std::sort(candidates.begin(), candidates.end(), [this](StreamedTextureID a, StreamedTextureID b) {
+            return mTextures[a].residentMip - mTextures[a].prefetchedMip > mTextures[b].residentMip - mTextures[b].prefetchedMip;
+        });
+
+        VkDeviceSize uploadedBytes = 0;
+        for (StreamedTextureID id : candidates) {
+            StreamedTexture& texture = mTextures[id];
+            const VkDeviceSize residentSize = GetMipRangeSize(texture, texture.residentMip);
+
+            // Coarser mips go first if the whole request doesn't fit into this frame
+            uint32_t targetMip = std::min(texture.prefetchedMip, texture.tailMip);
+            while (targetMip < texture.residentMip && uploadedBytes + GetMipRangeSize(texture, targetMip) - residentSize > mSpecs.maxUploadBytesPerFrame)
+                targetMip++;
+
+            if (targetMip < texture.residentMip && mResidentBytes + GetMipRangeSize(texture, targetMip) - residentSize > mMemoryBudget)
+                EvictFor(frame, GetMipRangeSize(texture, targetMip) - residentSize, id);
+
+            while (targetMip < texture.residentMip && mResidentBytes + GetMipRangeSize(texture, targetMip) - residentSize > mMemoryBudget)
+                targetMip++;
+
+            if (targetMip == texture.residentMip)
+                continue;
+
+            uploadedBytes += GetMipRangeSize(texture, targetMip) - residentSize;
+            RecordResidencyChange(frame.commandBuffer, frame.deletionQueue, texture, targetMip);
+        }
+    }
+
+    void VulkanTextureStreamer::EvictFor(VulkanFrameData& frame, VkDeviceSize requiredBytes, StreamedTextureID requester) {
+        std::vector<StreamedTextureID> candidates;
+        for (StreamedTextureID id = 0; id < mTextures.size(); id++) {
+            if (id != requester && mTextures[id].residentMip < mTextures[id].tailMip)
+                candidates.push_back(id);
+        }
+
+        std::sort(candidates.begin(), candidates.end(), [this](StreamedTextureID a, StreamedTextureID b) {
+            return mTextures[a].lastRequestedFrame < mTextures[b].lastRequestedFrame;
+        });
+
+        // Mips finer than what was last requested cost nothing visible, so those go first. After that, least recently used textures drop to their tail.
+        for (StreamedTextureID id : candidates) {
+            if (mResidentBytes + requiredBytes <= mMemoryBudget)
+                return;
+
+            StreamedTexture& texture = mTextures[id];
+            const uint32_t neededMip = std::min(texture.requestedMip, texture.tailMip);
+            if (neededMip > texture.residentMip)
+                RecordResidencyChange(frame.commandBuffer, frame.deletionQueue, texture, neededMip);
+        }
+
+        for (StreamedTextureID id : candidates) {
+            if (mResidentBytes + requiredBytes <= mMemoryBudget)
+                return;
+
+            StreamedTexture& texture = mTextures[id];
+            if (texture.lastRequestedFrame < mTextures[requester].lastRequestedFrame && texture.residentMip < texture.tailMip)
+                RecordResidencyChange(frame.commandBuffer, frame.deletionQueue, texture, texture.tailMip);
+        }
+    }
+
+    void VulkanTextureStreamer::UpdateResidencyBuffer(uint32_t frameIndex) {
+        VulkanBuffer& residency = *mFrames[frameIndex].residencyBuffer;
+        uint32_t* residentMips = static_cast<uint32_t*>(residency.GetMappedData());
+        for (size_t i = 0; i < mTextures.size(); i++)
+            residentMips[i] = mTextures[i].residentMip;
+
+        VK_CHECK(vmaFlushAllocation(mContext->GetAllocator(), residency.GetBufferInfo().allocation, 0, VK_WHOLE_SIZE));
+    }
+
+    void VulkanTextureStreamer::UpdateDataBuffer(uint32_t frameIndex) {
+        VulkanBuffer& buffer = *mFrames[frameIndex].dataBuffer;
+        std::byte* mapped = static_cast<std::byte*>(buffer.GetMappedData());
+
+        StreamedTextureData data{};
+        data.feedback = mFeedbackBuffer->GetBufferInfo().deviceAddress;
+        data.residency = mFrames[frameIndex].residencyBuffer->GetBufferInfo().deviceAddress;
+        data.materials = buffer.GetBufferInfo().deviceAddress + sizeof(StreamedTextureData);
+        data.frameNumber = static_cast<uint32_t>(mFrameNumber);
+        data.materialCount = static_cast<uint32_t>(mMaterialTextures.size());
+        memcpy(mapped, &data, sizeof(data));
+        memcpy(mapped + sizeof(StreamedTextureData), mMaterialTextures.data(), mMaterialTextures.size() * sizeof(uint32_t));
+
+        VK_CHECK(vmaFlushAllocation(mContext->GetAllocator(), buffer.GetBufferInfo().allocation, 0, VK_WHOLE_SIZE));
+    }
+
+    void VulkanTextureStreamer::UpdateDescriptorSet(uint32_t frameIndex) {
+        // The set was last bound by this frame slot, whose fence has been waited on, so it can be written
+        StreamerFrame& streamerFrame = mFrames[frameIndex];
+        streamerFrame.writtenViews.resize(mTextures.size(), VK_NULL_HANDLE);
+
+        std::vector<VkDescriptorImageInfo> imageInfos;
+        std::vector<VkWriteDescriptorSet> writes;
+        imageInfos.reserve(mTextures.size());
+        for (StreamedTextureID id = 0; id < mTextures.size(); id++) {
+            const VkImageView view = mTextures[id].image->GetImageInfo().imageView;
+            if (streamerFrame.writtenViews[id] == view)
+                continue;
+
+            streamerFrame.writtenViews[id] = view;
+            imageInfos.push_back({ mSampler, view, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL });
+
+            VkWriteDescriptorSet& write = writes.emplace_back();
+            write = {};
+            write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+            write.pNext = nullptr;
+            write.dstSet = streamerFrame.descriptorSet;
+            write.dstBinding = 0;
+            write.dstArrayElement = id;
+            write.descriptorCount = 1;
+            write.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+            write.pImageInfo = &imageInfos.back();
+        }
+
+        if (!writes.empty())
+            vkUpdateDescriptorSets(mContext->GetLogicalDevice().handle, static_cast<uint32_t>(writes.size()), writes.data(), 0, nullptr);
+    }
+
+    void VulkanTextureStreamer::RecordResidencyChange(VkCommandBuffer cmd, VulkanUtils::DeletionQueue& deletionQueue, StreamedTexture& texture, uint32_t residentMip) {
+        std::span<const TextureFormat::MipLevel> mips = texture.asset.GetMipLevels();
+        const uint32_t sourceMipCount = static_cast<uint32_t>(mips.size());
+        const uint32_t oldResidentMip = texture.residentMip;
+        std::shared_ptr<VulkanImage2D> oldImage = texture.image;
+
+        VkExtent3D extent = { mips[residentMip].width, mips[residentMip].height, 1 };
+        VkFormat format = ImageUtils::GetTextureFormat(texture.asset.GetFormat(), texture.asset.IsSRGB());
+        const VkImageUsageFlags usage = VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+        VmaAllocationCreateInfo allocInfo = mDefragmenter.GetAllocationCreateInfo(format, usage);
+
+        std::shared_ptr<VulkanImage2D> image = std::make_shared<VulkanImage2D>(mContext);
+        image->CreateImage(format, usage, extent, VK_IMAGE_ASPECT_COLOR_BIT, allocInfo, sourceMipCount - residentMip);
+        image->SetResidentMip(residentMip);
+
+        ImageUtils::TransitionImage(cmd, image->GetImageInfo().image, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
+
+        // Mips both images have are already on the GPU
+        if (oldImage) {
+            std::vector<VkImageCopy> copyRegions;
+            for (uint32_t mip = std::max(residentMip, oldResidentMip); mip < sourceMipCount; mip++) {
+                VkImageCopy& copyRegion = copyRegions.emplace_back();
+                copyRegion = {};
+                copyRegion.srcSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, mip - oldResidentMip, 0, 1 };
+                copyRegion.dstSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, mip - residentMip, 0, 1 };
+                copyRegion.extent = { mips[mip].width, mips[mip].height, 1 };
+            }
+
+            ImageUtils::TransitionImage(cmd, oldImage->GetImageInfo().image, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL);
+            vkCmdCopyImage(cmd, oldImage->GetImageInfo().image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, image->GetImageInfo().image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, static_cast<uint32_t>(copyRegions.size()), copyRegions.data());
+
+            // Frames still in flight may sample the old image, it goes once this frame's fence has been waited on. Dropping the last
+            // reference releases it, a defragmentation pass may still be holding on to it.
+            deletionQueue.PushDeleteFunc([oldImage]() mutable { oldImage.reset(); });
+        }
+
+        // Finer mips come straight out of the mapped file
+        const uint32_t uploadEnd = std::min(oldResidentMip, sourceMipCount);
+        if (residentMip < uploadEnd) {
+            std::span<const std::byte> data = texture.asset.GetMipRangeData(residentMip, uploadEnd - residentMip);
+            std::shared_ptr<VulkanBuffer> staging = std::make_shared<VulkanBuffer>(mContext);
+            staging->CreateBuffer(data.size(), VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VMA_MEMORY_USAGE_CPU_ONLY);
+            memcpy(staging->GetMappedData(), data.data(), data.size());
+
+            std::vector<VkBufferImageCopy> copyRegions;
+            for (uint32_t mip = residentMip; mip < uploadEnd; mip++) {
+                VkBufferImageCopy& copyRegion = copyRegions.emplace_back();
+                copyRegion = {};
+                copyRegion.bufferOffset = mips[mip].offset - mips[residentMip].offset;
+                copyRegion.imageSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, mip - residentMip, 0, 1 };
+                copyRegion.imageExtent = { mips[mip].width, mips[mip].height, 1 };
+            }
+
+            vkCmdCopyBufferToImage(cmd, staging->GetBufferInfo().buffer, image->GetImageInfo().image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, static_cast<uint32_t>(copyRegions.size()), copyRegions.data());
+            deletionQueue.PushDeleteFunc([staging]() { staging->Release(); });
+        }
+
+        ImageUtils::TransitionImage(cmd, image->GetImageInfo().image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+
+        mResidentBytes += GetMipRangeSize(texture, residentMip);
+        if (oldImage)
+            mResidentBytes -= GetMipRangeSize(texture, oldResidentMip);
+
+        // Evicted mips have to be requested and prefetched again before they come back
+        if (residentMip > oldResidentMip)
+            texture.prefetchedMip = UINT32_MAX;
+
+        mDefragmenter.Register(image);
+        texture.image = image;
+        texture.residentMip = residentMip;
+    }
+
+    VkDeviceSize VulkanTextureStreamer::GetMipRangeSize(const StreamedTexture& texture, uint32_t firstMip) const {
+        VkDeviceSize size = 0;
+        std::span<const TextureFormat::MipLevel> mips = texture.asset.GetMipLevels();
+        for (uint32_t mip = firstMip; mip < mips.size(); mip++)
+            size += mips[mip].size;
+        return size;
+    }
+
+}
@@ -0,0 +1,630 @@
+#include <Vulkan/VulkanVirtualTextureCache.h>
+
+#include <algorithm>
+#include <bit>
+#include <cstring>
+#include <print>
+
+namespace VKRE {
+
+    namespace {
+
+        constexpr uint32_t INVALID_SLOT = UINT32_MAX;
+        constexpr uint32_t INVALID_TILE = UINT32_MAX;
+        constexpr uint32_t INVALID_TEXTURE = UINT32_MAX; // Same as INVALID_VIRTUAL_TEXTURE in VirtualTexturing.glsl
+
+        // Tiles are packed the same way in the feedback buffer, see PackVirtualTile in VirtualTexturing.glsl
+        constexpr uint32_t PAGE_BITS = 10;
+        constexpr uint32_t MIP_BITS = 4;
+        constexpr uint32_t TEXTURE_BITS = 8;
+        // Page table entries hold the cache slot's column and row and the mip its tile is of
+        constexpr uint32_t SLOT_BITS = 12;
+
+        struct TileAddress {
+            uint32_t texture;
+            uint32_t mip;
+            uint32_t x;
+            uint32_t y;
+        };
+
+        uint32_t PackTile(uint32_t texture, uint32_t mip, uint32_t x, uint32_t y) {
+            return x | (y << PAGE_BITS) | (mip << (2 * PAGE_BITS)) | (texture << (2 * PAGE_BITS + MIP_BITS));
+        }
+
+        TileAddress UnpackTile(uint32_t tile) {
+            constexpr uint32_t pageMask = (1u << PAGE_BITS) - 1;
+            return {
+                tile >> (2 * PAGE_BITS + MIP_BITS),
+                (tile >> (2 * PAGE_BITS)) & ((1u << MIP_BITS) - 1),
+                tile & pageMask,
+                (tile >> PAGE_BITS) & pageMask
+            };
+        }
+
+        uint32_t PackPageEntry(uint32_t slotX, uint32_t slotY, uint32_t mip) {
+            return slotX | (slotY << SLOT_BITS) | (mip << (2 * SLOT_BITS));
+        }
+
+        uint32_t GetBlockDimension(TextureFormat::PixelFormat format) {
+            return TextureFormat::IsBlockCompressed(format) ? 4 : 1;
+        }
+
+        [[noreturn]] void InvalidSpecs(const char* reason) {
+            std::println("Invalid virtual texture specs: {}!", reason);
+            abort();
+        }
+
+    }
+
+    VulkanVirtualTextureCache::VulkanVirtualTextureCache(std::shared_ptr<VulkanContext> context, VulkanImmediateSubmit& immediateSubmit, JobSystem& jobSystem, uint32_t framesInFlight, const VirtualTextureSpecs& specs)
+        :mContext(context), mImmediateSubmit(immediateSubmit), mJobSystem(jobSystem), mSpecs(specs), mLoadSlots(specs.maxPendingLoads), mFrames(framesInFlight) {
+        VkDevice device = mContext->GetLogicalDevice().handle;
+
+        if (!std::has_single_bit(mSpecs.tileSize) || mSpecs.tileSize < 4)
+            InvalidSpecs("the tile size has to be a power of two of at least 4");
+        if (mSpecs.tileBorder % 4 != 0 || mSpecs.tileBorder >= mSpecs.tileSize)
+            InvalidSpecs("the tile border has to be a multiple of 4 smaller than a tile");
+        if (!std::has_single_bit(mSpecs.maxVirtualSize) || mSpecs.maxVirtualSize < mSpecs.tileSize || mSpecs.maxVirtualSize / mSpecs.tileSize > (1u << PAGE_BITS))
+            InvalidSpecs("the largest virtual texture has to be a power of two between one and 1024 tiles wide");
+        if (mSpecs.cacheTilesPerSide == 0 || mSpecs.cacheTilesPerSide > (1u << SLOT_BITS))
+            InvalidSpecs("the cache can't be more than 4096 tiles wide");
+        // A single layer would make the page table's view a plain 2D image
+        mSpecs.maxTextures = std::clamp(mSpecs.maxTextures, 2u, 1u << TEXTURE_BITS);
+        // Pinned tails can then never fill the cache, which is what lets BeginFrame upload every new tail without failing
+        if (mSpecs.cacheTilesPerSide * mSpecs.cacheTilesPerSide <= mSpecs.maxTextures)
+            InvalidSpecs("the cache needs more tiles than there can be textures");
+        mTextures.reserve(mSpecs.maxTextures);
+        mMaterialBindings.assign(mSpecs.maxMaterials, INVALID_TEXTURE);
+        mMaterialTextures.assign(mSpecs.maxMaterials, INVALID_TEXTURE);
+
+        mPaddedTileSize = mSpecs.tileSize + 2 * mSpecs.tileBorder;
+        mPageTableSize = mSpecs.maxVirtualSize / mSpecs.tileSize;
+        mTileBytes = TextureFormat::GetMipSize(mSpecs.format, mPaddedTileSize, mPaddedTileSize);
+
+        VmaAllocationCreateInfo allocInfo = {};
+        allocInfo.usage = VMA_MEMORY_USAGE_GPU_ONLY;
+        allocInfo.requiredFlags = VkMemoryPropertyFlags(VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+
+        const uint32_t cacheSize = mSpecs.cacheTilesPerSide * mPaddedTileSize;
+        mCache = std::make_unique<VulkanImage2D>(mContext);
+        mCache->CreateImage(ImageUtils::GetTextureFormat(mSpecs.format, mSpecs.srgb), VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT, { cacheSize, cacheSize, 1 }, VK_IMAGE_ASPECT_COLOR_BIT, allocInfo);
+
+        // A texture's mips down to its tail never have more pages than the page table's mip of the same level has texels
+        mPageTable = std::make_unique<VulkanImage2D>(mContext);
+        mPageTable->CreateImage(VK_FORMAT_R32_UINT, VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT, { mPageTableSize, mPageTableSize, 1 }, VK_IMAGE_ASPECT_COLOR_BIT, allocInfo,
+            TextureFormat::GetMaxMipCount(mPageTableSize, mPageTableSize), mSpecs.maxTextures);
+
+        mImmediateSubmit.Submit([&](VkCommandBuffer cmd) {
+            ImageUtils::TransitionImage(cmd, mCache->GetImageInfo().image, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+            ImageUtils::TransitionImage(cmd, mPageTable->GetImageInfo().image, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+        });
+
+        mCacheSlots.resize(mSpecs.cacheTilesPerSide * mSpecs.cacheTilesPerSide, CacheSlot{ .tile = INVALID_TILE });
+        mFreeSlots.reserve(mCacheSlots.size());
+        for (uint32_t slot = static_cast<uint32_t>(mCacheSlots.size()); slot > 0; slot--)
+            mFreeSlots.push_back(slot - 1);
+
+        mLoadBuffer = std::make_unique<VulkanBuffer>(mContext);
+        mLoadBuffer->CreateBuffer(mTileBytes * mLoadSlots.size(), VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VMA_MEMORY_USAGE_CPU_ONLY);
+
+        const VkDeviceSize feedbackSize = (1 + static_cast<VkDeviceSize>(mSpecs.maxFeedbackRequests)) * sizeof(uint32_t);
+        mFeedbackBuffer = std::make_unique<VulkanBuffer>(mContext);
+        mFeedbackBuffer->CreateBuffer(feedbackSize, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT, VMA_MEMORY_USAGE_GPU_ONLY);
+
+        const VkDeviceSize dataSize = sizeof(VirtualTextureData) + static_cast<VkDeviceSize>(mSpecs.maxTextures) * sizeof(GPUVirtualTexture)
+            + static_cast<VkDeviceSize>(mSpecs.maxMaterials) * sizeof(uint32_t);
+        for (auto& frame : mFrames) {
+            frame.readbackBuffer = std::make_unique<VulkanBuffer>(mContext);
+            frame.readbackBuffer->CreateBuffer(feedbackSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT, VMA_MEMORY_USAGE_GPU_TO_CPU);
+            memset(frame.readbackBuffer->GetMappedData(), 0, feedbackSize);
+
+            frame.dataBuffer = std::make_unique<VulkanBuffer>(mContext);
+            frame.dataBuffer->CreateBuffer(dataSize, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT, VMA_MEMORY_USAGE_CPU_TO_GPU);
+        }
+
+        VkSamplerCreateInfo samplerInfo{};
+        samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+        samplerInfo.pNext = nullptr;
+        samplerInfo.magFilter = VK_FILTER_LINEAR;
+        samplerInfo.minFilter = VK_FILTER_LINEAR;
+        samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+        samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+        samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+        samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+        samplerInfo.maxLod = 0.0f;
+        mCacheSampler = mContext->GetObjectCache().GetSampler(samplerInfo);
+
+        // Only ever read with texelFetch, which ignores the LOD clamp, but an integer format still needs a sampler that doesn't filter
+        samplerInfo.magFilter = VK_FILTER_NEAREST;
+        samplerInfo.minFilter = VK_FILTER_NEAREST;
+        mPageTableSampler = mContext->GetObjectCache().GetSampler(samplerInfo);
+
+        VkDescriptorSetLayoutBinding bindings[2] = {};
+        for (uint32_t i = 0; i < 2; i++) {
+            bindings[i].binding = i;
+            bindings[i].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+            bindings[i].descriptorCount = 1;
+            bindings[i].stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+        }
+
+        VkDescriptorSetLayoutCreateInfo layoutInfo{};
+        layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+        layoutInfo.pNext = nullptr;
+        layoutInfo.bindingCount = 2;
+        layoutInfo.pBindings = bindings;
+        mSetLayout = mContext->GetObjectCache().GetDescriptorSetLayout(layoutInfo);
+
+        VkDescriptorPoolSize poolSize{ VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 2 };
+        VkDescriptorPoolCreateInfo poolInfo{};
+        poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+        poolInfo.pNext = nullptr;
+        poolInfo.maxSets = 1;
+        poolInfo.poolSizeCount = 1;
+        poolInfo.pPoolSizes = &poolSize;
+        VK_CHECK(vkCreateDescriptorPool(device, &poolInfo, nullptr, &mDescriptorPool));
+
+        VkDescriptorSetAllocateInfo setAllocInfo{};
+        setAllocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+        setAllocInfo.pNext = nullptr;
+        setAllocInfo.descriptorPool = mDescriptorPool;
+        setAllocInfo.descriptorSetCount = 1;
+        setAllocInfo.pSetLayouts = &mSetLayout;
+        VK_CHECK(vkAllocateDescriptorSets(device, &setAllocInfo, &mDescriptorSet));
+
+        VkDescriptorImageInfo imageInfos[2] = {};
+        imageInfos[0].sampler = mCacheSampler;
+        imageInfos[0].imageView = mCache->GetImageInfo().imageView;
+        imageInfos[0].imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+        imageInfos[1].sampler = mPageTableSampler;
+        imageInfos[1].imageView = mPageTable->GetImageInfo().imageView;
+        imageInfos[1].imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+
+        VkWriteDescriptorSet write{};
+        write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        write.pNext = nullptr;
+        write.dstSet = mDescriptorSet;
+        write.dstBinding = 0;
+        write.descriptorCount = 2;
+        write.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+        write.pImageInfo = imageInfos;
+        vkUpdateDescriptorSets(device, 1, &write, 0, nullptr);
+    }
+
+    VulkanVirtualTextureCache::~VulkanVirtualTextureCache() {
+        // The loads write into the load buffer and read the textures' mapped files
+        uint32_t outstanding = mOutstandingLoads.load(std::memory_order_acquire);
+        while (outstanding != 0) {
+            mOutstandingLoads.wait(outstanding, std::memory_order_acquire);
+            outstanding = mOutstandingLoads.load(std::memory_order_acquire);
+        }
+
+        mFrames.clear();
+        mFeedbackBuffer.reset();
+        mLoadBuffer.reset();
+        mCache.reset();
+        mPageTable.reset();
+        vkDestroyDescriptorPool(mContext->GetLogicalDevice().handle, mDescriptorPool, nullptr);
+    }
+
+    std::optional<VirtualTextureID> VulkanVirtualTextureCache::Register(TextureAsset&& asset) {
+        if (mRegisteredCount >= mSpecs.maxTextures) {
+            std::println("Virtual texture cache is full ({} textures)!", mSpecs.maxTextures);
+            return std::nullopt;
+        }
+        if (asset.GetFormat() != mSpecs.format || asset.IsSRGB() != mSpecs.srgb) {
+            std::println("Virtual textures have to be cooked in the cache's format!");
+            return std::nullopt;
+        }
+        if (std::max(asset.GetWidth(), asset.GetHeight()) > mSpecs.maxVirtualSize) {
+            std::println("Virtual texture is {}x{}, larger than the {} the page table is made for!", asset.GetWidth(), asset.GetHeight(), mSpecs.maxVirtualSize);
+            return std::nullopt;
+        }
+
+        std::span<const TextureFormat::MipLevel> mips = asset.GetMipLevels();
+        if (std::none_of(mips.begin(), mips.end(), [this](const TextureFormat::MipLevel& mip) { return std::max(mip.width, mip.height) <= mSpecs.tileSize; })) {
+            std::println("Virtual textures need their mips down to one that fits into a tile ({} texels)!", mSpecs.tileSize);
+            return std::nullopt;
+        }
+
+        mRegistered.push_back(std::move(asset));
+        return mRegisteredCount++;
+    }
+
+    bool VulkanVirtualTextureCache::BindMaterial(uint32_t materialIndex, VirtualTextureID texture) {
+        if (materialIndex >= mMaterialBindings.size() || texture >= mRegisteredCount) {
+            std::println("Can't bind virtual texture {} to material {}, {} textures and {} materials exist!", texture, materialIndex, mRegisteredCount, mMaterialBindings.size());
+            return false;
+        }
+
+        mMaterialBindings[materialIndex] = texture;
+        return true;
+    }
+
+    void VulkanVirtualTextureCache::UnbindMaterial(uint32_t materialIndex) {
+        if (materialIndex < mMaterialBindings.size())
+            mMaterialBindings[materialIndex] = INVALID_TEXTURE;
+    }
+
+    void VulkanVirtualTextureCache::Capture(VirtualTextureSnapshot& snapshot) {
+        // A snapshot that was never applied still holds its registrations, they go in front of the new ones
+        for (auto& asset : mRegistered)
+            snapshot.registered.push_back(std::move(asset));
+        mRegistered.clear();
+
+        snapshot.materialTextures.assign(mMaterialBindings.begin(), mMaterialBindings.end());
+    }
+
+    void VulkanVirtualTextureCache::Apply(VirtualTextureSnapshot& snapshot) {
+        for (auto& asset : snapshot.registered) {
+            VirtualTexture& texture = mTextures.emplace_back(VirtualTexture{ .asset = std::move(asset) });
+
+            // Register made sure there is a tail
+            std::span<const TextureFormat::MipLevel> mips = texture.asset.GetMipLevels();
+            auto tail = std::find_if(mips.begin(), mips.end(), [this](const TextureFormat::MipLevel& mip) { return std::max(mip.width, mip.height) <= mSpecs.tileSize; });
+            texture.tailMip = static_cast<uint32_t>(tail - mips.begin());
+
+            uint32_t pageCount = 0;
+            for (uint32_t mip = 0; mip <= texture.tailMip; mip++) {
+                VirtualMip& virtualMip = texture.mips.emplace_back();
+                virtualMip.pagesX = (mips[mip].width + mSpecs.tileSize - 1) / mSpecs.tileSize;
+                virtualMip.pagesY = (mips[mip].height + mSpecs.tileSize - 1) / mSpecs.tileSize;
+                virtualMip.firstPage = pageCount;
+                pageCount += virtualMip.pagesX * virtualMip.pagesY;
+            }
+            texture.pageSlots.assign(pageCount, INVALID_SLOT);
+        }
+        snapshot.registered.clear();
+
+        mMaterialTextures.assign(snapshot.materialTextures.begin(), snapshot.materialTextures.end());
+    }
+
+    void VulkanVirtualTextureCache::BeginFrame(VulkanFrameData& frame, uint32_t frameIndex) {
+        mFrameNumber++;
+
+        // Everything below expects every page to resolve to at least the tail
+        UploadTails(frame);
+
+        // No material can be bound yet, so nothing samples and nothing writes feedback. The material table still has to be there.
+        if (mTextures.empty()) {
+            UpdateDataBuffer(frameIndex);
+            return;
+        }
+
+        // Their copies into the cache have finished
+        for (LoadSlot& slot : mLoadSlots) {
+            if (slot.state.load(std::memory_order_relaxed) == LoadState::UPLOADING && slot.frameIndex == frameIndex)
+                slot.state.store(LoadState::FREE, std::memory_order_relaxed);
+        }
+
+        // The feedback marks what this frame still needs before anything is evicted for the tiles that finished loading
+        ReadFeedback(frameIndex);
+        UploadLoadedTiles(frame.commandBuffer, frameIndex);
+        UploadPageTables(frame);
+        UpdateDataBuffer(frameIndex);
+
+        // The previous frame's copy out of the feedback buffer has to finish before its count is cleared
+        BufferUtils::GlobalBarrier(frame.commandBuffer, VK_PIPELINE_STAGE_2_TRANSFER_BIT, VK_ACCESS_2_TRANSFER_READ_BIT, VK_PIPELINE_STAGE_2_TRANSFER_BIT, VK_ACCESS_2_TRANSFER_WRITE_BIT);
+        vkCmdFillBuffer(frame.commandBuffer, mFeedbackBuffer->GetBufferInfo().buffer, 0, sizeof(uint32_t), 0);
+        BufferUtils::GlobalBarrier(frame.commandBuffer, VK_PIPELINE_STAGE_2_TRANSFER_BIT, VK_ACCESS_2_TRANSFER_WRITE_BIT,
+            VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_STORAGE_READ_BIT | VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT);
+    }
+
+    void VulkanVirtualTextureCache::EndFrame(VkCommandBuffer cmd, uint32_t frameIndex) {
+        if (mTextures.empty())
+            return;
+
+        BufferUtils::GlobalBarrier(cmd, VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT, VK_PIPELINE_STAGE_2_TRANSFER_BIT, VK_ACCESS_2_TRANSFER_READ_BIT);
+
+        VkBufferCopy copyRegion{};
+        copyRegion.size = mFeedbackBuffer->GetBufferInfo().size;
+        vkCmdCopyBuffer(cmd, mFeedbackBuffer->GetBufferInfo().buffer, mFrames[frameIndex].readbackBuffer->GetBufferInfo().buffer, 1, &copyRegion);
+
+        BufferUtils::GlobalBarrier(cmd, VK_PIPELINE_STAGE_2_TRANSFER_BIT, VK_ACCESS_2_TRANSFER_WRITE_BIT, VK_PIPELINE_STAGE_2_HOST_BIT, VK_ACCESS_2_HOST_READ_BIT);
+    }
+
+    void VulkanVirtualTextureCache::UploadTails(VulkanFrameData& frame) {
+        std::vector<VirtualTextureID> pending;
+        for (VirtualTextureID id = 0; id < mTextures.size(); id++) {
+            if (mTextures[id].tailPending)
+                pending.push_back(id);
+        }
+        if (pending.empty())
+            return;
+
+        std::shared_ptr<VulkanBuffer> staging = std::make_shared<VulkanBuffer>(mContext);
+        staging->CreateBuffer(pending.size() * mTileBytes, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VMA_MEMORY_USAGE_CPU_ONLY);
+        std::byte* tiles = static_cast<std::byte*>(staging->GetMappedData());
+
+        std::vector<VkBufferImageCopy> copyRegions;
+        for (VirtualTextureID id : pending) {
+            // Nothing has been touched this frame yet and the constructor leaves more slots than there can be pinned tails
+            std::optional<uint32_t> slot = AcquireCacheSlot();
+            if (!slot.has_value()) {
+                std::println("Virtual texture cache has no room left for a tail!");
+                abort();
+            }
+
+            // The tail is a single tile, it's what every page falls back to, so it's never evicted
+            VirtualTexture& texture = mTextures[id];
+            const uint32_t tile = PackTile(id, texture.tailMip, 0, 0);
+            mCacheSlots[slot.value()] = CacheSlot{ .tile = tile, .lastUsedFrame = mFrameNumber, .pinned = true };
+            GetPageSlot(tile) = slot.value();
+            texture.tailPending = false;
+            texture.dirty = true;
+
+            const VkDeviceSize offset = copyRegions.size() * mTileBytes;
+            ExtractTile(tile, tiles + offset);
+            copyRegions.push_back(GetTileCopy(slot.value(), offset));
+        }
+
+        // Frames still in flight may sample a slot that was just evicted for a tail, the transition orders the copies after them
+        VkImage cache = mCache->GetImageInfo().image;
+        ImageUtils::TransitionImage(frame.commandBuffer, cache, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
+        vkCmdCopyBufferToImage(frame.commandBuffer, staging->GetBufferInfo().buffer, cache, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, static_cast<uint32_t>(copyRegions.size()), copyRegions.data());
+        ImageUtils::TransitionImage(frame.commandBuffer, cache, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+        frame.deletionQueue.PushDeleteFunc([staging]() { staging->Release(); });
+    }
+
+    void VulkanVirtualTextureCache::ReadFeedback(uint32_t frameIndex) {
+        VulkanBuffer& readback = *mFrames[frameIndex].readbackBuffer;
+        VK_CHECK(vmaInvalidateAllocation(mContext->GetAllocator(), readback.GetBufferInfo().allocation, 0, VK_WHOLE_SIZE));
+        const uint32_t* feedback = static_cast<const uint32_t*>(readback.GetMappedData());
+
+        // Neighbouring pixels mostly want the same tiles
+        const uint32_t count = std::min(feedback[0], mSpecs.maxFeedbackRequests);
+        std::vector<uint32_t> requests(feedback + 1, feedback + 1 + count);
+        std::sort(requests.begin(), requests.end());
+        requests.erase(std::unique(requests.begin(), requests.end()), requests.end());
+
+        std::vector<uint32_t> missing;
+        for (uint32_t request : requests) {
+            const TileAddress address = UnpackTile(request);
+            if (address.texture >= mTextures.size())
+                continue;
+            const VirtualTexture& texture = mTextures[address.texture];
+            if (address.mip > texture.tailMip || address.x >= texture.mips[address.mip].pagesX || address.y >= texture.mips[address.mip].pagesY)
+                continue;
+
+            // Until the page arrives its nearest resident ancestor is what's sampled, so the whole chain counts as used
+            for (uint32_t mip = address.mip; mip <= texture.tailMip; mip++) {
+                const uint32_t slot = texture.pageSlots[GetAncestorPage(texture, address.mip, address.x, address.y, mip)];
+                if (slot != INVALID_SLOT)
+                    Touch(slot);
+            }
+
+            if (GetPageSlot(request) == INVALID_SLOT && !mPendingTiles.contains(request))
+                missing.push_back(request);
+        }
+
+        // Coarser tiles go first, each covers more of what's missing and the finer ones fall back to it
+        std::stable_sort(missing.begin(), missing.end(), [](uint32_t a, uint32_t b) { return UnpackTile(a).mip > UnpackTile(b).mip; });
+
+        auto loadSlot = mLoadSlots.begin();
+        for (uint32_t tile : missing) {
+            loadSlot = std::find_if(loadSlot, mLoadSlots.end(), [](const LoadSlot& slot) { return slot.state.load(std::memory_order_acquire) == LoadState::FREE; });
+            if (loadSlot == mLoadSlots.end())
+                break;
+            StartLoad(*loadSlot, tile);
+        }
+    }
+
+    void VulkanVirtualTextureCache::StartLoad(LoadSlot& slot, uint32_t tile) {
+        slot.tile = tile;
+        slot.state.store(LoadState::LOADING, std::memory_order_relaxed);
+        mPendingTiles.insert(tile);
+        mOutstandingLoads.fetch_add(1, std::memory_order_relaxed);
+
+        const VkDeviceSize offset = static_cast<VkDeviceSize>(&slot - mLoadSlots.data()) * mTileBytes;
+        std::byte* destination = static_cast<std::byte*>(mLoadBuffer->GetMappedData()) + offset;
+        mJobSystem.Submit([this, &slot, tile, destination]() {
+            // Reading the mapped file is what takes the time, its pages fault in on the worker instead of the render thread
+            ExtractTile(tile, destination);
+            slot.state.store(LoadState::LOADED, std::memory_order_release);
+            if (mOutstandingLoads.fetch_sub(1, std::memory_order_acq_rel) == 1)
+                mOutstandingLoads.notify_all();
+        }, mSpecs.loadPriority);
+    }
+
+    void VulkanVirtualTextureCache::UploadLoadedTiles(VkCommandBuffer cmd, uint32_t frameIndex) {
+        std::vector<VkBufferImageCopy> copyRegions;
+        for (uint32_t i = 0; i < mLoadSlots.size() && copyRegions.size() < mSpecs.maxUploadsPerFrame; i++) {
+            LoadSlot& load = mLoadSlots[i];
+            if (load.state.load(std::memory_order_acquire) != LoadState::LOADED)
+                continue;
+
+            // Loaded tiles wait in their load slot until something can be evicted for them
+            std::optional<uint32_t> slot = AcquireCacheSlot();
+            if (!slot.has_value())
+                break;
+
+            CacheSlot& cacheSlot = mCacheSlots[slot.value()];
+            cacheSlot.tile = load.tile;
+            cacheSlot.lastUsedFrame = mFrameNumber;
+            cacheSlot.pinned = false;
+            cacheSlot.lru = mLru.insert(mLru.end(), slot.value());
+
+            GetPageSlot(load.tile) = slot.value();
+            mTextures[UnpackTile(load.tile).texture].dirty = true;
+            mPendingTiles.erase(load.tile);
+
+            copyRegions.push_back(GetTileCopy(slot.value(), i * mTileBytes));
+            load.frameIndex = frameIndex;
+            load.state.store(LoadState::UPLOADING, std::memory_order_relaxed);
+        }
+
+        if (copyRegions.empty())
+            return;
+
+        // Frames still in flight may sample the slots being overwritten, the barrier orders the copies after them. Until the page
+        // tables are updated further down they see the tile's ancestor, or a tile that's only just been evicted.
+        VkImage cache = mCache->GetImageInfo().image;
+        ImageUtils::TransitionImage(cmd, cache, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
+        vkCmdCopyBufferToImage(cmd, mLoadBuffer->GetBufferInfo().buffer, cache, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, static_cast<uint32_t>(copyRegions.size()), copyRegions.data());
+        ImageUtils::TransitionImage(cmd, cache, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+    }
+
+    void VulkanVirtualTextureCache::UploadPageTables(VulkanFrameData& frame) {
+        size_t entryCount = 0;
+        for (const VirtualTexture& texture : mTextures) {
+            if (texture.dirty)
+                entryCount += texture.pageSlots.size();
+        }
+        if (entryCount == 0)
+            return;
+
+        std::shared_ptr<VulkanBuffer> staging = std::make_shared<VulkanBuffer>(mContext);
+        staging->CreateBuffer(entryCount * sizeof(uint32_t), VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VMA_MEMORY_USAGE_CPU_ONLY);
+        uint32_t* entries = static_cast<uint32_t*>(staging->GetMappedData());
+
+        std::vector<VkBufferImageCopy> copyRegions;
+        size_t offset = 0;
+        for (VirtualTextureID id = 0; id < mTextures.size(); id++) {
+            VirtualTexture& texture = mTextures[id];
+            if (!texture.dirty)
+                continue;
+
+            // A page that isn't resident takes the entry of its nearest resident ancestor. The tail always is, so every search ends.
+            for (uint32_t mip = 0; mip <= texture.tailMip; mip++) {
+                const VirtualMip& virtualMip = texture.mips[mip];
+                for (uint32_t y = 0; y < virtualMip.pagesY; y++) {
+                    for (uint32_t x = 0; x < virtualMip.pagesX; x++) {
+                        uint32_t residentMip = mip;
+                        uint32_t slot = texture.pageSlots[GetAncestorPage(texture, mip, x, y, residentMip)];
+                        while (slot == INVALID_SLOT)
+                            slot = texture.pageSlots[GetAncestorPage(texture, mip, x, y, ++residentMip)];
+                        entries[offset + virtualMip.firstPage + y * virtualMip.pagesX + x] = PackPageEntry(slot % mSpecs.cacheTilesPerSide, slot / mSpecs.cacheTilesPerSide, residentMip);
+                    }
+                }
+
+                VkBufferImageCopy& copyRegion = copyRegions.emplace_back();
+                copyRegion = {};
+                copyRegion.bufferOffset = (offset + virtualMip.firstPage) * sizeof(uint32_t);
+                copyRegion.imageSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, mip, id, 1 };
+                copyRegion.imageExtent = { virtualMip.pagesX, virtualMip.pagesY, 1 };
+            }
+
+            offset += texture.pageSlots.size();
+            texture.dirty = false;
+        }
+
+        VkImage pageTable = mPageTable->GetImageInfo().image;
+        ImageUtils::TransitionImage(frame.commandBuffer, pageTable, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
+        vkCmdCopyBufferToImage(frame.commandBuffer, staging->GetBufferInfo().buffer, pageTable, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, static_cast<uint32_t>(copyRegions.size()), copyRegions.data());
+        ImageUtils::TransitionImage(frame.commandBuffer, pageTable, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+        frame.deletionQueue.PushDeleteFunc([staging]() { staging->Release(); });
+    }
+
+    void VulkanVirtualTextureCache::UpdateDataBuffer(uint32_t frameIndex) {
+        VulkanBuffer& buffer = *mFrames[frameIndex].dataBuffer;
+
+        const VkDeviceSize materialsOffset = sizeof(VirtualTextureData) + static_cast<VkDeviceSize>(mSpecs.maxTextures) * sizeof(GPUVirtualTexture);
+        std::byte* mapped = static_cast<std::byte*>(buffer.GetMappedData());
+
+        VirtualTextureData data{};
+        data.feedback = mFeedbackBuffer->GetBufferInfo().deviceAddress;
+        data.materials = buffer.GetBufferInfo().deviceAddress + materialsOffset;
+        data.feedbackCapacity = mSpecs.maxFeedbackRequests;
+        data.tileSize = mSpecs.tileSize;
+        data.tileBorder = mSpecs.tileBorder;
+        data.paddedTileSize = mPaddedTileSize;
+        data.cacheSize = mSpecs.cacheTilesPerSide * mPaddedTileSize;
+        data.textureCount = static_cast<uint32_t>(mTextures.size());
+        data.frameNumber = static_cast<uint32_t>(mFrameNumber);
+        data.materialCount = static_cast<uint32_t>(mMaterialTextures.size());
+        memcpy(mapped, &data, sizeof(data));
+
+        GPUVirtualTexture* textures = reinterpret_cast<GPUVirtualTexture*>(mapped + sizeof(VirtualTextureData));
+        for (size_t i = 0; i < mTextures.size(); i++)
+            textures[i] = { mTextures[i].asset.GetWidth(), mTextures[i].asset.GetHeight(), mTextures[i].tailMip, 0 };
+        memcpy(mapped + materialsOffset, mMaterialTextures.data(), mMaterialTextures.size() * sizeof(uint32_t));
+
+        VK_CHECK(vmaFlushAllocation(mContext->GetAllocator(), buffer.GetBufferInfo().allocation, 0, VK_WHOLE_SIZE));
+    }
+
+    std::optional<uint32_t> VulkanVirtualTextureCache::AcquireCacheSlot() {
+        if (!mFreeSlots.empty()) {
+            const uint32_t slot = mFreeSlots.back();
+            mFreeSlots.pop_back();
+            return slot;
+        }
+
+        // The cache is too small for what's on screen once even its least recently used tile was asked for this frame
+        if (mLru.empty() || mCacheSlots[mLru.front()].lastUsedFrame >= mFrameNumber)
+            return std::nullopt;
+
+        const uint32_t slot = mLru.front();
+        Evict(slot);
+        return slot;
+    }
+
+    void VulkanVirtualTextureCache::Evict(uint32_t slot) {
+        CacheSlot& cacheSlot = mCacheSlots[slot];
+        GetPageSlot(cacheSlot.tile) = INVALID_SLOT;
+        mTextures[UnpackTile(cacheSlot.tile).texture].dirty = true;
+        mLru.erase(cacheSlot.lru);
+        cacheSlot.tile = INVALID_TILE;
+    }
+
+    void VulkanVirtualTextureCache::Touch(uint32_t slot) {
+        CacheSlot& cacheSlot = mCacheSlots[slot];
+        if (cacheSlot.pinned)
+            return;
+
+        cacheSlot.lastUsedFrame = mFrameNumber;
+        mLru.splice(mLru.end(), mLru, cacheSlot.lru);
+    }
+
+    uint32_t& VulkanVirtualTextureCache::GetPageSlot(uint32_t tile) {
+        const TileAddress address = UnpackTile(tile);
+        VirtualTexture& texture = mTextures[address.texture];
+        const VirtualMip& virtualMip = texture.mips[address.mip];
+        return texture.pageSlots[virtualMip.firstPage + address.y * virtualMip.pagesX + address.x];
+    }
+
+    uint32_t VulkanVirtualTextureCache::GetAncestorPage(const VirtualTexture& texture, uint32_t mip, uint32_t x, uint32_t y, uint32_t ancestorMip) {
+        // Halving the page, not the texel, so odd mip sizes can put the texel just outside the page, in its tile's border
+        const VirtualMip& ancestor = texture.mips[ancestorMip];
+        const uint32_t shift = ancestorMip - mip;
+        return ancestor.firstPage + std::min(y >> shift, ancestor.pagesY - 1) * ancestor.pagesX + std::min(x >> shift, ancestor.pagesX - 1);
+    }
+
+    void VulkanVirtualTextureCache::ExtractTile(uint32_t tile, std::byte* destination) const {
+        const TileAddress address = UnpackTile(tile);
+        const TextureAsset& asset = mTextures[address.texture].asset;
+        const TextureFormat::MipLevel& level = asset.GetMipLevels()[address.mip];
+        const std::byte* source = asset.GetMipData(address.mip).data();
+
+        // Block compressed mips can only be cut along their 4x4 blocks, which the tile size and border are multiples of
+        const uint32_t blockDimension = GetBlockDimension(mSpecs.format);
+        const uint32_t blockSize = TextureFormat::GetBlockSize(mSpecs.format);
+        const int64_t blocksX = (level.width + blockDimension - 1) / blockDimension;
+        const int64_t blocksY = (level.height + blockDimension - 1) / blockDimension;
+        const int64_t tileBlocks = mSpecs.tileSize / blockDimension;
+        const int64_t borderBlocks = mSpecs.tileBorder / blockDimension;
+        const int64_t paddedBlocks = mPaddedTileSize / blockDimension;
+
+        // The border repeats the neighbouring tiles, clamped to the mip's edge
+        for (int64_t row = 0; row < paddedBlocks; row++) {
+            const int64_t sourceRow = std::clamp(address.y * tileBlocks + row - borderBlocks, int64_t(0), blocksY - 1);
+            const std::byte* sourceRowData = source + sourceRow * blocksX * blockSize;
+            std::byte* destinationRow = destination + row * paddedBlocks * blockSize;
+
+            for (int64_t column = 0; column < paddedBlocks; column++) {
+                const int64_t sourceColumn = std::clamp(address.x * tileBlocks + column - borderBlocks, int64_t(0), blocksX - 1);
+                memcpy(destinationRow + column * blockSize, sourceRowData + sourceColumn * blockSize, blockSize);
+            }
+        }
+    }
+
+    VkBufferImageCopy VulkanVirtualTextureCache::GetTileCopy(uint32_t slot, VkDeviceSize bufferOffset) const {
+        VkBufferImageCopy copyRegion = {};
+        copyRegion.bufferOffset = bufferOffset;
+        copyRegion.bufferRowLength = 0;
+        copyRegion.bufferImageHeight = 0;
+        copyRegion.imageSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1 };
+        copyRegion.imageOffset = { static_cast<int32_t>(slot % mSpecs.cacheTilesPerSide * mPaddedTileSize), static_cast<int32_t>(slot / mSpecs.cacheTilesPerSide * mPaddedTileSize), 0 };
+        copyRegion.imageExtent = { mPaddedTileSize, mPaddedTileSize, 1 };
+        return copyRegion;
+    }
+
+}
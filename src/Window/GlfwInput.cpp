@@ -0,0 +1,86 @@
+#include <Window/GlfwInput.h>
+
+namespace VKRE {
+
+    void Input::AttachWindow(GLFWwindow* window) {
+        glfwSetKeyCallback(window, OnKey);
+        glfwSetMouseButtonCallback(window, OnMouseButton);
+        glfwSetCursorPosCallback(window, OnCursorMove);
+        glfwSetScrollCallback(window, OnScroll);
+
+        // The cursor callback only fires once the cursor moves
+        double x, y;
+        glfwGetCursorPos(window, &x, &y);
+        mMousePosition = { static_cast<float>(x), static_cast<float>(y) };
+    }
+
+    void Input::OnUpdate() {
+        mPreviousKeys = mKeys;
+        mPreviousMouseButtons = mMouseButtons;
+        mKeyPressEvents.reset();
+        mKeyReleaseEvents.reset();
+        mMouseButtonPressEvents.reset();
+        mMouseButtonReleaseEvents.reset();
+        mScrollDelta = { 0.0f, 0.0f };
+        mEvents.clear();
+
+        glfwPollEvents();
+
+        // Edges are the bits that differ from last frame. A key that was both pressed and released since then ends up where it
+        // started, so it's also counted as pressed and released.
+        const std::bitset<NUM_KEYS> keyTaps = mKeyPressEvents & mKeyReleaseEvents;
+        mPressedKeys = (mKeys & ~mPreviousKeys) | keyTaps;
+        mReleasedKeys = (~mKeys & mPreviousKeys) | keyTaps;
+
+        const std::bitset<NUM_MOUSE_BUTTONS> buttonTaps = mMouseButtonPressEvents & mMouseButtonReleaseEvents;
+        mPressedMouseButtons = (mMouseButtons & ~mPreviousMouseButtons) | buttonTaps;
+        mReleasedMouseButtons = (~mMouseButtons & mPreviousMouseButtons) | buttonTaps;
+    }
+
+    void Input::OnKey(GLFWwindow*, int key, int, int action, int mods) {
+        // Keys GLFW has no token for come in as GLFW_KEY_UNKNOWN
+        if (key < 0 || key >= NUM_KEYS)
+            return;
+
+        InputEventType type = InputEventType::KEY_REPEAT;
+        if (action == GLFW_PRESS) {
+            mKeys.set(key);
+            mKeyPressEvents.set(key);
+            type = InputEventType::KEY_PRESS;
+        } else if (action == GLFW_RELEASE) {
+            mKeys.reset(key);
+            mKeyReleaseEvents.set(key);
+            type = InputEventType::KEY_RELEASE;
+        }
+        mEvents.push_back({ glfwGetTime(), type, key, mods, mMousePosition.first, mMousePosition.second });
+    }
+
+    void Input::OnMouseButton(GLFWwindow*, int button, int action, int mods) {
+        if (button < 0 || button >= NUM_MOUSE_BUTTONS)
+            return;
+
+        InputEventType type;
+        if (action == GLFW_PRESS) {
+            mMouseButtons.set(button);
+            mMouseButtonPressEvents.set(button);
+            type = InputEventType::MOUSE_BUTTON_PRESS;
+        } else {
+            mMouseButtons.reset(button);
+            mMouseButtonReleaseEvents.set(button);
+            type = InputEventType::MOUSE_BUTTON_RELEASE;
+        }
+        mEvents.push_back({ glfwGetTime(), type, button, mods, mMousePosition.first, mMousePosition.second });
+    }
+
+    void Input::OnCursorMove(GLFWwindow*, double x, double y) {
+        mMousePosition = { static_cast<float>(x), static_cast<float>(y) };
+        mEvents.push_back({ glfwGetTime(), InputEventType::CURSOR_MOVE, 0, 0, mMousePosition.first, mMousePosition.second });
+    }
+
+    void Input::OnScroll(GLFWwindow*, double x, double y) {
+        mScrollDelta.first += static_cast<float>(x);
+        mScrollDelta.second += static_cast<float>(y);
+        mEvents.push_back({ glfwGetTime(), InputEventType::SCROLL, 0, 0, static_cast<float>(x), static_cast<float>(y) });
+    }
+
+}
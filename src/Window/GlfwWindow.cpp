@@ -1,17 +1,15 @@
 #include "GLFW/glfw3.h"
 
 #include <Window/GlfwWindow.h>
-#include <Engine.h>
 
 #include <cassert>
 
 namespace VKRE {
 
-    Window::Window(const WindowSpecs& specs)
-        :mGLFWwindow(nullptr), mSpecs(specs) {
+    Window::Window(const WindowSpecs& specs, EventBus* eventBus)
+        :mGLFWwindow(nullptr), mSpecs(specs), mEventBus(eventBus) {
 
-        if (!glfwInit())
-            assert("Couldn't initialise glfw");
+        InitBackend();
 
         glfwWindowHint(GLFW_CLIENT_API, GLFW_NO_API);
 
@@ -21,6 +19,7 @@ namespace VKRE {
             glfwWindowHint(GLFW_RESIZABLE, GLFW_FALSE);
 
         mGLFWwindow = glfwCreateWindow(static_cast<int>(mSpecs.width), static_cast<int>(mSpecs.height), mSpecs.title.c_str(), nullptr, nullptr);
+        sWindowCount++;
         if (!mGLFWwindow) {
             glfwTerminate();
             assert("Couldn't initialise window");
@@ -40,18 +39,43 @@ namespace VKRE {
         }
 
         Input::SetCurrentWindow(mGLFWwindow);
+        Input::AttachWindow(mGLFWwindow);
 
         glfwSetWindowUserPointer(mGLFWwindow, this);
         glfwSetWindowSizeCallback(mGLFWwindow, [](GLFWwindow* window, int width, int height) {
-                Window* VKREWindow = static_cast<Window*>(glfwGetWindowUserPointer(window));
-                VKREWindow->Resize(width, height);
-                Engine::GetInstance().hasResized = true;
+            Window* VKREWindow = static_cast<Window*>(glfwGetWindowUserPointer(window));
+            // GLFW has already resized the window, only the specs need to follow
+            VKREWindow->mSpecs.width = static_cast<uint32_t>(width);
+            VKREWindow->mSpecs.height = static_cast<uint32_t>(height);
+            if (VKREWindow->mEventBus)
+                VKREWindow->mEventBus->Post(WindowResizeEvent{ VKREWindow, static_cast<uint32_t>(width), static_cast<uint32_t>(height) });
+        });
+        if (!mEventBus)
+            return;
+
+        // The callbacks only post, whoever cares handles the events when the bus is dispatched
+        glfwSetFramebufferSizeCallback(mGLFWwindow, [](GLFWwindow* window, int width, int height) {
+            Window* VKREWindow = static_cast<Window*>(glfwGetWindowUserPointer(window));
+            VKREWindow->mEventBus->Post(FramebufferResizeEvent{ VKREWindow, static_cast<uint32_t>(width), static_cast<uint32_t>(height) });
         });
-   }
+        glfwSetWindowIconifyCallback(mGLFWwindow, [](GLFWwindow* window, int iconified) {
+            Window* VKREWindow = static_cast<Window*>(glfwGetWindowUserPointer(window));
+            VKREWindow->mEventBus->Post(WindowMinimizeEvent{ VKREWindow, iconified == GLFW_TRUE });
+        });
+        glfwSetWindowFocusCallback(mGLFWwindow, [](GLFWwindow* window, int focused) {
+            Window* VKREWindow = static_cast<Window*>(glfwGetWindowUserPointer(window));
+            VKREWindow->mEventBus->Post(WindowFocusEvent{ VKREWindow, focused == GLFW_TRUE });
+        });
+        mEventBus->Subscribe<WindowFocusEvent, &Window::OnFocus>(this);
+    }
 
     Window::~Window() {
+        if (mEventBus)
+            mEventBus->Unsubscribe<WindowFocusEvent>(this);
         glfwDestroyWindow(mGLFWwindow);
-        glfwTerminate();
+        // GLFW is shared by every window, the last one takes it down
+        if (--sWindowCount == 0)
+            glfwTerminate();
     }
 
     void Window::Close() const {
@@ -72,6 +96,12 @@ namespace VKRE {
         glfwSetWindowSize(mGLFWwindow, static_cast<int>(mSpecs.width), static_cast<int>(mSpecs.height));
     }
 
+    void Window::OnFocus(const WindowFocusEvent& event) {
+        // Input follows whichever window the user is typing into
+        if (event.window == this && event.focused)
+            Focus();
+    }
+
     std::pair<int32_t, int32_t> Window::GetFrameBufferExtents() const {
         int32_t width = 0;
         int32_t height = 0;
@@ -86,7 +116,13 @@ namespace VKRE {
         Input::OnUpdate();
     }
 
-    std::vector<const char*>Window::GetWindowExtensions() const {
+    void Window::InitBackend() {
+        // glfwInit returns straight away once GLFW is initialised
+        if (!glfwInit())
+            assert("Couldn't initialise glfw");
+    }
+
+    std::vector<const char*> Window::GetWindowExtensions() {
         uint32_t extensionCount = 0;
         const char** extensions = glfwGetRequiredInstanceExtensions(&extensionCount);
         return std::vector<const char*>(extensions, extensions + extensionCount);
@@ -0,0 +1,216 @@
+#include "MeshSimplifier.h"
+#include "MeshWriter.h"
+#include "MeshletBuilder.h"
+
+#include <Core/JobSystem.h>
+
+#include <assimp/Importer.hpp>
+#include <assimp/postprocess.h>
+#include <assimp/scene.h>
+
+#include <algorithm>
+#include <atomic>
+#include <filesystem>
+#include <optional>
+#include <print>
+#include <string_view>
+#include <vector>
+
+namespace VKRE {
+
+    namespace {
+
+        // Every level aims for half the triangles of the one before it
+        constexpr float LOD_TRIANGLE_RATIO = 0.5f;
+        // A level that keeps more than this share of the previous level's triangles isn't worth its indices, the chain ends there
+        constexpr float LOD_MIN_REDUCTION = 0.85f;
+        // The coarsest level may deviate this much from the original, relative to the mesh's bounding radius
+        constexpr float LOD_MAX_RELATIVE_ERROR = 0.1f;
+
+    }
+
+    // Simplifies each level from the previous one, so errors add up along the chain. Submeshes that can't be simplified any further
+    // keep their previous range, every level still has one range per submesh.
+    void BuildLods(CookedMesh& cooked) {
+        const uint32_t submeshCount = static_cast<uint32_t>(cooked.submeshes.size());
+        uint32_t triangleCount = 0;
+        for (const MeshFormat::Submesh& submesh : cooked.submeshes) {
+            cooked.lodRanges.push_back({ submesh.firstIndex, submesh.indexCount });
+            triangleCount += submesh.indexCount / 3;
+        }
+        cooked.lods.push_back({ 0.0f, triangleCount });
+
+        const float maxError = cooked.bounds.radius * LOD_MAX_RELATIVE_ERROR;
+        while (cooked.lods.size() < MeshFormat::MAX_MESH_LODS) {
+            const MeshFormat::Lod previous = cooked.lods.back();
+            if (previous.error >= maxError)
+                break;
+
+            const size_t previousRanges = cooked.lodRanges.size() - submeshCount;
+            const size_t indexCountBefore = cooked.indices.size();
+
+            MeshFormat::Lod lod{ previous.error, 0 };
+            for (uint32_t i = 0; i < submeshCount; i++) {
+                const MeshFormat::LodRange previousRange = cooked.lodRanges[previousRanges + i];
+                const uint32_t targetIndexCount = static_cast<uint32_t>(static_cast<float>(previousRange.indexCount / 3) * LOD_TRIANGLE_RATIO) * 3;
+                SimplifiedMesh simplified = SimplifyMesh(cooked.vertices, std::span<const uint32_t>(cooked.indices).subspan(previousRange.firstIndex, previousRange.indexCount),
+                    cooked.submeshes[i].vertexOffset, targetIndexCount, maxError - previous.error);
+
+                MeshFormat::LodRange range = previousRange;
+                if (simplified.indices.size() < previousRange.indexCount) {
+                    range = { static_cast<uint32_t>(cooked.indices.size()), static_cast<uint32_t>(simplified.indices.size()) };
+                    cooked.indices.insert(cooked.indices.end(), simplified.indices.begin(), simplified.indices.end());
+                    lod.error = std::max(lod.error, previous.error + simplified.error);
+                }
+                cooked.lodRanges.push_back(range);
+                lod.triangleCount += range.indexCount / 3;
+            }
+
+            if (static_cast<float>(lod.triangleCount) > static_cast<float>(previous.triangleCount) * LOD_MIN_REDUCTION) {
+                cooked.indices.resize(indexCountBefore);
+                cooked.lodRanges.resize(cooked.lodRanges.size() - submeshCount);
+                break;
+            }
+            cooked.lods.push_back(lod);
+        }
+    }
+
+    std::optional<CookedMesh> ImportMesh(const std::filesystem::path& path) {
+        Assimp::Importer importer;
+        // Drop everything we don't store so that JoinIdenticalVertices can merge as much as possible
+        importer.SetPropertyInteger(AI_CONFIG_PP_RVC_FLAGS, aiComponent_TANGENTS_AND_BITANGENTS | aiComponent_ANIMATIONS | aiComponent_BONEWEIGHTS | aiComponent_CAMERAS | aiComponent_LIGHTS);
+        importer.SetPropertyInteger(AI_CONFIG_PP_SBP_REMOVE, aiPrimitiveType_POINT | aiPrimitiveType_LINE);
+
+        const uint32_t flags = aiProcess_Triangulate
+                             | aiProcess_RemoveComponent
+                             | aiProcess_JoinIdenticalVertices
+                             | aiProcess_GenSmoothNormals
+                             | aiProcess_PreTransformVertices
+                             | aiProcess_SortByPType
+                             | aiProcess_OptimizeMeshes
+                             | aiProcess_ImproveCacheLocality
+                             | aiProcess_FindInvalidData
+                             | aiProcess_ValidateDataStructure;
+
+        const aiScene* scene = importer.ReadFile(path.string(), flags);
+        if (!scene || !scene->mRootNode || (scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE)) {
+            std::println("Failed to import {}: {}", path.string(), importer.GetErrorString());
+            return std::nullopt;
+        }
+
+        CookedMesh cooked;
+        MeshletData meshlets;
+        for (uint32_t meshIndex = 0; meshIndex < scene->mNumMeshes; meshIndex++) {
+            const aiMesh* mesh = scene->mMeshes[meshIndex];
+            if (!(mesh->mPrimitiveTypes & aiPrimitiveType_TRIANGLE))
+                continue;
+
+            MeshFormat::Submesh submesh{};
+            submesh.firstIndex = static_cast<uint32_t>(cooked.indices.size());
+            submesh.vertexOffset = static_cast<int32_t>(cooked.vertices.size());
+            submesh.materialIndex = mesh->mMaterialIndex;
+
+            for (uint32_t i = 0; i < mesh->mNumVertices; i++) {
+                MeshFormat::Vertex vertex{};
+                vertex.position = { mesh->mVertices[i].x, mesh->mVertices[i].y, mesh->mVertices[i].z };
+                vertex.normal = mesh->HasNormals() ? glm::vec3(mesh->mNormals[i].x, mesh->mNormals[i].y, mesh->mNormals[i].z) : glm::vec3(0.0f, 1.0f, 0.0f);
+                if (mesh->HasTextureCoords(0)) {
+                    vertex.uvX = mesh->mTextureCoords[0][i].x;
+                    vertex.uvY = mesh->mTextureCoords[0][i].y;
+                }
+                vertex.color = mesh->HasVertexColors(0) ? glm::vec4(mesh->mColors[0][i].r, mesh->mColors[0][i].g, mesh->mColors[0][i].b, mesh->mColors[0][i].a) : glm::vec4(1.0f);
+                cooked.vertices.push_back(vertex);
+            }
+
+            for (uint32_t i = 0; i < mesh->mNumFaces; i++) {
+                const aiFace& face = mesh->mFaces[i];
+                if (face.mNumIndices != 3)
+                    continue;
+                cooked.indices.push_back(face.mIndices[0]);
+                cooked.indices.push_back(face.mIndices[1]);
+                cooked.indices.push_back(face.mIndices[2]);
+            }
+
+            submesh.indexCount = static_cast<uint32_t>(cooked.indices.size()) - submesh.firstIndex;
+            submesh.bounds = ComputeBounds(cooked.vertices, std::span<const uint32_t>(cooked.indices).subspan(submesh.firstIndex, submesh.indexCount), submesh.vertexOffset);
+            submesh.firstMeshlet = static_cast<uint32_t>(meshlets.meshlets.size());
+            submesh.meshletCount = BuildMeshlets(meshlets, cooked.vertices, std::span<const uint32_t>(cooked.indices).subspan(submesh.firstIndex, submesh.indexCount), submesh.vertexOffset);
+            cooked.submeshes.push_back(submesh);
+        }
+
+        if (cooked.submeshes.empty()) {
+            std::println("{} contains no triangle meshes!", path.string());
+            return std::nullopt;
+        }
+
+        cooked.meshlets = std::move(meshlets.meshlets);
+        cooked.meshletVertices = std::move(meshlets.vertices);
+        cooked.meshletTriangles = std::move(meshlets.triangles);
+        cooked.bounds = ComputeBounds(cooked.vertices);
+        BuildLods(cooked);
+        return cooked;
+    }
+
+    bool WriteMesh(const std::filesystem::path& path, const CookedMesh& mesh) {
+        MeshWriter writer;
+        writer.AddSection(MeshFormat::SectionType::SUBMESHES, std::span<const MeshFormat::Submesh>(mesh.submeshes))
+              .AddSection(MeshFormat::SectionType::VERTICES, std::span<const MeshFormat::Vertex>(mesh.vertices))
+              .AddSection(MeshFormat::SectionType::INDICES, std::span<const uint32_t>(mesh.indices))
+              .AddSection(MeshFormat::SectionType::MESHLETS, std::span<const MeshFormat::Meshlet>(mesh.meshlets))
+              .AddSection(MeshFormat::SectionType::MESHLET_VERTICES, std::span<const uint32_t>(mesh.meshletVertices))
+              .AddSection(MeshFormat::SectionType::MESHLET_TRIANGLES, std::span<const uint32_t>(mesh.meshletTriangles))
+              .AddSection(MeshFormat::SectionType::LODS, std::span<const MeshFormat::Lod>(mesh.lods))
+              .AddSection(MeshFormat::SectionType::LOD_RANGES, std::span<const MeshFormat::LodRange>(mesh.lodRanges));
+        return writer.Write(path, mesh.bounds);
+    }
+
+}
+
+namespace {
+
+    bool CookMesh(const std::filesystem::path& input, const std::filesystem::path& output) {
+        std::optional<VKRE::CookedMesh> mesh = VKRE::ImportMesh(input);
+        if (!mesh.has_value())
+            return false;
+
+        if (!VKRE::WriteMesh(output, mesh.value())) {
+            std::println("Failed to write {}", output.string());
+            return false;
+        }
+
+        std::println("Cooked {} -> {} ({} submeshes, {} vertices, {} triangles, {} meshlets, {} LODs down to {} triangles at error {})", input.string(), output.string(),
+            mesh->submeshes.size(), mesh->vertices.size(), mesh->lods.front().triangleCount, mesh->meshlets.size(), mesh->lods.size(), mesh->lods.back().triangleCount, mesh->lods.back().error);
+        return true;
+    }
+
+}
+
+int main(int argc, char** argv) {
+    if (argc >= 4 && std::string_view(argv[1]) == "--batch") {
+        // Every source file gets its own assimp importer, so whole files are imported in parallel
+        std::filesystem::path outputDirectory = argv[2];
+        std::vector<std::filesystem::path> inputs(argv + 3, argv + argc);
+        std::filesystem::create_directories(outputDirectory);
+
+        VKRE::JobSystem jobSystem;
+        std::atomic<uint32_t> failures{ 0 };
+        jobSystem.ParallelFor(static_cast<uint32_t>(inputs.size()), 1, [&](uint32_t begin, uint32_t end) {
+            for (uint32_t i = begin; i < end; i++) {
+                std::filesystem::path output = outputDirectory / inputs[i].filename().replace_extension(".vkmesh");
+                if (!CookMesh(inputs[i], output))
+                    failures.fetch_add(1, std::memory_order_relaxed);
+            }
+        });
+
+        std::println("Cooked {} of {} meshes", inputs.size() - failures.load(), inputs.size());
+        return failures.load() == 0 ? 0 : 1;
+    }
+
+    if (argc != 3) {
+        std::println("Usage: {} <source mesh> <output.vkmesh>", argv[0]);
+        std::println("       {} --batch <output directory> <source meshes...>", argv[0]);
+        return 1;
+    }
+
+    return CookMesh(argv[1], argv[2]) ? 0 : 1;
+}
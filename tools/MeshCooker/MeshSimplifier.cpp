@@ -0,0 +1,381 @@
+#include "MeshSimplifier.h"
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <unordered_map>
+
+namespace VKRE {
+
+    namespace {
+
+        constexpr uint32_t NO_VERTEX = UINT32_MAX;
+        // Border planes are weighted far above the surface planes so that open edges keep their outline
+        constexpr float BORDER_WEIGHT = 10.0f;
+        constexpr float MAX_NORMAL_ROTATION_COS = 0.25f;
+
+        enum class VertexKind : uint8_t {
+            Manifold, // Interior vertex, may collapse onto any neighbour
+            Border,   // On exactly one open border, may only collapse along it
+            Locked    // Seam, non manifold or unused, never moves
+        };
+
+        // Sum of squared distances to a set of planes, weighted by area: Q(p) = pᵀAp + 2b·p + c. Dividing by the total weight turns it
+        // back into a squared distance.
+        struct Quadric {
+            float a00 = 0.0f, a01 = 0.0f, a02 = 0.0f, a11 = 0.0f, a12 = 0.0f, a22 = 0.0f;
+            float b0 = 0.0f, b1 = 0.0f, b2 = 0.0f;
+            float c = 0.0f;
+            float weight = 0.0f;
+
+            static Quadric FromPlane(const glm::vec3& normal, float distance, float weight) {
+                Quadric quadric;
+                quadric.a00 = weight * normal.x * normal.x;
+                quadric.a01 = weight * normal.x * normal.y;
+                quadric.a02 = weight * normal.x * normal.z;
+                quadric.a11 = weight * normal.y * normal.y;
+                quadric.a12 = weight * normal.y * normal.z;
+                quadric.a22 = weight * normal.z * normal.z;
+                quadric.b0 = weight * normal.x * distance;
+                quadric.b1 = weight * normal.y * distance;
+                quadric.b2 = weight * normal.z * distance;
+                quadric.c = weight * distance * distance;
+                quadric.weight = weight;
+                return quadric;
+            }
+
+            Quadric& operator+=(const Quadric& other) {
+                a00 += other.a00; a01 += other.a01; a02 += other.a02;
+                a11 += other.a11; a12 += other.a12; a22 += other.a22;
+                b0 += other.b0; b1 += other.b1; b2 += other.b2;
+                c += other.c;
+                weight += other.weight;
+                return *this;
+            }
+
+            // Squared distance, averaged over the planes
+            float Evaluate(const glm::vec3& p) const {
+                const float rx = a00 * p.x + a01 * p.y + a02 * p.z;
+                const float ry = a01 * p.x + a11 * p.y + a12 * p.z;
+                const float rz = a02 * p.x + a12 * p.y + a22 * p.z;
+                const float error = p.x * rx + p.y * ry + p.z * rz + 2.0f * (b0 * p.x + b1 * p.y + b2 * p.z) + c;
+                return weight > 0.0f ? std::max(error, 0.0f) / weight : 0.0f;
+            }
+        };
+
+        struct Collapse {
+            uint32_t from;
+            uint32_t to;
+            float error; // Squared, in normalized units
+        };
+
+        // Triangles around each vertex of the current index list
+        struct VertexTriangles {
+            std::vector<uint32_t> offsets;
+            std::vector<uint32_t> triangles;
+
+            void Build(std::span<const uint32_t> indices, uint32_t vertexCount) {
+                offsets.assign(vertexCount + 1, 0);
+                for (uint32_t index : indices)
+                    offsets[index + 1]++;
+                for (uint32_t vertex = 0; vertex < vertexCount; vertex++)
+                    offsets[vertex + 1] += offsets[vertex];
+
+                triangles.resize(indices.size());
+                std::vector<uint32_t> cursor(offsets.begin(), offsets.end() - 1);
+                for (uint32_t i = 0; i < indices.size(); i++)
+                    triangles[cursor[indices[i]]++] = i / 3;
+            }
+
+            std::span<const uint32_t> Get(uint32_t vertex) const { return std::span<const uint32_t>(triangles).subspan(offsets[vertex], offsets[vertex + 1] - offsets[vertex]); }
+        };
+
+        // Vertices sharing a position with another vertex sit on an attribute seam. Moving one copy would tear the seam open.
+        std::vector<bool> FindSeamVertices(std::span<const MeshFormat::Vertex> vertices) {
+            struct PositionHash {
+                size_t operator()(const glm::vec3& position) const {
+                    uint32_t bits[3];
+                    memcpy(bits, &position, sizeof(bits));
+                    return (bits[0] * 73856093u) ^ (bits[1] * 19349663u) ^ (bits[2] * 83492791u);
+                }
+            };
+
+            std::unordered_map<glm::vec3, uint32_t, PositionHash> firstVertex;
+            firstVertex.reserve(vertices.size());
+            std::vector<bool> seam(vertices.size(), false);
+            for (uint32_t vertex = 0; vertex < vertices.size(); vertex++) {
+                auto [it, inserted] = firstVertex.try_emplace(vertices[vertex].position, vertex);
+                if (!inserted) {
+                    seam[vertex] = true;
+                    seam[it->second] = true;
+                }
+            }
+            return seam;
+        }
+
+        uint32_t NextCorner(uint32_t corner) { return corner % 3 == 2 ? corner - 2 : corner + 1; }
+        uint32_t PreviousCorner(uint32_t corner) { return corner % 3 == 0 ? corner + 2 : corner - 1; }
+
+        uint32_t FindCorner(std::span<const uint32_t> indices, uint32_t triangle, uint32_t vertex) {
+            for (uint32_t corner = triangle * 3; corner < triangle * 3 + 3; corner++) {
+                if (indices[corner] == vertex)
+                    return corner;
+            }
+            return NO_VERTEX;
+        }
+
+        // Classifies a vertex from the triangles around it. An edge is open when no triangle runs along it in the opposite direction.
+        VertexKind ClassifyVertex(std::span<const uint32_t> indices, std::span<const uint32_t> triangles, uint32_t vertex, uint32_t& borderNext, uint32_t& borderPrevious) {
+            borderNext = NO_VERTEX;
+            borderPrevious = NO_VERTEX;
+            if (triangles.empty())
+                return VertexKind::Locked;
+
+            for (uint32_t triangle : triangles) {
+                const uint32_t corner = FindCorner(indices, triangle, vertex);
+                const uint32_t next = indices[NextCorner(corner)];
+                const uint32_t previous = indices[PreviousCorner(corner)];
+
+                uint32_t sameNext = 0, oppositeNext = 0, samePrevious = 0, oppositePrevious = 0;
+                for (uint32_t other : triangles) {
+                    const uint32_t otherCorner = FindCorner(indices, other, vertex);
+                    const uint32_t otherNext = indices[NextCorner(otherCorner)];
+                    const uint32_t otherPrevious = indices[PreviousCorner(otherCorner)];
+                    sameNext += otherNext == next;
+                    oppositeNext += otherPrevious == next;
+                    samePrevious += otherPrevious == previous;
+                    oppositePrevious += otherNext == previous;
+                }
+
+                if (sameNext > 1 || oppositeNext > 1 || samePrevious > 1 || oppositePrevious > 1)
+                    return VertexKind::Locked;
+
+                if (oppositeNext == 0) {
+                    if (borderNext != NO_VERTEX)
+                        return VertexKind::Locked;
+                    borderNext = next;
+                }
+                if (oppositePrevious == 0) {
+                    if (borderPrevious != NO_VERTEX)
+                        return VertexKind::Locked;
+                    borderPrevious = previous;
+                }
+            }
+
+            if (borderNext == NO_VERTEX && borderPrevious == NO_VERTEX)
+                return VertexKind::Manifold;
+            return borderNext != NO_VERTEX && borderPrevious != NO_VERTEX ? VertexKind::Border : VertexKind::Locked;
+        }
+
+        // Collapsing must not turn any of the remaining triangles around the vertex upside down. Rotations past ~75 degrees are refused
+        // as well, over a few passes those add up to the same thing.
+        bool FlipsTriangles(std::span<const uint32_t> indices, std::span<const uint32_t> triangles, std::span<const glm::vec3> positions, uint32_t from, uint32_t to) {
+            for (uint32_t triangle : triangles) {
+                const uint32_t a = indices[triangle * 3 + 0];
+                const uint32_t b = indices[triangle * 3 + 1];
+                const uint32_t c = indices[triangle * 3 + 2];
+                if (a == to || b == to || c == to)
+                    continue;
+
+                const glm::vec3 oldNormal = glm::cross(positions[b] - positions[a], positions[c] - positions[a]);
+                const glm::vec3& newA = a == from ? positions[to] : positions[a];
+                const glm::vec3& newB = b == from ? positions[to] : positions[b];
+                const glm::vec3& newC = c == from ? positions[to] : positions[c];
+                const glm::vec3 newNormal = glm::cross(newB - newA, newC - newA);
+                if (glm::dot(oldNormal, newNormal) <= MAX_NORMAL_ROTATION_COS * glm::length(oldNormal) * glm::length(newNormal))
+                    return true;
+            }
+            return false;
+        }
+
+        // The endpoints may only share the neighbours opposite the edge itself, any other shared neighbour would end up with a pinched,
+        // non manifold surface after the collapse
+        bool PinchesSurface(std::span<const uint32_t> indices, const VertexTriangles& vertexTriangles, uint32_t from, uint32_t to) {
+            uint32_t edgeTriangles = 0;
+            for (uint32_t triangle : vertexTriangles.Get(from))
+                edgeTriangles += FindCorner(indices, triangle, to) != NO_VERTEX;
+
+            auto IsNeighbourOfTo = [&](uint32_t vertex) {
+                for (uint32_t triangle : vertexTriangles.Get(to)) {
+                    if (FindCorner(indices, triangle, vertex) != NO_VERTEX)
+                        return true;
+                }
+                return false;
+            };
+
+            uint32_t sharedNeighbours = 0;
+            std::vector<uint32_t> visited;
+            for (uint32_t triangle : vertexTriangles.Get(from)) {
+                for (uint32_t corner = triangle * 3; corner < triangle * 3 + 3; corner++) {
+                    const uint32_t vertex = indices[corner];
+                    if (vertex == from || vertex == to || std::find(visited.begin(), visited.end(), vertex) != visited.end())
+                        continue;
+
+                    visited.push_back(vertex);
+                    sharedNeighbours += IsNeighbourOfTo(vertex);
+                }
+            }
+            return sharedNeighbours > edgeTriangles;
+        }
+
+    }
+
+    SimplifiedMesh SimplifyMesh(std::span<const MeshFormat::Vertex> vertices, std::span<const uint32_t> indices, int32_t vertexOffset, uint32_t targetIndexCount, float maxError) {
+        SimplifiedMesh result;
+        result.indices.assign(indices.begin(), indices.end());
+        if (indices.size() <= targetIndexCount || indices.empty())
+            return result;
+
+        const uint32_t vertexCount = *std::max_element(indices.begin(), indices.end()) + 1;
+        std::span<const MeshFormat::Vertex> submeshVertices = vertices.subspan(vertexOffset, vertexCount);
+
+        // Work in a unit sized box so the quadrics stay well conditioned in floats whatever the mesh's scale
+        glm::vec3 minPosition(std::numeric_limits<float>::max());
+        glm::vec3 maxPosition(std::numeric_limits<float>::lowest());
+        for (const MeshFormat::Vertex& vertex : submeshVertices) {
+            minPosition = glm::min(minPosition, vertex.position);
+            maxPosition = glm::max(maxPosition, vertex.position);
+        }
+        const float scale = std::max({ maxPosition.x - minPosition.x, maxPosition.y - minPosition.y, maxPosition.z - minPosition.z });
+        if (scale <= 0.0f)
+            return result;
+
+        std::vector<glm::vec3> positions(vertexCount);
+        for (uint32_t vertex = 0; vertex < vertexCount; vertex++)
+            positions[vertex] = (submeshVertices[vertex].position - minPosition) / scale;
+
+        const std::vector<bool> seam = FindSeamVertices(submeshVertices);
+        const float maxErrorSquared = (maxError / scale) * (maxError / scale);
+
+        VertexTriangles vertexTriangles;
+        vertexTriangles.Build(result.indices, vertexCount);
+
+        std::vector<VertexKind> kinds(vertexCount);
+        std::vector<uint32_t> borderNext(vertexCount), borderPrevious(vertexCount);
+        auto ClassifyVertices = [&]() {
+            for (uint32_t vertex = 0; vertex < vertexCount; vertex++) {
+                kinds[vertex] = ClassifyVertex(result.indices, vertexTriangles.Get(vertex), vertex, borderNext[vertex], borderPrevious[vertex]);
+                if (seam[vertex])
+                    kinds[vertex] = VertexKind::Locked;
+            }
+        };
+        ClassifyVertices();
+
+        std::vector<Quadric> quadrics(vertexCount);
+        for (uint32_t triangle = 0; triangle < result.indices.size() / 3; triangle++) {
+            const uint32_t corners[3] = { result.indices[triangle * 3 + 0], result.indices[triangle * 3 + 1], result.indices[triangle * 3 + 2] };
+            const glm::vec3 cross = glm::cross(positions[corners[1]] - positions[corners[0]], positions[corners[2]] - positions[corners[0]]);
+            const float doubleArea = glm::length(cross);
+            if (doubleArea <= 0.0f)
+                continue;
+
+            const glm::vec3 normal = cross / doubleArea;
+            const Quadric plane = Quadric::FromPlane(normal, -glm::dot(normal, positions[corners[0]]), doubleArea * 0.5f);
+            for (uint32_t corner = 0; corner < 3; corner++) {
+                quadrics[corners[corner]] += plane;
+
+                // A plane through the open edge, perpendicular to the face, holds border vertices on the border's line
+                const uint32_t from = corners[corner];
+                const uint32_t to = corners[(corner + 1) % 3];
+                if (kinds[from] != VertexKind::Manifold && borderNext[from] == to) {
+                    const glm::vec3 edge = positions[to] - positions[from];
+                    const float edgeLength = glm::length(edge);
+                    if (edgeLength <= 0.0f)
+                        continue;
+
+                    const glm::vec3 borderNormal = glm::normalize(glm::cross(edge / edgeLength, normal));
+                    const Quadric border = Quadric::FromPlane(borderNormal, -glm::dot(borderNormal, positions[from]), edgeLength * edgeLength * BORDER_WEIGHT);
+                    quadrics[from] += border;
+                    quadrics[to] += border;
+                }
+            }
+        }
+
+        std::vector<Collapse> collapses;
+        std::vector<bool> locked(vertexCount);
+        std::vector<uint32_t> remap(vertexCount);
+        float resultErrorSquared = 0.0f;
+
+        // Each pass applies as many independent collapses as it can, cheapest first, then rebuilds the index list
+        while (result.indices.size() > targetIndexCount) {
+            collapses.clear();
+            for (uint32_t corner = 0; corner < result.indices.size(); corner++) {
+                const uint32_t from = result.indices[corner];
+                const uint32_t to = result.indices[NextCorner(corner)];
+                for (auto [a, b] : { std::pair{ from, to }, std::pair{ to, from } }) {
+                    const bool allowed = kinds[a] == VertexKind::Manifold || (kinds[a] == VertexKind::Border && (borderNext[a] == b || borderPrevious[a] == b));
+                    if (!allowed)
+                        continue;
+
+                    Quadric merged = quadrics[a];
+                    merged += quadrics[b];
+                    const float error = merged.Evaluate(positions[b]);
+                    if (error <= maxErrorSquared)
+                        collapses.push_back({ a, b, error });
+                }
+            }
+            if (collapses.empty())
+                break;
+
+            std::sort(collapses.begin(), collapses.end(), [](const Collapse& a, const Collapse& b) { return a.error < b.error; });
+
+            // A manifold collapse removes two triangles, a border one only one
+            const uint32_t trianglesToRemove = static_cast<uint32_t>(result.indices.size() - targetIndexCount + 2) / 3;
+            uint32_t trianglesRemoved = 0;
+            uint32_t collapseCount = 0;
+            std::fill(locked.begin(), locked.end(), false);
+            for (uint32_t vertex = 0; vertex < vertexCount; vertex++)
+                remap[vertex] = vertex;
+
+            for (const Collapse& collapse : collapses) {
+                if (trianglesRemoved >= trianglesToRemove)
+                    break;
+                if (locked[collapse.from] || locked[collapse.to])
+                    continue;
+
+                std::span<const uint32_t> triangles = vertexTriangles.Get(collapse.from);
+                if (PinchesSurface(result.indices, vertexTriangles, collapse.from, collapse.to) || FlipsTriangles(result.indices, triangles, positions, collapse.from, collapse.to))
+                    continue;
+
+                remap[collapse.from] = collapse.to;
+                quadrics[collapse.to] += quadrics[collapse.from];
+                resultErrorSquared = std::max(resultErrorSquared, collapse.error);
+
+                // Neighbours are locked too, otherwise a second collapse in the same pass could flip a triangle the first one already moved
+                for (uint32_t triangle : triangles) {
+                    for (uint32_t corner = 0; corner < 3; corner++)
+                        locked[result.indices[triangle * 3 + corner]] = true;
+                }
+                trianglesRemoved += kinds[collapse.from] == VertexKind::Border ? 1 : 2;
+                collapseCount++;
+            }
+
+            if (collapseCount == 0)
+                break;
+
+            uint32_t writeIndex = 0;
+            for (uint32_t triangle = 0; triangle < result.indices.size() / 3; triangle++) {
+                const uint32_t a = remap[result.indices[triangle * 3 + 0]];
+                const uint32_t b = remap[result.indices[triangle * 3 + 1]];
+                const uint32_t c = remap[result.indices[triangle * 3 + 2]];
+                if (a == b || b == c || c == a)
+                    continue;
+
+                result.indices[writeIndex++] = a;
+                result.indices[writeIndex++] = b;
+                result.indices[writeIndex++] = c;
+            }
+            result.indices.resize(writeIndex);
+
+            vertexTriangles.Build(result.indices, vertexCount);
+            ClassifyVertices();
+        }
+
+        result.error = std::sqrt(resultErrorSquared) * scale;
+        return result;
+    }
+
+}
@@ -0,0 +1,24 @@
+#pragma once
+
+#include <Asset/MeshFormat.h>
+
+#include <cstdint>
+#include <span>
+#include <vector>
+
+namespace VKRE {
+
+    struct SimplifiedMesh {
+        std::vector<uint32_t> indices; // Relative to the vertexOffset passed in, like the source indices
+        float error = 0.0f;            // Largest deviation from the source surface, in the units of the positions
+    };
+
+    // Quadric error metric edge collapse after Garland and Heckbert. Vertices only ever collapse onto one of their neighbours, so the
+    // result is a new index list over the same vertices and every attribute survives untouched. Vertices on attribute seams or non
+    // manifold edges never move, vertices on open borders only slide along the border.
+    //
+    // Collapses are applied cheapest first until the index count reaches targetIndexCount, or until the next one would move the surface
+    // further than maxError.
+    SimplifiedMesh SimplifyMesh(std::span<const MeshFormat::Vertex> vertices, std::span<const uint32_t> indices, int32_t vertexOffset, uint32_t targetIndexCount, float maxError);
+
+}
@@ -0,0 +1,82 @@
+#include "MeshWriter.h"
+
+#include <algorithm>
+#include <fstream>
+#include <limits>
+
+namespace VKRE {
+
+    bool MeshWriter::Write(const std::filesystem::path& path, const MeshFormat::Bounds& bounds) const {
+        MeshFormat::FileHeader header{};
+        header.magic = MeshFormat::MESH_FILE_MAGIC;
+        header.version = MeshFormat::MESH_FILE_VERSION;
+        header.sectionCount = static_cast<uint32_t>(mSections.size());
+        header.flags = 0;
+        header.bounds = bounds;
+
+        std::vector<MeshFormat::Section> table;
+        uint64_t offset = MeshFormat::AlignSectionOffset(sizeof(MeshFormat::FileHeader) + mSections.size() * sizeof(MeshFormat::Section));
+        for (const auto& section : mSections) {
+            table.push_back({ section.type, section.elementSize, section.elementCount, offset, section.data.size() });
+            offset = MeshFormat::AlignSectionOffset(offset + section.data.size());
+        }
+
+        std::ofstream file(path, std::ios::binary | std::ios::trunc);
+        if (!file)
+            return false;
+
+        auto PadTo = [&](uint64_t target) {
+            static const char zeros[MeshFormat::MESH_SECTION_ALIGNMENT] = {};
+            uint64_t position = static_cast<uint64_t>(file.tellp());
+            file.write(zeros, static_cast<std::streamsize>(target - position));
+        };
+
+        file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        file.write(reinterpret_cast<const char*>(table.data()), static_cast<std::streamsize>(table.size() * sizeof(MeshFormat::Section)));
+        for (size_t i = 0; i < mSections.size(); i++) {
+            PadTo(table[i].offset);
+            file.write(reinterpret_cast<const char*>(mSections[i].data.data()), static_cast<std::streamsize>(mSections[i].data.size()));
+        }
+
+        return static_cast<bool>(file);
+    }
+
+    namespace {
+
+        template <typename Iterate> MeshFormat::Bounds ComputeBoundsImpl(Iterate&& iterate) {
+            glm::vec3 minPos(std::numeric_limits<float>::max());
+            glm::vec3 maxPos(std::numeric_limits<float>::lowest());
+            iterate([&](const glm::vec3& position) {
+                minPos = glm::min(minPos, position);
+                maxPos = glm::max(maxPos, position);
+            });
+
+            MeshFormat::Bounds bounds{};
+            if (minPos.x > maxPos.x)
+                return bounds;
+
+            bounds.center = (minPos + maxPos) * 0.5f;
+            bounds.extents = (maxPos - minPos) * 0.5f;
+            iterate([&](const glm::vec3& position) {
+                bounds.radius = std::max(bounds.radius, glm::length(position - bounds.center));
+            });
+            return bounds;
+        }
+
+    }
+
+    MeshFormat::Bounds ComputeBounds(std::span<const MeshFormat::Vertex> vertices) {
+        return ComputeBoundsImpl([&](auto&& visit) {
+            for (const auto& vertex : vertices)
+                visit(vertex.position);
+        });
+    }
+
+    MeshFormat::Bounds ComputeBounds(std::span<const MeshFormat::Vertex> vertices, std::span<const uint32_t> indices, int32_t vertexOffset) {
+        return ComputeBoundsImpl([&](auto&& visit) {
+            for (uint32_t index : indices)
+                visit(vertices[vertexOffset + index].position);
+        });
+    }
+
+}
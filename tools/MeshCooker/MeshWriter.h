@@ -0,0 +1,48 @@
+#pragma once
+
+#include <Asset/MeshFormat.h>
+
+#include <cstddef>
+#include <filesystem>
+#include <span>
+#include <vector>
+
+namespace VKRE {
+
+    struct CookedMesh {
+        std::vector<MeshFormat::Submesh> submeshes;
+        std::vector<MeshFormat::Vertex> vertices;
+        std::vector<uint32_t> indices;
+        std::vector<MeshFormat::Meshlet> meshlets;
+        std::vector<uint32_t> meshletVertices;
+        std::vector<uint32_t> meshletTriangles;
+        std::vector<MeshFormat::Lod> lods;
+        std::vector<MeshFormat::LodRange> lodRanges;
+        MeshFormat::Bounds bounds{};
+    };
+
+    class MeshWriter {
+    public:
+        template <typename T> MeshWriter& AddSection(MeshFormat::SectionType type, std::span<const T> elements) {
+            const std::byte* bytes = reinterpret_cast<const std::byte*>(elements.data());
+            mSections.push_back({ type, static_cast<uint32_t>(sizeof(T)), elements.size(), std::vector<std::byte>(bytes, bytes + elements.size_bytes()) });
+            return *this;
+        }
+
+        bool Write(const std::filesystem::path& path, const MeshFormat::Bounds& bounds) const;
+
+    private:
+        struct PendingSection {
+            MeshFormat::SectionType type;
+            uint32_t elementSize;
+            uint64_t elementCount;
+            std::vector<std::byte> data;
+        };
+
+        std::vector<PendingSection> mSections;
+    };
+
+    MeshFormat::Bounds ComputeBounds(std::span<const MeshFormat::Vertex> vertices);
+    MeshFormat::Bounds ComputeBounds(std::span<const MeshFormat::Vertex> vertices, std::span<const uint32_t> indices, int32_t vertexOffset);
+
+}
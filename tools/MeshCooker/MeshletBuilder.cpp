@@ -0,0 +1,223 @@
+#include "MeshletBuilder.h"
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace VKRE {
+
+    namespace {
+
+        constexpr uint8_t NOT_IN_MESHLET = 0xFF;
+
+        // Triangles around each vertex, emitted triangles are swap-removed so the lists only ever hold candidates
+        struct TriangleAdjacency {
+            std::vector<uint32_t> offsets;
+            std::vector<uint32_t> counts;
+            std::vector<uint32_t> triangles;
+
+            TriangleAdjacency(std::span<const uint32_t> indices, uint32_t vertexCount)
+                :offsets(vertexCount, 0), counts(vertexCount, 0), triangles(indices.size()) {
+                for (uint32_t index : indices)
+                    counts[index]++;
+
+                uint32_t offset = 0;
+                for (uint32_t vertex = 0; vertex < vertexCount; vertex++) {
+                    offsets[vertex] = offset;
+                    offset += counts[vertex];
+                    counts[vertex] = 0;
+                }
+
+                for (uint32_t i = 0; i < indices.size(); i++) {
+                    uint32_t vertex = indices[i];
+                    triangles[offsets[vertex] + counts[vertex]++] = i / 3;
+                }
+            }
+
+            std::span<const uint32_t> Get(uint32_t vertex) const { return std::span<const uint32_t>(triangles).subspan(offsets[vertex], counts[vertex]); }
+
+            void Remove(uint32_t vertex, uint32_t triangle) {
+                uint32_t* begin = triangles.data() + offsets[vertex];
+                uint32_t* end = begin + counts[vertex];
+                uint32_t* found = std::find(begin, end, triangle);
+                if (found != end) {
+                    *found = *(end - 1);
+                    counts[vertex]--;
+                }
+            }
+        };
+
+        void ComputeMeshletBounds(MeshFormat::Meshlet& meshlet, std::span<const MeshFormat::Vertex> vertices, const MeshletData& output) {
+            std::span<const uint32_t> meshletVertices = std::span<const uint32_t>(output.vertices).subspan(meshlet.vertexOffset, meshlet.vertexCount);
+            std::span<const uint32_t> meshletTriangles = std::span<const uint32_t>(output.triangles).subspan(meshlet.triangleOffset, meshlet.triangleCount);
+
+            glm::vec3 min(std::numeric_limits<float>::max());
+            glm::vec3 max(std::numeric_limits<float>::lowest());
+            for (uint32_t vertex : meshletVertices) {
+                min = glm::min(min, vertices[vertex].position);
+                max = glm::max(max, vertices[vertex].position);
+            }
+
+            meshlet.center = (min + max) * 0.5f;
+            meshlet.radius = 0.0f;
+            for (uint32_t vertex : meshletVertices)
+                meshlet.radius = std::max(meshlet.radius, glm::length(vertices[vertex].position - meshlet.center));
+
+            std::vector<glm::vec3> normals;
+            normals.reserve(meshletTriangles.size());
+            glm::vec3 normalSum(0.0f);
+            for (uint32_t triangle : meshletTriangles) {
+                const glm::vec3& a = vertices[meshletVertices[triangle & 0xFF]].position;
+                const glm::vec3& b = vertices[meshletVertices[(triangle >> 8) & 0xFF]].position;
+                const glm::vec3& c = vertices[meshletVertices[(triangle >> 16) & 0xFF]].position;
+
+                glm::vec3 normal = glm::cross(b - a, c - a);
+                float length = glm::length(normal);
+                if (length <= 0.0f)
+                    continue;
+
+                normals.push_back(normal / length);
+                normalSum += normals.back();
+            }
+
+            // Disabled until proven otherwise, a cutoff of 1 can never pass the cone test
+            meshlet.coneAxis = glm::vec3(0.0f, 0.0f, 1.0f);
+            meshlet.coneCutoff = 1.0f;
+
+            float sumLength = glm::length(normalSum);
+            if (normals.empty() || sumLength <= 0.0f)
+                return;
+
+            glm::vec3 axis = normalSum / sumLength;
+            float minDot = 1.0f;
+            for (const glm::vec3& normal : normals)
+                minDot = std::min(minDot, glm::dot(axis, normal));
+
+            // Cones wider than ~84 degrees almost never cull anything and only cost the test
+            if (minDot <= 0.1f)
+                return;
+
+            meshlet.coneAxis = axis;
+            meshlet.coneCutoff = std::sqrt(1.0f - minDot * minDot);
+        }
+
+    }
+
+    uint32_t BuildMeshlets(MeshletData& output, std::span<const MeshFormat::Vertex> vertices, std::span<const uint32_t> indices, int32_t vertexOffset) {
+        const uint32_t triangleCount = static_cast<uint32_t>(indices.size() / 3);
+        if (triangleCount == 0)
+            return 0;
+
+        std::span<const MeshFormat::Vertex> submeshVertices = vertices.subspan(vertexOffset);
+        const uint32_t vertexCount = *std::max_element(indices.begin(), indices.end()) + 1;
+
+        TriangleAdjacency adjacency(indices, vertexCount);
+        std::vector<bool> emitted(triangleCount, false);
+        std::vector<uint8_t> localIndices(vertexCount, NOT_IN_MESHLET);
+
+        std::vector<uint32_t> meshletVertices;
+        std::vector<uint32_t> meshletTriangles;
+        glm::vec3 positionSum(0.0f);
+
+        const uint32_t firstMeshlet = static_cast<uint32_t>(output.meshlets.size());
+
+        auto triangleCentroid = [&](uint32_t triangle) {
+            return (submeshVertices[indices[triangle * 3 + 0]].position + submeshVertices[indices[triangle * 3 + 1]].position + submeshVertices[indices[triangle * 3 + 2]].position) / 3.0f;
+        };
+
+        auto newVertexCount = [&](uint32_t triangle) {
+            uint32_t count = 0;
+            for (uint32_t corner = 0; corner < 3; corner++)
+                count += localIndices[indices[triangle * 3 + corner]] == NOT_IN_MESHLET ? 1 : 0;
+            return count;
+        };
+
+        auto flush = [&]() {
+            if (meshletTriangles.empty())
+                return;
+
+            MeshFormat::Meshlet meshlet{};
+            meshlet.vertexOffset = static_cast<uint32_t>(output.vertices.size());
+            meshlet.triangleOffset = static_cast<uint32_t>(output.triangles.size());
+            meshlet.vertexCount = static_cast<uint32_t>(meshletVertices.size());
+            meshlet.triangleCount = static_cast<uint32_t>(meshletTriangles.size());
+
+            for (uint32_t vertex : meshletVertices) {
+                output.vertices.push_back(vertex + static_cast<uint32_t>(vertexOffset));
+                localIndices[vertex] = NOT_IN_MESHLET;
+            }
+            output.triangles.insert(output.triangles.end(), meshletTriangles.begin(), meshletTriangles.end());
+
+            // Bounds are computed from the absolute vertex indices just written
+            ComputeMeshletBounds(meshlet, vertices, output);
+            output.meshlets.push_back(meshlet);
+
+            meshletVertices.clear();
+            meshletTriangles.clear();
+            positionSum = glm::vec3(0.0f);
+        };
+
+        uint32_t scanCursor = 0;
+        while (true) {
+            // Grow from the triangles touching the meshlet, fewest new vertices first, then closest to its centroid
+            uint32_t best = UINT32_MAX;
+            uint32_t bestNewVertices = 4;
+            float bestDistance = std::numeric_limits<float>::max();
+            glm::vec3 centroid = meshletVertices.empty() ? glm::vec3(0.0f) : positionSum / static_cast<float>(meshletVertices.size());
+
+            for (uint32_t vertex : meshletVertices) {
+                for (uint32_t triangle : adjacency.Get(vertex)) {
+                    uint32_t newVertices = newVertexCount(triangle);
+                    if (meshletVertices.size() + newVertices > MeshFormat::MAX_MESHLET_VERTICES)
+                        continue;
+
+                    glm::vec3 offset = triangleCentroid(triangle) - centroid;
+                    float distance = glm::dot(offset, offset);
+                    if (newVertices < bestNewVertices || (newVertices == bestNewVertices && distance < bestDistance)) {
+                        best = triangle;
+                        bestNewVertices = newVertices;
+                        bestDistance = distance;
+                    }
+                }
+            }
+
+            // Nothing connected fits, continue with the next triangle in index order, which the importer already sorted for locality
+            if (best == UINT32_MAX) {
+                while (scanCursor < triangleCount && emitted[scanCursor])
+                    scanCursor++;
+                if (scanCursor == triangleCount)
+                    break;
+
+                best = scanCursor;
+                bestNewVertices = newVertexCount(best);
+            }
+
+            if (meshletVertices.size() + bestNewVertices > MeshFormat::MAX_MESHLET_VERTICES || meshletTriangles.size() == MeshFormat::MAX_MESHLET_TRIANGLES) {
+                flush();
+                continue;
+            }
+
+            uint32_t packed = 0;
+            for (uint32_t corner = 0; corner < 3; corner++) {
+                uint32_t vertex = indices[best * 3 + corner];
+                if (localIndices[vertex] == NOT_IN_MESHLET) {
+                    localIndices[vertex] = static_cast<uint8_t>(meshletVertices.size());
+                    meshletVertices.push_back(vertex);
+                    positionSum += submeshVertices[vertex].position;
+                }
+
+                packed |= static_cast<uint32_t>(localIndices[vertex]) << (corner * 8);
+                adjacency.Remove(vertex, best);
+            }
+
+            meshletTriangles.push_back(packed);
+            emitted[best] = true;
+        }
+
+        flush();
+        return static_cast<uint32_t>(output.meshlets.size()) - firstMeshlet;
+    }
+
+}
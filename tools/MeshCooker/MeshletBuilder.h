@@ -0,0 +1,22 @@
+#pragma once
+
+#include <Asset/MeshFormat.h>
+
+#include <cstdint>
+#include <span>
+#include <vector>
+
+namespace VKRE {
+
+    struct MeshletData {
+        std::vector<MeshFormat::Meshlet> meshlets;
+        std::vector<uint32_t> vertices;  // Absolute indices into the mesh's vertex buffer
+        std::vector<uint32_t> triangles; // Three 8-bit meshlet local indices per triangle
+    };
+
+    // Splits the triangles of one submesh into meshlets and appends them to output. Triangles are grown from the current meshlet's
+    // vertices, preferring those that add the fewest new vertices, so meshlets stay spatially compact and their cones stay narrow.
+    // Returns the number of meshlets appended.
+    uint32_t BuildMeshlets(MeshletData& output, std::span<const MeshFormat::Vertex> vertices, std::span<const uint32_t> indices, int32_t vertexOffset);
+
+}
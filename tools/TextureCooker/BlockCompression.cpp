@@ -0,0 +1,428 @@
+#include "BlockCompression.h"
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define VKRE_BLOCK_COMPRESSION_SSE2
+#include <emmintrin.h>
+#endif
+
+namespace VKRE::BlockCompression {
+
+    namespace {
+
+        constexpr uint32_t MAX_PALETTE_SIZE = 16;
+        const glm::vec4 RGB_CHANNELS = { 1.0f, 1.0f, 1.0f, 0.0f };
+        const glm::vec4 RGBA_CHANNELS = { 1.0f, 1.0f, 1.0f, 1.0f };
+        const glm::vec4 RED_CHANNEL = { 1.0f, 0.0f, 0.0f, 0.0f };
+
+        glm::vec4 GetPixel(const ColorBlock& block, uint32_t i) {
+            return { block.r[i], block.g[i], block.b[i], block.a[i] };
+        }
+
+        // Assigns every pixel to the closest palette entry by weighted squared distance and returns the summed error.
+        // This is where nearly all of the encoding time goes, so the SSE2 path handles four pixels per iteration.
+        float FindNearestIndices(const ColorBlock& block, const glm::vec4* palette, uint32_t paletteSize, const glm::vec4& weights, uint8_t indices[16]) {
+            float totalError = 0.0f;
+
+            #ifdef VKRE_BLOCK_COMPRESSION_SSE2
+            const __m128 weightR = _mm_set1_ps(weights.r);
+            const __m128 weightG = _mm_set1_ps(weights.g);
+            const __m128 weightB = _mm_set1_ps(weights.b);
+            const __m128 weightA = _mm_set1_ps(weights.a);
+
+            for (uint32_t pixel = 0; pixel < 16; pixel += 4) {
+                const __m128 r = _mm_load_ps(block.r + pixel);
+                const __m128 g = _mm_load_ps(block.g + pixel);
+                const __m128 b = _mm_load_ps(block.b + pixel);
+                const __m128 a = _mm_load_ps(block.a + pixel);
+
+                __m128 bestError = _mm_set1_ps(FLT_MAX);
+                __m128i bestIndex = _mm_setzero_si128();
+                for (uint32_t i = 0; i < paletteSize; i++) {
+                    const __m128 dr = _mm_sub_ps(r, _mm_set1_ps(palette[i].r));
+                    const __m128 dg = _mm_sub_ps(g, _mm_set1_ps(palette[i].g));
+                    const __m128 db = _mm_sub_ps(b, _mm_set1_ps(palette[i].b));
+                    const __m128 da = _mm_sub_ps(a, _mm_set1_ps(palette[i].a));
+
+                    const __m128 error = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_mul_ps(dr, dr), weightR), _mm_mul_ps(_mm_mul_ps(dg, dg), weightG)),
+                                                    _mm_add_ps(_mm_mul_ps(_mm_mul_ps(db, db), weightB), _mm_mul_ps(_mm_mul_ps(da, da), weightA)));
+
+                    const __m128i closer = _mm_castps_si128(_mm_cmplt_ps(error, bestError));
+                    bestError = _mm_min_ps(error, bestError);
+                    bestIndex = _mm_or_si128(_mm_and_si128(closer, _mm_set1_epi32(static_cast<int>(i))), _mm_andnot_si128(closer, bestIndex));
+                }
+
+                alignas(16) int32_t laneIndices[4];
+                alignas(16) float laneErrors[4];
+                _mm_store_si128(reinterpret_cast<__m128i*>(laneIndices), bestIndex);
+                _mm_store_ps(laneErrors, bestError);
+                for (uint32_t lane = 0; lane < 4; lane++) {
+                    indices[pixel + lane] = static_cast<uint8_t>(laneIndices[lane]);
+                    totalError += laneErrors[lane];
+                }
+            }
+            #else
+            for (uint32_t pixel = 0; pixel < 16; pixel++) {
+                const glm::vec4 color = GetPixel(block, pixel);
+                float bestError = FLT_MAX;
+                for (uint32_t i = 0; i < paletteSize; i++) {
+                    const glm::vec4 delta = color - palette[i];
+                    const float error = glm::dot(delta * delta, weights);
+                    if (error < bestError) {
+                        bestError = error;
+                        indices[pixel] = static_cast<uint8_t>(i);
+                    }
+                }
+                totalError += bestError;
+            }
+            #endif
+
+            return totalError;
+        }
+
+        // Fits a line through the block with PCA and returns the extremes of the pixels projected onto it
+        void ComputeEndpoints(const ColorBlock& block, const glm::vec4& channels, glm::vec4& low, glm::vec4& high) {
+            glm::vec4 mean(0.0f);
+            glm::vec4 minColor(FLT_MAX);
+            glm::vec4 maxColor(-FLT_MAX);
+            for (uint32_t i = 0; i < 16; i++) {
+                const glm::vec4 color = GetPixel(block, i) * channels;
+                mean += color;
+                minColor = glm::min(minColor, color);
+                maxColor = glm::max(maxColor, color);
+            }
+            mean /= 16.0f;
+
+            glm::mat4 covariance(0.0f);
+            for (uint32_t i = 0; i < 16; i++) {
+                const glm::vec4 delta = GetPixel(block, i) * channels - mean;
+                covariance += glm::outerProduct(delta, delta);
+            }
+
+            // Power iteration, seeded with the bounding box diagonal which is usually close already
+            glm::vec4 axis = maxColor - minColor;
+            if (glm::dot(axis, axis) < 1e-6f) {
+                low = high = mean;
+                return;
+            }
+            for (uint32_t iteration = 0; iteration < 8; iteration++) {
+                glm::vec4 next = covariance * axis;
+                float largest = std::max(std::max(std::abs(next.x), std::abs(next.y)), std::max(std::abs(next.z), std::abs(next.w)));
+                if (largest < 1e-6f)
+                    break;
+                axis = next / largest;
+            }
+            axis = glm::normalize(axis);
+
+            float minProjection = FLT_MAX;
+            float maxProjection = -FLT_MAX;
+            for (uint32_t i = 0; i < 16; i++) {
+                const float projection = glm::dot(GetPixel(block, i) * channels - mean, axis);
+                minProjection = std::min(minProjection, projection);
+                maxProjection = std::max(maxProjection, projection);
+            }
+
+            low = glm::clamp(mean + axis * minProjection, 0.0f, 255.0f);
+            high = glm::clamp(mean + axis * maxProjection, 0.0f, 255.0f);
+        }
+
+        // Least squares fit of both endpoints given fixed indices, where palette entry i is mix(low, high, paletteWeights[i])
+        bool RefineEndpoints(const ColorBlock& block, const uint8_t indices[16], const float* paletteWeights, glm::vec4& low, glm::vec4& high) {
+            float aa = 0.0f, ab = 0.0f, bb = 0.0f;
+            glm::vec4 ax(0.0f), bx(0.0f);
+            for (uint32_t i = 0; i < 16; i++) {
+                const float b = paletteWeights[indices[i]];
+                const float a = 1.0f - b;
+                const glm::vec4 color = GetPixel(block, i);
+                aa += a * a;
+                ab += a * b;
+                bb += b * b;
+                ax += color * a;
+                bx += color * b;
+            }
+
+            const float determinant = aa * bb - ab * ab;
+            if (std::abs(determinant) < 1e-6f)
+                return false;
+
+            low = glm::clamp((ax * bb - bx * ab) / determinant, 0.0f, 255.0f);
+            high = glm::clamp((bx * aa - ax * ab) / determinant, 0.0f, 255.0f);
+            return true;
+        }
+
+        struct BitWriter {
+            uint8_t* output;
+            uint32_t position = 0;
+
+            void Write(uint32_t value, uint32_t bitCount) {
+                for (uint32_t i = 0; i < bitCount; i++, position++) {
+                    if ((value >> i) & 1)
+                        output[position >> 3] |= static_cast<uint8_t>(1 << (position & 7));
+                }
+            }
+        };
+
+        uint16_t PackRGB565(const glm::vec4& color) {
+            uint32_t r = static_cast<uint32_t>(std::lround(std::clamp(color.r, 0.0f, 255.0f) * 31.0f / 255.0f));
+            uint32_t g = static_cast<uint32_t>(std::lround(std::clamp(color.g, 0.0f, 255.0f) * 63.0f / 255.0f));
+            uint32_t b = static_cast<uint32_t>(std::lround(std::clamp(color.b, 0.0f, 255.0f) * 31.0f / 255.0f));
+            return static_cast<uint16_t>((r << 11) | (g << 5) | b);
+        }
+
+        glm::vec4 UnpackRGB565(uint16_t color) {
+            uint32_t r = (color >> 11) & 31;
+            uint32_t g = (color >> 5) & 63;
+            uint32_t b = color & 31;
+            return { static_cast<float>((r << 3) | (r >> 2)), static_cast<float>((g << 2) | (g >> 4)), static_cast<float>((b << 3) | (b >> 2)), 255.0f };
+        }
+
+        // Always produces a four colour block (color0 > color1), which is also the only mode BC3 allows
+        void EncodeColorBlock(const ColorBlock& block, uint8_t* output) {
+            static const float paletteWeights[4] = { 0.0f, 1.0f, 1.0f / 3.0f, 2.0f / 3.0f };
+
+            glm::vec4 low, high;
+            ComputeEndpoints(block, RGB_CHANNELS, low, high);
+
+            float bestError = FLT_MAX;
+            uint16_t bestColor0 = 0, bestColor1 = 0;
+            uint8_t bestIndices[16] = {};
+
+            for (uint32_t iteration = 0; iteration < 2; iteration++) {
+                uint16_t color0 = PackRGB565(high);
+                uint16_t color1 = PackRGB565(low);
+                if (color0 < color1)
+                    std::swap(color0, color1);
+
+                uint8_t indices[16] = {};
+                float error;
+                glm::vec4 palette[4];
+                palette[0] = UnpackRGB565(color0);
+                palette[1] = UnpackRGB565(color1);
+                if (color0 == color1) {
+                    // Would decode as a three colour block, only index 0 is safe
+                    palette[2] = palette[3] = palette[0];
+                    error = FindNearestIndices(block, palette, 1, RGB_CHANNELS, indices);
+                } else {
+                    palette[2] = (palette[0] * 2.0f + palette[1]) / 3.0f;
+                    palette[3] = (palette[0] + palette[1] * 2.0f) / 3.0f;
+                    error = FindNearestIndices(block, palette, 4, RGB_CHANNELS, indices);
+                }
+
+                if (error < bestError) {
+                    bestError = error;
+                    bestColor0 = color0;
+                    bestColor1 = color1;
+                    memcpy(bestIndices, indices, sizeof(indices));
+                }
+
+                if (color0 == color1 || !RefineEndpoints(block, indices, paletteWeights, high, low))
+                    break;
+            }
+
+            uint32_t packedIndices = 0;
+            for (uint32_t i = 0; i < 16; i++) {
+                packedIndices |= static_cast<uint32_t>(bestIndices[i]) << (i * 2);
+            }
+
+            memcpy(output + 0, &bestColor0, sizeof(uint16_t));
+            memcpy(output + 2, &bestColor1, sizeof(uint16_t));
+            memcpy(output + 4, &packedIndices, sizeof(uint32_t));
+        }
+
+        // BC4 block of the given channel, always in eight value mode (endpoint0 > endpoint1)
+        void EncodeSingleChannelBlock(const float* values, uint8_t* output) {
+            ColorBlock channelBlock{};
+            memcpy(channelBlock.r, values, sizeof(channelBlock.r));
+
+            float minValue = 255.0f, maxValue = 0.0f;
+            for (uint32_t i = 0; i < 16; i++) {
+                minValue = std::min(minValue, values[i]);
+                maxValue = std::max(maxValue, values[i]);
+            }
+
+            uint8_t endpoint0 = static_cast<uint8_t>(std::lround(std::clamp(maxValue, 0.0f, 255.0f)));
+            uint8_t endpoint1 = static_cast<uint8_t>(std::lround(std::clamp(minValue, 0.0f, 255.0f)));
+
+            uint8_t indices[16] = {};
+            if (endpoint0 != endpoint1) {
+                glm::vec4 palette[8];
+                palette[0] = glm::vec4(endpoint0, 0.0f, 0.0f, 0.0f);
+                palette[1] = glm::vec4(endpoint1, 0.0f, 0.0f, 0.0f);
+                for (uint32_t i = 2; i < 8; i++) {
+                    palette[i] = glm::vec4(static_cast<float>((8 - i) * endpoint0 + (i - 1) * endpoint1) / 7.0f, 0.0f, 0.0f, 0.0f);
+                }
+                FindNearestIndices(channelBlock, palette, 8, RED_CHANNEL, indices);
+            }
+
+            memset(output, 0, 8);
+            output[0] = endpoint0;
+            output[1] = endpoint1;
+            BitWriter writer{ output + 2 };
+            for (uint32_t i = 0; i < 16; i++) {
+                writer.Write(indices[i], 3);
+            }
+        }
+
+        // BC7 mode 6: one subset, RGBA endpoints with 7 bits per channel plus a shared p-bit per endpoint, 4 bit indices
+        struct Mode6Endpoint {
+            uint32_t channels[4]; // 7 bits each
+            uint32_t pBit;
+
+            glm::vec4 Decode() const {
+                return { static_cast<float>((channels[0] << 1) | pBit), static_cast<float>((channels[1] << 1) | pBit),
+                         static_cast<float>((channels[2] << 1) | pBit), static_cast<float>((channels[3] << 1) | pBit) };
+            }
+        };
+
+        Mode6Endpoint QuantizeMode6Endpoint(const glm::vec4& color) {
+            Mode6Endpoint best{};
+            float bestError = FLT_MAX;
+            for (uint32_t pBit = 0; pBit < 2; pBit++) {
+                Mode6Endpoint candidate{};
+                candidate.pBit = pBit;
+                for (uint32_t c = 0; c < 4; c++) {
+                    candidate.channels[c] = static_cast<uint32_t>(std::clamp(std::lround((color[c] - static_cast<float>(pBit)) * 0.5f), 0l, 127l));
+                }
+
+                const glm::vec4 delta = candidate.Decode() - color;
+                const float error = glm::dot(delta, delta);
+                if (error < bestError) {
+                    bestError = error;
+                    best = candidate;
+                }
+            }
+            return best;
+        }
+
+    }
+
+    void EncodeBC1(const ColorBlock& block, uint8_t* output) {
+        EncodeColorBlock(block, output);
+    }
+
+    void EncodeBC3(const ColorBlock& block, uint8_t* output) {
+        EncodeSingleChannelBlock(block.a, output);
+        EncodeColorBlock(block, output + 8);
+    }
+
+    void EncodeBC4(const ColorBlock& block, uint8_t* output) {
+        EncodeSingleChannelBlock(block.r, output);
+    }
+
+    void EncodeBC5(const ColorBlock& block, uint8_t* output) {
+        EncodeSingleChannelBlock(block.r, output);
+        EncodeSingleChannelBlock(block.g, output + 8);
+    }
+
+    void EncodeBC7(const ColorBlock& block, uint8_t* output) {
+        static const uint32_t interpolationWeights[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+        static const float paletteWeights[16] = { 0.0f / 64, 4.0f / 64, 9.0f / 64, 13.0f / 64, 17.0f / 64, 21.0f / 64, 26.0f / 64, 30.0f / 64,
+                                                  34.0f / 64, 38.0f / 64, 43.0f / 64, 47.0f / 64, 51.0f / 64, 55.0f / 64, 60.0f / 64, 64.0f / 64 };
+
+        glm::vec4 low, high;
+        ComputeEndpoints(block, RGBA_CHANNELS, low, high);
+
+        float bestError = FLT_MAX;
+        Mode6Endpoint bestEndpoints[2] = {};
+        uint8_t bestIndices[16] = {};
+
+        for (uint32_t iteration = 0; iteration < 2; iteration++) {
+            Mode6Endpoint endpoints[2] = { QuantizeMode6Endpoint(low), QuantizeMode6Endpoint(high) };
+            const glm::vec4 decoded0 = endpoints[0].Decode();
+            const glm::vec4 decoded1 = endpoints[1].Decode();
+
+            glm::vec4 palette[MAX_PALETTE_SIZE];
+            for (uint32_t i = 0; i < 16; i++) {
+                const uint32_t weight = interpolationWeights[i];
+                for (uint32_t c = 0; c < 4; c++) {
+                    palette[i][c] = static_cast<float>(((64 - weight) * static_cast<uint32_t>(decoded0[c]) + weight * static_cast<uint32_t>(decoded1[c]) + 32) >> 6);
+                }
+            }
+
+            uint8_t indices[16];
+            const float error = FindNearestIndices(block, palette, 16, RGBA_CHANNELS, indices);
+            if (error < bestError) {
+                bestError = error;
+                bestEndpoints[0] = endpoints[0];
+                bestEndpoints[1] = endpoints[1];
+                memcpy(bestIndices, indices, sizeof(indices));
+            }
+
+            if (!RefineEndpoints(block, indices, paletteWeights, low, high))
+                break;
+        }
+
+        // The anchor (first) index is stored without its top bit, so it has to be in the lower half of the palette
+        if (bestIndices[0] & 8) {
+            std::swap(bestEndpoints[0], bestEndpoints[1]);
+            for (auto& index : bestIndices) {
+                index = static_cast<uint8_t>(15 - index);
+            }
+        }
+
+        memset(output, 0, 16);
+        BitWriter writer{ output };
+        writer.Write(1 << 6, 7); // Mode 6
+        for (uint32_t c = 0; c < 4; c++) {
+            writer.Write(bestEndpoints[0].channels[c], 7);
+            writer.Write(bestEndpoints[1].channels[c], 7);
+        }
+        writer.Write(bestEndpoints[0].pBit, 1);
+        writer.Write(bestEndpoints[1].pBit, 1);
+        writer.Write(bestIndices[0], 3);
+        for (uint32_t i = 1; i < 16; i++) {
+            writer.Write(bestIndices[i], 4);
+        }
+    }
+
+    std::vector<std::byte> EncodeImage(TextureFormat::PixelFormat format, uint32_t width, uint32_t height, const uint8_t* rgba, JobSystem& jobSystem) {
+        std::vector<std::byte> output(TextureFormat::GetMipSize(format, width, height));
+        if (!TextureFormat::IsBlockCompressed(format)) {
+            memcpy(output.data(), rgba, output.size());
+            return output;
+        }
+
+        const uint32_t blockSize = TextureFormat::GetBlockSize(format);
+        const uint32_t blocksX = (width + 3) / 4;
+        const uint32_t blocksY = (height + 3) / 4;
+
+        jobSystem.ParallelFor(blocksY, 4, [&](uint32_t begin, uint32_t end) {
+            for (uint32_t blockY = begin; blockY < end; blockY++) {
+                for (uint32_t blockX = 0; blockX < blocksX; blockX++) {
+                    // Blocks hanging over the edge of the image repeat the last row/column
+                    ColorBlock block;
+                    for (uint32_t y = 0; y < 4; y++) {
+                        for (uint32_t x = 0; x < 4; x++) {
+                            const uint32_t sourceX = std::min(blockX * 4 + x, width - 1);
+                            const uint32_t sourceY = std::min(blockY * 4 + y, height - 1);
+                            const uint8_t* pixel = rgba + (static_cast<size_t>(sourceY) * width + sourceX) * 4;
+                            block.r[y * 4 + x] = pixel[0];
+                            block.g[y * 4 + x] = pixel[1];
+                            block.b[y * 4 + x] = pixel[2];
+                            block.a[y * 4 + x] = pixel[3];
+                        }
+                    }
+
+                    uint8_t* destination = reinterpret_cast<uint8_t*>(output.data()) + (static_cast<size_t>(blockY) * blocksX + blockX) * blockSize;
+                    switch (format) {
+                        case TextureFormat::PixelFormat::BC1: EncodeBC1(block, destination); break;
+                        case TextureFormat::PixelFormat::BC3: EncodeBC3(block, destination); break;
+                        case TextureFormat::PixelFormat::BC4: EncodeBC4(block, destination); break;
+                        case TextureFormat::PixelFormat::BC5: EncodeBC5(block, destination); break;
+                        case TextureFormat::PixelFormat::BC7: EncodeBC7(block, destination); break;
+                        case TextureFormat::PixelFormat::RGBA8: break;
+                    }
+                }
+            }
+        });
+
+        return output;
+    }
+
+}
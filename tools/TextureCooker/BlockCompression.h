@@ -0,0 +1,33 @@
+#pragma once
+
+#include <Asset/TextureFormat.h>
+#include <Core/JobSystem.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace VKRE {
+
+    // One 4x4 block in structure-of-arrays form, channels in [0, 255], pixels in row-major order
+    struct alignas(16) ColorBlock {
+        float r[16];
+        float g[16];
+        float b[16];
+        float a[16];
+    };
+
+    namespace BlockCompression {
+
+        void EncodeBC1(const ColorBlock& block, uint8_t* output);
+        void EncodeBC3(const ColorBlock& block, uint8_t* output);
+        void EncodeBC4(const ColorBlock& block, uint8_t* output); // Encodes the red channel
+        void EncodeBC5(const ColorBlock& block, uint8_t* output); // Encodes the red and green channels
+        void EncodeBC7(const ColorBlock& block, uint8_t* output);
+
+        // Encodes a whole RGBA8 image, block rows are spread over the job system
+        std::vector<std::byte> EncodeImage(TextureFormat::PixelFormat format, uint32_t width, uint32_t height, const uint8_t* rgba, JobSystem& jobSystem);
+
+    }
+
+}
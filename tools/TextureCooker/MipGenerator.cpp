@@ -0,0 +1,91 @@
+#include "MipGenerator.h"
+
+#include <Asset/TextureFormat.h>
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+
+namespace VKRE {
+
+    namespace {
+
+        float SRGBToLinear(float value) {
+            return value <= 0.04045f ? value / 12.92f : std::pow((value + 0.055f) / 1.055f, 2.4f);
+        }
+
+        float LinearToSRGB(float value) {
+            return value <= 0.0031308f ? value * 12.92f : 1.055f * std::pow(value, 1.0f / 2.4f) - 0.055f;
+        }
+
+        const std::array<float, 256>& GetSRGBToLinearTable() {
+            static const std::array<float, 256> table = []() {
+                std::array<float, 256> values{};
+                for (uint32_t i = 0; i < 256; i++) {
+                    values[i] = SRGBToLinear(static_cast<float>(i) / 255.0f);
+                }
+                return values;
+            }();
+            return table;
+        }
+
+        uint8_t ToUnorm8(float value) {
+            return static_cast<uint8_t>(std::lround(std::clamp(value, 0.0f, 1.0f) * 255.0f));
+        }
+
+        MipImage Downsample(const MipImage& source, bool srgb, JobSystem& jobSystem) {
+            const std::array<float, 256>& toLinear = GetSRGBToLinearTable();
+
+            MipImage mip;
+            mip.width = std::max(source.width / 2, 1u);
+            mip.height = std::max(source.height / 2, 1u);
+            mip.rgba.resize(static_cast<size_t>(mip.width) * mip.height * 4);
+
+            jobSystem.ParallelFor(mip.height, 16, [&](uint32_t begin, uint32_t end) {
+                for (uint32_t y = begin; y < end; y++) {
+                    const uint32_t y0 = std::min(y * 2, source.height - 1);
+                    const uint32_t y1 = std::min(y * 2 + 1, source.height - 1);
+                    for (uint32_t x = 0; x < mip.width; x++) {
+                        const uint32_t x0 = std::min(x * 2, source.width - 1);
+                        const uint32_t x1 = std::min(x * 2 + 1, source.width - 1);
+                        const uint8_t* taps[4] = {
+                            &source.rgba[(static_cast<size_t>(y0) * source.width + x0) * 4],
+                            &source.rgba[(static_cast<size_t>(y0) * source.width + x1) * 4],
+                            &source.rgba[(static_cast<size_t>(y1) * source.width + x0) * 4],
+                            &source.rgba[(static_cast<size_t>(y1) * source.width + x1) * 4],
+                        };
+
+                        uint8_t* destination = &mip.rgba[(static_cast<size_t>(y) * mip.width + x) * 4];
+                        for (uint32_t c = 0; c < 4; c++) {
+                            // Alpha is always linear
+                            if (srgb && c < 3) {
+                                float sum = toLinear[taps[0][c]] + toLinear[taps[1][c]] + toLinear[taps[2][c]] + toLinear[taps[3][c]];
+                                destination[c] = ToUnorm8(LinearToSRGB(sum * 0.25f));
+                            } else {
+                                uint32_t sum = taps[0][c] + taps[1][c] + taps[2][c] + taps[3][c];
+                                destination[c] = static_cast<uint8_t>((sum + 2) / 4);
+                            }
+                        }
+                    }
+                }
+            });
+
+            return mip;
+        }
+
+    }
+
+    std::vector<MipImage> GenerateMipChain(uint32_t width, uint32_t height, const uint8_t* rgba, bool srgb, uint32_t maxMipCount, JobSystem& jobSystem) {
+        const uint32_t mipCount = std::clamp(maxMipCount, 1u, TextureFormat::GetMaxMipCount(width, height));
+
+        std::vector<MipImage> chain;
+        chain.reserve(mipCount);
+        chain.push_back({ width, height, std::vector<uint8_t>(rgba, rgba + static_cast<size_t>(width) * height * 4) });
+        while (chain.size() < mipCount) {
+            chain.push_back(Downsample(chain.back(), srgb, jobSystem));
+        }
+
+        return chain;
+    }
+
+}
@@ -0,0 +1,20 @@
+#pragma once
+
+#include <Core/JobSystem.h>
+
+#include <cstdint>
+#include <vector>
+
+namespace VKRE {
+
+    struct MipImage {
+        uint32_t width = 0;
+        uint32_t height = 0;
+        std::vector<uint8_t> rgba;
+    };
+
+    // Builds the full chain down to 1x1 with a 2x2 box filter, averaging in linear space when the source is sRGB.
+    // The first entry is a copy of the source image.
+    std::vector<MipImage> GenerateMipChain(uint32_t width, uint32_t height, const uint8_t* rgba, bool srgb, uint32_t maxMipCount, JobSystem& jobSystem);
+
+}
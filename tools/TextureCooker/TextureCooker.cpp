@@ -0,0 +1,123 @@
+#include "BlockCompression.h"
+#include "MipGenerator.h"
+
+#include <Asset/ImageAsset.h>
+#include <Asset/TextureFormat.h>
+#include <Core/JobSystem.h>
+
+#include <filesystem>
+#include <fstream>
+#include <optional>
+#include <print>
+#include <string_view>
+#include <vector>
+
+namespace VKRE {
+
+    struct TextureCookOptions {
+        TextureFormat::PixelFormat format = TextureFormat::PixelFormat::BC7;
+        bool srgb = false;
+        uint32_t maxMipCount = UINT32_MAX;
+    };
+
+    std::optional<TextureFormat::PixelFormat> ParsePixelFormat(std::string_view name) {
+        if (name == "rgba8") return TextureFormat::PixelFormat::RGBA8;
+        if (name == "bc1") return TextureFormat::PixelFormat::BC1;
+        if (name == "bc3") return TextureFormat::PixelFormat::BC3;
+        if (name == "bc4") return TextureFormat::PixelFormat::BC4;
+        if (name == "bc5") return TextureFormat::PixelFormat::BC5;
+        if (name == "bc7") return TextureFormat::PixelFormat::BC7;
+        return std::nullopt;
+    }
+
+    bool WriteTexture(const std::filesystem::path& path, const TextureCookOptions& options, const std::vector<MipImage>& chain, const std::vector<std::vector<std::byte>>& encodedMips) {
+        TextureFormat::FileHeader header{};
+        header.magic = TextureFormat::TEXTURE_FILE_MAGIC;
+        header.version = TextureFormat::TEXTURE_FILE_VERSION;
+        header.format = options.format;
+        header.flags = options.srgb ? static_cast<uint32_t>(TextureFormat::TEXTURE_FLAG_SRGB) : 0u;
+        header.width = chain.front().width;
+        header.height = chain.front().height;
+        header.mipCount = static_cast<uint32_t>(chain.size());
+
+        std::vector<TextureFormat::MipLevel> mipTable;
+        uint64_t offset = TextureFormat::AlignDataOffset(sizeof(TextureFormat::FileHeader) + chain.size() * sizeof(TextureFormat::MipLevel));
+        for (size_t i = 0; i < chain.size(); i++) {
+            mipTable.push_back({ chain[i].width, chain[i].height, offset, encodedMips[i].size() });
+            offset = TextureFormat::AlignDataOffset(offset + encodedMips[i].size());
+        }
+
+        std::ofstream file(path, std::ios::binary | std::ios::trunc);
+        if (!file)
+            return false;
+
+        file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        file.write(reinterpret_cast<const char*>(mipTable.data()), static_cast<std::streamsize>(mipTable.size() * sizeof(TextureFormat::MipLevel)));
+        for (size_t i = 0; i < chain.size(); i++) {
+            static const char zeros[TextureFormat::TEXTURE_DATA_ALIGNMENT] = {};
+            file.write(zeros, static_cast<std::streamsize>(mipTable[i].offset - static_cast<uint64_t>(file.tellp())));
+            file.write(reinterpret_cast<const char*>(encodedMips[i].data()), static_cast<std::streamsize>(encodedMips[i].size()));
+        }
+
+        return static_cast<bool>(file);
+    }
+
+    bool CookTexture(const std::filesystem::path& input, const std::filesystem::path& output, const TextureCookOptions& options, JobSystem& jobSystem) {
+        std::optional<DecodedImage> image = DecodeImage(input);
+        if (!image.has_value())
+            return false;
+
+        std::vector<MipImage> chain = GenerateMipChain(image->width, image->height, image->pixels.get(), options.srgb, options.maxMipCount, jobSystem);
+
+        std::vector<std::vector<std::byte>> encodedMips;
+        encodedMips.reserve(chain.size());
+        for (const auto& mip : chain) {
+            encodedMips.push_back(BlockCompression::EncodeImage(options.format, mip.width, mip.height, mip.rgba.data(), jobSystem));
+        }
+
+        if (!WriteTexture(output, options, chain, encodedMips)) {
+            std::println("Failed to write {}", output.string());
+            return false;
+        }
+
+        std::println("Cooked {} -> {} ({}x{}, {} mips)", input.string(), output.string(), image->width, image->height, chain.size());
+        return true;
+    }
+
+}
+
+int main(int argc, char** argv) {
+    VKRE::TextureCookOptions options;
+    std::vector<std::string_view> positional;
+
+    for (int i = 1; i < argc; i++) {
+        std::string_view argument = argv[i];
+        if (argument == "--format" && i + 1 < argc) {
+            std::optional<VKRE::TextureFormat::PixelFormat> format = VKRE::ParsePixelFormat(argv[++i]);
+            if (!format.has_value()) {
+                std::println("Unknown format {}", argv[i]);
+                return 1;
+            }
+            options.format = format.value();
+        } else if (argument == "--srgb") {
+            options.srgb = true;
+        } else if (argument == "--no-mips") {
+            options.maxMipCount = 1;
+        } else {
+            positional.push_back(argument);
+        }
+    }
+
+    if (positional.size() != 2) {
+        std::println("Usage: {} [--format rgba8|bc1|bc3|bc4|bc5|bc7] [--srgb] [--no-mips] <source image> <output.vktex>", argv[0]);
+        return 1;
+    }
+
+    if (options.srgb && (options.format == VKRE::TextureFormat::PixelFormat::BC4 || options.format == VKRE::TextureFormat::PixelFormat::BC5)) {
+        std::println("BC4 and BC5 store linear data, --srgb can't be used with them");
+        return 1;
+    }
+
+    VKRE::JobSystem jobSystem;
+    return VKRE::CookTexture(positional[0], positional[1], options, jobSystem) ? 0 : 1;
+}